@@ -0,0 +1,97 @@
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "assets/baked_mesh.hpp"
+#include "assets/baked_texture.hpp"
+#include "assets/mip_generator.hpp"
+#include "assets/texture_format.hpp"
+#include "fmt/format.h"
+#include "image_loader.hpp"
+#include "scene/scene_geometry.hpp"
+#include "spdlog/spdlog.h"
+
+// Converts source content into the formats the application loads at runtime.
+// The build runs it once per file, so only changed sources are baked again:
+//   vulkan_tutorial_baker mesh <model.obj|model.glb> <out.mesh>
+//   vulkan_tutorial_baker texture <image.png|image.jpg> <out.tex>
+
+// raw data size over the size of the whole baked file
+static double GetCompressionRatio(size_t raw_size,
+                                  const std::filesystem::path& output) {
+  return static_cast<double>(raw_size) /
+         static_cast<double>(std::filesystem::file_size(output));
+}
+
+static void BakeMesh(const std::filesystem::path& input,
+                     const std::filesystem::path& output) {
+  SceneGeometry geometry;
+  const std::array mesh_files{input};
+  LoadSceneMeshes(mesh_files, geometry, nullptr);
+  WriteBakedMesh(output, geometry);
+  const size_t raw_size = geometry.GetVertices().size() * sizeof(Vertex) +
+                          geometry.GetIndices().size() * sizeof(ui32);
+  spdlog::info("{}: {} meshes, {} vertices, {} indices, ratio {:.2f}",
+               output.string(), geometry.GetMeshes().size(),
+               geometry.GetVertices().size(), geometry.GetIndices().size(),
+               GetCompressionRatio(raw_size, output));
+}
+
+static void BakeTexture(const std::filesystem::path& input,
+                        const std::filesystem::path& output) {
+  const ImageLoader image(input.string());
+  const PixelLayout layout = image.GetLayout();
+  std::vector<TextureMip> mips;
+  std::vector<ui8> levels = GenerateMipChain(
+      image.GetWidth(), image.GetHeight(), layout, image.GetData(), mips);
+
+  // mips are filtered at full precision before the texels are narrowed
+  const TextureFormat format = GetTextureFormat(layout);
+  if (format.layout != layout) {
+    levels = ConvertMipChain(levels, mips, layout, format.layout);
+  }
+
+  BakedTexture::Write(output, format.format, mips, levels);
+  spdlog::info("{}: {}x{}, {} channels, format {}, {} mips, ratio {:.2f}",
+               output.string(), image.GetWidth(), image.GetHeight(),
+               layout.channels, static_cast<int>(format.format), mips.size(),
+               GetCompressionRatio(levels.size(), output));
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path output;
+  try {
+    [[unlikely]] if (argc != 4) {
+      throw std::runtime_error(
+          "usage: vulkan_tutorial_baker <mesh|texture> <input> <output>");
+    }
+
+    const std::string_view kind = argv[1];
+    const std::filesystem::path input = argv[2];
+    output = argv[3];
+    if (output.has_parent_path()) {
+      std::filesystem::create_directories(output.parent_path());
+    }
+
+    if (kind == "mesh") {
+      BakeMesh(input, output);
+    } else if (kind == "texture") {
+      BakeTexture(input, output);
+    } else {
+      throw std::runtime_error(fmt::format("unknown asset kind {}", kind));
+    }
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception& e) {
+    // partial output would look up to date to the build
+    if (!output.empty()) {
+      std::error_code error;
+      std::filesystem::remove(output, error);
+    }
+    spdlog::critical("Unhandled exception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,88 @@
+#include "benchmark_runner.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+BenchmarkRunner::BenchmarkRunner(BenchmarkSettings settings)
+    : settings_(std::move(settings)) {}
+
+bool BenchmarkRunner::IsEnabled(std::string_view name) const noexcept {
+  return name.find(settings_.filter) != std::string_view::npos;
+}
+
+void BenchmarkRunner::Run(std::string_view name, size_t input_size,
+                          size_t bytes_per_iteration,
+                          const std::function<void()>& iteration) {
+  if (!IsEnabled(name)) {
+    return;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  // the first call warms up caches and lazy initialization
+  iteration();
+
+  std::vector<double> samples;
+  std::chrono::nanoseconds total{0};
+  while (samples.size() < settings_.max_iterations &&
+         (samples.size() < settings_.min_iterations ||
+          total < settings_.min_time)) {
+    const auto start = Clock::now();
+    iteration();
+    const auto duration = Clock::now() - start;
+    total += duration;
+    samples.push_back(static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count()));
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  BenchmarkResult result;
+  result.name = name;
+  result.input_size = input_size;
+  result.iterations = samples.size();
+  result.min = samples.front();
+  result.median = samples[samples.size() / 2];
+  result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+                static_cast<double>(samples.size());
+  result.max = samples.back();
+  if (bytes_per_iteration != 0 && result.median > 0.0) {
+    result.bytes_per_second =
+        static_cast<double>(bytes_per_iteration) * 1e9 / result.median;
+  }
+
+  spdlog::info("{}/{}: median {:.0f} ns over {} iterations", result.name,
+               result.input_size, result.median, result.iterations);
+  results_.push_back(std::move(result));
+}
+
+void BenchmarkRunner::PrintTable() const {
+  fmt::print("{:<36} {:>10} {:>8} {:>14} {:>14} {:>14} {:>10}\n", "name",
+             "input", "iters", "min ns", "median ns", "mean ns", "MiB/s");
+  for (const BenchmarkResult& result : results_) {
+    fmt::print("{:<36} {:>10} {:>8} {:>14.0f} {:>14.0f} {:>14.0f} {:>10.1f}\n",
+               result.name, result.input_size, result.iterations, result.min,
+               result.median, result.mean,
+               result.bytes_per_second / (1024.0 * 1024.0));
+  }
+}
+
+void BenchmarkRunner::WriteJson(std::ostream& stream) const {
+  stream << "{\n  \"benchmarks\": [";
+  for (size_t i = 0; i != results_.size(); ++i) {
+    const BenchmarkResult& result = results_[i];
+    stream << fmt::format(
+        "{}\n    {{\"name\": \"{}\", \"input_size\": {}, \"iterations\": {}, "
+        "\"min_ns\": {:.1f}, \"median_ns\": {:.1f}, \"mean_ns\": {:.1f}, "
+        "\"max_ns\": {:.1f}, \"bytes_per_second\": {:.1f}}}",
+        i == 0 ? "" : ",", result.name, result.input_size, result.iterations,
+        result.min, result.median, result.mean, result.max,
+        result.bytes_per_second);
+  }
+  stream << "\n  ]\n}\n";
+}
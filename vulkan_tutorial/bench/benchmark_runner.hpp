@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct BenchmarkSettings {
+  // each benchmark runs at least this long and at least `min_iterations`
+  std::chrono::nanoseconds min_time = std::chrono::milliseconds(200);
+  size_t min_iterations = 3;
+  size_t max_iterations = 100000;
+  // only benchmarks which names contain this string are run
+  std::string filter;
+};
+
+// all durations are nanoseconds per iteration
+struct BenchmarkResult {
+  std::string name;
+  // size of the synthetic input, its meaning depends on the benchmark
+  size_t input_size = 0;
+  size_t iterations = 0;
+  double min = 0.0;
+  double median = 0.0;
+  double mean = 0.0;
+  double max = 0.0;
+  // zero when the benchmark doesn't report processed bytes
+  double bytes_per_second = 0.0;
+};
+
+class BenchmarkRunner {
+ public:
+  explicit BenchmarkRunner(BenchmarkSettings settings);
+
+  // Calls `iteration` repeatedly and records time of every call. Skipped if
+  // the name does not pass the filter
+  void Run(std::string_view name, size_t input_size,
+           size_t bytes_per_iteration, const std::function<void()>& iteration);
+
+  [[nodiscard]] bool IsEnabled(std::string_view name) const noexcept;
+  [[nodiscard]] const std::vector<BenchmarkResult>& GetResults()
+      const noexcept {
+    return results_;
+  }
+
+  void PrintTable() const;
+  void WriteJson(std::ostream& stream) const;
+
+ private:
+  BenchmarkSettings settings_;
+  std::vector<BenchmarkResult> results_;
+};
+
+// keeps the compiler from optimizing away computations which result is unused
+template <typename T>
+inline void DoNotOptimize(const T& value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink = nullptr;
+  sink = &value;
+#endif
+}
@@ -0,0 +1,434 @@
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assets/baked_mesh.hpp"
+#include "assets/baked_texture.hpp"
+#include "assets/mip_generator.hpp"
+#include "benchmark_runner.hpp"
+#include "fmt/format.h"
+#include "image_loader.hpp"
+#include "image_writer.hpp"
+#include "integer.hpp"
+#include "io/file_reader.hpp"
+#include "model_loader.hpp"
+#include "physical_device_info.hpp"
+#include "pipeline/uniform_buffer_object.hpp"
+#include "read_file.hpp"
+#include "scene/scene_geometry.hpp"
+#include "spdlog/spdlog.h"
+#include "threading/thread_pool.hpp"
+
+// Synthetic inputs are generated into a temporary directory so that every
+// benchmark can be measured at several sizes and show how it scales
+
+static void WriteTextFile(const std::filesystem::path& path,
+                          const std::string& text) {
+  std::ofstream file(path, std::ios::binary);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+  file << text;
+}
+
+// grid of size x size quads, two triangles each, all vertices are shared
+static void WriteGridObj(const std::filesystem::path& path, ui32 size) {
+  std::string text;
+  for (ui32 y = 0; y <= size; ++y) {
+    for (ui32 x = 0; x <= size; ++x) {
+      text += fmt::format("v {} {} 0\n", x, y);
+    }
+  }
+
+  const float step = 1.0f / static_cast<float>(size);
+  for (ui32 y = 0; y <= size; ++y) {
+    for (ui32 x = 0; x <= size; ++x) {
+      text += fmt::format("vt {} {}\n", static_cast<float>(x) * step,
+                          static_cast<float>(y) * step);
+    }
+  }
+
+  for (ui32 y = 0; y != size; ++y) {
+    for (ui32 x = 0; x != size; ++x) {
+      // obj indices start from one
+      const ui32 a = y * (size + 1) + x + 1;
+      const ui32 b = a + 1;
+      const ui32 c = a + size + 1;
+      const ui32 d = c + 1;
+      text += fmt::format("f {0}/{0} {1}/{1} {2}/{2}\n", a, b, d);
+      text += fmt::format("f {0}/{0} {1}/{1} {2}/{2}\n", a, d, c);
+    }
+  }
+
+  WriteTextFile(path, text);
+}
+
+// gradient with noise so that the encoder can't collapse it
+static void WriteNoisePng(const std::filesystem::path& path, ui32 size) {
+  std::minstd_rand random(size);
+  std::vector<ui8> pixels(size_t{size} * size * 4);
+  for (size_t i = 0; i != pixels.size(); i += 4) {
+    const size_t x = (i / 4) % size;
+    const size_t y = (i / 4) / size;
+    pixels[i + 0] = static_cast<ui8>(x * 255 / size);
+    pixels[i + 1] = static_cast<ui8>(y * 255 / size);
+    pixels[i + 2] = static_cast<ui8>(random());
+    pixels[i + 3] = 255;
+  }
+
+  WritePng(path, size, size, pixels);
+}
+
+static void WriteRandomFile(const std::filesystem::path& path, size_t size) {
+  std::minstd_rand random(static_cast<ui32>(size));
+  std::string bytes(size, '\0');
+  for (char& byte : bytes) {
+    byte = static_cast<char>(random());
+  }
+
+  WriteTextFile(path, bytes);
+}
+
+static void BenchmarkModelLoading(BenchmarkRunner& runner,
+                                  const std::filesystem::path& content_dir,
+                                  const std::filesystem::path& temp_dir) {
+  auto run = [&](std::string_view name, const std::filesystem::path& path,
+                 size_t input_size) {
+    runner.Run(name, input_size, std::filesystem::file_size(path), [&] {
+      std::vector<Vertex> vertices;
+      std::vector<ui32> indices;
+      LoadObjModel(path, vertices, indices);
+      DoNotOptimize(vertices.data());
+      DoNotOptimize(indices.data());
+    });
+  };
+
+  const std::filesystem::path model_path =
+      content_dir / "models" / "viking_room.obj";
+  run("load_obj/viking_room", model_path,
+      std::filesystem::file_size(model_path));
+
+  // input size is the number of triangles
+  for (ui32 size : {16u, 64u, 256u}) {
+    if (!runner.IsEnabled("load_obj/grid")) {
+      break;
+    }
+
+    const auto path = temp_dir / fmt::format("grid_{}.obj", size);
+    WriteGridObj(path, size);
+    run("load_obj/grid", path, size_t{size} * size * 2);
+  }
+}
+
+static void BenchmarkImageLoading(BenchmarkRunner& runner,
+                                  const std::filesystem::path& content_dir,
+                                  const std::filesystem::path& temp_dir) {
+  auto run = [&](std::string_view name, const std::filesystem::path& path,
+                 size_t input_size) {
+    const std::string path_string = path.string();
+    runner.Run(name, input_size, std::filesystem::file_size(path), [&] {
+      ImageLoader image(path_string);
+      DoNotOptimize(image.GetData().data());
+    });
+  };
+
+  for (std::string_view file_name : {"viking_room.png", "statue.jpg"}) {
+    const std::filesystem::path path = content_dir / "textures" / file_name;
+    run(fmt::format("load_image/{}", file_name), path,
+        std::filesystem::file_size(path));
+  }
+
+  // input size is the image side in pixels
+  for (ui32 size : {256u, 1024u, 2048u}) {
+    if (!runner.IsEnabled("load_image/noise_png")) {
+      break;
+    }
+
+    const auto path = temp_dir / fmt::format("noise_{}.png", size);
+    WriteNoisePng(path, size);
+    run("load_image/noise_png", path, size);
+  }
+}
+
+// Same content as the importers above after the build baked it. Blocks are
+// decoded on the calling thread and together with a pool
+static void BenchmarkBakedLoading(BenchmarkRunner& runner,
+                                  const std::filesystem::path& content_dir) {
+  // loads log every decoded asset
+  spdlog::set_level(spdlog::level::warn);
+  ThreadPool thread_pool;
+  const std::filesystem::path mesh_path =
+      content_dir / "models" / "viking_room.mesh";
+  const size_t mesh_size = std::filesystem::file_size(mesh_path);
+  for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+    runner.Run(pool ? "load_baked_mesh/viking_room_pool"
+                    : "load_baked_mesh/viking_room",
+               mesh_size, mesh_size, [&] {
+                 SceneGeometry geometry;
+                 LoadBakedMesh(mesh_path, geometry, pool);
+                 DoNotOptimize(geometry.GetVertices().data());
+               });
+  }
+
+  for (std::string_view file_name : {"viking_room.tex", "statue.tex"}) {
+    const std::filesystem::path path = content_dir / "textures" / file_name;
+    const size_t size = std::filesystem::file_size(path);
+    for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+      runner.Run(fmt::format("load_baked_texture/{}{}", file_name,
+                             pool ? "_pool" : ""),
+                 size, size, [&] {
+                   // decode all levels like an upload would
+                   const BakedTexture texture(path);
+                   std::vector<ui8> levels(texture.GetLevelsSize());
+                   texture.ReadLevels(0, levels, pool);
+                   DoNotOptimize(levels.data());
+                 });
+    }
+  }
+  spdlog::set_level(spdlog::level::info);
+}
+
+// Quality tiers reduce decoded images instead of building the whole chain,
+// both are measured on random RGBA images
+static void BenchmarkMipGeneration(BenchmarkRunner& runner) {
+  // input size is the image side in pixels
+  for (ui32 size : {256u, 1024u, 2048u}) {
+    if (!runner.IsEnabled("reduce_image") &&
+        !runner.IsEnabled("generate_mip_chain")) {
+      break;
+    }
+
+    std::vector<ui8> pixels(size_t{size} * size * 4);
+    std::mt19937 random(size);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (ui8& value : pixels) {
+      value = static_cast<ui8>(distribution(random));
+    }
+
+    const PixelLayout layout{4, PixelComponent::kUnorm8};
+    runner.Run("reduce_image/rgba8", size, pixels.size(), [&] {
+      TextureMip reduced;
+      const std::vector<ui8> result =
+          ReduceImage(size, size, layout, pixels, 2, reduced);
+      DoNotOptimize(result.data());
+    });
+    runner.Run("generate_mip_chain/rgba8", size, pixels.size(), [&] {
+      std::vector<TextureMip> mips;
+      const std::vector<ui8> levels =
+          GenerateMipChain(size, size, layout, pixels, mips);
+      DoNotOptimize(levels.data());
+    });
+  }
+}
+
+static void BenchmarkReadFile(BenchmarkRunner& runner,
+                              const std::filesystem::path& temp_dir) {
+  // input size is the file size in bytes
+  for (size_t size : {size_t{64} << 10, size_t{1} << 20, size_t{16} << 20}) {
+    if (!runner.IsEnabled("read_file")) {
+      break;
+    }
+
+    const auto path = temp_dir / fmt::format("random_{}.bin", size);
+    WriteRandomFile(path, size);
+    std::vector<char> buffer;
+    runner.Run("read_file", size, size, [&] {
+      ReadFile(path, buffer);
+      DoNotOptimize(buffer.data());
+    });
+  }
+}
+
+// Reads of a batch are in flight together. Files are in the page cache after
+// the first iteration, so this measures submission overhead rather than disk
+// bandwidth, drop caches and use one iteration for cold reads
+static void BenchmarkReadFiles(BenchmarkRunner& runner,
+                               const std::filesystem::path& temp_dir) {
+  if (!runner.IsEnabled("read_files")) {
+    return;
+  }
+
+  constexpr size_t kNumFiles = 16;
+  ThreadPool thread_pool;
+  // input size is the size of every file of the batch
+  for (size_t size : {size_t{64} << 10, size_t{1} << 20, size_t{4} << 20}) {
+    std::vector<std::filesystem::path> paths;
+    for (size_t i = 0; i != kNumFiles; ++i) {
+      paths.push_back(temp_dir / fmt::format("batch_{}_{}.bin", size, i));
+      WriteRandomFile(paths.back(), size);
+    }
+
+    for (const bool io_uring : {true, false}) {
+      FileReaderSettings settings;
+      settings.io_uring = io_uring;
+      FileReader reader(thread_pool, settings);
+      if (io_uring && reader.GetBackend() != FileReaderBackend::IoUring) {
+        continue;
+      }
+
+      const char* name = io_uring ? "read_files/io_uring" : "read_files/pread";
+      runner.Run(name, size, size * kNumFiles, [&] {
+        std::latch done(static_cast<std::ptrdiff_t>(kNumFiles));
+        const auto on_complete = [&](FileBuffer data, std::exception_ptr) {
+          DoNotOptimize(data.data());
+          done.count_down();
+        };
+        std::vector<FileReader::Request> requests;
+        for (const std::filesystem::path& path : paths) {
+          requests.push_back({path, on_complete});
+        }
+        reader.Submit(std::move(requests));
+        done.wait();
+      });
+    }
+  }
+}
+
+static void BenchmarkUniformBuffer(BenchmarkRunner& runner) {
+  // input size is the number of objects updated per iteration
+  for (size_t count : {size_t{1}, size_t{64}, size_t{4096}}) {
+    runner.Run("uniform_buffer_object", count, 0, [count] {
+      for (size_t i = 0; i != count; ++i) {
+        const UniformBufferObject ubo =
+            MakeUniformBufferObject(static_cast<float>(i) * 0.001f, 1.5f);
+        DoNotOptimize(ubo);
+      }
+    });
+  }
+}
+
+// Format properties are queried from the driver once and then cached, both
+// paths are measured. Needs only an instance, no window or device
+static void BenchmarkFormatLookups(BenchmarkRunner& runner) {
+  if (!runner.IsEnabled("format")) {
+    return;
+  }
+
+  VkApplicationInfo app_info{};
+  app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  app_info.pApplicationName = "Vulkan Tutorial Benchmark";
+  app_info.apiVersion = VK_API_VERSION_1_0;
+
+  VkInstanceCreateInfo create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  create_info.pApplicationInfo = &app_info;
+
+  VkInstance instance = nullptr;
+  if (vkCreateInstance(&create_info, nullptr, &instance) != VK_SUCCESS) {
+    spdlog::warn("failed to create vulkan instance, format lookups skipped");
+    return;
+  }
+
+  ui32 num_devices = 0;
+  vkEnumeratePhysicalDevices(instance, &num_devices, nullptr);
+  std::vector<VkPhysicalDevice> devices(num_devices);
+  vkEnumeratePhysicalDevices(instance, &num_devices, devices.data());
+  if (devices.empty()) {
+    spdlog::warn("no physical devices, format lookups skipped");
+    vkDestroyInstance(instance, nullptr);
+    return;
+  }
+
+  PhysicalDeviceInfo device_info;
+  device_info.device = devices.front();
+
+  // all core Vulkan 1.0 formats
+  std::vector<VkFormat> formats;
+  for (int format = VK_FORMAT_R4G4_UNORM_PACK8;
+       format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK; ++format) {
+    formats.push_back(static_cast<VkFormat>(format));
+  }
+
+  // input size is the number of formats looked up per iteration
+  for (size_t count : {size_t{16}, formats.size()}) {
+    const std::span<const VkFormat> lookups(formats.data(), count);
+    runner.Run("format_properties/uncached", count, 0, [&] {
+      device_info.formats_properties.clear();
+      for (VkFormat format : lookups) {
+        DoNotOptimize(device_info.GetFormatProperties(format));
+      }
+    });
+    runner.Run("format_properties/cached", count, 0, [&] {
+      for (VkFormat format : lookups) {
+        DoNotOptimize(device_info.GetFormatProperties(format));
+      }
+    });
+  }
+
+  constexpr std::array depth_formats{VK_FORMAT_D32_SFLOAT,
+                                     VK_FORMAT_D32_SFLOAT_S8_UINT,
+                                     VK_FORMAT_D24_UNORM_S8_UINT};
+  runner.Run("find_supported_format/depth", depth_formats.size(), 0, [&] {
+    DoNotOptimize(device_info.FindSupportedFormat(
+        depth_formats, VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT));
+  });
+
+  vkDestroyInstance(instance, nullptr);
+}
+
+int main(int argc, char** argv) {
+  try {
+    BenchmarkSettings settings;
+    std::filesystem::path json_path = "benchmark_results.json";
+    for (int i = 1; i < argc; ++i) {
+      const std::string_view arg = argv[i];
+      if (arg == "--filter" && i + 1 < argc) {
+        settings.filter = argv[++i];
+      } else if (arg == "--out" && i + 1 < argc) {
+        json_path = argv[++i];
+      } else if (arg == "--min-time-ms" && i + 1 < argc) {
+        settings.min_time = std::chrono::milliseconds(std::stoul(argv[++i]));
+      } else {
+        throw std::runtime_error(fmt::format("unknown argument {}", arg));
+      }
+    }
+
+    // importers are measured on the sources, the build directory only has
+    // baked content
+    const std::filesystem::path source_content_dir =
+        VULKAN_TUTORIAL_SOURCE_CONTENT_DIR;
+    const std::filesystem::path content_dir =
+        std::filesystem::path(argv[0]).parent_path() / "content";
+    const std::filesystem::path temp_dir =
+        std::filesystem::temp_directory_path() / "vulkan_tutorial_bench";
+    std::filesystem::create_directories(temp_dir);
+
+    BenchmarkRunner runner(std::move(settings));
+    BenchmarkModelLoading(runner, source_content_dir, temp_dir);
+    BenchmarkImageLoading(runner, source_content_dir, temp_dir);
+    BenchmarkBakedLoading(runner, content_dir);
+    BenchmarkMipGeneration(runner);
+    BenchmarkReadFile(runner, temp_dir);
+    BenchmarkReadFiles(runner, temp_dir);
+    BenchmarkUniformBuffer(runner);
+    BenchmarkFormatLookups(runner);
+    std::filesystem::remove_all(temp_dir);
+
+    runner.PrintTable();
+    if (json_path == "-") {
+      runner.WriteJson(std::cout);
+    } else {
+      std::ofstream file(json_path);
+      [[unlikely]] if (!file.is_open()) {
+        throw std::runtime_error(
+            fmt::format("failed to open file {}", json_path.string()));
+      }
+      runner.WriteJson(file);
+      spdlog::info("results written to {}", json_path.string());
+    }
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception& e) {
+    spdlog::critical("Unhandled exception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,19 @@
+#version 450
+
+// depth prepass, positions are the only vertex input
+layout(binding = 0) uniform UniformBufferObject {
+  mat4 model;
+  mat4 view;
+  mat4 proj;
+}
+ubo;
+
+layout(location = 0) in vec3 inPosition;
+
+// the main pass tests against this depth with LESS_OR_EQUAL, both compute it
+// the same way
+invariant gl_Position;
+
+void main() {
+  gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,216 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+#include "read_file.hpp"
+#include "spdlog/spdlog.h"
+#include "spirv_reflection.hpp"
+
+// Generates a header that describes the interface of a shader program, so
+// pipeline layouts and vertex input are built from constants and checked
+// against C++ structs at compile time:
+//   vulkan_tutorial_reflect <struct name> <out.hpp> <stage.spv>...
+
+static std::string_view GetStageName(VkShaderStageFlags stage) {
+  switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return "VK_SHADER_STAGE_VERTEX_BIT";
+    case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+      return "VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT";
+    case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+      return "VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT";
+    case VK_SHADER_STAGE_GEOMETRY_BIT:
+      return "VK_SHADER_STAGE_GEOMETRY_BIT";
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return "VK_SHADER_STAGE_FRAGMENT_BIT";
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return "VK_SHADER_STAGE_COMPUTE_BIT";
+    default:
+      throw std::runtime_error(fmt::format("unknown stage {}", stage));
+  }
+}
+
+static std::string GetStageFlagsName(VkShaderStageFlags stages) {
+  std::string name;
+  for (VkShaderStageFlags bit = 1; bit <= stages; bit <<= 1) {
+    if (stages & bit) {
+      name += name.empty() ? "" : " | ";
+      name += GetStageName(bit);
+    }
+  }
+  return name;
+}
+
+static std::string_view GetDescriptorTypeName(VkDescriptorType type) {
+  switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+      return "VK_DESCRIPTOR_TYPE_SAMPLER";
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+      return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+      return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+      return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      return "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+      return "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER";
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+    default:
+      throw std::runtime_error(fmt::format("unknown descriptor type {}",
+                                           static_cast<int>(type)));
+  }
+}
+
+static std::string_view GetFormatName(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_R32_SFLOAT:
+      return "VK_FORMAT_R32_SFLOAT";
+    case VK_FORMAT_R32G32_SFLOAT:
+      return "VK_FORMAT_R32G32_SFLOAT";
+    case VK_FORMAT_R32G32B32_SFLOAT:
+      return "VK_FORMAT_R32G32B32_SFLOAT";
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      return "VK_FORMAT_R32G32B32A32_SFLOAT";
+    case VK_FORMAT_R32_SINT:
+      return "VK_FORMAT_R32_SINT";
+    case VK_FORMAT_R32G32_SINT:
+      return "VK_FORMAT_R32G32_SINT";
+    case VK_FORMAT_R32G32B32_SINT:
+      return "VK_FORMAT_R32G32B32_SINT";
+    case VK_FORMAT_R32G32B32A32_SINT:
+      return "VK_FORMAT_R32G32B32A32_SINT";
+    case VK_FORMAT_R32_UINT:
+      return "VK_FORMAT_R32_UINT";
+    case VK_FORMAT_R32G32_UINT:
+      return "VK_FORMAT_R32G32_UINT";
+    case VK_FORMAT_R32G32B32_UINT:
+      return "VK_FORMAT_R32G32B32_UINT";
+    case VK_FORMAT_R32G32B32A32_UINT:
+      return "VK_FORMAT_R32G32B32A32_UINT";
+    default:
+      throw std::runtime_error(
+          fmt::format("unknown format {}", static_cast<int>(format)));
+  }
+}
+
+static std::string GenerateHeader(std::string_view struct_name,
+                                  const ProgramReflection& program) {
+  std::string sources;
+  for (const ShaderReflection& stage : program.stages) {
+    sources += sources.empty() ? "" : ", ";
+    sources += stage.file.filename().string();
+  }
+
+  std::string text = fmt::format(
+      "// Generated by vulkan_tutorial_reflect from {}, do not edit\n"
+      "#pragma once\n\n"
+      "#include <array>\n\n"
+      "#include \"pipeline/shader_interface.hpp\"\n\n"
+      "struct {} {{\n",
+      sources, struct_name);
+
+  text += fmt::format(
+      "  static constexpr std::array<ShaderStage, {}> kStages{{{{\n",
+      program.stages.size());
+  for (const ShaderReflection& stage : program.stages) {
+    text += fmt::format("      {{{}, \"{}\", \"{}\"}},\n",
+                        GetStageName(stage.stage),
+                        stage.file.filename().string(), stage.entry_point);
+  }
+  text += "  }};\n\n";
+
+  text += fmt::format(
+      "  static constexpr std::array<ShaderDescriptorBinding, {}>\n"
+      "      kDescriptorBindings{{{{\n",
+      program.bindings.size());
+  for (const ReflectedBinding& binding : program.bindings) {
+    text += fmt::format(
+        "          // {}\n"
+        "          {{{}, {{{}, {}, {},\n"
+        "               {}, nullptr}},\n"
+        "           {}}},\n",
+        binding.name, binding.set, binding.binding,
+        GetDescriptorTypeName(binding.type), binding.count,
+        GetStageFlagsName(binding.stages), binding.block_size);
+  }
+  text += "      }};\n\n";
+
+  text += fmt::format(
+      "  static constexpr std::array<VkPushConstantRange, {}>\n"
+      "      kPushConstantRanges{{{{\n",
+      program.push_constant_ranges.size());
+  for (const VkPushConstantRange& range : program.push_constant_ranges) {
+    text += fmt::format("          {{{}, {}, {}}},\n",
+                        GetStageFlagsName(range.stageFlags), range.offset,
+                        range.size);
+  }
+  text += "      }};\n\n";
+
+  text += fmt::format(
+      "  static constexpr std::array<ShaderVertexInput, {}>\n"
+      "      kVertexInputs{{{{\n",
+      program.vertex_inputs.size());
+  for (const ReflectedVariable& input : program.vertex_inputs) {
+    text += fmt::format("          // {}\n          {{{}, {}}},\n",
+                        input.name, input.location,
+                        GetFormatName(input.format));
+  }
+  text += "      }};\n};\n";
+  return text;
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path output;
+  try {
+    [[unlikely]] if (argc < 4) {
+      throw std::runtime_error(
+          "usage: vulkan_tutorial_reflect <struct name> <out.hpp> "
+          "<stage.spv>...");
+    }
+
+    const std::string_view struct_name = argv[1];
+    output = argv[2];
+    std::vector<ShaderReflection> stages;
+    std::vector<char> buffer;
+    std::vector<ui32> words;
+    for (int i = 3; i < argc; ++i) {
+      const std::filesystem::path file = argv[i];
+      ReadFile(file, buffer);
+      words.resize(buffer.size() / sizeof(ui32));
+      std::memcpy(words.data(), buffer.data(), words.size() * sizeof(ui32));
+      stages.push_back(ReflectSpirv(file, words));
+    }
+
+    const std::string header =
+        GenerateHeader(struct_name, ReflectProgram(std::move(stages)));
+
+    if (output.has_parent_path()) {
+      std::filesystem::create_directories(output.parent_path());
+    }
+    std::ofstream file(output, std::ios::binary);
+    [[unlikely]] if (!file.is_open()) {
+      throw std::runtime_error(
+          fmt::format("failed to open file {}", output.string()));
+    }
+    file << header;
+
+    return EXIT_SUCCESS;
+  } catch (const std::exception& e) {
+    if (!output.empty()) {
+      std::error_code error;
+      std::filesystem::remove(output, error);
+    }
+    spdlog::critical("Unhandled exception: {}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,594 @@
+#include "spirv_reflection.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "fmt/format.h"
+
+namespace {
+constexpr ui32 kMagic = 0x07230203;
+constexpr size_t kHeaderWords = 5;
+
+// opcodes, decorations and enumerants of the SPIR-V specification that are
+// needed to describe resources
+enum Op : ui32 {
+  kOpName = 5,
+  kOpEntryPoint = 15,
+  kOpTypeInt = 21,
+  kOpTypeFloat = 22,
+  kOpTypeVector = 23,
+  kOpTypeMatrix = 24,
+  kOpTypeImage = 25,
+  kOpTypeSampler = 26,
+  kOpTypeSampledImage = 27,
+  kOpTypeArray = 28,
+  kOpTypeRuntimeArray = 29,
+  kOpTypeStruct = 30,
+  kOpTypePointer = 32,
+  kOpConstant = 43,
+  kOpVariable = 59,
+  kOpDecorate = 71,
+  kOpMemberDecorate = 72
+};
+
+enum Decoration : ui32 {
+  kBlock = 2,
+  kBufferBlock = 3,
+  kArrayStride = 6,
+  kMatrixStride = 7,
+  kBuiltIn = 11,
+  kLocation = 30,
+  kBinding = 33,
+  kDescriptorSet = 34,
+  kOffset = 35
+};
+
+enum StorageClass : ui32 {
+  kUniformConstant = 0,
+  kInput = 1,
+  kUniform = 2,
+  kOutput = 3,
+  kPushConstant = 9,
+  kStorageBuffer = 12
+};
+
+constexpr ui32 kDimBuffer = 5;
+
+struct Decorations {
+  std::optional<ui32> location;
+  std::optional<ui32> binding;
+  std::optional<ui32> set;
+  std::optional<ui32> array_stride;
+  bool block = false;
+  bool buffer_block = false;
+  bool builtin = false;
+};
+
+struct MemberDecorations {
+  ui32 offset = 0;
+  std::optional<ui32> matrix_stride;
+  bool builtin = false;
+};
+
+// operands of a type declaration without the result id
+struct Type {
+  ui32 op = 0;
+  std::vector<ui32> operands;
+};
+
+struct Variable {
+  ui32 id = 0;
+  ui32 pointer_type = 0;
+  ui32 storage_class = 0;
+};
+
+class Module {
+ public:
+  Module(const std::filesystem::path& file, std::span<const ui32> words)
+      : file_(&file) {
+    [[unlikely]] if (words.size() < kHeaderWords || words[0] != kMagic) {
+      Fail("is not a SPIR-V module");
+    }
+
+    size_t position = kHeaderWords;
+    while (position != words.size()) {
+      const ui32 word_count = words[position] >> 16;
+      [[unlikely]] if (word_count == 0 ||
+                       word_count > words.size() - position) {
+        Fail("has a malformed instruction");
+      }
+
+      Parse(words[position] & 0xFFFF,
+            words.subspan(position + 1, word_count - 1));
+      position += word_count;
+    }
+  }
+
+  [[noreturn]] void Fail(std::string_view message) const {
+    throw std::runtime_error(fmt::format("{} {}", file_->string(), message));
+  }
+
+  [[nodiscard]] std::string GetName(ui32 id) const {
+    auto it = names_.find(id);
+    return it != names_.end() ? it->second : fmt::format("id{}", id);
+  }
+
+  [[nodiscard]] const Decorations& GetDecorations(ui32 id) const {
+    static const Decorations kNone;
+    auto it = decorations_.find(id);
+    return it != decorations_.end() ? it->second : kNone;
+  }
+
+  [[nodiscard]] const MemberDecorations& GetMemberDecorations(
+      ui32 id, ui32 member) const {
+    static const MemberDecorations kNone;
+    auto it = member_decorations_.find({id, member});
+    return it != member_decorations_.end() ? it->second : kNone;
+  }
+
+  [[nodiscard]] const Type& GetType(ui32 id) const {
+    auto it = types_.find(id);
+    [[unlikely]] if (it == types_.end()) {
+      Fail(fmt::format("uses undeclared type {}", id));
+    }
+    return it->second;
+  }
+
+  [[nodiscard]] ui32 GetConstant(ui32 id) const {
+    auto it = constants_.find(id);
+    [[unlikely]] if (it == constants_.end()) {
+      Fail(fmt::format("uses array length {} that is not a constant", id));
+    }
+    return it->second;
+  }
+
+  // pointee of the pointer type
+  [[nodiscard]] ui32 GetPointee(ui32 pointer_type) const {
+    const Type& type = GetType(pointer_type);
+    [[unlikely]] if (type.op != kOpTypePointer || type.operands.size() < 2) {
+      Fail(fmt::format("has a variable of non pointer type {}", pointer_type));
+    }
+    return type.operands[1];
+  }
+
+  // true when all members of the struct are built in, like gl_PerVertex
+  [[nodiscard]] bool IsBuiltinBlock(ui32 type_id) const {
+    const Type& type = GetType(type_id);
+    if (type.op != kOpTypeStruct) {
+      return false;
+    }
+    for (ui32 i = 0; i != type.operands.size(); ++i) {
+      if (!GetMemberDecorations(type_id, i).builtin) {
+        return false;
+      }
+    }
+    return !type.operands.empty();
+  }
+
+  // bytes covered by members of a block, in the layout given by decorations
+  [[nodiscard]] ui32 GetSize(ui32 type_id,
+                             std::optional<ui32> matrix_stride) const {
+    const Type& type = GetType(type_id);
+    switch (type.op) {
+      case kOpTypeInt:
+      case kOpTypeFloat:
+        return type.operands.at(0) / 8;
+      case kOpTypeVector:
+        return type.operands.at(1) * GetSize(type.operands.at(0), {});
+      case kOpTypeMatrix: {
+        const ui32 column_size = GetSize(type.operands.at(0), {});
+        return type.operands.at(1) * matrix_stride.value_or(column_size);
+      }
+      case kOpTypeArray: {
+        const ui32 length = GetConstant(type.operands.at(1));
+        const std::optional<ui32> stride =
+            GetDecorations(type_id).array_stride;
+        return length * (stride ? *stride
+                                : GetSize(type.operands.at(0), matrix_stride));
+      }
+      case kOpTypeRuntimeArray:
+        return 0;
+      case kOpTypeStruct: {
+        ui32 size = 0;
+        for (ui32 i = 0; i != type.operands.size(); ++i) {
+          const MemberDecorations& member = GetMemberDecorations(type_id, i);
+          size = std::max(size, member.offset + GetSize(type.operands[i],
+                                                        member.matrix_stride));
+        }
+        return size;
+      }
+      default:
+        Fail(fmt::format("has a block member of unsupported type {}",
+                         type_id));
+    }
+  }
+
+  // first offset used by members of a struct
+  [[nodiscard]] ui32 GetFirstOffset(ui32 type_id) const {
+    const Type& type = GetType(type_id);
+    ui32 offset = type.operands.empty() ? 0 : ~0u;
+    for (ui32 i = 0; i != type.operands.size(); ++i) {
+      offset = std::min(offset, GetMemberDecorations(type_id, i).offset);
+    }
+    return offset;
+  }
+
+  [[nodiscard]] VkFormat GetFormat(ui32 type_id) const {
+    const Type* type = &GetType(type_id);
+    ui32 num_components = 1;
+    if (type->op == kOpTypeVector) {
+      num_components = type->operands.at(1);
+      type = &GetType(type->operands.at(0));
+    }
+
+    [[unlikely]] if ((type->op != kOpTypeFloat && type->op != kOpTypeInt) ||
+                     type->operands.at(0) != 32 || num_components > 4) {
+      Fail(fmt::format("has an interface variable of unsupported type {}",
+                       type_id));
+    }
+
+    constexpr std::array<std::array<VkFormat, 4>, 3> kFormats{{
+        {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+         VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT},
+        {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT,
+         VK_FORMAT_R32G32B32A32_SINT},
+        {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT,
+         VK_FORMAT_R32G32B32A32_UINT},
+    }};
+    size_t kind = 0;
+    if (type->op == kOpTypeInt) {
+      kind = type->operands.at(1) != 0 ? 1 : 2;
+    }
+    return kFormats[kind][num_components - 1];
+  }
+
+  [[nodiscard]] const std::vector<Variable>& GetVariables() const noexcept {
+    return variables_;
+  }
+  [[nodiscard]] ui32 GetExecutionModel() const noexcept {
+    return execution_model_;
+  }
+  [[nodiscard]] const std::string& GetEntryPoint() const noexcept {
+    return entry_point_;
+  }
+
+ private:
+  [[nodiscard]] static std::string ReadString(std::span<const ui32> words) {
+    std::string text;
+    for (ui32 word : words) {
+      for (ui32 shift = 0; shift != 32; shift += 8) {
+        const char c = static_cast<char>((word >> shift) & 0xFF);
+        if (c == '\0') {
+          return text;
+        }
+        text += c;
+      }
+    }
+    return text;
+  }
+
+  void Parse(ui32 op, std::span<const ui32> operands) {
+    switch (op) {
+      case kOpName:
+        if (operands.size() >= 2) {
+          names_[operands[0]] = ReadString(operands.subspan(1));
+        }
+        break;
+
+      case kOpEntryPoint:
+        // only the first entry point is described
+        if (entry_point_.empty() && operands.size() >= 3) {
+          execution_model_ = operands[0];
+          entry_point_ = ReadString(operands.subspan(2));
+        }
+        break;
+
+      case kOpTypeInt:
+      case kOpTypeFloat:
+      case kOpTypeVector:
+      case kOpTypeMatrix:
+      case kOpTypeImage:
+      case kOpTypeSampler:
+      case kOpTypeSampledImage:
+      case kOpTypeArray:
+      case kOpTypeRuntimeArray:
+      case kOpTypeStruct:
+      case kOpTypePointer:
+        if (!operands.empty()) {
+          Type& type = types_[operands[0]];
+          type.op = op;
+          type.operands.assign(operands.begin() + 1, operands.end());
+        }
+        break;
+
+      case kOpConstant:
+        if (operands.size() >= 3) {
+          constants_[operands[1]] = operands[2];
+        }
+        break;
+
+      case kOpVariable:
+        if (operands.size() >= 3) {
+          variables_.push_back({operands[1], operands[0], operands[2]});
+        }
+        break;
+
+      case kOpDecorate:
+        if (operands.size() >= 2) {
+          Decorate(decorations_[operands[0]], operands[1],
+                   operands.subspan(2));
+        }
+        break;
+
+      case kOpMemberDecorate:
+        if (operands.size() >= 3) {
+          MemberDecorations& member =
+              member_decorations_[{operands[0], operands[1]}];
+          const std::span<const ui32> values = operands.subspan(3);
+          if (operands[2] == kOffset && !values.empty()) {
+            member.offset = values[0];
+          } else if (operands[2] == kMatrixStride && !values.empty()) {
+            member.matrix_stride = values[0];
+          } else if (operands[2] == kBuiltIn) {
+            member.builtin = true;
+          }
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  static void Decorate(Decorations& decorations, ui32 decoration,
+                       std::span<const ui32> values) {
+    const std::optional<ui32> value =
+        values.empty() ? std::nullopt : std::optional(values[0]);
+    switch (decoration) {
+      case kBlock:
+        decorations.block = true;
+        break;
+      case kBufferBlock:
+        decorations.buffer_block = true;
+        break;
+      case kArrayStride:
+        decorations.array_stride = value;
+        break;
+      case kBuiltIn:
+        decorations.builtin = true;
+        break;
+      case kLocation:
+        decorations.location = value;
+        break;
+      case kBinding:
+        decorations.binding = value;
+        break;
+      case kDescriptorSet:
+        decorations.set = value;
+        break;
+      default:
+        break;
+    }
+  }
+
+ private:
+  const std::filesystem::path* file_;
+  ui32 execution_model_ = 0;
+  std::string entry_point_;
+  std::map<ui32, std::string> names_;
+  std::map<ui32, Decorations> decorations_;
+  std::map<std::pair<ui32, ui32>, MemberDecorations> member_decorations_;
+  std::map<ui32, Type> types_;
+  std::map<ui32, ui32> constants_;
+  std::vector<Variable> variables_;
+};
+
+[[nodiscard]] VkShaderStageFlagBits GetStage(const Module& module) {
+  switch (module.GetExecutionModel()) {
+    case 0:
+      return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1:
+      return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2:
+      return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3:
+      return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4:
+      return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5:
+      return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+      module.Fail(fmt::format("has unsupported execution model {}",
+                              module.GetExecutionModel()));
+  }
+}
+
+[[nodiscard]] ReflectedBinding ReflectBinding(const Module& module,
+                                              const Variable& variable) {
+  const Decorations& decorations = module.GetDecorations(variable.id);
+  ReflectedBinding binding;
+  binding.name = module.GetName(variable.id);
+  binding.set = decorations.set.value_or(0);
+  [[unlikely]] if (!decorations.binding) {
+    module.Fail(fmt::format("resource {} has no binding", binding.name));
+  }
+  binding.binding = *decorations.binding;
+
+  ui32 type_id = module.GetPointee(variable.pointer_type);
+  const Type* type = &module.GetType(type_id);
+  if (type->op == kOpTypeArray) {
+    binding.count = module.GetConstant(type->operands.at(1));
+    type_id = type->operands.at(0);
+    type = &module.GetType(type_id);
+  } else if (type->op == kOpTypeRuntimeArray) {
+    module.Fail(fmt::format("resource {} is a runtime array", binding.name));
+  }
+
+  const Decorations& type_decorations = module.GetDecorations(type_id);
+  if (variable.storage_class == kStorageBuffer ||
+      (variable.storage_class == kUniform && type_decorations.buffer_block)) {
+    binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.block_size = module.GetSize(type_id, {});
+  } else if (variable.storage_class == kUniform) {
+    binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.block_size = module.GetSize(type_id, {});
+  } else if (type->op == kOpTypeSampledImage) {
+    binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  } else if (type->op == kOpTypeSampler) {
+    binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+  } else if (type->op == kOpTypeImage && type->operands.size() >= 6) {
+    // operands: sampled type, dim, depth, arrayed, multisampled, sampled
+    const bool buffer = type->operands[1] == kDimBuffer;
+    const bool storage = type->operands[5] == 2;
+    if (buffer) {
+      binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                             : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    } else {
+      binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                             : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+  } else {
+    module.Fail(fmt::format("resource {} has unsupported type", binding.name));
+  }
+
+  return binding;
+}
+
+[[nodiscard]] ReflectedVariable ReflectVariable(const Module& module,
+                                                const Variable& variable) {
+  ReflectedVariable reflected;
+  reflected.name = module.GetName(variable.id);
+  const std::optional<ui32> location =
+      module.GetDecorations(variable.id).location;
+  [[unlikely]] if (!location) {
+    module.Fail(fmt::format("variable {} has no location", reflected.name));
+  }
+  reflected.location = *location;
+  reflected.format = module.GetFormat(module.GetPointee(variable.pointer_type));
+  return reflected;
+}
+
+void SortByLocation(std::vector<ReflectedVariable>& variables) {
+  std::ranges::sort(variables, {}, &ReflectedVariable::location);
+}
+}  // namespace
+
+ShaderReflection ReflectSpirv(const std::filesystem::path& file,
+                              std::span<const ui32> words) {
+  const Module module(file, words);
+  ShaderReflection reflection;
+  reflection.file = file;
+  reflection.stage = GetStage(module);
+  reflection.entry_point = module.GetEntryPoint();
+
+  for (const Variable& variable : module.GetVariables()) {
+    const ui32 pointee = module.GetPointee(variable.pointer_type);
+    const bool builtin = module.GetDecorations(variable.id).builtin ||
+                         module.IsBuiltinBlock(pointee);
+    switch (variable.storage_class) {
+      case kUniformConstant:
+      case kUniform:
+      case kStorageBuffer:
+        reflection.bindings.push_back(ReflectBinding(module, variable));
+        reflection.bindings.back().stages = reflection.stage;
+        break;
+
+      case kInput:
+        if (!builtin) {
+          reflection.inputs.push_back(ReflectVariable(module, variable));
+        }
+        break;
+
+      case kOutput:
+        if (!builtin) {
+          reflection.outputs.push_back(ReflectVariable(module, variable));
+        }
+        break;
+
+      case kPushConstant: {
+        const ui32 offset = module.GetFirstOffset(pointee);
+        reflection.push_constants.stageFlags = reflection.stage;
+        reflection.push_constants.offset = offset;
+        reflection.push_constants.size =
+            module.GetSize(pointee, {}) - offset;
+      } break;
+
+      default:
+        break;
+    }
+  }
+
+  SortByLocation(reflection.inputs);
+  SortByLocation(reflection.outputs);
+  return reflection;
+}
+
+ProgramReflection ReflectProgram(std::vector<ShaderReflection> stages) {
+  // pipeline order, the stage bits follow it
+  std::ranges::sort(stages, {}, &ShaderReflection::stage);
+
+  ProgramReflection program;
+  for (size_t i = 0; i != stages.size(); ++i) {
+    const ShaderReflection& stage = stages[i];
+    [[unlikely]] if (i != 0 && stages[i - 1].stage == stage.stage) {
+      throw std::runtime_error(fmt::format("{} and {} have the same stage",
+                                           stages[i - 1].file.string(),
+                                           stage.file.string()));
+    }
+
+    for (const ReflectedBinding& binding : stage.bindings) {
+      auto it = std::ranges::find_if(
+          program.bindings, [&](const ReflectedBinding& merged) {
+            return merged.set == binding.set &&
+                   merged.binding == binding.binding;
+          });
+      if (it == program.bindings.end()) {
+        program.bindings.push_back(binding);
+        continue;
+      }
+
+      [[unlikely]] if (it->type != binding.type ||
+                       it->count != binding.count) {
+        throw std::runtime_error(fmt::format(
+            "{} declares set {} binding {} differently than other stages",
+            stage.file.string(), binding.set, binding.binding));
+      }
+      it->stages |= binding.stages;
+      it->block_size = std::max(it->block_size, binding.block_size);
+    }
+
+    if (stage.push_constants.size != 0) {
+      program.push_constant_ranges.push_back(stage.push_constants);
+    }
+
+    if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+      program.vertex_inputs = stage.inputs;
+    }
+
+    // every input has to be written by the previous stage
+    if (i != 0 && stage.stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+      const ShaderReflection& previous = stages[i - 1];
+      for (const ReflectedVariable& input : stage.inputs) {
+        auto it = std::ranges::find(previous.outputs, input.location,
+                                    &ReflectedVariable::location);
+        [[unlikely]] if (it == previous.outputs.end() ||
+                         it->format != input.format) {
+          throw std::runtime_error(fmt::format(
+              "input {} at location {} of {} does not match outputs of {}",
+              input.name, input.location, stage.file.string(),
+              previous.file.string()));
+        }
+      }
+    }
+  }
+
+  std::ranges::sort(program.bindings, [](const ReflectedBinding& a,
+                                         const ReflectedBinding& b) {
+    return std::pair(a.set, a.binding) < std::pair(b.set, b.binding);
+  });
+  program.stages = std::move(stages);
+  return program;
+}
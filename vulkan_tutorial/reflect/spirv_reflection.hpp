@@ -0,0 +1,59 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "integer.hpp"
+#include "vulkan/vulkan.h"
+
+struct ReflectedBinding {
+  std::string name;
+  ui32 set = 0;
+  ui32 binding = 0;
+  VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+  ui32 count = 1;
+  VkShaderStageFlags stages = 0;
+  // bytes of uniform and storage blocks, zero for other descriptors
+  ui32 block_size = 0;
+};
+
+// input or output variable of the stage interface
+struct ReflectedVariable {
+  std::string name;
+  ui32 location = 0;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+struct ShaderReflection {
+  std::filesystem::path file;
+  VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+  std::string entry_point;
+  std::vector<ReflectedBinding> bindings;
+  std::vector<ReflectedVariable> inputs;
+  std::vector<ReflectedVariable> outputs;
+  // size is zero when the stage has no push constants
+  VkPushConstantRange push_constants{};
+};
+
+// Reads descriptor bindings, push constants and interface variables of the
+// first entry point. Throws on malformed modules and on declarations that
+// have no matching Vulkan description
+[[nodiscard]] ShaderReflection ReflectSpirv(const std::filesystem::path& file,
+                                            std::span<const ui32> words);
+
+// all stages of one pipeline
+struct ProgramReflection {
+  std::vector<ShaderReflection> stages;
+  // merged over stages, sorted by set and binding
+  std::vector<ReflectedBinding> bindings;
+  std::vector<VkPushConstantRange> push_constant_ranges;
+  // inputs of the vertex stage, sorted by location
+  std::vector<ReflectedVariable> vertex_inputs;
+};
+
+// Merges stages and checks that bindings used by several stages agree and
+// that every stage reads only what the previous stage writes
+[[nodiscard]] ProgramReflection ReflectProgram(
+    std::vector<ShaderReflection> stages);
@@ -6,24 +6,70 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <map>
 #include <stdexcept>
 #include <string_view>
 
+#include "assets/baked_mesh.hpp"
+#include "assets/baked_texture.hpp"
+#include "assets/texture_format.hpp"
+#include "cache/cached_loaders.hpp"
+#include "device_selector.hpp"
 #include "fmt/format.h"
-#include "image_loader.hpp"
-#include "include_glm.hpp"
+#include "image_writer.hpp"
 #include "pipeline/descriptors/vertex_descriptor.hpp"
 #include "pipeline/uniform_buffer_object.hpp"
 #include "read_file.hpp"
+#include "scene/scene_geometry.hpp"
+#include "shaders/depth_program.hpp"
+#include "shaders/mesh_program.hpp"
 #include "spdlog/spdlog.h"
-#include "tiny_obj_loader.h"
 #include "unused_var.hpp"
 #include "vulkan_utility.hpp"
 
-include_glm_begin;
-#include "glm/gtc/matrix_transform.hpp"
-include_glm_end;
+// Descriptor set layout, pipeline layout and vertex input come from the
+// reflection of the compiled shaders. Resources of the sets are listed by hand,
+// so the shaders have to declare exactly these bindings
+static constexpr ui32 kUniformBufferBinding = 0;
+static constexpr ui32 kTextureBinding = 1;
+static_assert(UsesSingleDescriptorSet(MeshProgram::kDescriptorBindings),
+              "one descriptor set is allocated per swap chain image");
+static_assert(MeshProgram::kDescriptorBindings.size() == 2,
+              "every binding has to be written by UpdateDescriptorSets");
+static_assert(HasDescriptorBinding(MeshProgram::kDescriptorBindings, 0,
+                                   kUniformBufferBinding,
+                                   VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) &&
+                  GetDescriptorBlockSize(MeshProgram::kDescriptorBindings, 0,
+                                         kUniformBufferBinding) <=
+                      sizeof(UniformBufferObject),
+              "shaders read a different uniform buffer");
+static_assert(HasDescriptorBinding(MeshProgram::kDescriptorBindings, 0,
+                                   kTextureBinding,
+                                   VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+              "shaders sample the texture through a different binding");
+static_assert(MatchesVertexInputs<Vertex>(MeshProgram::kVertexInputs) &&
+                  MatchesVertexInputs<VertexStreams>(
+                      MeshProgram::kVertexInputs),
+              "vertex shader inputs do not match both vertex layouts");
+
+// the depth prepass shares the pipeline layout and reads only positions,
+// which are the first binding of both vertex layouts
+static_assert(DepthProgram::kDescriptorBindings.size() == 1 &&
+                  HasDescriptorBinding(DepthProgram::kDescriptorBindings, 0,
+                                       kUniformBufferBinding,
+                                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) &&
+                  DepthProgram::kPushConstantRanges.empty(),
+              "depth prepass has to fit the layout of the mesh program");
+static_assert(MatchesVertexInputs<Vertex>(DepthProgram::kVertexInputs) &&
+                  MatchesVertexInputs<VertexStreams>(
+                      DepthProgram::kVertexInputs) &&
+                  ReadsOnlyVertexBinding<VertexStreams>(
+                      DepthProgram::kVertexInputs,
+                      StructDescriptor<VertexStreams>::kPositionBinding),
+              "depth prepass has to read only positions");
 
 VkResult CreateDebugUtilsMessengerEXT(
     VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* create_info,
@@ -86,18 +132,6 @@ Application::Application() {
   glfw_initialized_ = false;
   frame_buffer_resized_ = false;
 
-  if constexpr (kEnableValidation) {
-    required_layers_.push_back("VK_LAYER_KHRONOS_validation");
-  }
-
-  if constexpr (kEnableOverlay) {
-    required_layers_.push_back("VK_LAYER_MESA_overlay");
-  }
-
-  if constexpr (kEnableLunarGMonitor) {
-    required_layers_.push_back("VK_LAYER_LUNARG_monitor");
-  }
-
   device_extensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
   app_start_time_ = GetGlobalTime();
@@ -109,10 +143,55 @@ void Application::SetExecutableFile(std::filesystem::path path) {
   executable_file_ = path;
 }
 
+void Application::SetConfigSource(ConfigSource source) {
+  config_ = source.Load();
+  config_source_ = std::move(source);
+}
+
+void Application::EnableRegressionCheck(RegressionCheckSettings settings) {
+  regression_check_ = std::make_unique<RegressionCheck>(std::move(settings));
+}
+
+void Application::EnableTraceRecording(std::filesystem::path path) {
+  trace_writer_ = std::make_unique<TraceWriter>(path);
+}
+
+void Application::EnableReplay(std::filesystem::path path) {
+  replay_path_ = std::move(path);
+}
+
 void Application::Run() {
-  InitializeWindow();
+  if (regression_check_ && !regression_check_->HasReferences()) {
+    spdlog::warn("regression check skipped, there is no reference frame in "
+                 "{}. It is written with --update-references",
+                 regression_check_->GetSettings().reference_dir.string());
+    exit_code_ = RegressionCheck::kSkipExitCode;
+    return;
+  }
+
+  if (!replay_path_.empty()) {
+    // parsed separately so upload stages measure only the upload
+    startup_profiler_.Measure("ReadTrace",
+                              [&] { replay_ = ReadTrace(replay_path_); });
+    [[unlikely]] if (replay_->frames.empty()) {
+      throw std::runtime_error(
+          fmt::format("trace {} has no frames", replay_path_.string()));
+    }
+  }
+
+  startup_profiler_.Measure("InitializeWindow", [&] { InitializeWindow(); });
   InitializeVulkan();
-  MainLoop();
+  WriteStartupReport();
+  simulation_clock_ = SimulationClock(GetSimulationClockSettings());
+  if (!config_.record_camera_path.empty()) {
+    simulation_clock_.RecordCamera(config_.record_camera_path);
+  }
+
+  if (regression_check_) {
+    RunRegressionCheck();
+  } else {
+    MainLoop();
+  }
   Cleanup();
 }
 
@@ -120,13 +199,25 @@ void Application::InitializeWindow() {
   glfwInit();
   glfw_initialized_ = true;
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
-  window_ = glfwCreateWindow(static_cast<int>(window_width_),
-                             static_cast<int>(window_height_), "Vulkan",
+  VkExtent2D window_size{config_.window_width, config_.window_height};
+  if (regression_check_) {
+    // fixed size keeps frames comparable with the reference
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  } else if (replay_) {
+    // recorded commands render to the recorded extent
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    window_size = replay_->commands.extent;
+  } else {
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+  }
+  window_ = glfwCreateWindow(static_cast<int>(window_size.width),
+                             static_cast<int>(window_size.height), "Vulkan",
                              nullptr, nullptr);
   glfwSetWindowUserPointer(window_, this);
   glfwSetFramebufferSizeCallback(window_,
                                  Application::FrameBufferResizeCallback);
+  glfwSetKeyCallback(window_, Application::KeyCallback);
 }
 
 void Application::FrameBufferResizeCallback(GLFWwindow* window, int width,
@@ -136,6 +227,15 @@ void Application::FrameBufferResizeCallback(GLFWwindow* window, int width,
   app->frame_buffer_resized_ = true;
 }
 
+void Application::KeyCallback(GLFWwindow* window, int key, int scancode,
+                              int action, int mods) {
+  UnusedVar(scancode, mods);
+  auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+  if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+    app->SaveScreenshot();
+  }
+}
+
 void populate_debug_messenger_create_info(
     VkDebugUtilsMessengerCreateInfoEXT& create_info) {
   create_info = {};
@@ -152,62 +252,44 @@ void populate_debug_messenger_create_info(
 }
 
 void Application::PickPhysicalDevice() {
-  std::vector<VkPhysicalDevice> devices;
-  VulkanUtility::GetDevices(instance_, devices);
-
-  [[unlikely]] if (devices.empty()) {
-    throw std::runtime_error("There is no vulkan capable devices");
-  }
-
-  device_info_ = std::make_unique<PhysicalDeviceInfo>();
-  surface_info_ = std::make_unique<DeviceSurfaceInfo>();
-
-  int best_score = -1;
-  for (size_t i = 0; i < devices.size(); ++i) {
-    PhysicalDeviceInfo device_info;
-    device_info.Populate(devices[i], surface_);
-
-    bool has_extensions = true;
-    for (auto& required_extension : device_extensions_) {
-      if (!device_info.HasExtension(required_extension)) {
-        has_extensions = false;
-        break;
-      }
-    }
-
-    if (!has_extensions) {
-      continue;
-    }
-
-    // Check swapchain compatibility
-    DeviceSurfaceInfo surface_info;
-    surface_info.Populate(devices[i], surface_);
-    if (surface_info.formats.empty() || surface_info.present_modes.empty()) {
-      continue;
-    }
-
-    const int score = device_info.RateDevice();
-    if (score > best_score) {
-      best_score = score;
-      *device_info_ = std::move(device_info);
-      *surface_info_ = std::move(surface_info);
-    }
-  }
-
-  [[unlikely]] if (best_score < 0) {
-    throw std::runtime_error("There is no suitable device");
-  }
-
-  msaa_samples_ = device_info_->GetMaxUsableSampleCount();
+  DeviceSelectionSettings settings;
+  settings.required_extensions = device_extensions_;
+  settings.optional_extensions = {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME};
+  settings.instance_api_version = instance_api_version_;
+  settings.device_override = config_.device;
+  settings.run_benchmark = config_.device_benchmark;
+
+  DeviceCandidate candidate =
+      DeviceSelector(std::move(settings)).Select(instance_, surface_);
+  device_info_ =
+      std::make_unique<PhysicalDeviceInfo>(std::move(candidate.device_info));
+  surface_info_ =
+      std::make_unique<DeviceSurfaceInfo>(std::move(candidate.surface_info));
+
+  msaa_samples_ = ChooseSampleCount();
 
   spdlog::info("picked physical device:");
   spdlog::info("   name: {}", device_info_->properties.deviceName);
+  if (device_info_->has_device_uuid) {
+    spdlog::info("   uuid: {}", device_info_->GetDeviceUuidString());
+  }
   spdlog::info(
       "   sampler anisotropy: {} {}",
       device_info_->features.samplerAnisotropy ? "enabled" : "disabled",
       device_info_->properties.limits.maxSamplerAnisotropy);
   spdlog::info("   MSAA max samples: {}",
                VulkanUtility::SampleCountFlagsToString(msaa_samples_));
+  spdlog::info("   graphics queue family: {}",
+               device_info_->GetGraphicsQueueFamilyIndex());
+  spdlog::info("   present queue family: {}",
+               device_info_->GetPresentQueueFamilyIndex());
+  spdlog::info("   transfer queue family: {} ({})",
+               device_info_->GetTransferQueueFamilyIndex(),
+               device_info_->HasDedicatedTransferFamily() ? "dedicated"
+                                                          : "shared");
+  spdlog::info("   compute queue family: {} ({})",
+               device_info_->GetComputeQueueFamilyIndex(),
+               device_info_->HasAsyncComputeFamily() ? "async" : "shared");
 }
 
 void Application::CreateSurface() {
@@ -240,26 +322,63 @@ void Application::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 }
 
 void Application::CreateDevice() {
-  float queue_priority = 1.0f;
-
-  std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+  // budget is queried with a Vulkan 1.1 function
+  memory_budget_enabled_ =
+      device_info_->HasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) &&
+      instance_api_version_ >= VK_API_VERSION_1_1 &&
+      device_info_->properties.apiVersion >= VK_API_VERSION_1_1;
+  if (memory_budget_enabled_) {
+    device_extensions_.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
 
-  auto add_queue_family = [&](ui32 idx) {
-    if (std::find_if(queue_create_infos.begin(), queue_create_infos.end(),
-                     [idx](auto& info) {
-                       return info.queueFamilyIndex == idx;
-                     }) == queue_create_infos.end()) {
-      VkDeviceQueueCreateInfo queue_create_info{};
-      queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-      queue_create_info.queueFamilyIndex = idx;
-      queue_create_info.queueCount = 1;
-      queue_create_info.pQueuePriorities = &queue_priority;
-      queue_create_infos.push_back(queue_create_info);
+  // Number of requested queues for each family. When a few roles share one
+  // family, they get separate queues while the family has enough of them
+  // and share the last one otherwise.
+  std::map<ui32, ui32> family_queue_counts;
+  auto reserve_queues = [&](ui32 family, ui32 count) {
+    const ui32 available = device_info_->GetQueueCount(family);
+    ui32& used = family_queue_counts[family];
+    std::vector<ui32> indices;
+    for (ui32 i = 0; i != count; ++i) {
+      indices.push_back(std::min(used, available - 1));
+      used = std::min(used + 1, available);
     }
+    return indices;
   };
 
-  add_queue_family(device_info_->GetGraphicsQueueFamilyIndex());
-  add_queue_family(device_info_->GetPresentQueueFamilyIndex());
+  const ui32 graphics_family = device_info_->GetGraphicsQueueFamilyIndex();
+  const ui32 present_family = device_info_->GetPresentQueueFamilyIndex();
+  const ui32 transfer_family = device_info_->GetTransferQueueFamilyIndex();
+
+  const ui32 graphics_index = reserve_queues(graphics_family, 1).front();
+  // present through graphics queue when it is possible
+  const ui32 present_index = present_family == graphics_family
+                                 ? graphics_index
+                                 : reserve_queues(present_family, 1).front();
+  // Copies of independent uploads are spread over the transfer queues. No
+  // compute queue is created, the renderer has no compute work: mips are
+  // generated with blits, which need a graphics queue, and there is no GPU
+  // culling or post-processing
+  const ui32 num_transfer_queues = std::min(
+      kMaxTransferQueues, device_info_->GetQueueCount(transfer_family));
+  const auto transfer_indices =
+      reserve_queues(transfer_family, num_transfer_queues);
+
+  ui32 max_queues_in_family = 0;
+  for (const auto& [family, count] : family_queue_counts) {
+    max_queues_in_family = std::max(max_queues_in_family, count);
+  }
+  const std::vector<float> queue_priorities(max_queues_in_family, 1.0f);
+
+  std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+  for (const auto& [family, count] : family_queue_counts) {
+    VkDeviceQueueCreateInfo queue_create_info{};
+    queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_create_info.queueFamilyIndex = family;
+    queue_create_info.queueCount = count;
+    queue_create_info.pQueuePriorities = queue_priorities.data();
+    queue_create_infos.push_back(queue_create_info);
+  }
 
   VkPhysicalDeviceFeatures device_features{};
   device_features.samplerAnisotropy = device_info_->features.samplerAnisotropy;
@@ -286,10 +405,28 @@ void Application::CreateDevice() {
                          &logical_device);
 
   device_ = logical_device;
-  vkGetDeviceQueue(device_, device_info_->GetGraphicsQueueFamilyIndex(), 0,
-                   &graphics_queue_);
-  vkGetDeviceQueue(device_, device_info_->GetPresentQueueFamilyIndex(), 0,
-                   &present_queue_);
+  auto get_queue = [&](ui32 family, ui32 index) {
+    VkQueue queue = nullptr;
+    vkGetDeviceQueue(device_, family, index, &queue);
+    return queue;
+  };
+
+  graphics_queue_ = get_queue(graphics_family, graphics_index);
+  present_queue_ = get_queue(present_family, present_index);
+
+  // indices repeat when the family has fewer queues
+  transfer_queues_.clear();
+  next_transfer_queue_ = 0;
+  for (const ui32 index : transfer_indices) {
+    const VkQueue queue = get_queue(transfer_family, index);
+    if (transfer_queues_.empty() || transfer_queues_.back() != queue) {
+      transfer_queues_.push_back(queue);
+    }
+  }
+
+  for (const auto& [family, count] : family_queue_counts) {
+    spdlog::info("created {} queue(s) in family {}", count, family);
+  }
 }
 
 void Application::CreateSwapChain() {
@@ -312,7 +449,13 @@ void Application::CreateSwapChain() {
   create_info.imageColorSpace = surfaceFormat.colorSpace;
   create_info.imageExtent = swap_chain_extent_;
   create_info.imageArrayLayers = 1;
-  create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // transfer source is needed to read presented images back
+  swap_chain_image_usage_ = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (surface_info_->capabilities.supportedUsageFlags &
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+    swap_chain_image_usage_ |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  }
+  create_info.imageUsage = swap_chain_image_usage_;
 
   std::array queue_family_indices = {
       device_info_->GetGraphicsQueueFamilyIndex(),
@@ -433,69 +576,82 @@ void Application::CreateRenderPass() {
                              &render_pass_);
 }
 
-void Application::CreateDescriptorSetLayout() {
-  VkDescriptorSetLayoutBinding ubo_layout_binding{};
-  ubo_layout_binding.binding = 0;
-  ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  ubo_layout_binding.descriptorCount = 1;
-  ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  ubo_layout_binding.pImmutableSamplers = nullptr;
-
-  VkDescriptorSetLayoutBinding sampler_layout_binding{};
-  sampler_layout_binding.binding = 1;
-  sampler_layout_binding.descriptorCount = 1;
-  sampler_layout_binding.descriptorType =
-      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  sampler_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-  sampler_layout_binding.pImmutableSamplers = nullptr;
-
-  const std::array bindings{ubo_layout_binding, sampler_layout_binding};
-
-  VkDescriptorSetLayoutCreateInfo create_info{};
-  create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  create_info.bindingCount = static_cast<ui32>(bindings.size());
-  create_info.pBindings = bindings.data();
-
-  VkWrap(vkCreateDescriptorSetLayout)(device_, &create_info, nullptr,
-                                      &descriptor_set_layout_);
+void Application::CreateDescriptorAllocator() {
+  constexpr auto bindings =
+      GetDescriptorSetLayoutBindings(MeshProgram::kDescriptorBindings);
+  // update templates are core in Vulkan 1.1
+  const bool update_templates =
+      instance_api_version_ >= VK_API_VERSION_1_1 &&
+      device_info_->properties.apiVersion >= VK_API_VERSION_1_1;
+  descriptor_allocator_ = std::make_unique<DescriptorAllocator>(
+      device_, bindings, update_templates);
 }
 
 void Application::CreateGraphicsPipeline() {
   const auto shaders_dir = GetShadersDir();
 
-  std::vector<char> cache;
-  VkShaderModule vert_shader_module =
-      CreateShaderModule(shaders_dir / "vertex_shader.spv", cache);
-  VkShaderModule fragment_shader_module =
-      CreateShaderModule(shaders_dir / "fragment_shader.spv", cache);
-
-  VkPipelineShaderStageCreateInfo vert_shader_stage_create_info{};
-  vert_shader_stage_create_info.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  vert_shader_stage_create_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vert_shader_stage_create_info.module = vert_shader_module;
-  vert_shader_stage_create_info.pName = "main";
-
-  VkPipelineShaderStageCreateInfo frag_shader_stage_create_info{};
-  frag_shader_stage_create_info.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  frag_shader_stage_create_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  frag_shader_stage_create_info.module = fragment_shader_module;
-  frag_shader_stage_create_info.pName = "main";
-
-  auto binding_descriptions = StructDescriptor<Vertex>::GetBindingDescription();
-  auto attribute_descriptions =
-      StructDescriptor<Vertex>::GetInputAttributeDescriptions();
-
-  VkPipelineVertexInputStateCreateInfo vert_input_info{};
-  vert_input_info.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vert_input_info.vertexBindingDescriptionCount =
-      static_cast<ui32>(binding_descriptions.size());
-  vert_input_info.pVertexBindingDescriptions = binding_descriptions.data();
-  vert_input_info.vertexAttributeDescriptionCount =
-      static_cast<ui32>(attribute_descriptions.size());
-  vert_input_info.pVertexAttributeDescriptions = attribute_descriptions.data();
+  // stages of both programs are read concurrently, the depth program follows
+  // the mesh program
+  std::vector<ShaderStage> stages(MeshProgram::kStages.begin(),
+                                  MeshProgram::kStages.end());
+  if (config_.depth_prepass) {
+    stages.insert(stages.end(), DepthProgram::kStages.begin(),
+                  DepthProgram::kStages.end());
+  }
+  std::vector<Task<VkShaderModule>> shader_loads;
+  for (const ShaderStage& stage : stages) {
+    shader_loads.push_back(LoadShaderModule(shaders_dir / stage.file));
+  }
+  std::vector<VkShaderModule> shader_modules =
+      scheduler_->RunUntilDone(scheduler_->WhenAll(std::move(shader_loads)));
+
+  std::vector<VkPipelineShaderStageCreateInfo> shader_stages(stages.size());
+  for (size_t i = 0; i != shader_stages.size(); ++i) {
+    shader_stages[i].sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shader_stages[i].stage = stages[i].stage;
+    shader_stages[i].module = shader_modules[i];
+    shader_stages[i].pName = stages[i].entry_point;
+  }
+
+  // Both programs read the same vertex buffers. The depth program only reads
+  // positions from the first binding, with split streams it is the only one
+  // it fetches
+  const auto make_vertex_input =
+      [](std::span<const VkVertexInputBindingDescription> bindings,
+         std::span<const VkVertexInputAttributeDescription> attributes) {
+        VkPipelineVertexInputStateCreateInfo vertex_input{};
+        vertex_input.sType =
+            VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertex_input.vertexBindingDescriptionCount =
+            static_cast<ui32>(bindings.size());
+        vertex_input.pVertexBindingDescriptions = bindings.data();
+        vertex_input.vertexAttributeDescriptionCount =
+            static_cast<ui32>(attributes.size());
+        vertex_input.pVertexAttributeDescriptions = attributes.data();
+        return vertex_input;
+      };
+  constexpr auto interleaved_bindings =
+      StructDescriptor<Vertex>::GetBindingDescription();
+  constexpr auto interleaved_attributes =
+      GetVertexAttributes<Vertex>(MeshProgram::kVertexInputs);
+  constexpr auto interleaved_depth_attributes =
+      GetVertexAttributes<Vertex>(DepthProgram::kVertexInputs);
+  constexpr auto split_bindings =
+      StructDescriptor<VertexStreams>::GetBindingDescription();
+  constexpr auto split_attributes =
+      GetVertexAttributes<VertexStreams>(MeshProgram::kVertexInputs);
+  constexpr auto split_depth_attributes =
+      GetVertexAttributes<VertexStreams>(DepthProgram::kVertexInputs);
+  const bool split = config_.split_vertex_streams;
+  const VkPipelineVertexInputStateCreateInfo vert_input_info =
+      split ? make_vertex_input(split_bindings, split_attributes)
+            : make_vertex_input(interleaved_bindings, interleaved_attributes);
+  const VkPipelineVertexInputStateCreateInfo depth_vert_input_info =
+      split ? make_vertex_input(std::span(split_bindings).first(1),
+                                split_depth_attributes)
+            : make_vertex_input(interleaved_bindings,
+                                interleaved_depth_attributes);
 
   VkPipelineInputAssemblyStateCreateInfo input_assembly{};
   input_assembly.sType =
@@ -560,9 +716,12 @@ void Application::CreateGraphicsPipeline() {
   VkPipelineDepthStencilStateCreateInfo depth_stencil{};
   depth_stencil.sType =
       VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  // after the prepass only the nearest surface passes the test
   depth_stencil.depthTestEnable = kVkTrue;
-  depth_stencil.depthWriteEnable = kVkTrue;
-  depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depth_stencil.depthWriteEnable = config_.depth_prepass ? kVkFalse : kVkTrue;
+  depth_stencil.depthCompareOp = config_.depth_prepass
+                                     ? VK_COMPARE_OP_LESS_OR_EQUAL
+                                     : VK_COMPARE_OP_LESS;
   depth_stencil.depthBoundsTestEnable = kVkFalse;
   depth_stencil.minDepthBounds = 0.0f;
   depth_stencil.maxDepthBounds = 1.0f;
@@ -585,17 +744,18 @@ void Application::CreateGraphicsPipeline() {
   VkPipelineLayoutCreateInfo pipline_layout_info{};
   pipline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipline_layout_info.setLayoutCount = 1;
-  pipline_layout_info.pSetLayouts = &descriptor_set_layout_;
-  pipline_layout_info.pushConstantRangeCount = 0;     // Optional
-  pipline_layout_info.pPushConstantRanges = nullptr;  // Optional
+  const VkDescriptorSetLayout set_layout = descriptor_allocator_->GetLayout();
+  pipline_layout_info.pSetLayouts = &set_layout;
+  pipline_layout_info.pushConstantRangeCount =
+      static_cast<ui32>(MeshProgram::kPushConstantRanges.size());
+  pipline_layout_info.pPushConstantRanges =
+      MeshProgram::kPushConstantRanges.data();
   VkWrap(vkCreatePipelineLayout)(device_, &pipline_layout_info, nullptr,
                                  &pipeline_layout_);
 
-  std::array shader_stages{vert_shader_stage_create_info,
-                           frag_shader_stage_create_info};
   VkGraphicsPipelineCreateInfo pipeline_info{};
   pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipeline_info.stageCount = static_cast<ui32>(shader_stages.size());
+  pipeline_info.stageCount = static_cast<ui32>(MeshProgram::kStages.size());
   pipeline_info.pStages = shader_stages.data();
   pipeline_info.pVertexInputState = &vert_input_info;
   pipeline_info.pInputAssemblyState = &input_assembly;
@@ -614,9 +774,35 @@ void Application::CreateGraphicsPipeline() {
   VkWrap(vkCreateGraphicsPipelines)(device_, nullptr, 1u, &pipeline_info,
                                     nullptr, &graphics_pipeline_);
 
-  VulkanUtility::Destroy<vkDestroyShaderModule>(device_, vert_shader_module);
-  VulkanUtility::Destroy<vkDestroyShaderModule>(device_,
-                                                fragment_shader_module);
+  if (config_.depth_prepass) {
+    // no fragment stage and no color writes
+    VkPipelineColorBlendAttachmentState depth_blend_attachment{};
+    VkPipelineColorBlendStateCreateInfo depth_color_blending = color_blending;
+    depth_color_blending.pAttachments = &depth_blend_attachment;
+    VkPipelineDepthStencilStateCreateInfo prepass_depth_stencil =
+        depth_stencil;
+    prepass_depth_stencil.depthWriteEnable = kVkTrue;
+    prepass_depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineMultisampleStateCreateInfo depth_multisampling = multisampling;
+    depth_multisampling.sampleShadingEnable = kVkFalse;
+
+    VkGraphicsPipelineCreateInfo depth_pipeline_info = pipeline_info;
+    depth_pipeline_info.stageCount =
+        static_cast<ui32>(DepthProgram::kStages.size());
+    depth_pipeline_info.pStages =
+        shader_stages.data() + MeshProgram::kStages.size();
+    depth_pipeline_info.pVertexInputState = &depth_vert_input_info;
+    depth_pipeline_info.pMultisampleState = &depth_multisampling;
+    depth_pipeline_info.pDepthStencilState = &prepass_depth_stencil;
+    depth_pipeline_info.pColorBlendState = &depth_color_blending;
+    VkWrap(vkCreateGraphicsPipelines)(device_, nullptr, 1u,
+                                      &depth_pipeline_info, nullptr,
+                                      &depth_pipeline_);
+  }
+
+  for (VkShaderModule& shader_module : shader_modules) {
+    VulkanUtility::Destroy<vkDestroyShaderModule>(device_, shader_module);
+  }
 }
 
 void Application::CreateFrameBuffers() {
@@ -659,6 +845,9 @@ void Application::CreateCommandPools() {
   transient_command_pool_ =
       CreateCommandPool(device_info_->GetGraphicsQueueFamilyIndex(),
                         VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+  transfer_command_pool_ =
+      CreateCommandPool(device_info_->GetTransferQueueFamilyIndex(),
+                        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
 }
 
 void Application::CreateImage(ui32 width, ui32 height, ui32 mip_levels,
@@ -695,95 +884,398 @@ void Application::CreateImage(ui32 width, ui32 height, ui32 mip_levels,
   VkWrap(vkBindImageMemory)(device_, image, image_memory, 0u);
 }
 
-void Application::CreateTextureImages() {
-  constexpr VkFormat image_format = VK_FORMAT_R8G8B8A8_SRGB;
-  std::filesystem::path texture_path = GetTexturesDir() / "viking_room.png";
+void Application::CreateDerivedDataCache() {
+  if (config_.cache_size_mb == 0 || replay_) {
+    return;
+  }
+
+  DerivedDataCacheSettings settings;
+  settings.directory = config_.cache_dir.empty()
+                           ? executable_file_.parent_path() / "derived_data"
+                           : config_.cache_dir;
+  settings.max_size = ui64{config_.cache_size_mb} << 20;
+  derived_data_cache_ = std::make_unique<DerivedDataCache>(std::move(settings));
+}
 
-  // check that linear sampling is supported for this image format
-  // this is required for mipmaps generation
-  if (!(device_info_->GetFormatProperties(image_format).optimalTilingFeatures &
-        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-    throw std::runtime_error(
-        "VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT is not supporte for "
-        "image format");
+// makes offsets relative to the first level, returns its previous offset
+static ui64 RebaseMips(std::span<TextureMip> mips) {
+  const ui64 base_offset = mips.front().offset;
+  for (TextureMip& mip : mips) {
+    mip.offset -= base_offset;
   }
+  return base_offset;
+}
+
+void Application::CreateTextureImages() {
+  scheduler_->RunUntilDone(LoadTexture());
+  texture_id_ = texture_residency_.AddTexture(texture_source_.mips);
+  CreateTextureSampler();
+}
+
+Task<void> Application::LoadTexture() {
+  std::filesystem::path texture_path = GetTexturesDir() / "viking_room.png";
 
   // read texture from file, create image and device memory
   {
-    VkBuffer staging_buffer = nullptr;
-    VkDeviceMemory staging_buffer_memory = nullptr;
-
-    const ImageLoader image(texture_path.string());
-    texture_mip_levels_ = 1 + static_cast<ui32>(std::floor(std::log2(std::max(
-                                  image.GetWidth(), image.GetHeight()))));
-    const auto image_data = image.GetData();
-    CreateBuffer(image_data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 staging_buffer, staging_buffer_memory);
-
-    VulkanUtility::MapCopyUnmap(image_data.data(), image_data.size(), device_,
-                                staging_buffer_memory);
-
-    CreateImage(image.GetWidth(), image.GetHeight(), texture_mip_levels_,
-                VK_SAMPLE_COUNT_1_BIT, image_format, VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-                    VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                    VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
-                texture_image_memory_);
-
-    annotate_.SetObjectName(device_, texture_image_, "texture image");
-    annotate_.SetObjectName(device_, texture_image_memory_, "texture memory");
-
-    ExecuteSingleTimeCommands([&](VkCommandBuffer command_buffer) {
-      TransitionImageLayout(command_buffer, texture_image_, image_format,
-                            VK_IMAGE_LAYOUT_UNDEFINED,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            texture_mip_levels_);
-      CopyBufferToImage(command_buffer, staging_buffer, texture_image_,
-                        image.GetWidth(), image.GetHeight());
-      // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while
-      // generating mips
-      GenerateMipMaps_Blit(command_buffer, texture_image_, image.GetWidth(),
-                           image.GetHeight(), texture_mip_levels_);
-    });
+    // baked textures come with all mips, others get them from blits
+    std::optional<BakedTexture>& baked = texture_source_.baked;
+    std::vector<TextureMip> mips;
+    DecodedImage decoded;
+    ui32 width = 0;
+    ui32 height = 0;
+    PixelLayout layout;
+    std::span<const ui8> image_data;
+    if (replay_) {
+      std::optional<TextureFormat> traced_format;
+      if (!replay_->textures.empty()) {
+        traced_format = FindTextureFormat(replay_->textures.front().format);
+      }
+      [[unlikely]] if (!traced_format) {
+        throw std::runtime_error("trace has no texture of a known format");
+      }
+      const TracedTexture& texture = replay_->textures.front();
+      width = texture.width;
+      height = texture.height;
+      layout = traced_format->layout;
+      const size_t pixel_size = GetPixelSize(layout);
+      const ui64 num_pixels = ui64{width} * height;
+      [[unlikely]] if (num_pixels > texture.pixels.size() / pixel_size ||
+                       num_pixels * pixel_size != texture.pixels.size()) {
+        throw std::runtime_error(fmt::format(
+            "trace texture {}x{} with {} bytes per pixel has {} bytes", width,
+            height, pixel_size, texture.pixels.size()));
+      }
+      image_data = texture.pixels;
+    } else if (const std::filesystem::path baked_path =
+                   std::filesystem::path(texture_path).replace_extension(
+                       ".tex");
+               std::filesystem::exists(baked_path)) {
+      texture_path = baked_path;
+      baked.emplace(baked_path);
+      width = baked->GetWidth();
+      height = baked->GetHeight();
+      layout = baked->GetLayout();
+      mips.assign(baked->GetMips().begin(), baked->GetMips().end());
+    } else {
+      const FileBuffer source = co_await scheduler_->ReadFile(texture_path);
+      decoded = co_await scheduler_->Run([&]() {
+        return DecodeImageCached(source, derived_data_cache_.get());
+      });
+      width = decoded.width;
+      height = decoded.height;
+      layout = decoded.layout;
+      image_data = decoded.pixels;
+    }
 
-    VulkanUtility::Destroy<vkDestroyBuffer>(device_, staging_buffer);
-    VulkanUtility::FreeMemory(device_, staging_buffer_memory);
+    // Quality tier skips the largest levels. Baked textures just start from
+    // a smaller level, others are reduced right after decoding. Recorded
+    // textures were reduced when they were recorded
+    const std::string texture_name = texture_path.stem().string();
+    ui32 quality = config_.texture_quality;
+    if (auto it = config_.texture_quality_overrides.find(texture_name);
+        it != config_.texture_quality_overrides.end()) {
+      quality = it->second;
+    }
+    const ui32 full_width = width;
+    const ui32 full_height = height;
+    const ui32 num_levels =
+        1 + static_cast<ui32>(std::floor(std::log2(std::max(width, height))));
+    const ui32 skipped = replay_ ? 0 : std::min(quality, num_levels - 1);
+    ui64 baked_offset = 0;
+    if (skipped != 0 && baked) {
+      mips.erase(mips.begin(), mips.begin() + skipped);
+      baked_offset = RebaseMips(mips);
+      width = mips.front().width;
+      height = mips.front().height;
+    } else if (skipped != 0) {
+      TextureMip reduced;
+      decoded.pixels = co_await scheduler_->Run([&]() {
+        return ReduceImage(width, height, layout, image_data, skipped, reduced);
+      });
+      image_data = decoded.pixels;
+      width = reduced.width;
+      height = reduced.height;
+    }
+
+    // shaders sample with linear filtering, mips of textures that are not
+    // baked are generated by blits
+    VkFormatFeatureFlags required_features =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if (!baked) {
+      required_features |=
+          VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    }
+    const TextureFormat format =
+        ChooseTextureFormat(layout, [&](VkFormat candidate) {
+          const VkFormatFeatureFlags features =
+              device_info_->GetFormatProperties(candidate)
+                  .optimalTilingFeatures;
+          return (features & required_features) == required_features;
+        });
+
+    // baked levels stay compressed until they are decoded into staging memory,
+    // conversion and tracing need them on the host
+    std::vector<ui8> baked_levels;
+    if (baked && (format.layout != layout || trace_writer_)) {
+      baked_levels.resize(mips.back().offset + mips.back().size);
+      baked->ReadLevels(baked_offset, baked_levels, thread_pool_.get());
+      image_data = baked_levels;
+    }
+
+    // the device lacks the compact format, texels are expanded to rgba
+    std::vector<ui8> converted;
+    if (format.layout != layout) {
+      converted = co_await scheduler_->Run([&]() {
+        return baked ? ConvertMipChain(image_data, mips, layout, format.layout)
+                     : ConvertPixels(image_data, layout, format.layout);
+      });
+      image_data = converted;
+    }
+    spdlog::info("texture {}: {}x{}, {} channels, format {}",
+                 texture_path.filename().string(), width, height,
+                 layout.channels, static_cast<int>(format.format));
+    if (skipped != 0) {
+      const size_t pixel_size = GetPixelSize(format.layout);
+      const auto get_chain_size = [&](ui32 chain_width, ui32 chain_height) {
+        const TextureMip last =
+            GetMipChainLayout(chain_width, chain_height, pixel_size).back();
+        return last.offset + last.size;
+      };
+      const ui64 saved = get_chain_size(full_width, full_height) -
+                         get_chain_size(width, height);
+      spdlog::info(
+          "texture {}: quality tier {} skips {} levels, {}x{} instead of "
+          "{}x{}, {} KiB of device memory saved",
+          texture_name, quality, skipped, width, height, full_width,
+          full_height, saved >> 10);
+    }
+
+    if (trace_writer_) {
+      trace_writer_->WriteTexture(
+          width, height, format.format,
+          baked ? image_data.subspan(mips.front().offset, mips.front().size)
+                : image_data);
+    }
+
+    texture_source_.name = texture_name;
+    texture_source_.format = format;
+    if (baked) {
+      texture_source_.mips = std::move(mips);
+      if (converted.empty()) {
+        texture_source_.baked_offset = baked_offset;
+      } else {
+        // converted levels replace the mapped file
+        texture_source_.levels = std::move(converted);
+        baked.reset();
+      }
+      UploadTextureLevels(0);
+    } else {
+      texture_source_.mips = GetMipChainLayout(width, height,
+                                               GetPixelSize(format.layout));
+      UploadTextureBlit(image_data);
+      // evicted levels are restored from a chain built from the base level
+      if (!converted.empty()) {
+        texture_source_.pixels = std::move(converted);
+      } else if (!decoded.pixels.empty()) {
+        texture_source_.pixels = std::move(decoded.pixels);
+      } else {
+        texture_source_.pixels.assign(image_data.begin(), image_data.end());
+      }
+    }
   }
+}
 
-  // create image view
+void Application::UploadTextureBlit(std::span<const ui8> pixels) {
+  const VkFormat format = texture_source_.format.format;
+  const ui32 width = texture_source_.mips.front().width;
+  const ui32 height = texture_source_.mips.front().height;
+  texture_mip_levels_ = static_cast<ui32>(texture_source_.mips.size());
+
+  VkBuffer staging_buffer = nullptr;
+  VkDeviceMemory staging_buffer_memory = nullptr;
+  CreateBuffer(pixels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               staging_buffer, staging_buffer_memory);
+  VulkanUtility::MapCopyUnmap(pixels.data(), pixels.size(), device_,
+                              staging_buffer_memory);
+
+  CreateImage(width, height, texture_mip_levels_, VK_SAMPLE_COUNT_1_BIT,
+              format, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_image_,
+              texture_image_memory_);
+  annotate_.SetObjectName(device_, texture_image_, "texture image");
+  annotate_.SetObjectName(device_, texture_image_memory_, "texture memory");
+
+  // copy on the transfer queue, mips are generated by blits on the graphics
+  // queue
+  constexpr VkAccessFlags blit_access =
+      VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  ExecuteUploadCommands(
+      [&](VkCommandBuffer command_buffer) {
+        TransitionImageLayout(command_buffer, texture_image_, format,
+                              VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              texture_mip_levels_);
+        CopyBufferToImage(command_buffer, staging_buffer, texture_image_,
+                          width, height);
+        TransferOwnership(command_buffer, true, texture_image_,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          texture_mip_levels_, blit_access,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT);
+      },
+      [&](VkCommandBuffer command_buffer) {
+        TransferOwnership(command_buffer, false, texture_image_,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          texture_mip_levels_, blit_access,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT);
+        // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while
+        // generating mips
+        GenerateMipMaps_Blit(command_buffer, texture_image_, width, height,
+                             texture_mip_levels_);
+      },
+      VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  VulkanUtility::Destroy<vkDestroyBuffer>(device_, staging_buffer);
+  VulkanUtility::FreeMemory(device_, staging_buffer_memory);
+
+  texture_image_view_ = CreateImageView(
+      texture_image_, format, VK_IMAGE_ASPECT_COLOR_BIT, texture_mip_levels_,
+      texture_source_.format.swizzle);
+  annotate_.SetObjectName(
+      device_, texture_image_view_,
+      fmt::format("image view for texture {}", texture_source_.name));
+}
+
+void Application::UploadTextureLevels(ui32 first_mip) {
+  TextureSource& source = texture_source_;
+  if (!source.baked && source.levels.empty()) {
+    // mips of this texture came from blits, the host copy is built once
+    source.levels =
+        GenerateMipChain(source.mips.front().width, source.mips.front().height,
+                         source.format.layout, source.pixels, source.mips);
+    source.pixels = {};
+  }
+
+  // offsets of the copy are relative to the first resident level
+  std::vector<TextureMip> mips(source.mips.begin() + first_mip,
+                               source.mips.end());
+  const ui64 levels_offset = RebaseMips(mips);
+  const size_t levels_size = mips.back().offset + mips.back().size;
+
+  VkBuffer staging_buffer = nullptr;
+  VkDeviceMemory staging_buffer_memory = nullptr;
+  CreateBuffer(levels_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               staging_buffer, staging_buffer_memory);
+  if (source.baked) {
+    // blocks are decoded on the pool straight into the staging buffer
+    void* mapped = nullptr;
+    VkWrap(vkMapMemory)(device_, staging_buffer_memory, 0u, levels_size, 0u,
+                        &mapped);
+    const auto start = std::chrono::steady_clock::now();
+    source.baked->ReadLevels(
+        source.baked_offset + levels_offset,
+        std::span(static_cast<ui8*>(mapped), levels_size), thread_pool_.get());
+    LogDecompression(source.name, source.baked->GetLevelsSize(),
+                     source.baked->GetStoredSize(), levels_size,
+                     std::chrono::steady_clock::now() - start);
+    vkUnmapMemory(device_, staging_buffer_memory);
+  } else {
+    VulkanUtility::MapCopyUnmap(source.levels.data() + levels_offset,
+                                levels_size, device_, staging_buffer_memory);
+  }
+
+  const VkFormat format = source.format.format;
+  const ui32 mip_levels = static_cast<ui32>(mips.size());
+  VkImage image = nullptr;
+  VkDeviceMemory image_memory = nullptr;
+  CreateImage(mips.front().width, mips.front().height, mip_levels,
+              VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, image_memory);
+  annotate_.SetObjectName(device_, image, "texture image");
+  annotate_.SetObjectName(device_, image_memory, "texture memory");
+
+  // every level is copied on the transfer queue, the graphics queue only
+  // makes the image readable by shaders
+  ExecuteUploadCommands(
+      [&](VkCommandBuffer command_buffer) {
+        TransitionImageLayout(command_buffer, image, format,
+                              VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              mip_levels);
+        CopyBufferToImage(command_buffer, staging_buffer, image, mips);
+        TransferOwnership(command_buffer, true, image,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels,
+                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT);
+      },
+      [&](VkCommandBuffer command_buffer) {
+        TransferOwnership(command_buffer, false, image,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels,
+                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT);
+        TransitionImageLayout(command_buffer, image, format,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              mip_levels);
+      },
+      VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  VulkanUtility::Destroy<vkDestroyBuffer>(device_, staging_buffer);
+  VulkanUtility::FreeMemory(device_, staging_buffer_memory);
+
+  // callers wait for the device, so the previous image is not used anymore
+  descriptor_allocator_->ReleaseSetsUsing(texture_image_view_);
+  VulkanUtility::Destroy<vkDestroyImageView>(device_, texture_image_view_);
+  VulkanUtility::Destroy<vkDestroyImage>(device_, texture_image_);
+  VulkanUtility::FreeMemory(device_, texture_image_memory_);
+  texture_image_ = image;
+  texture_image_memory_ = image_memory;
+  texture_mip_levels_ = mip_levels;
   texture_image_view_ =
-      CreateImageView(texture_image_, image_format, VK_IMAGE_ASPECT_COLOR_BIT,
-                      texture_mip_levels_);
+      CreateImageView(texture_image_, format, VK_IMAGE_ASPECT_COLOR_BIT,
+                      texture_mip_levels_, source.format.swizzle);
   annotate_.SetObjectName(
       device_, texture_image_view_,
-      fmt::format("image view for texture {}", texture_path.stem().string()));
+      fmt::format("image view for texture {}", source.name));
+}
 
-  // create texture sampler
-  {
-    VkSamplerCreateInfo sampler_info{};
-    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    sampler_info.magFilter = VK_FILTER_LINEAR;  // oversampling
-    sampler_info.minFilter = VK_FILTER_LINEAR;  // undersampling
-    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.anisotropyEnable = device_info_->features.samplerAnisotropy;
-    sampler_info.maxAnisotropy =
-        device_info_->properties.limits.maxSamplerAnisotropy;
-    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    sampler_info.unnormalizedCoordinates = kVkFalse;
-    sampler_info.compareEnable = kVkFalse;
-    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    sampler_info.mipLodBias = 0.0f;
-    sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = static_cast<float>(texture_mip_levels_);
-    VkWrap(vkCreateSampler)(device_, &sampler_info, nullptr, &texture_sampler_);
-    annotate_.SetObjectName(device_, texture_sampler_, "texture sampler");
+void Application::CreateTextureSampler() {
+  const float max_anisotropy =
+      device_info_->properties.limits.maxSamplerAnisotropy;
+  const bool anisotropy = device_info_->features.samplerAnisotropy &&
+                          config_.max_anisotropy > 1;
+  if (static_cast<float>(config_.max_anisotropy) > max_anisotropy) {
+    spdlog::warn("max_anisotropy {} is clamped to the device limit {}",
+                 config_.max_anisotropy, max_anisotropy);
   }
+
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_LINEAR;  // oversampling
+  sampler_info.minFilter = VK_FILTER_LINEAR;  // undersampling
+  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  sampler_info.anisotropyEnable = anisotropy ? kVkTrue : kVkFalse;
+  sampler_info.maxAnisotropy =
+      std::min(static_cast<float>(config_.max_anisotropy), max_anisotropy);
+  sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  sampler_info.unnormalizedCoordinates = kVkFalse;
+  sampler_info.compareEnable = kVkFalse;
+  sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  sampler_info.mipLodBias = 0.0f;
+  sampler_info.minLod = 0.0f;
+  sampler_info.maxLod = static_cast<float>(texture_mip_levels_);
+  VkWrap(vkCreateSampler)(device_, &sampler_info, nullptr, &texture_sampler_);
+  annotate_.SetObjectName(device_, texture_sampler_, "texture sampler");
 }
 
 void Application::CreateDepthResources() {
@@ -828,10 +1320,15 @@ void Application::CreateColorResources() {
 }
 
 VkCommandBuffer Application::BeginSingleTimeCommands() {
+  return BeginSingleTimeCommands(transient_command_pool_);
+}
+
+VkCommandBuffer Application::BeginSingleTimeCommands(
+    VkCommandPool command_pool) {
   VkCommandBufferAllocateInfo alloc_info{};
   alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  alloc_info.commandPool = transient_command_pool_;
+  alloc_info.commandPool = command_pool;
   alloc_info.commandBufferCount = 1;
 
   VkCommandBuffer command_buffer{};
@@ -853,86 +1350,508 @@ void Application::EndSingleTimeCommands(VkCommandBuffer command_buffer) {
   submit_info.commandBufferCount = 1;
   submit_info.pCommandBuffers = &command_buffer;
 
-  VkWrap(vkQueueSubmit)(graphics_queue_, 1u, &submit_info, nullptr);
-  VkWrap(vkQueueWaitIdle)(graphics_queue_);
+  // the fence covers earlier work of the graphics queue, but not other
+  // queues and not what is submitted while waiting
+  VkFence fence = CreateFence();
+  VkWrap(vkQueueSubmit)(graphics_queue_, 1u, &submit_info, fence);
+  startup_profiler_.MeasureWait([&] {
+    VkWrap(vkWaitForFences)(device_, 1u, &fence, kVkTrue, UINT64_MAX);
+  });
 
+  VulkanUtility::Destroy<vkDestroyFence>(device_, fence);
   vkFreeCommandBuffers(device_, transient_command_pool_, 1u, &command_buffer);
 }
 
-namespace std {
-template <>
-struct hash<tinyobj::index_t> {
-  size_t operator()(const tinyobj::index_t& index) const noexcept {
-    return (hash<int>()(index.vertex_index) ^
-            hash<int>()(index.texcoord_index) ^
-            hash<int>()(index.normal_index));
-  }
-};
-}  // namespace std
-
-namespace tinyobj {
-bool operator==(const index_t& a, const index_t& b) noexcept {
-  return a.vertex_index == b.vertex_index &&
-         a.texcoord_index == b.texcoord_index &&
-         a.normal_index == b.normal_index;
-}
-}  // namespace tinyobj
-
-void Application::LoadModel() {
-  tinyobj::attrib_t attrib;
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-  std::string warn, err;
-
-  const auto model_path = (GetModelsDir() / "viking_room.obj").string();
-
-  [[unlikely]] if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
-                                     model_path.data())) {
-    throw std::runtime_error(warn + err);
-  }
-
-  std::unordered_map<tinyobj::index_t, ui32> index_remap;
-  for (const tinyobj::shape_t& shape : shapes) {
-    indices_.reserve(indices_.size() + shape.mesh.indices.size());
-    for (const tinyobj::index_t& model_index : shape.mesh.indices) {
-      auto map_iterator = index_remap.find(model_index);
-      if (map_iterator == index_remap.end()) {
-        Vertex v{};
-        const size_t vertex_offset =
-            static_cast<size_t>(3 * model_index.vertex_index);
-        v.pos = {attrib.vertices[vertex_offset + 0u],
-                 attrib.vertices[vertex_offset + 1u],
-                 attrib.vertices[vertex_offset + 2u]};
-
-        const size_t texcoord_offset =
-            static_cast<size_t>(2 * model_index.texcoord_index);
-        v.tex_coord = {attrib.texcoords[texcoord_offset + 0u],
-                       1.0f - attrib.texcoords[texcoord_offset + 1u]};
-        v.color = {1.0f, 1.0f, 1.0f};
-        const ui32 index = static_cast<ui32>(vertices_.size());
-        vertices_.push_back(v);
-
-        auto [it, inserted] = index_remap.insert({model_index, index});
-        map_iterator = it;
+void Application::EndUploadCommands(VkCommandBuffer copy_command_buffer,
+                                    VkCommandBuffer acquire_command_buffer,
+                                    VkPipelineStageFlags acquire_stage) {
+  VkWrap(vkEndCommandBuffer)(copy_command_buffer);
+  VkWrap(vkEndCommandBuffer)(acquire_command_buffer);
+
+  PendingAcquire& acquire = pending_acquires_.emplace_back();
+  acquire.command_buffer = acquire_command_buffer;
+  acquire.semaphore = AcquireUploadSemaphore();
+  acquire.fence = CreateFence();
+
+  VkSubmitInfo copy_submit_info{};
+  copy_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  copy_submit_info.commandBufferCount = 1;
+  copy_submit_info.pCommandBuffers = &copy_command_buffer;
+  copy_submit_info.signalSemaphoreCount = 1;
+  copy_submit_info.pSignalSemaphores = &acquire.semaphore;
+  VkFence copy_fence = CreateFence();
+  VkWrap(vkQueueSubmit)(NextTransferQueue(), 1u, &copy_submit_info,
+                        copy_fence);
+
+  VkSubmitInfo acquire_submit_info{};
+  acquire_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquire_submit_info.waitSemaphoreCount = 1;
+  acquire_submit_info.pWaitSemaphores = &acquire.semaphore;
+  acquire_submit_info.pWaitDstStageMask = &acquire_stage;
+  acquire_submit_info.commandBufferCount = 1;
+  acquire_submit_info.pCommandBuffers = &acquire_command_buffer;
+  VkWrap(vkQueueSubmit)(graphics_queue_, 1u, &acquire_submit_info,
+                        acquire.fence);
+
+  // staging memory is read only by the copy, frames that are drawn later
+  // wait for the acquire part in the graphics queue
+  startup_profiler_.MeasureWait([&] {
+    VkWrap(vkWaitForFences)(device_, 1u, &copy_fence, kVkTrue, UINT64_MAX);
+  });
+
+  VulkanUtility::Destroy<vkDestroyFence>(device_, copy_fence);
+  vkFreeCommandBuffers(device_, transfer_command_pool_, 1u,
+                       &copy_command_buffer);
+}
+
+void Application::ReleaseFinishedAcquires() {
+  std::erase_if(pending_acquires_, [&](PendingAcquire& acquire) {
+    if (vkGetFenceStatus(device_, acquire.fence) != VK_SUCCESS) {
+      return false;
+    }
+
+    VulkanUtility::Destroy<vkDestroyFence>(device_, acquire.fence);
+    ReleaseUploadSemaphore(acquire.semaphore);
+    vkFreeCommandBuffers(device_, transient_command_pool_, 1u,
+                         &acquire.command_buffer);
+    return true;
+  });
+}
+
+VkFence Application::CreateFence() const {
+  VkFenceCreateInfo fence_info{};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence = nullptr;
+  VkWrap(vkCreateFence)(device_, &fence_info, nullptr, &fence);
+  return fence;
+}
+
+VkSemaphore Application::AcquireUploadSemaphore() {
+  if (!free_upload_semaphores_.empty()) {
+    const VkSemaphore semaphore = free_upload_semaphores_.back();
+    free_upload_semaphores_.pop_back();
+    return semaphore;
+  }
+
+  VkSemaphoreCreateInfo create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VkSemaphore semaphore = nullptr;
+  VkWrap(vkCreateSemaphore)(device_, &create_info, nullptr, &semaphore);
+  return semaphore;
+}
+
+void Application::ReleaseUploadSemaphore(VkSemaphore semaphore) {
+  free_upload_semaphores_.push_back(semaphore);
+}
+
+VkQueue Application::NextTransferQueue() {
+  const VkQueue queue = transfer_queues_[next_transfer_queue_];
+  next_transfer_queue_ = (next_transfer_queue_ + 1) % transfer_queues_.size();
+  return queue;
+}
+
+void Application::SubmitUpload(AsyncUpload& upload,
+                               VkPipelineStageFlags acquire_stage) {
+  upload.fence = CreateFence();
+
+  VkSubmitInfo acquire_submit_info{};
+  acquire_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquire_submit_info.commandBufferCount = 1;
+  acquire_submit_info.pCommandBuffers = &upload.acquire_command_buffer;
+  if (upload.copy_command_buffer) {
+    VkWrap(vkEndCommandBuffer)(upload.copy_command_buffer);
+    VkSubmitInfo copy_submit_info{};
+    copy_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    copy_submit_info.commandBufferCount = 1;
+    copy_submit_info.pCommandBuffers = &upload.copy_command_buffer;
+    copy_submit_info.signalSemaphoreCount = 1;
+    upload.semaphore = AcquireUploadSemaphore();
+    copy_submit_info.pSignalSemaphores = &upload.semaphore;
+    VkWrap(vkQueueSubmit)(NextTransferQueue(), 1u, &copy_submit_info,
+                          nullptr);
+
+    acquire_submit_info.waitSemaphoreCount = 1;
+    acquire_submit_info.pWaitSemaphores = &upload.semaphore;
+    acquire_submit_info.pWaitDstStageMask = &acquire_stage;
+  }
+
+  VkWrap(vkEndCommandBuffer)(upload.acquire_command_buffer);
+  VkWrap(vkQueueSubmit)(graphics_queue_, 1u, &acquire_submit_info,
+                        upload.fence);
+}
+
+Task<void> Application::AwaitUpload(AsyncUpload& upload) {
+  co_await scheduler_->WaitFence(upload.fence);
+
+  VulkanUtility::Destroy<vkDestroyFence>(device_, upload.fence);
+  if (upload.semaphore) {
+    ReleaseUploadSemaphore(upload.semaphore);
+    upload.semaphore = nullptr;
+  }
+  if (upload.copy_command_buffer) {
+    vkFreeCommandBuffers(device_, transfer_command_pool_, 1u,
+                         &upload.copy_command_buffer);
+    upload.copy_command_buffer = nullptr;
+  }
+  vkFreeCommandBuffers(device_, transient_command_pool_, 1u,
+                       &upload.acquire_command_buffer);
+  upload.acquire_command_buffer = nullptr;
+}
+
+void Application::TransferOwnership(VkCommandBuffer command_buffer,
+                                    bool release, VkBuffer buffer,
+                                    VkAccessFlags dst_access,
+                                    VkPipelineStageFlags dst_stage) const {
+  if (!NeedsOwnershipTransfer()) {
+    return;
+  }
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      release ? VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT) : VkAccessFlags(0);
+  barrier.dstAccessMask = release ? VkAccessFlags(0) : dst_access;
+  barrier.srcQueueFamilyIndex = device_info_->GetTransferQueueFamilyIndex();
+  barrier.dstQueueFamilyIndex = device_info_->GetGraphicsQueueFamilyIndex();
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  const VkPipelineStageFlags src_stage =
+      release ? VK_PIPELINE_STAGE_TRANSFER_BIT
+              : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  const VkPipelineStageFlags barrier_dst_stage =
+      release ? VkPipelineStageFlags(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+              : dst_stage;
+  vkCmdPipelineBarrier(command_buffer, src_stage, barrier_dst_stage, 0, 0,
+                       nullptr, 1, &barrier, 0, nullptr);
+}
+
+void Application::TransferOwnership(VkCommandBuffer command_buffer,
+                                    bool release, VkImage image,
+                                    VkImageLayout layout, ui32 mip_levels,
+                                    VkAccessFlags dst_access,
+                                    VkPipelineStageFlags dst_stage) const {
+  if (!NeedsOwnershipTransfer()) {
+    return;
+  }
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask =
+      release ? VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT) : VkAccessFlags(0);
+  barrier.dstAccessMask = release ? VkAccessFlags(0) : dst_access;
+  barrier.oldLayout = layout;
+  barrier.newLayout = layout;
+  barrier.srcQueueFamilyIndex = device_info_->GetTransferQueueFamilyIndex();
+  barrier.dstQueueFamilyIndex = device_info_->GetGraphicsQueueFamilyIndex();
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = mip_levels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  const VkPipelineStageFlags src_stage =
+      release ? VK_PIPELINE_STAGE_TRANSFER_BIT
+              : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  const VkPipelineStageFlags barrier_dst_stage =
+      release ? VkPipelineStageFlags(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+              : dst_stage;
+  vkCmdPipelineBarrier(command_buffer, src_stage, barrier_dst_stage, 0, 0,
+                       nullptr, 0, nullptr, 1, &barrier);
+}
+
+void Application::LoadScene() {
+  if (!replay_) {
+    std::vector<std::filesystem::path> mesh_files;
+    if (config_.scene.empty()) {
+      // baked by the build, the source is used when running from the tree
+      const std::filesystem::path baked = GetModelsDir() / "viking_room.mesh";
+      mesh_files.push_back(std::filesystem::exists(baked)
+                               ? baked
+                               : GetModelsDir() / "viking_room.obj");
+    } else {
+      mesh_files = ReadSceneFile(config_.scene);
+    }
+
+    if (IsMeshStreamingEnabled()) {
+      // only baked meshes know their bounds before they are loaded
+      streamed_files_.resize(mesh_files.size());
+      for (size_t i = 0; i != mesh_files.size(); ++i) {
+        if (const auto bounds = ReadBakedMeshBounds(mesh_files[i])) {
+          streamed_files_[i].placeholder =
+              static_cast<ui32>(scene_geometry_.GetMeshes().size());
+          AddBoxMesh(mesh_files[i].stem().string(), *bounds, scene_geometry_);
+        }
+      }
+
+      streaming_start_ = GetGlobalTime();
+      for (size_t i = 0; i != mesh_files.size(); ++i) {
+        scheduler_->Spawn(
+            StreamMeshFile(static_cast<ui32>(i), std::move(mesh_files[i])));
       }
+    } else {
+      LoadSceneMeshes(mesh_files, scene_geometry_, derived_data_cache_.get(),
+                      thread_pool_.get());
+    }
+  } else {
+    [[unlikely]] if (replay_->vertex_stride != sizeof(Vertex) ||
+                     replay_->vertices.size() % sizeof(Vertex) != 0) {
+      throw std::runtime_error(fmt::format(
+          "trace vertices have stride {}, expected {}", replay_->vertex_stride,
+          sizeof(Vertex)));
+    }
 
-      indices_.push_back(map_iterator->second);
+    // recorded draws have to stay inside the recorded geometry
+    const ui64 num_vertices = replay_->vertices.size() / sizeof(Vertex);
+    for (const TracedDraw& draw : replay_->commands.draws) {
+      [[unlikely]] if (ui64{draw.first_index} + draw.index_count >
+                       replay_->indices.size()) {
+        throw std::runtime_error(fmt::format(
+            "trace draw of indices [{}, {}) exceeds {} indices",
+            draw.first_index, ui64{draw.first_index} + draw.index_count,
+            replay_->indices.size()));
+      }
+
+      const auto indices = std::span(replay_->indices)
+                               .subspan(draw.first_index, draw.index_count);
+      for (const ui32 index : indices) {
+        const i64 vertex = i64{draw.vertex_offset} + index;
+        [[unlikely]] if (vertex < 0 ||
+                         static_cast<ui64>(vertex) >= num_vertices) {
+          throw std::runtime_error(fmt::format(
+              "trace draw with vertex offset {} uses vertex {} of {}",
+              draw.vertex_offset, vertex, num_vertices));
+        }
+      }
     }
+
+    // draws come from the trace, so all geometry is kept as one mesh
+    std::vector<Vertex> vertices(replay_->vertices.size() / sizeof(Vertex));
+    std::memcpy(vertices.data(), replay_->vertices.data(),
+                replay_->vertices.size());
+    scene_geometry_.AddMesh(replay_path_.stem().string(), vertices,
+                            replay_->indices);
   }
+
+  scene_bounds_ = ComputeBounds(scene_geometry_.GetVertices());
+}
+
+bool Application::IsMeshStreamingEnabled() const noexcept {
+  // these need the whole scene in the first frame
+  return config_.mesh_streaming && !replay_ && !trace_writer_ &&
+         !regression_check_;
 }
 
 void Application::CreateVertexBuffers() {
-  CreateGpuBuffer(std::span<const Vertex>(vertices_),
+  const std::vector<Vertex>& vertices = scene_geometry_.GetVertices();
+  if (trace_writer_) {
+    trace_writer_->WriteVertices(
+        sizeof(Vertex),
+        std::span(reinterpret_cast<const ui8*>(vertices.data()),
+                  vertices.size() * sizeof(Vertex)));
+  }
+
+  // streamed scenes start empty when none of the files is baked
+  if (vertices.empty()) {
+    return;
+  }
+
+  if (config_.split_vertex_streams) {
+    const VertexStreams streams = SplitVertexStreams(vertices);
+    CreateGpuBuffer(std::span<const glm::vec3>(streams.positions),
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_,
+                    vertex_buffer_memory_);
+    CreateGpuBuffer(std::span<const VertexAttributes>(streams.attributes),
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, attribute_buffer_,
+                    attribute_buffer_memory_);
+    return;
+  }
+
+  CreateGpuBuffer(std::span<const Vertex>(vertices),
                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_,
                   vertex_buffer_memory_);
 }
 
 void Application::CreateIndexBuffers() {
-  CreateGpuBuffer(std::span<const ui32>(indices_),
+  const std::vector<ui32>& indices = scene_geometry_.GetIndices();
+  if (trace_writer_) {
+    trace_writer_->WriteIndices(indices);
+  }
+
+  if (indices.empty()) {
+    return;
+  }
+
+  CreateGpuBuffer(std::span<const ui32>(indices),
                   VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_,
                   index_buffer_memory_);
 }
 
+Task<void> Application::StreamMeshFile(ui32 file,
+                                       std::filesystem::path path) {
+  // The work keeps its own copies of the path and the source, it may finish
+  // on the pool after this coroutine is destroyed. Obj sources are read by
+  // the file reader, baked and glb files are memory mapped
+  const bool is_obj = path.extension() == ".obj";
+  std::pair<SceneGeometry, MeshBounds> loaded;
+  try {
+    FileBuffer source;
+    if (is_obj) {
+      source = co_await scheduler_->ReadFile(path);
+    }
+    loaded = co_await scheduler_->Run(
+        [path, is_obj, source = std::move(source),
+         cache = derived_data_cache_.get(),
+         thread_pool = thread_pool_.get()]() {
+          std::pair<SceneGeometry, MeshBounds> result;
+          if (is_obj) {
+            std::vector<Vertex> vertices;
+            std::vector<ui32> indices;
+            ParseObjModelCached(source, cache, vertices, indices);
+            result.first.AddMesh(path.stem().string(), vertices, indices);
+          } else {
+            LoadSceneMeshes(std::span(&path, 1), result.first, cache,
+                            thread_pool);
+          }
+          result.second = ComputeBounds(result.first.GetVertices());
+          return result;
+        });
+  } catch (const std::exception& e) {
+    spdlog::error("failed to load mesh {}: {}", path.string(), e.what());
+  }
+
+  const auto& [geometry, bounds] = loaded;
+  if (geometry.GetIndices().empty()) {
+    // nothing to draw, the placeholder is not drawn either
+    MarkFileStreamed(file);
+    co_return;
+  }
+
+  scene_bounds_.Add(bounds);
+  const auto upload = UploadStreamedMesh(file, geometry);
+  co_await AwaitUpload(upload->upload);
+  VulkanUtility::Destroy<vkDestroyBuffer>(device_, upload->staging_buffer);
+  VulkanUtility::FreeMemory(device_, upload->staging_buffer_memory);
+  streamed_meshes_.push_back(std::move(*upload));
+  streamed_uploads_.erase(upload);
+  MarkFileStreamed(file);
+}
+
+std::list<Application::StreamedMesh>::iterator
+Application::UploadStreamedMesh(ui32 file, const SceneGeometry& geometry) {
+  const auto upload =
+      streamed_uploads_.emplace(streamed_uploads_.end(), StreamedMesh{});
+  StreamedMesh& mesh = *upload;
+  mesh.file = file;
+  for (const MeshRange& range : geometry.GetMeshes()) {
+    TracedDraw& draw = mesh.draws.emplace_back();
+    draw.index_count = range.index_count;
+    draw.first_index = range.first_index;
+    draw.vertex_offset = range.vertex_offset;
+  }
+
+  // all vertex streams and indices share the staging buffer
+  struct Stream {
+    std::span<const ui8> data;
+    VkBufferUsageFlags usage = 0;
+    VkBuffer* buffer = nullptr;
+    VkDeviceMemory* memory = nullptr;
+  };
+  const auto as_bytes = [](const auto& values) {
+    return std::span(reinterpret_cast<const ui8*>(values.data()),
+                     values.size() * sizeof(values[0]));
+  };
+  VertexStreams split;
+  std::vector<Stream> streams;
+  if (config_.split_vertex_streams) {
+    split = SplitVertexStreams(geometry.GetVertices());
+    streams.push_back({as_bytes(split.positions),
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &mesh.vertex_buffer,
+                       &mesh.vertex_buffer_memory});
+    streams.push_back({as_bytes(split.attributes),
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                       &mesh.attribute_buffer, &mesh.attribute_buffer_memory});
+  } else {
+    streams.push_back({as_bytes(geometry.GetVertices()),
+                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &mesh.vertex_buffer,
+                       &mesh.vertex_buffer_memory});
+  }
+  streams.push_back({as_bytes(geometry.GetIndices()),
+                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &mesh.index_buffer,
+                     &mesh.index_buffer_memory});
+
+  VkDeviceSize staging_size = 0;
+  for (const Stream& stream : streams) {
+    staging_size += stream.data.size();
+  }
+  CreateBuffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               mesh.staging_buffer, mesh.staging_buffer_memory);
+  VkDeviceSize staging_offset = 0;
+  for (const Stream& stream : streams) {
+    VulkanUtility::MapCopyUnmap(stream.data.data(), stream.data.size(),
+                                device_, mesh.staging_buffer_memory,
+                                staging_offset);
+    staging_offset += stream.data.size();
+    CreateBuffer(stream.data.size(),
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | stream.usage,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, *stream.buffer,
+                 *stream.memory);
+  }
+
+  constexpr VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+  constexpr VkAccessFlags dst_access =
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  mesh.upload = SubmitUploadCommands(
+      [&](VkCommandBuffer command_buffer) {
+        VkBufferCopy region{};
+        for (const Stream& stream : streams) {
+          region.size = stream.data.size();
+          vkCmdCopyBuffer(command_buffer, mesh.staging_buffer, *stream.buffer,
+                          1, &region);
+          region.srcOffset += region.size;
+        }
+        for (const Stream& stream : streams) {
+          TransferOwnership(command_buffer, true, *stream.buffer, dst_access,
+                            dst_stage);
+        }
+      },
+      [&](VkCommandBuffer command_buffer) {
+        for (const Stream& stream : streams) {
+          TransferOwnership(command_buffer, false, *stream.buffer, dst_access,
+                            dst_stage);
+        }
+      },
+      dst_stage);
+  return upload;
+}
+
+void Application::MarkFileStreamed(ui32 file) {
+  streamed_files_[file].loaded = true;
+  streamed_meshes_changed_ = true;
+  if (++num_streamed_files_ == streamed_files_.size()) {
+    spdlog::info("streamed {} mesh files in {:.1f} ms", streamed_files_.size(),
+                 std::chrono::duration<double, std::milli>(GetGlobalTime() -
+                                                           streaming_start_)
+                     .count());
+  }
+}
+
+void Application::UpdateMeshStreaming() {
+  // streamed files are swapped in together, the frame never shows a part of
+  // a file
+  if (streamed_meshes_changed_) {
+    streamed_meshes_changed_ = false;
+    // command buffers of frames in flight can't be freed
+    VkWrap(vkDeviceWaitIdle)(device_);
+    DestroyCommandBuffers();
+    CreateCommandBuffers();
+  }
+}
+
 void Application::CreateUniformBuffers() {
   VkDeviceSize buffer_size = sizeof(UniformBufferObject);
 
@@ -950,67 +1869,29 @@ void Application::CreateUniformBuffers() {
   }
 }
 
-void Application::CreateDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> pool_sizes{};
-  pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  pool_sizes[0].descriptorCount = static_cast<ui32>(swap_chain_images_.size());
-  pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  pool_sizes[1].descriptorCount = static_cast<ui32>(swap_chain_images_.size());
-
-  VkDescriptorPoolCreateInfo pool_info{};
-  pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  pool_info.poolSizeCount = static_cast<ui32>(pool_sizes.size());
-  pool_info.pPoolSizes = pool_sizes.data();
-  pool_info.maxSets = static_cast<ui32>(swap_chain_images_.size());
-
-  VkWrap(vkCreateDescriptorPool)(device_, &pool_info, nullptr,
-                                 &descriptor_pool_);
-}
-
-void Application::CreateDescriptorSets() {
-  const ui32 num_descriptor_sets = static_cast<ui32>(swap_chain_images_.size());
-  std::vector<VkDescriptorSetLayout> layouts(num_descriptor_sets,
-                                             descriptor_set_layout_);
-
-  VkDescriptorSetAllocateInfo alloc_info{};
-  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  alloc_info.descriptorPool = descriptor_pool_;
-  alloc_info.descriptorSetCount = num_descriptor_sets;
-  alloc_info.pSetLayouts = layouts.data();
-
-  descriptor_sets_.resize(num_descriptor_sets);
-  VkWrap(vkAllocateDescriptorSets)(device_, &alloc_info,
-                                   descriptor_sets_.data());
-
-  for (ui32 i = 0; i < num_descriptor_sets; ++i) {
-    std::array<VkWriteDescriptorSet, 2> wds{};
-
-    VkDescriptorBufferInfo buffer_info{};
-    buffer_info.buffer = uniform_buffers_[i];
-    buffer_info.offset = 0;
-    buffer_info.range = sizeof(UniformBufferObject);
-    wds[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    wds[0].dstSet = descriptor_sets_[i];
-    wds[0].dstBinding = 0;
-    wds[0].dstArrayElement = 0;
-    wds[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    wds[0].descriptorCount = 1;
-    wds[0].pBufferInfo = &buffer_info;
-
-    VkDescriptorImageInfo image_info{};
-    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    image_info.imageView = texture_image_view_;
-    image_info.sampler = texture_sampler_;
-    wds[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    wds[1].dstSet = descriptor_sets_[i];
-    wds[1].dstBinding = 1;
-    wds[1].dstArrayElement = 0;
-    wds[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    wds[1].descriptorCount = 1;
-    wds[1].pImageInfo = &image_info;
+void Application::UpdateDescriptorSets() {
+  // resources of a texture or uniform buffer that was released get a set of
+  // the free list, which may be a different one or the same one written again
+  const ui64 num_writes = descriptor_allocator_->GetNumWrites();
+  bool changed = descriptor_sets_.size() != uniform_buffers_.size();
+  descriptor_sets_.resize(uniform_buffers_.size());
+  // resources are in the order of binding numbers
+  static_assert(kUniformBufferBinding < kTextureBinding);
+  for (size_t i = 0; i != descriptor_sets_.size(); ++i) {
+    const std::array resources{
+        MakeBufferDescriptor(uniform_buffers_[i], 0,
+                             sizeof(UniformBufferObject)),
+        MakeImageDescriptor(texture_sampler_, texture_image_view_,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)};
+    const VkDescriptorSet set =
+        descriptor_allocator_->GetPersistentSet(resources);
+    changed = std::exchange(descriptor_sets_[i], set) != set || changed;
+  }
 
-    vkUpdateDescriptorSets(device_, static_cast<ui32>(wds.size()), wds.data(),
-                           0, nullptr);
+  changed = changed || descriptor_allocator_->GetNumWrites() != num_writes;
+  if (changed && !command_buffers_.empty()) {
+    DestroyCommandBuffers();
+    CreateCommandBuffers();
   }
 }
 
@@ -1041,6 +1922,30 @@ void Application::CopyBufferToImage(VkCommandBuffer command_buffer,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
+void Application::CopyBufferToImage(VkCommandBuffer command_buffer,
+                                    VkBuffer src, VkImage image,
+                                    std::span<const TextureMip> mips) {
+  std::vector<VkBufferImageCopy> regions(mips.size());
+  for (size_t i = 0; i != mips.size(); ++i) {
+    VkBufferImageCopy& region = regions[i];
+    region.bufferOffset = mips[i].offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = static_cast<ui32>(i);
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {mips[i].width, mips[i].height, 1};
+  }
+
+  vkCmdCopyBufferToImage(command_buffer, src, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         static_cast<ui32>(regions.size()), regions.data());
+}
+
 void Application::TransitionImageLayout(VkCommandBuffer command_buffer,
                                         VkImage image, VkFormat format,
                                         VkImageLayout old_layout,
@@ -1181,6 +2086,63 @@ void Application::GenerateMipMaps_Blit(VkCommandBuffer command_buffer,
                        nullptr, 1, &barrier);
 }
 
+void Application::CreateTelemetry() {
+  if (config_.metrics_port != 0) {
+    telemetry_ = std::make_unique<RendererTelemetry>(
+        config_.metrics_port, *device_info_, memory_budget_enabled_);
+  }
+}
+
+void Application::CreateTimestampQueries() {
+  const ui32 valid_bits =
+      device_info_
+          ->families_properties[device_info_->GetGraphicsQueueFamilyIndex()]
+          .timestampValidBits;
+  if (valid_bits == 0) {
+    spdlog::warn("graphics queue does not support timestamps, gpu frame time "
+                 "is not collected");
+    return;
+  }
+
+  timestamp_mask_ = valid_bits >= 64 ? ~ui64{0} : (ui64{1} << valid_bits) - 1;
+  timestamp_period_ =
+      static_cast<double>(device_info_->properties.limits.timestampPeriod);
+
+  const ui32 num_images = static_cast<ui32>(swap_chain_images_.size());
+  VkQueryPoolCreateInfo create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  create_info.queryCount = 2 * num_images;
+  VkWrap(vkCreateQueryPool)(device_, &create_info, nullptr,
+                            &timestamp_query_pool_);
+  timestamps_pending_.assign(num_images, false);
+}
+
+void Application::ReadGpuFrameTime(ui32 image_index) {
+  if (!timestamp_query_pool_ || !timestamps_pending_[image_index]) {
+    return;
+  }
+
+  // fence of the frame was waited, so results should be ready, but the
+  // call must never block the frame
+  std::array<ui64, 2> timestamps{};
+  const VkResult result = vkGetQueryPoolResults(
+      device_, timestamp_query_pool_, 2 * image_index, 2, sizeof(timestamps),
+      timestamps.data(), sizeof(ui64), VK_QUERY_RESULT_64_BIT);
+  if (result == VK_NOT_READY) {
+    return;
+  }
+
+  [[unlikely]] if (result != VK_SUCCESS) {
+    VkThrow(vkGetQueryPoolResults, result);
+  }
+
+  timestamps_pending_[image_index] = false;
+  const ui64 ticks = (timestamps[1] - timestamps[0]) & timestamp_mask_;
+  frame_stats_.AddGpuTime(std::chrono::nanoseconds(
+      static_cast<i64>(static_cast<double>(ticks) * timestamp_period_)));
+}
+
 void Application::CreateCommandBuffers() {
   ui32 num_buffers = static_cast<ui32>(swap_chain_frame_buffers_.size());
   command_buffers_.resize(num_buffers);
@@ -1193,6 +2155,11 @@ void Application::CreateCommandBuffers() {
   VkWrap(vkAllocateCommandBuffers)(device_, &allocInfo,
                                    command_buffers_.data());
 
+  const std::vector<TracedDraw> draws = GetDraws();
+  if (trace_writer_) {
+    trace_writer_->WriteCommands({swap_chain_extent_, draws});
+  }
+
   for (ui32 i = 0; i != num_buffers; ++i) {
     VkCommandBuffer command_buffer = command_buffers_[i];
 
@@ -1202,6 +2169,12 @@ void Application::CreateCommandBuffers() {
     beginInfo.pInheritanceInfo = nullptr;  // Optional
 
     VkWrap(vkBeginCommandBuffer)(command_buffer, &beginInfo);
+    if (timestamp_query_pool_) {
+      vkCmdResetQueryPool(command_buffer, timestamp_query_pool_, 2 * i, 2);
+      vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                          timestamp_query_pool_, 2 * i);
+    }
+
     std::array<VkClearValue, 2> clear_values{};
     clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
     clear_values[1].depthStencil = {1.0f, 0};
@@ -1221,35 +2194,114 @@ void Application::CreateCommandBuffers() {
     auto draw_frame_label = annotate_.ScopedLabel(command_buffer, "draw frame",
                                                   LabelColor::Green());
     {
-      vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        graphics_pipeline_);
-
-      std::array vertex_buffers{vertex_buffer_};
-      const ui32 num_vertex_buffers = static_cast<ui32>(vertex_buffers.size());
-      std::array offsets{VkDeviceSize(0)};
-      vkCmdBindVertexBuffers(command_buffer, 0, num_vertex_buffers,
-                             vertex_buffers.data(), offsets.data());
-      vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0,
-                           VK_INDEX_TYPE_UINT32);
+      // Both pipelines share the layout, so the descriptor set stays bound.
+      // The prepass binds only the first vertex buffer, with split streams
+      // it holds just positions
       vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                               pipeline_layout_, 0, 1, &descriptor_sets_[i], 0,
                               nullptr);
 
-      ui32 num_instances = 1;
-      const ui32 num_indices = static_cast<ui32>(indices_.size());
-      vkCmdDrawIndexed(command_buffer, num_indices, num_instances, 0, 0, 0);
+      auto draw_meshes = [&](bool positions_only, VkBuffer vertex_buffer,
+                             VkBuffer attribute_buffer, VkBuffer index_buffer,
+                             std::span<const TracedDraw> mesh_draws) {
+        if (mesh_draws.empty()) {
+          return;
+        }
+
+        std::array vertex_buffers{vertex_buffer, attribute_buffer};
+        const ui32 num_vertex_buffers =
+            positions_only || !attribute_buffer ? 1 : 2;
+        std::array offsets{VkDeviceSize(0), VkDeviceSize(0)};
+        vkCmdBindVertexBuffers(command_buffer, 0, num_vertex_buffers,
+                               vertex_buffers.data(), offsets.data());
+        vkCmdBindIndexBuffer(command_buffer, index_buffer, 0,
+                             VK_INDEX_TYPE_UINT32);
+        for (const TracedDraw& draw : mesh_draws) {
+          vkCmdDrawIndexed(command_buffer, draw.index_count,
+                           draw.instance_count, draw.first_index,
+                           draw.vertex_offset, 0);
+        }
+      };
+
+      // all meshes of the scene share these bindings, streamed files have
+      // their own
+      auto draw_scene = [&](VkPipeline pipeline, bool positions_only) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipeline);
+        draw_meshes(positions_only, vertex_buffer_, attribute_buffer_,
+                    index_buffer_, draws);
+        for (const StreamedMesh& mesh : streamed_meshes_) {
+          draw_meshes(positions_only, mesh.vertex_buffer,
+                      mesh.attribute_buffer, mesh.index_buffer, mesh.draws);
+        }
+      };
+
+      if (depth_pipeline_) {
+        auto depth_prepass_label = annotate_.ScopedLabel(
+            command_buffer, "depth prepass", LabelColor::Blue());
+        draw_scene(depth_pipeline_, true);
+      }
+      draw_scene(graphics_pipeline_, false);
     }
 
     vkCmdEndRenderPass(command_buffer);
 
+    if (timestamp_query_pool_) {
+      vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          timestamp_query_pool_, 2 * i + 1);
+    }
+
     VkWrap(vkEndCommandBuffer)(command_buffer);
   }
 }
 
-VkShaderModule Application::CreateShaderModule(
-    const std::filesystem::path& file, std::vector<char>& shader_code) {
-  ReadFile(file, shader_code);
+void Application::DestroyCommandBuffers() {
+  if (!command_buffers_.empty()) {
+    vkFreeCommandBuffers(device_, persistent_command_pool_,
+                         static_cast<uint32_t>(command_buffers_.size()),
+                         command_buffers_.data());
+    command_buffers_.clear();
+  }
+}
+
+std::vector<TracedDraw> Application::GetDraws() const {
+  if (replay_) {
+    return replay_->commands.draws;
+  }
+
+  // placeholders are replaced by streamed meshes
+  const std::vector<MeshRange>& meshes = scene_geometry_.GetMeshes();
+  std::vector<bool> hidden(meshes.size());
+  for (const StreamedFile& file : streamed_files_) {
+    if (file.loaded && file.placeholder) {
+      hidden[*file.placeholder] = true;
+    }
+  }
 
+  std::vector<TracedDraw> draws;
+  for (size_t i = 0; i != meshes.size(); ++i) {
+    if (hidden[i]) {
+      continue;
+    }
+
+    const MeshRange& mesh = meshes[i];
+    TracedDraw& draw = draws.emplace_back();
+    draw.index_count = mesh.index_count;
+    draw.first_index = mesh.first_index;
+    draw.vertex_offset = mesh.vertex_offset;
+  }
+
+  return draws;
+}
+
+Task<VkShaderModule> Application::LoadShaderModule(
+    std::filesystem::path file) {
+  const FileBuffer shader_code = co_await scheduler_->ReadFile(std::move(file));
+  co_return CreateShaderModule(shader_code);
+}
+
+VkShaderModule Application::CreateShaderModule(
+    std::span<const char> shader_code) {
   VkShaderModuleCreateInfo create_info{};
   create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
   create_info.codeSize = shader_code.size();
@@ -1282,30 +2334,59 @@ void Application::CheckRequiredLayersSupport() {
 }
 
 void Application::InitializeVulkan() {
-  CreateInstance();
-  annotate_.Initialize(instance_);
-  SetupDebugMessenger();
-  CreateSurface();
-  PickPhysicalDevice();
-  CreateDevice();
-  CreateSwapChain();
-  CreateSwapChainImageViews();
-  CreateRenderPass();
-  CreateDescriptorSetLayout();
-  CreateGraphicsPipeline();
-  CreateCommandPools();
-  CreateTextureImages();
-  CreateColorResources();
-  CreateDepthResources();
-  CreateFrameBuffers();
-  LoadModel();
-  CreateVertexBuffers();
-  CreateIndexBuffers();
-  CreateUniformBuffers();
-  CreateDescriptorPool();
-  CreateDescriptorSets();
-  CreateCommandBuffers();
-  CreateSyncObjects();
+  auto measure = [this](std::string_view name, void (Application::*stage)()) {
+    startup_profiler_.Measure(name, [&] { (this->*stage)(); });
+  };
+
+  measure("CreateInstance", &Application::CreateInstance);
+  startup_profiler_.Measure("SetupDebugMessenger", [&] {
+    annotate_.Initialize(instance_);
+    SetupDebugMessenger();
+  });
+  measure("CreateSurface", &Application::CreateSurface);
+  measure("PickPhysicalDevice", &Application::PickPhysicalDevice);
+  measure("CreateDevice", &Application::CreateDevice);
+  measure("CreateTaskScheduler", &Application::CreateTaskScheduler);
+  measure("CreateSwapChain", &Application::CreateSwapChain);
+  measure("CreateSwapChainImageViews", &Application::CreateSwapChainImageViews);
+  measure("CreateRenderPass", &Application::CreateRenderPass);
+  measure("CreateDescriptorAllocator", &Application::CreateDescriptorAllocator);
+  measure("CreateGraphicsPipeline", &Application::CreateGraphicsPipeline);
+  measure("CreateCommandPools", &Application::CreateCommandPools);
+  measure("CreateReadback", &Application::CreateReadback);
+  measure("CreateDerivedDataCache", &Application::CreateDerivedDataCache);
+  measure("CreateTextureImages", &Application::CreateTextureImages);
+  measure("CreateColorResources", &Application::CreateColorResources);
+  measure("CreateDepthResources", &Application::CreateDepthResources);
+  measure("CreateFrameBuffers", &Application::CreateFrameBuffers);
+  measure("LoadScene", &Application::LoadScene);
+  measure("CreateVertexBuffers", &Application::CreateVertexBuffers);
+  measure("CreateIndexBuffers", &Application::CreateIndexBuffers);
+  measure("CreateUniformBuffers", &Application::CreateUniformBuffers);
+  measure("UpdateDescriptorSets", &Application::UpdateDescriptorSets);
+  measure("CreateTimestampQueries", &Application::CreateTimestampQueries);
+  measure("CreateCommandBuffers", &Application::CreateCommandBuffers);
+  measure("CreateSyncObjects", &Application::CreateSyncObjects);
+  measure("CreateTelemetry", &Application::CreateTelemetry);
+  startup_duration_ = GetTimeSinceAppStart();
+}
+
+void Application::WriteStartupReport() const {
+  const std::filesystem::path output_dir = executable_file_.parent_path();
+  const std::filesystem::path history_path =
+      output_dir / "startup_history.csv";
+  // report is a diagnostic, failing to write it must not stop the application
+  try {
+    startup_profiler_.PrintTable(history_path);
+    startup_profiler_.WriteJson(output_dir / "startup_report.json");
+    startup_profiler_.AppendHistory(history_path);
+  } catch (const std::exception& e) {
+    spdlog::warn("failed to write startup report: {}", e.what());
+  }
+
+  if (derived_data_cache_) {
+    derived_data_cache_->LogStats();
+  }
 }
 
 void Application::RecreateSwapChain() {
@@ -1330,12 +2411,23 @@ void Application::RecreateSwapChain() {
   CreateDepthResources();
   CreateFrameBuffers();
   CreateUniformBuffers();
-  CreateDescriptorPool();
-  CreateDescriptorSets();
+  UpdateDescriptorSets();
+  CreateTimestampQueries();
   CreateCommandBuffers();
 }
 
 void Application::CreateInstance() {
+  required_layers_.clear();
+  if (config_.validation) {
+    required_layers_.push_back("VK_LAYER_KHRONOS_validation");
+  }
+  if (config_.mesa_overlay) {
+    required_layers_.push_back("VK_LAYER_MESA_overlay");
+  }
+  if (config_.lunarg_monitor) {
+    required_layers_.push_back("VK_LAYER_LUNARG_monitor");
+  }
+
   CheckRequiredLayersSupport();
 
   VkApplicationInfo app_info{};
@@ -1344,7 +2436,7 @@ void Application::CreateInstance() {
   app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   app_info.pEngineName = "No Engine";
   app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  app_info.apiVersion = VK_API_VERSION_1_0;
+  app_info.apiVersion = instance_api_version_ = QueryInstanceApiVersion();
 
   auto required_extensions = GetRequiredExtensions();
 
@@ -1366,6 +2458,21 @@ void Application::CreateInstance() {
   VkWrap(vkCreateInstance)(&create_info, nullptr, &instance_);
 }
 
+ui32 Application::QueryInstanceApiVersion() {
+  // vkEnumerateInstanceVersion does not exist in Vulkan 1.0 loaders
+  auto enumerate_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+      vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+  ui32 version = VK_API_VERSION_1_0;
+  if (enumerate_version == nullptr ||
+      enumerate_version(&version) != VK_SUCCESS) {
+    return VK_API_VERSION_1_0;
+  }
+
+  // 1.1 is enough to query device UUID, newer features are not used
+  return version >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1
+                                       : VK_API_VERSION_1_0;
+}
+
 void Application::SetupDebugMessenger() {
   if constexpr (kEnableDebugMessengerExtension) {
     VkDebugUtilsMessengerCreateInfoEXT create_info{};
@@ -1376,24 +2483,177 @@ void Application::SetupDebugMessenger() {
 }
 
 void Application::MainLoop() {
+  bool finished = false;
+  bool presented = true;
   while (!glfwWindowShouldClose(window_)) {
+    // a frame dropped by swap chain recreation is drawn again, so recorded
+    // and replayed sequences keep every frame
+    if (presented && !simulation_clock_.Advance()) {
+      finished = true;
+      break;
+    }
+
+    glfwPollEvents();
+    PollConfigChanges();
+    presented = DrawFrame();
+  }
+
+  simulation_clock_.SaveRecording();
+  if (finished) {
+    // the whole sequence was rendered, the summary is comparable between runs
+    spdlog::info("rendered {} frames", frame_stats_.GetNumFrames());
+    frame_stats_.LogSummary();
+  }
+}
+
+void Application::PollConfigChanges() {
+  // file modification time is not worth checking every frame
+  const TimePoint now = GetGlobalTime();
+  if (!config_source_ || now - last_config_poll_ < std::chrono::seconds(1)) {
+    return;
+  }
+
+  last_config_poll_ = now;
+  if (std::optional<AppConfig> updated = config_source_->PollChanges()) {
+    ApplyConfigChanges(std::move(*updated));
+  }
+}
+
+void Application::ApplyConfigChanges(AppConfig updated) {
+  // these settings are used only while starting
+  auto keep = [&](auto field, std::string_view name) {
+    if (updated.*field != config_.*field) {
+      spdlog::warn("{} is applied after restart", name);
+      updated.*field = config_.*field;
+    }
+  };
+  keep(&AppConfig::validation, "validation");
+  keep(&AppConfig::mesa_overlay, "mesa_overlay");
+  keep(&AppConfig::lunarg_monitor, "lunarg_monitor");
+  keep(&AppConfig::content_dir, "content_dir");
+  keep(&AppConfig::device, "device");
+  keep(&AppConfig::device_benchmark, "device_benchmark");
+  keep(&AppConfig::metrics_port, "metrics_port");
+  keep(&AppConfig::clock, "clock");
+  keep(&AppConfig::simulation_rate, "simulation_rate");
+  keep(&AppConfig::camera_path, "camera_path");
+  keep(&AppConfig::record_camera_path, "record_camera_path");
+  keep(&AppConfig::frame_limit, "frame_limit");
+  keep(&AppConfig::scene, "scene");
+  keep(&AppConfig::mesh_streaming, "mesh_streaming");
+  keep(&AppConfig::cache_dir, "cache_dir");
+  keep(&AppConfig::cache_size_mb, "cache_size_mb");
+  keep(&AppConfig::texture_quality, "texture_quality");
+  keep(&AppConfig::texture_quality_overrides, "texture_quality_overrides");
+  keep(&AppConfig::io_uring, "io_uring");
+  keep(&AppConfig::direct_io, "direct_io");
+  keep(&AppConfig::split_vertex_streams, "split_vertex_streams");
+  keep(&AppConfig::depth_prepass, "depth_prepass");
+
+  if (updated == config_) {
+    return;
+  }
+
+  VkWrap(vkDeviceWaitIdle)(device_);
+  const AppConfig previous = std::exchange(config_, std::move(updated));
+
+  if (config_.max_anisotropy != previous.max_anisotropy) {
+    descriptor_allocator_->ReleaseSetsUsing(texture_sampler_);
+    VulkanUtility::Destroy<vkDestroySampler>(device_, texture_sampler_);
+    CreateTextureSampler();
+    UpdateDescriptorSets();
+  }
+
+  if (config_.max_frames_in_flight != previous.max_frames_in_flight) {
+    // copies in flight refer to frame fences, all of them are signaled now
+    readback_->Poll();
+    DestroySyncObjects();
+    CreateSyncObjects();
+    current_frame_ = 0;
+  }
+
+  if (config_.window_width != previous.window_width ||
+      config_.window_height != previous.window_height) {
+    // swap chain is recreated by the resize callback
+    glfwSetWindowSize(window_, static_cast<int>(config_.window_width),
+                      static_cast<int>(config_.window_height));
+  }
+
+  if (config_.msaa_samples != previous.msaa_samples ||
+      config_.present_modes != previous.present_modes) {
+    msaa_samples_ = ChooseSampleCount();
+    RecreateSwapChain();
+  }
+}
+
+void Application::RunRegressionCheck() {
+  const RegressionCheckSettings& settings = regression_check_->GetSettings();
+  auto draw_frame = [this]() {
     glfwPollEvents();
     DrawFrame();
+  };
+
+  for (ui32 i = 0; i != settings.warmup_frames; ++i) {
+    draw_frame();
+  }
+
+  std::chrono::nanoseconds frames_duration{0};
+  for (ui32 i = 0; i != settings.measured_frames; ++i) {
+    const TimePoint start = GetGlobalTime();
+    draw_frame();
+    frames_duration += GetGlobalTime() - start;
   }
+
+  // readback resolves a few frames later
+  constexpr ui32 kMaxReadbackFrames = 1000;
+  std::future<ReadbackImage> frame = CaptureNextFrame();
+  for (ui32 i = 0; frame.wait_for(std::chrono::seconds(0)) !=
+                   std::future_status::ready;
+       ++i) {
+    [[unlikely]] if (i == kMaxReadbackFrames) {
+      throw std::runtime_error("frame readback did not finish");
+    }
+    draw_frame();
+  }
+
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+  RegressionMetrics metrics;
+  metrics.startup = Milliseconds(startup_duration_).count();
+  metrics.upload =
+      Milliseconds(startup_profiler_.GetStageTotal("CreateTextureImages") +
+                   startup_profiler_.GetStageTotal("CreateVertexBuffers") +
+                   startup_profiler_.GetStageTotal("CreateIndexBuffers"))
+          .count();
+  metrics.frame = Milliseconds(frames_duration).count() /
+                  std::max(settings.measured_frames, 1u);
+
+  const bool frame_passed = regression_check_->CheckFrame(frame.get());
+  regression_check_->ReportMetrics(metrics);
+  exit_code_ = frame_passed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-void Application::DrawFrame() {
+bool Application::DrawFrame() {
+  frame_stats_.BeginFrame();
+
   // first check that nobody does not draw to current frame
   VkWrap(vkWaitForFences)(device_, 1u, &in_flight_fences_[current_frame_],
                           kVkTrue, UINT64_MAX);
 
+  // has to happen before the fence is reset
+  readback_->Poll();
+  ReleaseFinishedAcquires();
+  WriteFinishedScreenshots();
+
   // get next image index from the swap chain
   ui32 image_index;
 
   {
+    const TimePoint acquire_start = GetGlobalTime();
     const VkResult acquire_result = vkAcquireNextImageKHR(
         device_, swap_chain_, UINT64_MAX,
         image_available_semaphores_[current_frame_], nullptr, &image_index);
+    frame_stats_.AddDuration(FrameMetric::Acquire,
+                             GetGlobalTime() - acquire_start);
 
     switch (acquire_result) {
       case VK_SUCCESS:
@@ -1402,7 +2662,7 @@ void Application::DrawFrame() {
 
       case VK_ERROR_OUT_OF_DATE_KHR:
         RecreateSwapChain();
-        return;
+        return false;
         break;
 
       default:
@@ -1416,11 +2676,12 @@ void Application::DrawFrame() {
   if (auto fence = images_in_flight_[image_index]; fence != VK_NULL_HANDLE) {
     VkWrap(vkWaitForFences)(device_, 1u, &fence, kVkTrue, UINT64_MAX);
   }
+  ReadGpuFrameTime(image_index);
 
   // Mark the image as now being in use by this frame
   images_in_flight_[image_index] = in_flight_fences_[current_frame_];
 
-  UpdateUniformBuffer(image_index);
+  const UniformBufferObject ubo = UpdateUniformBuffer(image_index);
 
   VkSubmitInfo submit_info{};
   submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1439,14 +2700,26 @@ void Application::DrawFrame() {
   submit_info.waitSemaphoreCount = num_wait_semaphores;
   submit_info.pWaitSemaphores = wait_semaphores.data();
   submit_info.pWaitDstStageMask = waitStages;
-  submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &command_buffers_[image_index];
+  std::array<VkCommandBuffer, 2> frame_command_buffers{
+      command_buffers_[image_index], nullptr};
+  ui32 num_frame_command_buffers = 1;
+  if (!capture_requests_.empty()) {
+    frame_command_buffers[num_frame_command_buffers++] =
+        RecordFrameCapture(image_index);
+  }
+
+  submit_info.commandBufferCount = num_frame_command_buffers;
+  submit_info.pCommandBuffers = frame_command_buffers.data();
   submit_info.signalSemaphoreCount = num_signal_semaphores;
   submit_info.pSignalSemaphores = signal_semaphores.data();
 
   VkWrap(vkResetFences)(device_, 1u, &in_flight_fences_[current_frame_]);
   VkWrap(vkQueueSubmit)(graphics_queue_, 1u, &submit_info,
                         in_flight_fences_[current_frame_]);
+  readback_->OnSubmitted(in_flight_fences_[current_frame_]);
+  if (timestamp_query_pool_) {
+    timestamps_pending_[image_index] = true;
+  }
 
   VkPresentInfoKHR present_info{};
   present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1458,8 +2731,11 @@ void Application::DrawFrame() {
   present_info.pResults = nullptr;
 
   {
+    const TimePoint present_start = GetGlobalTime();
     const VkResult present_result =
         vkQueuePresentKHR(present_queue_, &present_info);
+    frame_stats_.AddDuration(FrameMetric::Present,
+                             GetGlobalTime() - present_start);
     if (present_result == VK_ERROR_OUT_OF_DATE_KHR ||
         present_result == VK_SUBOPTIMAL_KHR || frame_buffer_resized_) {
       frame_buffer_resized_ = false;
@@ -1469,55 +2745,228 @@ void Application::DrawFrame() {
     }
   }
 
-  vkDeviceWaitIdle(device_);
+  // loading coroutines resume between frames
+  scheduler_->Poll();
+  UpdateMeshStreaming();
+  UpdateTextureResidency(ubo);
+  frame_stats_.EndFrame();
+  if (telemetry_) {
+    telemetry_->PublishFrame(frame_stats_);
+    telemetry_->PublishQueues(readback_->GetNumCopiesInFlight(),
+                              pending_screenshots_.size());
+  }
 
-  current_frame_ = (current_frame_ + 1) % kMaxFramesInFlight;
+  current_frame_ = (current_frame_ + 1) % in_flight_fences_.size();
+  return true;
 }
 
-void Application::UpdateUniformBuffer(ui32 current_image) {
-  UniformBufferObject ubo{};
-  const float time = std::chrono::duration<float, std::chrono::seconds::period>(
-                         GetTimeSinceAppStart())
-                         .count();
-  ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
-                          glm::vec3(0.0f, 0.0f, 1.0f));
-  const float distance = 1.0f + std::abs(std::sin(time));
-  ubo.view =
-      glm::lookAt(glm::vec3(distance, distance, distance),
-                  glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.proj = glm::perspective(glm::radians(45.0f),
-                              static_cast<float>(swap_chain_extent_.width) /
-                                  static_cast<float>(swap_chain_extent_.height),
-                              0.1f, 10.0f);
-  ubo.proj[1][1] *= -1;
+UniformBufferObject Application::UpdateUniformBuffer(ui32 current_image) {
+  const float aspect_ratio = static_cast<float>(swap_chain_extent_.width) /
+                             static_cast<float>(swap_chain_extent_.height);
+  const SimulationFrame& frame = simulation_clock_.GetFrame();
+  UniformBufferObject ubo;
+  if (replay_) {
+    const std::vector<ui8>& uniforms = replay_->frames[frame.index].uniforms;
+    [[unlikely]] if (uniforms.size() != sizeof(ubo)) {
+      throw std::runtime_error(
+          fmt::format("trace frame {} has {} bytes of uniforms, expected {}",
+                      frame.index, uniforms.size(), sizeof(ubo)));
+    }
+    std::memcpy(&ubo, uniforms.data(), sizeof(ubo));
+  } else {
+    ubo = MakeUniformBufferObject(frame.time, frame.camera, aspect_ratio);
+  }
+
+  if (trace_writer_) {
+    trace_writer_->WriteFrame(
+        std::span(reinterpret_cast<const ui8*>(&ubo), sizeof(ubo)));
+  }
 
   VulkanUtility::MapCopyUnmap(ubo, device_,
                               uniform_buffers_memory_[current_image]);
+  return ubo;
+}
+
+void Application::UpdateTextureResidency(const UniformBufferObject& ubo) {
+  // every mesh samples the texture, so it spans as many pixels as the
+  // projected bounding sphere of the scene
+  const glm::vec3 scene_center =
+      scene_bounds_.IsEmpty() ? glm::vec3{}
+                              : (scene_bounds_.min + scene_bounds_.max) * 0.5f;
+  const float scene_radius =
+      scene_bounds_.IsEmpty() ? 0.0f
+                              : glm::distance(scene_center, scene_bounds_.max);
+  const glm::vec4 view_center =
+      ubo.view * ubo.model * glm::vec4(scene_center, 1.0f);
+  const float distance = -view_center.z;
+  const float viewport_size = static_cast<float>(
+      std::max(swap_chain_extent_.width, swap_chain_extent_.height));
+  const float screen_size =
+      distance > scene_radius
+          ? std::min(viewport_size,
+                     scene_radius * std::abs(ubo.proj[1][1]) *
+                         static_cast<float>(swap_chain_extent_.height) /
+                         distance)
+          : viewport_size;
+  texture_residency_.MarkUsed(texture_id_, screen_size);
+
+  const std::vector<TextureResidencyChange> changes =
+      texture_residency_.Update(GetTextureBudget());
+  if (!changes.empty()) {
+    // frames in flight sample the image and bind the sets which are replaced
+    VkWrap(vkDeviceWaitIdle)(device_);
+  }
+
+  for (const TextureResidencyChange& change : changes) {
+    // the scene has a single texture
+    UploadTextureLevels(change.first_mip);
+    spdlog::info("texture {}: {} of {} levels resident, {} KiB of textures",
+                 texture_source_.name, texture_mip_levels_,
+                 texture_source_.mips.size(),
+                 texture_residency_.GetResidentSize() >> 10);
+  }
+
+  if (!changes.empty()) {
+    UpdateDescriptorSets();
+  }
+}
+
+ui64 Application::GetTextureBudget() const {
+  if (config_.texture_budget_mb != 0) {
+    return ui64{config_.texture_budget_mb} << 20;
+  }
+
+  if (!memory_budget_enabled_) {
+    return std::numeric_limits<ui64>::max();
+  }
+
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+  budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  VkPhysicalDeviceMemoryProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  properties.pNext = &budget;
+  vkGetPhysicalDeviceMemoryProperties2(device_info_->device, &properties);
+
+  // textures live in the largest device local heap
+  const VkPhysicalDeviceMemoryProperties& memory =
+      properties.memoryProperties;
+  std::optional<ui32> heap;
+  for (ui32 index = 0; index != memory.memoryHeapCount; ++index) {
+    if ((memory.memoryHeaps[index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+        (!heap || memory.memoryHeaps[index].size >
+                      memory.memoryHeaps[*heap].size)) {
+      heap = index;
+    }
+  }
+
+  if (!heap) {
+    return std::numeric_limits<ui64>::max();
+  }
+
+  // the rest of the heap usage is not managed, textures get what is left
+  const ui64 textures = texture_residency_.GetResidentSize();
+  const ui64 usage = budget.heapUsage[*heap];
+  const ui64 other = usage > textures ? usage - textures : 0;
+  const ui64 heap_budget = budget.heapBudget[*heap];
+  return heap_budget > other ? heap_budget - other : 0;
+}
+
+SimulationClockSettings Application::GetSimulationClockSettings() const {
+  SimulationClockSettings settings;
+  if (regression_check_) {
+    settings.mode = ClockMode::FixedStep;
+    settings.start_time = regression_check_->GetSettings().animation_time;
+    settings.step = std::chrono::nanoseconds(0);
+    return settings;
+  }
+
+  if (replay_) {
+    // frame index selects recorded uniforms
+    settings.mode = ClockMode::FixedStep;
+    settings.frame_limit = replay_->frames.size();
+    return settings;
+  }
+
+  settings.mode = config_.clock;
+  settings.step = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::seconds(1)) /
+                  config_.simulation_rate;
+  settings.camera_path = config_.camera_path;
+  settings.frame_limit = config_.frame_limit;
+  return settings;
 }
 
 void Application::Cleanup() {
+  telemetry_ = nullptr;
+  // waits for copies in flight, so finished screenshots can be written
+  readback_ = nullptr;
+  capture_requests_.clear();
+  WriteFinishedScreenshots();
+  // Coroutines of unfinished loads are destroyed without resuming. Reads in
+  // flight are waited for, and the thread pool runs every queued task before
+  // its threads join, including the work of those loads, whose results are
+  // dropped, and the screenshot writes
+  scheduler_ = nullptr;
+  file_reader_ = nullptr;
+  thread_pool_ = nullptr;
+
+  // frames and uploads in flight finish before their objects are destroyed
+  if (device_) {
+    vkDeviceWaitIdle(device_);
+  }
   CleanupSwapChain();
 
   using Vk = VulkanUtility;
 
+  // command buffers are freed with their pools
+  for (PendingAcquire& acquire : pending_acquires_) {
+    Vk::Destroy<vkDestroyFence>(device_, acquire.fence);
+    Vk::Destroy<vkDestroySemaphore>(device_, acquire.semaphore);
+  }
+  pending_acquires_.clear();
+
   Vk::Destroy<vkDestroySampler>(device_, texture_sampler_);
   Vk::Destroy<vkDestroyImageView>(device_, texture_image_view_);
   Vk::Destroy<vkDestroyImage>(device_, texture_image_);
   Vk::FreeMemory(device_, texture_image_memory_);
 
-  Vk::Destroy<vkDestroyDescriptorSetLayout>(device_, descriptor_set_layout_);
+  descriptor_allocator_ = nullptr;
 
   Vk::Destroy<vkDestroyBuffer>(device_, vertex_buffer_);
   Vk::FreeMemory(device_, vertex_buffer_memory_);
+  Vk::Destroy<vkDestroyBuffer>(device_, attribute_buffer_);
+  Vk::FreeMemory(device_, attribute_buffer_memory_);
 
   Vk::Destroy<vkDestroyBuffer>(device_, index_buffer_);
   Vk::FreeMemory(device_, index_buffer_memory_);
 
-  Vk::Destroy<vkDestroyFence>(device_, in_flight_fences_);
-  Vk::Destroy<vkDestroySemaphore>(device_, render_finished_semaphores_);
-  Vk::Destroy<vkDestroySemaphore>(device_, image_available_semaphores_);
+  // command buffers of uploads are freed with their pools
+  streamed_meshes_.insert(streamed_meshes_.end(),
+                          std::make_move_iterator(streamed_uploads_.begin()),
+                          std::make_move_iterator(streamed_uploads_.end()));
+  streamed_uploads_.clear();
+  for (StreamedMesh& mesh : streamed_meshes_) {
+    Vk::Destroy<vkDestroyFence>(device_, mesh.upload.fence);
+    Vk::Destroy<vkDestroySemaphore>(device_, mesh.upload.semaphore);
+    Vk::Destroy<vkDestroyBuffer>(device_, mesh.staging_buffer);
+    Vk::FreeMemory(device_, mesh.staging_buffer_memory);
+    Vk::Destroy<vkDestroyBuffer>(device_, mesh.vertex_buffer);
+    Vk::FreeMemory(device_, mesh.vertex_buffer_memory);
+    Vk::Destroy<vkDestroyBuffer>(device_, mesh.attribute_buffer);
+    Vk::FreeMemory(device_, mesh.attribute_buffer_memory);
+    Vk::Destroy<vkDestroyBuffer>(device_, mesh.index_buffer);
+    Vk::FreeMemory(device_, mesh.index_buffer_memory);
+  }
+  streamed_meshes_.clear();
+  for (VkSemaphore semaphore : free_upload_semaphores_) {
+    Vk::Destroy<vkDestroySemaphore>(device_, semaphore);
+  }
+  free_upload_semaphores_.clear();
+
+  DestroySyncObjects();
   Vk::Destroy<vkDestroyCommandPool>(device_, persistent_command_pool_);
   Vk::Destroy<vkDestroyCommandPool>(device_, transient_command_pool_);
+  Vk::Destroy<vkDestroyCommandPool>(device_, transfer_command_pool_);
   Vk::Destroy<vkDestroyDevice>(device_);
 
   DestroyDebugUtilsMessengerEXT(instance_, debug_messenger_, nullptr);
@@ -1548,21 +2997,21 @@ void Application::CleanupSwapChain() {
   Vk::FreeMemory(device_, color_image_memory_);
 
   Vk::Destroy<vkDestroyFramebuffer>(device_, swap_chain_frame_buffers_);
-  if (!command_buffers_.empty()) {
-    vkFreeCommandBuffers(device_, persistent_command_pool_,
-                         static_cast<uint32_t>(command_buffers_.size()),
-                         command_buffers_.data());
-    command_buffers_.clear();
-  }
+  Vk::Destroy<vkDestroyQueryPool>(device_, timestamp_query_pool_);
+  timestamps_pending_.clear();
+  DestroyCommandBuffers();
 
   Vk::Destroy<vkDestroyPipeline>(device_, graphics_pipeline_);
+  Vk::Destroy<vkDestroyPipeline>(device_, depth_pipeline_);
   Vk::Destroy<vkDestroyPipelineLayout>(device_, pipeline_layout_);
   Vk::Destroy<vkDestroyRenderPass>(device_, render_pass_);
   Vk::Destroy<vkDestroyImageView>(device_, swap_chain_image_views_);
   Vk::Destroy<vkDestroySwapchainKHR>(device_, swap_chain_);
+  for (VkBuffer buffer : uniform_buffers_) {
+    descriptor_allocator_->ReleaseSetsUsing(buffer);
+  }
   Vk::Destroy<vkDestroyBuffer>(device_, uniform_buffers_);
   Vk::FreeMemory(device_, uniform_buffers_memory_);
-  Vk::Destroy<vkDestroyDescriptorPool>(device_, descriptor_pool_);
 }
 
 VkSurfaceFormatKHR Application::ChooseSurfaceFormat() const {
@@ -1573,28 +3022,40 @@ VkSurfaceFormatKHR Application::ChooseSurfaceFormat() const {
 }
 
 VkPresentModeKHR Application::ChoosePresentMode() const {
-  constexpr std::array priority{
-      VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
-      VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
-
-  size_t best_index = 0;
-  int best_score = -1;
-  auto& modes = surface_info_->present_modes;
-  for (size_t i = 0; i < modes.size(); ++i) {
-    auto it = std::find(priority.begin(), priority.end(), modes[i]);
-    if (it != priority.end()) {
-      int score = static_cast<int>(std::distance(priority.begin(), it));
-      if (score > best_score) {
-        best_score = score;
-        best_index = i;
-      }
+  const auto& modes = surface_info_->present_modes;
+  for (VkPresentModeKHR mode : config_.present_modes) {
+    if (std::find(modes.begin(), modes.end(), mode) != modes.end()) {
+      return mode;
     }
   }
 
-  return surface_info_->present_modes[best_index];
+  // the only mode every surface has to support
+  spdlog::warn("none of the configured present modes is supported, fifo is "
+               "used");
+  return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkSampleCountFlagBits Application::ChooseSampleCount() const {
+  const VkSampleCountFlagBits max_samples =
+      device_info_->GetMaxUsableSampleCount();
+  if (config_.msaa_samples == 0) {
+    return max_samples;
+  }
+
+  if (config_.msaa_samples > static_cast<ui32>(max_samples)) {
+    spdlog::warn("msaa_samples {} is not supported, {} is used",
+                 config_.msaa_samples, static_cast<ui32>(max_samples));
+    return max_samples;
+  }
+
+  return static_cast<VkSampleCountFlagBits>(config_.msaa_samples);
 }
 
 std::filesystem::path Application::GetContentDir() const noexcept {
+  if (!config_.content_dir.empty()) {
+    return config_.content_dir;
+  }
+
   return executable_file_.parent_path() / "content";
 }
 
@@ -1647,9 +3108,29 @@ void Application::CreateGpuBufferRaw(const void* data, VkDeviceSize buffer_size,
   CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage_flags,
                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, buffer_memory);
 
-  ExecuteSingleTimeCommands([&](VkCommandBuffer command_buffer) {
-    CopyBuffer(command_buffer, staging_buffer, buffer, buffer_size);
-  });
+  // the only consumers of uploaded buffers are vertex input stage
+  // and shaders
+  const bool is_vertex_input =
+      usage_flags &
+      (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  const VkPipelineStageFlags dst_stage =
+      is_vertex_input ? VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                      : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+  const VkAccessFlags dst_access =
+      is_vertex_input ? (VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                         VK_ACCESS_INDEX_READ_BIT)
+                      : VK_ACCESS_SHADER_READ_BIT;
+
+  ExecuteUploadCommands(
+      [&](VkCommandBuffer command_buffer) {
+        CopyBuffer(command_buffer, staging_buffer, buffer, buffer_size);
+        TransferOwnership(command_buffer, true, buffer, dst_access, dst_stage);
+      },
+      [&](VkCommandBuffer command_buffer) {
+        TransferOwnership(command_buffer, false, buffer, dst_access,
+                          dst_stage);
+      },
+      dst_stage);
 
   VulkanUtility::Destroy<vkDestroyBuffer>(device_, staging_buffer);
   VulkanUtility::FreeMemory(device_, staging_buffer_memory);
@@ -1713,31 +3194,124 @@ void Application::CreateSyncObjects() {
   auto make_n = [](ui32 n, auto& make_one) {
     std::vector<decltype(make_one())> semaphores;
     semaphores.reserve(n);
-    for (size_t i = 0; i < kMaxFramesInFlight; ++i) {
+    for (size_t i = 0; i < n; ++i) {
       semaphores.push_back(make_one());
     }
 
     return semaphores;
   };
 
-  image_available_semaphores_ = make_n(kMaxFramesInFlight, make_semaphore);
-  render_finished_semaphores_ = make_n(kMaxFramesInFlight, make_semaphore);
-  in_flight_fences_ = make_n(kMaxFramesInFlight, make_fence);
-  images_in_flight_.resize(swap_chain_image_views_.size(), nullptr);
+  const ui32 num_frames = config_.max_frames_in_flight;
+  image_available_semaphores_ = make_n(num_frames, make_semaphore);
+  render_finished_semaphores_ = make_n(num_frames, make_semaphore);
+  in_flight_fences_ = make_n(num_frames, make_fence);
+  images_in_flight_.assign(swap_chain_image_views_.size(), nullptr);
+}
+
+void Application::DestroySyncObjects() {
+  using Vk = VulkanUtility;
+  Vk::Destroy<vkDestroyFence>(device_, in_flight_fences_);
+  Vk::Destroy<vkDestroySemaphore>(device_, render_finished_semaphores_);
+  Vk::Destroy<vkDestroySemaphore>(device_, image_available_semaphores_);
+}
+
+void Application::CreateTaskScheduler() {
+  thread_pool_ = std::make_unique<ThreadPool>();
+
+  FileReaderSettings reader_settings;
+  reader_settings.io_uring = config_.io_uring;
+  reader_settings.direct = config_.direct_io;
+  file_reader_ = std::make_unique<FileReader>(*thread_pool_, reader_settings);
+  spdlog::info("files are read by {}", ToString(file_reader_->GetBackend()));
+
+  scheduler_ = std::make_unique<TaskScheduler>(*thread_pool_, *file_reader_,
+                                               device_);
+}
+
+void Application::CreateReadback() {
+  readback_ = std::make_unique<GpuReadback>(
+      device_, *device_info_, device_info_->GetGraphicsQueueFamilyIndex(),
+      *thread_pool_);
+}
+
+std::future<ReadbackImage> Application::CaptureNextFrame() {
+  std::promise<ReadbackImage> promise;
+  std::future<ReadbackImage> result = promise.get_future();
+  if (!(swap_chain_image_usage_ & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) ||
+      !GpuReadback::IsFormatSupported(swap_chain_image_format_)) {
+    promise.set_exception(std::make_exception_ptr(
+        std::runtime_error("swap chain images can't be read back")));
+    return result;
+  }
+
+  capture_requests_.push_back(std::move(promise));
+  return result;
+}
+
+VkCommandBuffer Application::RecordFrameCapture(ui32 image_index) {
+  std::promise<ReadbackImage> promise = std::move(capture_requests_.front());
+  capture_requests_.pop_front();
+
+  ReadbackSource source;
+  source.image = swap_chain_images_[image_index];
+  source.format = swap_chain_image_format_;
+  source.extent = swap_chain_extent_;
+  // final layout of the resolve attachment in the render pass
+  source.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  return readback_->RecordCopy(source, std::move(promise));
+}
+
+void Application::SaveScreenshot() {
+  const std::filesystem::path dir =
+      executable_file_.parent_path() / "screenshots";
+  std::filesystem::create_directories(dir);
+
+  PendingScreenshot screenshot;
+  screenshot.image = CaptureNextFrame();
+  screenshot.path = dir / fmt::format("screenshot_{:04}.png", num_screenshots_);
+  ++num_screenshots_;
+  pending_screenshots_.push_back(std::move(screenshot));
+}
+
+void Application::WriteFinishedScreenshots() {
+  auto is_ready = [](const PendingScreenshot& screenshot) {
+    return screenshot.image.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  };
+
+  for (PendingScreenshot& screenshot : pending_screenshots_) {
+    if (!is_ready(screenshot)) {
+      continue;
+    }
+
+    thread_pool_->Enqueue([screenshot = std::move(screenshot)]() mutable {
+      try {
+        const ReadbackImage image = screenshot.image.get();
+        WritePng(screenshot.path, image.width, image.height, image.pixels);
+        spdlog::info("saved screenshot {}", screenshot.path.string());
+      } catch (const std::exception& e) {
+        spdlog::error("failed to save screenshot {}: {}",
+                      screenshot.path.string(), e.what());
+      }
+    });
+  }
+
+  std::erase_if(pending_screenshots_, [](const PendingScreenshot& screenshot) {
+    return !screenshot.image.valid();
+  });
 }
 
 VkImageView Application::CreateImageView(VkImage image, VkFormat format,
                                          VkImageAspectFlags aspect_flags,
-                                         ui32 mip_levels) {
+                                         ui32 mip_levels,
+                                         const VkComponentMapping& swizzle) {
   VkImageViewCreateInfo create_info{};
   create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   create_info.image = image;
   create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
   create_info.format = format;
-  create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-  create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-  create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-  create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+  // zero initialized mapping is the identity
+  create_info.components = swizzle;
   create_info.subresourceRange.aspectMask = aspect_flags;
   create_info.subresourceRange.baseMipLevel = 0;
   create_info.subresourceRange.levelCount = mip_levels;
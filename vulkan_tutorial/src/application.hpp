@@ -2,19 +2,43 @@
 
 #include <array>
 #include <chrono>
+#include <cstdlib>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <list>
 #include <memory>
 #include <optional>
 #include <span>
 #include <string>
 #include <vector>
 
+#include "assets/baked_texture.hpp"
+#include "assets/mip_generator.hpp"
+#include "assets/texture_format.hpp"
+#include "cache/derived_data_cache.hpp"
+#include "config/app_config.hpp"
 #include "debug/vulkan_debug.hpp"
 #include "device_surface_info.hpp"
 #include "error_handling.hpp"
 #include "integer.hpp"
+#include "io/file_reader.hpp"
 #include "physical_device_info.hpp"
+#include "pipeline/descriptor_allocator.hpp"
+#include "pipeline/uniform_buffer_object.hpp"
 #include "pipeline/vertex.hpp"
+#include "profiling/frame_stats.hpp"
+#include "profiling/startup_profiler.hpp"
+#include "readback/gpu_readback.hpp"
+#include "regression/regression_check.hpp"
+#include "residency/texture_residency.hpp"
+#include "scene/scene_geometry.hpp"
+#include "simulation/simulation_clock.hpp"
+#include "telemetry/renderer_telemetry.hpp"
+#include "threading/task.hpp"
+#include "threading/task_scheduler.hpp"
+#include "threading/thread_pool.hpp"
+#include "trace/trace_file.hpp"
 #include "vulkan/vulkan.hpp"
 
 struct GLFWwindow;
@@ -23,9 +47,8 @@ class Application {
  public:
   using TimePoint = decltype(std::chrono::high_resolution_clock::now());
 
-  static constexpr size_t kMaxFramesInFlight = 2;
-  static constexpr ui32 kDefaultWindowWidth = 800;
-  static constexpr ui32 kDefaultWindowHeight = 600;
+  // upper bounds, actual number depends on queue families of the device
+  static constexpr ui32 kMaxTransferQueues = 2;
 
  public:
   Application();
@@ -34,7 +57,27 @@ class Application {
   ~Application();
 
   void SetExecutableFile(std::filesystem::path path);
+  // loads the config right away, so invalid values are reported before the
+  // window opens. Changes of the config file are applied while running
+  void SetConfigSource(ConfigSource source);
+  // renders a fixed number of frames in a hidden window instead of running
+  // the main loop and compares results with stored references
+  void EnableRegressionCheck(RegressionCheckSettings settings);
+  // writes uploaded resources and per frame commands to a trace file
+  void EnableTraceRecording(std::filesystem::path path);
+  // renders frames of a recorded trace instead of the model and animation
+  void EnableReplay(std::filesystem::path path);
   void Run();
+  [[nodiscard]] int GetExitCode() const noexcept { return exit_code_; }
+
+  // Copies the next presented frame to host memory. Rendering is not stalled,
+  // the future resolves a few frames later
+  [[nodiscard]] std::future<ReadbackImage> CaptureNextFrame();
+
+  // live statistics of recent frames
+  [[nodiscard]] const FrameStats& GetFrameStats() const noexcept {
+    return frame_stats_;
+  }
 
  private:
   void RecreateSwapChain();
@@ -44,7 +87,8 @@ class Application {
   void CreateSwapChain();
   void CreateSwapChainImageViews();
   void CreateRenderPass();
-  void CreateDescriptorSetLayout();
+  // descriptor allocator, owns the set layout of the mesh program
+  void CreateDescriptorAllocator();
   void CreateGraphicsPipeline();
   void CreateFrameBuffers();
   [[nodiscard]] VkCommandPool CreateCommandPool(
@@ -52,20 +96,54 @@ class Application {
   void CreateCommandPools();
   void CreateDepthResources();
   void CreateColorResources();
+  void CreateDerivedDataCache();
   void CreateTextureImages();
-  void LoadModel();
+  // decoding and conversions run on the thread pool
+  [[nodiscard]] Task<void> LoadTexture();
+  // uploads the base level and generates the other ones with blits
+  void UploadTextureBlit(std::span<const ui8> pixels);
+  // Replaces the texture image with one that holds levels from `first_mip`,
+  // copied from the host copy of the texture. The device has to be idle
+  void UploadTextureLevels(ui32 first_mip);
+  // evicts or restores texture levels after the frame, waits for the device
+  // when the residency changes
+  void UpdateTextureResidency(const UniformBufferObject& ubo);
+  // device memory textures may use, all of it when the budget is unknown
+  [[nodiscard]] ui64 GetTextureBudget() const;
+  void CreateTextureSampler();
+  void LoadScene();
+  [[nodiscard]] bool IsMeshStreamingEnabled() const noexcept;
   void CreateVertexBuffers();
   void CreateIndexBuffers();
+  // Records command buffers again when streamed files replaced their
+  // placeholders since the previous frame, waits for the device first
+  void UpdateMeshStreaming();
   void CreateUniformBuffers();
-  void CreateDescriptorPool();
-  void CreateDescriptorSets();
+  // Takes the set of every swap chain image from the cache of the allocator.
+  // Records command buffers again when a set changed or was written, so the
+  // device has to be idle
+  void UpdateDescriptorSets();
+  // two timestamps per swap chain image, written by its command buffer
+  void CreateTimestampQueries();
   void CreateCommandBuffers();
+  void DestroyCommandBuffers();
+  [[nodiscard]] std::vector<TracedDraw> GetDraws() const;
   void CreateSyncObjects();
-  VkShaderModule CreateShaderModule(const std::filesystem::path& file,
-                                    std::vector<char>& cache);
+  void DestroySyncObjects();
+  void CreateTaskScheduler();
+  void CreateReadback();
+  void CreateTelemetry();
+  [[nodiscard]] VkCommandBuffer RecordFrameCapture(ui32 image_index);
+  // captures the next frame and writes it as PNG on a worker thread
+  void SaveScreenshot();
+  void WriteFinishedScreenshots();
+  [[nodiscard]] Task<VkShaderModule> LoadShaderModule(
+      std::filesystem::path file);
+  VkShaderModule CreateShaderModule(std::span<const char> shader_code);
   void CheckRequiredLayersSupport();
   void InitializeVulkan();
   void CreateInstance();
+  [[nodiscard]] static ui32 QueryInstanceApiVersion();
   void SetupDebugMessenger();
   void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties, VkBuffer& buffer,
@@ -75,12 +153,16 @@ class Application {
                   VkDeviceSize size);
   void CopyBufferToImage(VkCommandBuffer command_buffer, VkBuffer src,
                          VkImage image, ui32 width, ui32 height);
+  // one region per mip, offsets are relative to the start of the buffer
+  void CopyBufferToImage(VkCommandBuffer command_buffer, VkBuffer src,
+                         VkImage image, std::span<const TextureMip> mips);
   void TransitionImageLayout(VkCommandBuffer command_buffer, VkImage image,
                              VkFormat format, VkImageLayout old_layout,
                              VkImageLayout new_layout, ui32 mip_levels);
   void GenerateMipMaps_Blit(VkCommandBuffer command_buffer, VkImage image,
                             ui32 width, ui32 height, ui32 mip_levels);
 
+  VkCommandBuffer BeginSingleTimeCommands(VkCommandPool command_pool);
   VkCommandBuffer BeginSingleTimeCommands();
   void EndSingleTimeCommands(VkCommandBuffer command_buffer);
 
@@ -91,19 +173,128 @@ class Application {
     EndSingleTimeCommands(command_buffer);
   }
 
+  // true if uploads are submitted to another queue than graphics one
+  [[nodiscard]] bool HasSeparateTransferQueue() const noexcept {
+    return transfer_queues_.front() != graphics_queue_;
+  }
+  [[nodiscard]] bool NeedsOwnershipTransfer() const noexcept {
+    return device_info_->GetTransferQueueFamilyIndex() !=
+           device_info_->GetGraphicsQueueFamilyIndex();
+  }
+
+  // Queue family ownership transfer from the transfer family to the graphics
+  // family. Has to be recorded twice with the same arguments: on the transfer
+  // queue (release) and on the graphics queue (acquire). Does nothing when
+  // both queues belong to the same family
+  void TransferOwnership(VkCommandBuffer command_buffer, bool release,
+                         VkBuffer buffer, VkAccessFlags dst_access,
+                         VkPipelineStageFlags dst_stage) const;
+  void TransferOwnership(VkCommandBuffer command_buffer, bool release,
+                         VkImage image, VkImageLayout layout, ui32 mip_levels,
+                         VkAccessFlags dst_access,
+                         VkPipelineStageFlags dst_stage) const;
+
+  // Records `copy` for the transfer queue and `acquire` for the graphics
+  // queue. Graphics part waits for the copy on `acquire_stage`. Both parts
+  // are recorded into one graphics command buffer if there is no separate
+  // transfer queue
+  template <typename Copy, typename Acquire>
+  void ExecuteUploadCommands(Copy&& copy, Acquire&& acquire,
+                             VkPipelineStageFlags acquire_stage) {
+    if (!HasSeparateTransferQueue()) {
+      ExecuteSingleTimeCommands([&](VkCommandBuffer command_buffer) {
+        copy(command_buffer);
+        acquire(command_buffer);
+      });
+      return;
+    }
+
+    const VkCommandBuffer copy_command_buffer =
+        BeginSingleTimeCommands(transfer_command_pool_);
+    copy(copy_command_buffer);
+    const VkCommandBuffer acquire_command_buffer =
+        BeginSingleTimeCommands(transient_command_pool_);
+    acquire(acquire_command_buffer);
+    EndUploadCommands(copy_command_buffer, acquire_command_buffer,
+                      acquire_stage);
+  }
+  // Waits only for the copy, the acquire part stays in the graphics queue
+  // with the frames and is released by ReleaseFinishedAcquires
+  void EndUploadCommands(VkCommandBuffer copy_command_buffer,
+                         VkCommandBuffer acquire_command_buffer,
+                         VkPipelineStageFlags acquire_stage);
+  // frees acquire parts of uploads whose fences are signaled
+  void ReleaseFinishedAcquires();
+  [[nodiscard]] VkFence CreateFence() const;
+  // Binary semaphores between a copy and its acquire. A semaphore is
+  // released once the fence of the acquire is signaled, its wait is done
+  // then and it can be signaled again
+  [[nodiscard]] VkSemaphore AcquireUploadSemaphore();
+  void ReleaseUploadSemaphore(VkSemaphore semaphore);
+  // transfer queue for the next copy
+  [[nodiscard]] VkQueue NextTransferQueue();
+
+  // upload that is submitted without waiting for it
+  struct AsyncUpload {
+    VkCommandBuffer copy_command_buffer = nullptr;
+    VkCommandBuffer acquire_command_buffer = nullptr;
+    // signaled by the copy, only set with a separate transfer queue
+    VkSemaphore semaphore = nullptr;
+    // signaled when the acquire part finished
+    VkFence fence = nullptr;
+  };
+
+  // same as ExecuteUploadCommands but returns right after the submit
+  template <typename Copy, typename Acquire>
+  [[nodiscard]] AsyncUpload SubmitUploadCommands(
+      Copy&& copy, Acquire&& acquire, VkPipelineStageFlags acquire_stage) {
+    AsyncUpload upload;
+    if (HasSeparateTransferQueue()) {
+      upload.copy_command_buffer =
+          BeginSingleTimeCommands(transfer_command_pool_);
+      copy(upload.copy_command_buffer);
+      upload.acquire_command_buffer =
+          BeginSingleTimeCommands(transient_command_pool_);
+      acquire(upload.acquire_command_buffer);
+    } else {
+      upload.acquire_command_buffer = BeginSingleTimeCommands();
+      copy(upload.acquire_command_buffer);
+      acquire(upload.acquire_command_buffer);
+    }
+    SubmitUpload(upload, acquire_stage);
+    return upload;
+  }
+  void SubmitUpload(AsyncUpload& upload, VkPipelineStageFlags acquire_stage);
+  // resumes when the upload finished, its command buffers are freed then
+  [[nodiscard]] Task<void> AwaitUpload(AsyncUpload& upload);
+
   void InitializeWindow();
   static void FrameBufferResizeCallback(GLFWwindow* window, int width,
                                         int height);
+  static void KeyCallback(GLFWwindow* window, int key, int scancode,
+                          int action, int mods);
 
   void MainLoop();
+  void PollConfigChanges();
+  // rebuilds only resources affected by the changed settings
+  void ApplyConfigChanges(AppConfig updated);
+  void RunRegressionCheck();
+  // table goes to the log, json and history are written next to executable
+  void WriteStartupReport() const;
   std::optional<ui32> AcquireNextSwapChainImage() const;
-  void DrawFrame();
-  void UpdateUniformBuffer(ui32 current_image);
+  // returns false when the swap chain was out of date and the frame was not
+  // submitted, the same simulation frame has to be drawn again
+  bool DrawFrame();
+  // collects gpu time of the previous frame rendered to this image
+  void ReadGpuFrameTime(ui32 image_index);
+  // returns uniforms of the frame
+  UniformBufferObject UpdateUniformBuffer(ui32 current_image);
 
   void Cleanup();
   void CleanupSwapChain();
   [[nodiscard]] VkSurfaceFormatKHR ChooseSurfaceFormat() const;
   [[nodiscard]] VkPresentModeKHR ChoosePresentMode() const;
+  [[nodiscard]] VkSampleCountFlagBits ChooseSampleCount() const;
   [[nodiscard]] VkExtent2D ChooseSwapExtent() const;
   [[nodiscard]] std::vector<const char*> GetRequiredExtensions();
   [[nodiscard]] std::filesystem::path GetContentDir() const noexcept;
@@ -135,6 +326,8 @@ class Application {
   [[nodiscard]] auto GetTimeSinceAppStart() const noexcept {
     return GetGlobalTime() - app_start_time_;
   }
+  // frozen frame when regression check is enabled
+  [[nodiscard]] SimulationClockSettings GetSimulationClockSettings() const;
 
   void CreateImage(ui32 width, ui32 height, ui32 mip_levels,
                    VkSampleCountFlagBits samples, VkFormat format,
@@ -143,10 +336,65 @@ class Application {
                    VkDeviceMemory& image_memory);
 
   VkImageView CreateImageView(VkImage image, VkFormat format,
-                              VkImageAspectFlags aspect_flags, ui32 mip_levels);
+                              VkImageAspectFlags aspect_flags, ui32 mip_levels,
+                              const VkComponentMapping& swizzle = {});
+
+ private:
+  struct PendingScreenshot {
+    std::future<ReadbackImage> image;
+    std::filesystem::path path;
+  };
+
+  // host copy of the texture, evicted levels are uploaded from it again
+  struct TextureSource {
+    std::string name;
+    TextureFormat format;
+    std::vector<TextureMip> mips;
+    // levels are decoded from the file when they are uploaded as they are,
+    // mip offsets start at `baked_offset` of its level data
+    std::optional<BakedTexture> baked;
+    ui64 baked_offset = 0;
+    std::vector<ui8> levels;
+    // base level until the first eviction when mips come from blits
+    std::vector<ui8> pixels;
+  };
+
+  // file of the scene that is loaded in the background
+  struct StreamedFile {
+    // box drawn until the file is loaded, index of a mesh in scene geometry
+    std::optional<ui32> placeholder;
+    bool loaded = false;
+  };
+
+  // meshes of a streamed file, drawn with their own buffers
+  struct StreamedMesh {
+    ui32 file = 0;
+    std::vector<TracedDraw> draws;
+    VkBuffer vertex_buffer = nullptr;
+    VkDeviceMemory vertex_buffer_memory = nullptr;
+    VkBuffer attribute_buffer = nullptr;
+    VkDeviceMemory attribute_buffer_memory = nullptr;
+    VkBuffer index_buffer = nullptr;
+    VkDeviceMemory index_buffer_memory = nullptr;
+    // released when the upload finished
+    AsyncUpload upload;
+    VkBuffer staging_buffer = nullptr;
+    VkDeviceMemory staging_buffer_memory = nullptr;
+  };
+
+  // loads the file on the thread pool and uploads it into its own buffers
+  [[nodiscard]] Task<void> StreamMeshFile(ui32 file,
+                                          std::filesystem::path path);
+  // starts the upload of a streamed file, it stays in uploads until done
+  std::list<StreamedMesh>::iterator UploadStreamedMesh(
+      ui32 file, const SceneGeometry& geometry);
+  void MarkFileStreamed(ui32 file);
 
  private:
   VkDebug annotate_;
+  AppConfig config_;
+  std::optional<ConfigSource> config_source_;
+  TimePoint last_config_poll_;
   std::filesystem::path executable_file_;
   std::vector<VkImage> swap_chain_images_;
   std::vector<VkImageView> swap_chain_image_views_;
@@ -163,7 +411,28 @@ class Application {
   std::vector<VkDescriptorSet> descriptor_sets_;
   std::unique_ptr<DeviceSurfaceInfo> surface_info_;
   std::unique_ptr<PhysicalDeviceInfo> device_info_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::unique_ptr<FileReader> file_reader_;
+  // resumes loading coroutines on the main thread
+  std::unique_ptr<TaskScheduler> scheduler_;
+  std::unique_ptr<GpuReadback> readback_;
+  // fulfilled one per frame in the order of requests
+  std::deque<std::promise<ReadbackImage>> capture_requests_;
+  std::vector<PendingScreenshot> pending_screenshots_;
+  ui32 num_screenshots_ = 0;
+  std::unique_ptr<RegressionCheck> regression_check_;
+  std::unique_ptr<RendererTelemetry> telemetry_;
+  std::unique_ptr<TraceWriter> trace_writer_;
+  std::unique_ptr<DerivedDataCache> derived_data_cache_;
+  std::unique_ptr<DescriptorAllocator> descriptor_allocator_;
+  std::filesystem::path replay_path_;
+  std::optional<Trace> replay_;
+  bool memory_budget_enabled_ = false;
 
+  TextureSource texture_source_;
+  TextureResidency texture_residency_;
+  ui32 texture_id_ = 0;
+  // resident levels of the texture
   ui32 texture_mip_levels_ = 0;
   VkImage texture_image_ = nullptr;
   VkDeviceMemory texture_image_memory_ = nullptr;
@@ -179,20 +448,53 @@ class Application {
   VkDeviceMemory color_image_memory_ = nullptr;
   VkImageView color_image_view_ = nullptr;
 
-  std::vector<Vertex> vertices_;
-  std::vector<ui32> indices_;
+  // the whole scene or placeholders of streamed files
+  SceneGeometry scene_geometry_;
+  // sphere around these bounds is as large on screen as the texture
+  MeshBounds scene_bounds_;
+  std::vector<StreamedFile> streamed_files_;
+  // uploads in flight, moved to streamed meshes when they finish
+  std::list<StreamedMesh> streamed_uploads_;
+  std::vector<StreamedMesh> streamed_meshes_;
+  size_t num_streamed_files_ = 0;
+  // placeholders were replaced since command buffers were recorded
+  bool streamed_meshes_changed_ = false;
+  TimePoint streaming_start_;
+  // whole vertices, or positions when vertex streams are split
   VkDeviceMemory vertex_buffer_memory_ = nullptr;
   VkBuffer vertex_buffer_ = nullptr;
+  // other attributes of split vertex streams
+  VkDeviceMemory attribute_buffer_memory_ = nullptr;
+  VkBuffer attribute_buffer_ = nullptr;
   VkDeviceMemory index_buffer_memory_ = nullptr;
   VkBuffer index_buffer_ = nullptr;
   VkQueue graphics_queue_ = nullptr;
   VkQueue present_queue_ = nullptr;
-  VkDescriptorPool descriptor_pool_ = nullptr;
+  std::vector<VkQueue> transfer_queues_;
+  // copies are submitted to these queues in turn
+  size_t next_transfer_queue_ = 0;
+  // acquire parts of uploads submitted by EndUploadCommands
+  struct PendingAcquire {
+    VkCommandBuffer command_buffer = nullptr;
+    VkSemaphore semaphore = nullptr;
+    VkFence fence = nullptr;
+  };
+  std::vector<PendingAcquire> pending_acquires_;
+  // semaphores of finished uploads
+  std::vector<VkSemaphore> free_upload_semaphores_;
   VkCommandPool persistent_command_pool_ = nullptr;
   VkCommandPool transient_command_pool_ = nullptr;
+  VkCommandPool transfer_command_pool_ = nullptr;
+  VkQueryPool timestamp_query_pool_ = nullptr;
+  // whether timestamps of the image were submitted and not read yet
+  std::vector<bool> timestamps_pending_;
+  // nanoseconds per timestamp tick
+  double timestamp_period_ = 0.0;
+  ui64 timestamp_mask_ = 0;
   VkPipeline graphics_pipeline_ = nullptr;
+  // draws depth of all meshes before the graphics pipeline when enabled
+  VkPipeline depth_pipeline_ = nullptr;
   VkRenderPass render_pass_ = nullptr;
-  VkDescriptorSetLayout descriptor_set_layout_ = nullptr;
   VkPipelineLayout pipeline_layout_ = nullptr;
   VkSwapchainKHR swap_chain_ = nullptr;
   VkSurfaceKHR surface_ = nullptr;
@@ -200,14 +502,19 @@ class Application {
   VkDebugUtilsMessengerEXT debug_messenger_ = nullptr;
   GLFWwindow* window_ = nullptr;
   VkInstance instance_ = nullptr;
+  ui32 instance_api_version_ = VK_API_VERSION_1_0;
   TimePoint app_start_time_;
+  std::chrono::nanoseconds startup_duration_{0};
+  StartupProfiler startup_profiler_;
+  FrameStats frame_stats_;
+  SimulationClock simulation_clock_;
+  int exit_code_ = EXIT_SUCCESS;
   size_t current_frame_ = 0;
   std::optional<VkFormat> depth_format_ = {};
   VkExtent2D swap_chain_extent_ = {};
   VkSampleCountFlagBits msaa_samples_ = VK_SAMPLE_COUNT_1_BIT;
-  ui32 window_width_ = kDefaultWindowWidth;
-  ui32 window_height_ = kDefaultWindowHeight;
   VkFormat swap_chain_image_format_ = {};
+  VkImageUsageFlags swap_chain_image_usage_ = 0;
   ui8 glfw_initialized_ : 1;
   ui8 frame_buffer_resized_ : 1;
 };
\ No newline at end of file
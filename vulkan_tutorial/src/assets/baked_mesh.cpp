@@ -0,0 +1,242 @@
+#include "assets/baked_mesh.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "compression/compressed_blocks.hpp"
+#include "fmt/format.h"
+#include "mapped_file.hpp"
+#include "pipeline/descriptors/vertex_descriptor.hpp"
+#include "scene/scene_geometry.hpp"
+
+namespace {
+constexpr std::array<char, 4> kMagic{'V', 'K', 'M', 'S'};
+constexpr ui32 kVersion = 3;
+
+constexpr auto kAttributes =
+    StructDescriptor<Vertex>::GetInputAttributeDescriptions();
+
+struct Header {
+  std::array<char, 4> magic{};
+  ui32 version = 0;
+  ui32 vertex_stride = 0;
+  ui32 num_attributes = 0;
+  std::array<VkVertexInputAttributeDescription, kAttributes.size()>
+      attributes{};
+  ui64 num_vertices = 0;
+  ui64 num_indices = 0;
+  ui64 num_meshes = 0;
+  glm::vec3 bounds_min{};
+  glm::vec3 bounds_max{};
+};
+static_assert(std::is_trivially_copyable_v<Header>);
+
+// name is stored separately right after the record
+struct MeshRecord {
+  ui32 first_index = 0;
+  ui32 index_count = 0;
+  i32 vertex_offset = 0;
+  ui32 vertex_count = 0;
+  ui64 name_size = 0;
+};
+
+[[nodiscard]] bool IsSameAttribute(
+    const VkVertexInputAttributeDescription& a,
+    const VkVertexInputAttributeDescription& b) noexcept {
+  return a.location == b.location && a.binding == b.binding &&
+         a.format == b.format && a.offset == b.offset;
+}
+
+template <typename T>
+void Write(std::ofstream& file, const T& value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteCompressed(std::ofstream& file, std::span<const T> values) {
+  std::vector<ui8> compressed;
+  CompressBlocks(std::span(reinterpret_cast<const ui8*>(values.data()),
+                           values.size_bytes()),
+                 compressed);
+  file.write(reinterpret_cast<const char*>(compressed.data()),
+             static_cast<std::streamsize>(compressed.size()));
+}
+
+// throws when the file ends before the requested bytes
+class FileReader {
+ public:
+  FileReader(std::span<const ui8> data, const std::filesystem::path& path)
+      : data_(data), path_(&path) {}
+
+  template <typename T>
+  [[nodiscard]] T Read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value;
+    std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  [[nodiscard]] std::span<const ui8> Take(size_t size) {
+    [[unlikely]] if (size > data_.size()) {
+      throw std::runtime_error(
+          fmt::format("baked mesh {} is truncated", path_->string()));
+    }
+
+    const std::span<const ui8> bytes = data_.first(size);
+    data_ = data_.subspan(size);
+    return bytes;
+  }
+
+  [[nodiscard]] CompressedBlocks TakeCompressed() {
+    const CompressedBlocks blocks(data_);
+    data_ = data_.subspan(blocks.GetStoredSize());
+    return blocks;
+  }
+
+ private:
+  std::span<const ui8> data_;
+  const std::filesystem::path* path_;
+};
+}  // namespace
+
+void WriteBakedMesh(const std::filesystem::path& path,
+                    const SceneGeometry& geometry) {
+  std::ofstream file(path, std::ios::binary);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  Header header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.vertex_stride = sizeof(Vertex);
+  header.num_attributes = static_cast<ui32>(kAttributes.size());
+  header.attributes = kAttributes;
+  header.num_vertices = geometry.GetVertices().size();
+  header.num_indices = geometry.GetIndices().size();
+  header.num_meshes = geometry.GetMeshes().size();
+  const MeshBounds bounds = ComputeBounds(geometry.GetVertices());
+  header.bounds_min = bounds.min;
+  header.bounds_max = bounds.max;
+  Write(file, header);
+  WriteCompressed(file, std::span<const Vertex>(geometry.GetVertices()));
+  WriteCompressed(file, std::span<const ui32>(geometry.GetIndices()));
+
+  for (const MeshRange& mesh : geometry.GetMeshes()) {
+    MeshRecord record;
+    record.first_index = mesh.first_index;
+    record.index_count = mesh.index_count;
+    record.vertex_offset = mesh.vertex_offset;
+    record.vertex_count = mesh.vertex_count;
+    record.name_size = mesh.name.size();
+    Write(file, record);
+    file.write(mesh.name.data(),
+               static_cast<std::streamsize>(mesh.name.size()));
+  }
+
+  [[unlikely]] if (!file) {
+    throw std::runtime_error(
+        fmt::format("failed to write baked mesh {}", path.string()));
+  }
+}
+
+void LoadBakedMesh(const std::filesystem::path& path, SceneGeometry& geometry,
+                   ThreadPool* thread_pool) {
+  const MappedFile mapped_file(path);
+  FileReader file(mapped_file.GetData(), path);
+
+  const auto header = file.Read<Header>();
+  [[unlikely]] if (header.magic != kMagic || header.version != kVersion) {
+    throw std::runtime_error(fmt::format(
+        "{} is not a baked mesh of version {}", path.string(), kVersion));
+  }
+
+  bool same_layout = header.vertex_stride == sizeof(Vertex) &&
+                     header.num_attributes == kAttributes.size();
+  for (size_t i = 0; same_layout && i != kAttributes.size(); ++i) {
+    same_layout = IsSameAttribute(header.attributes[i], kAttributes[i]);
+  }
+  [[unlikely]] if (!same_layout) {
+    throw std::runtime_error(fmt::format(
+        "baked mesh {} has a different vertex layout, bake it again",
+        path.string()));
+  }
+
+  const CompressedBlocks vertices = file.TakeCompressed();
+  const CompressedBlocks indices = file.TakeCompressed();
+  [[unlikely]] if (vertices.GetRawSize() % sizeof(Vertex) != 0 ||
+                   vertices.GetRawSize() / sizeof(Vertex) !=
+                       header.num_vertices ||
+                   indices.GetRawSize() % sizeof(ui32) != 0 ||
+                   indices.GetRawSize() / sizeof(ui32) != header.num_indices) {
+    throw std::runtime_error(fmt::format(
+        "baked mesh {} has arrays of wrong size", path.string()));
+  }
+
+  std::vector<MeshRange> meshes;
+  for (ui64 i = 0; i != header.num_meshes; ++i) {
+    const auto record = file.Read<MeshRecord>();
+    const std::span<const ui8> name = file.Take(record.name_size);
+    MeshRange& mesh = meshes.emplace_back();
+    mesh.name.assign(name.begin(), name.end());
+    mesh.first_index = record.first_index;
+    mesh.index_count = record.index_count;
+    mesh.vertex_offset = record.vertex_offset;
+    mesh.vertex_count = record.vertex_count;
+  }
+
+  // both arrays are decoded straight into the scene
+  const auto start = std::chrono::steady_clock::now();
+  const size_t first_mesh = geometry.GetMeshes().size();
+  const SceneGeometry::MeshStorage storage = geometry.AllocateMeshes(
+      meshes, header.num_vertices, header.num_indices);
+  vertices.Decompress(0,
+                      std::span(reinterpret_cast<ui8*>(storage.vertices.data()),
+                                storage.vertices.size_bytes()),
+                      thread_pool);
+  indices.Decompress(0,
+                     std::span(reinterpret_cast<ui8*>(storage.indices.data()),
+                               storage.indices.size_bytes()),
+                     thread_pool);
+  const ui64 raw_size = vertices.GetRawSize() + indices.GetRawSize();
+  LogDecompression(path.filename().string(), raw_size,
+                   vertices.GetStoredSize() + indices.GetStoredSize(),
+                   raw_size, std::chrono::steady_clock::now() - start);
+
+  // indices are relative to their mesh and must not reach past it
+  const auto& all_meshes = geometry.GetMeshes();
+  const auto& all_indices = geometry.GetIndices();
+  for (size_t i = first_mesh; i != all_meshes.size(); ++i) {
+    const MeshRange& mesh = all_meshes[i];
+    for (ui32 j = 0; j != mesh.index_count; ++j) {
+      [[unlikely]] if (all_indices[mesh.first_index + j] >= mesh.vertex_count) {
+        throw std::runtime_error(fmt::format(
+            "baked mesh {} has an index out of range", path.string()));
+      }
+    }
+  }
+}
+
+std::optional<MeshBounds> ReadBakedMeshBounds(
+    const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  Header header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != kMagic || header.version != kVersion ||
+      header.num_vertices == 0) {
+    return std::nullopt;
+  }
+
+  MeshBounds bounds;
+  bounds.min = header.bounds_min;
+  bounds.max = header.bounds_max;
+  return bounds;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+class SceneGeometry;
+class ThreadPool;
+struct MeshBounds;
+
+// Baked mesh files keep vertices in the exact layout of `Vertex` together with
+// the vertex input description they were baked for, followed by 32 bit
+// indices and the mesh table. Both arrays are stored in LZ4 blocks. The header
+// keeps bounds of all vertices, so a placeholder can be drawn before the file
+// is loaded. Loading validates the layout and decodes both arrays straight
+// into the scene, files baked for another layout have to be baked again
+
+// writes all meshes of the geometry
+void WriteBakedMesh(const std::filesystem::path& path,
+                    const SceneGeometry& geometry);
+
+// appends meshes of the file to the geometry, blocks are decoded on the pool
+// when it is not null
+void LoadBakedMesh(const std::filesystem::path& path, SceneGeometry& geometry,
+                   ThreadPool* thread_pool = nullptr);
+
+// reads only the header, nothing when the file is not a baked mesh of the
+// current version. The load reports what is wrong with it
+[[nodiscard]] std::optional<MeshBounds> ReadBakedMeshBounds(
+    const std::filesystem::path& path);
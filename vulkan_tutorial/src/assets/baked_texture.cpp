@@ -0,0 +1,102 @@
+#include "assets/baked_texture.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "fmt/format.h"
+
+namespace {
+constexpr std::array<char, 4> kMagic{'V', 'K', 'T', 'X'};
+constexpr ui32 kVersion = 2;
+// enough for 2^31 texels on a side
+constexpr ui32 kMaxMips = 32;
+
+struct Header {
+  std::array<char, 4> magic{};
+  ui32 version = 0;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  ui32 num_mips = 0;
+};
+}  // namespace
+
+void BakedTexture::Write(const std::filesystem::path& path, VkFormat format,
+                         std::span<const TextureMip> mips,
+                         std::span<const ui8> levels) {
+  std::ofstream file(path, std::ios::binary);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  Header header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.format = format;
+  header.num_mips = static_cast<ui32>(mips.size());
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(mips.data()),
+             static_cast<std::streamsize>(mips.size_bytes()));
+  std::vector<ui8> compressed;
+  CompressBlocks(levels, compressed);
+  file.write(reinterpret_cast<const char*>(compressed.data()),
+             static_cast<std::streamsize>(compressed.size()));
+  [[unlikely]] if (!file) {
+    throw std::runtime_error(
+        fmt::format("failed to write baked texture {}", path.string()));
+  }
+}
+
+BakedTexture::BakedTexture(const std::filesystem::path& path) : file_(path) {
+  const std::span<const ui8> data = file_.GetData();
+  Header header;
+  [[unlikely]] if (data.size() < sizeof(header)) {
+    throw std::runtime_error(
+        fmt::format("baked texture {} is truncated", path.string()));
+  }
+
+  std::memcpy(&header, data.data(), sizeof(header));
+  [[unlikely]] if (header.magic != kMagic || header.version != kVersion) {
+    throw std::runtime_error(fmt::format(
+        "{} is not a baked texture of version {}", path.string(), kVersion));
+  }
+
+  const size_t table_size = size_t{header.num_mips} * sizeof(TextureMip);
+  [[unlikely]] if (header.num_mips == 0 || header.num_mips > kMaxMips ||
+                   data.size() - sizeof(header) < table_size) {
+    throw std::runtime_error(
+        fmt::format("baked texture {} has a broken mip table", path.string()));
+  }
+
+  // the baker only writes formats of GetTextureFormat
+  const std::optional<TextureFormat> format = FindTextureFormat(header.format);
+  [[unlikely]] if (!format) {
+    throw std::runtime_error(
+        fmt::format("baked texture {} has unknown format {}", path.string(),
+                    static_cast<int>(header.format)));
+  }
+  format_ = *format;
+
+  mips_.resize(header.num_mips);
+  std::memcpy(mips_.data(), data.data() + sizeof(header), table_size);
+  levels_ = CompressedBlocks(data.subspan(sizeof(header) + table_size));
+  const size_t pixel_size = GetPixelSize(format_.layout);
+  for (const TextureMip& mip : mips_) {
+    // levels are tightly packed, width times height fits into 64 bits
+    [[unlikely]] if (mip.width == 0 || mip.height == 0 ||
+                     mip.size % pixel_size != 0 ||
+                     mip.size / pixel_size != ui64{mip.width} * mip.height) {
+      throw std::runtime_error(fmt::format(
+          "baked texture {} has a {}x{} mip of {} bytes", path.string(),
+          mip.width, mip.height, mip.size));
+    }
+    [[unlikely]] if (mip.offset > levels_.GetRawSize() ||
+                     mip.size > levels_.GetRawSize() - mip.offset) {
+      throw std::runtime_error(
+          fmt::format("baked texture {} is truncated", path.string()));
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "assets/mip_generator.hpp"
+#include "assets/texture_format.hpp"
+#include "compression/compressed_blocks.hpp"
+#include "integer.hpp"
+#include "mapped_file.hpp"
+#include "vulkan/vulkan.h"
+
+// GPU ready texture: format, level table and all mip levels stored one after
+// another from the largest in LZ4 blocks. Level data is decoded straight into
+// the staging buffer and uploaded with a copy region per level, so the runtime
+// neither decodes images nor generates mips
+class BakedTexture {
+ public:
+  static void Write(const std::filesystem::path& path, VkFormat format,
+                    std::span<const TextureMip> mips,
+                    std::span<const ui8> levels);
+
+  // maps the file and validates the format and the level table
+  explicit BakedTexture(const std::filesystem::path& path);
+
+  [[nodiscard]] VkFormat GetFormat() const noexcept { return format_.format; }
+  [[nodiscard]] PixelLayout GetLayout() const noexcept {
+    return format_.layout;
+  }
+  [[nodiscard]] ui32 GetWidth() const noexcept { return mips_.front().width; }
+  [[nodiscard]] ui32 GetHeight() const noexcept {
+    return mips_.front().height;
+  }
+  [[nodiscard]] std::span<const TextureMip> GetMips() const noexcept {
+    return mips_;
+  }
+  // size of all levels, mip offsets are relative to their start
+  [[nodiscard]] ui64 GetLevelsSize() const noexcept {
+    return levels_.GetRawSize();
+  }
+  // compressed size of all levels
+  [[nodiscard]] size_t GetStoredSize() const noexcept {
+    return levels_.GetStoredSize();
+  }
+  // decodes level bytes from `offset` into `out`, on the pool when it is set
+  void ReadLevels(ui64 offset, std::span<ui8> out,
+                  ThreadPool* thread_pool = nullptr) const {
+    levels_.Decompress(offset, out, thread_pool);
+  }
+
+ private:
+  MappedFile file_;
+  TextureFormat format_;
+  std::vector<TextureMip> mips_;
+  CompressedBlocks levels_;
+};
@@ -0,0 +1,333 @@
+#include "assets/mip_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "assets/texture_format.hpp"
+#include "fmt/format.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VULKAN_TUTORIAL_SSE2
+#endif
+
+namespace {
+// linear values are quantized to this many steps when converted back
+constexpr size_t kLinearSteps = 4096;
+
+[[nodiscard]] float SrgbToLinear(float value) noexcept {
+  return value <= 0.04045f ? value / 12.92f
+                           : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+[[nodiscard]] float LinearToSrgb(float value) noexcept {
+  return value <= 0.0031308f ? value * 12.92f
+                             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+struct SrgbTables {
+  std::array<float, 256> to_linear{};
+  std::array<ui8, kLinearSteps + 1> to_srgb{};
+
+  SrgbTables() {
+    for (size_t i = 0; i != to_linear.size(); ++i) {
+      to_linear[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+    }
+    for (size_t i = 0; i != to_srgb.size(); ++i) {
+      const float linear =
+          static_cast<float>(i) / static_cast<float>(kLinearSteps);
+      const float srgb = LinearToSrgb(linear);
+      to_srgb[i] = static_cast<ui8>(std::lround(srgb * 255.0f));
+    }
+  }
+};
+
+const SrgbTables& GetSrgbTables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+// reads a component as a linear value
+[[nodiscard]] float Load(const ui8* data, PixelComponent component,
+                         bool srgb) noexcept {
+  switch (component) {
+    case PixelComponent::kUnorm8:
+      return srgb ? GetSrgbTables().to_linear[*data]
+                  : static_cast<float>(*data) / 255.0f;
+    case PixelComponent::kUnorm16: {
+      ui16 value = 0;
+      std::memcpy(&value, data, sizeof(value));
+      return static_cast<float>(value) / 65535.0f;
+    }
+    case PixelComponent::kFloat16: {
+      ui16 value = 0;
+      std::memcpy(&value, data, sizeof(value));
+      return HalfToFloat(value);
+    }
+    case PixelComponent::kFloat32: {
+      float value = 0.0f;
+      std::memcpy(&value, data, sizeof(value));
+      return value;
+    }
+  }
+  return 0.0f;
+}
+
+void Store(float value, PixelComponent component, bool srgb,
+           ui8* data) noexcept {
+  switch (component) {
+    case PixelComponent::kUnorm8:
+      *data = srgb ? GetSrgbTables().to_srgb[static_cast<size_t>(std::lround(
+                         value * static_cast<float>(kLinearSteps)))]
+                   : static_cast<ui8>(std::lround(value * 255.0f));
+      break;
+    case PixelComponent::kUnorm16: {
+      const auto unorm = static_cast<ui16>(std::lround(value * 65535.0f));
+      std::memcpy(data, &unorm, sizeof(unorm));
+    } break;
+    case PixelComponent::kFloat16: {
+      const ui16 half = FloatToHalf(value);
+      std::memcpy(data, &half, sizeof(half));
+    } break;
+    case PixelComponent::kFloat32:
+      std::memcpy(data, &value, sizeof(value));
+      break;
+  }
+}
+
+// gray and alpha or rgba, alpha is not sRGB encoded. Channel count when
+// there is no alpha
+[[nodiscard]] ui32 GetAlphaChannel(PixelLayout layout) noexcept {
+  return layout.channels == 2 || layout.channels == 4 ? layout.channels - 1
+                                                      : layout.channels;
+}
+
+void Validate(ui32 width, ui32 height, PixelLayout layout,
+              std::span<const ui8> pixels) {
+  const size_t pixel_size = GetPixelSize(layout);
+  [[unlikely]] if (width == 0 || height == 0 || pixel_size == 0 ||
+                   pixels.size() != size_t{width} * height * pixel_size) {
+    throw std::runtime_error(
+        fmt::format("{} bytes are not a {}x{} image with {} byte pixels",
+                    pixels.size(), width, height, pixel_size));
+  }
+}
+
+// averages up to 2x2 source pixels into every destination pixel
+void Downsample(PixelLayout layout, ui32 src_width, ui32 src_height,
+                const ui8* src, ui32 dst_width, ui32 dst_height, ui8* dst) {
+  const size_t pixel_size = GetPixelSize(layout);
+  const size_t component_size = GetComponentSize(layout.component);
+  const ui32 alpha = GetAlphaChannel(layout);
+  for (ui32 y = 0; y != dst_height; ++y) {
+    const ui32 y0 = std::min(2 * y, src_height - 1);
+    const ui32 y1 = std::min(2 * y + 1, src_height - 1);
+    for (ui32 x = 0; x != dst_width; ++x) {
+      const ui32 x0 = std::min(2 * x, src_width - 1);
+      const ui32 x1 = std::min(2 * x + 1, src_width - 1);
+      const std::array<const ui8*, 4> pixels{
+          src + (size_t{y0} * src_width + x0) * pixel_size,
+          src + (size_t{y0} * src_width + x1) * pixel_size,
+          src + (size_t{y1} * src_width + x0) * pixel_size,
+          src + (size_t{y1} * src_width + x1) * pixel_size};
+
+      ui8* out = dst + (size_t{y} * dst_width + x) * pixel_size;
+      for (ui32 c = 0; c != layout.channels; ++c) {
+        const bool srgb = c != alpha;
+        const size_t offset = c * component_size;
+        float sum = 0.0f;
+        for (const ui8* pixel : pixels) {
+          sum += Load(pixel + offset, layout.component, srgb);
+        }
+        Store(sum * 0.25f, layout.component, srgb, out + offset);
+      }
+    }
+  }
+}
+// Images reduced by several levels at once stay in linear floats between
+// levels, so components are decoded and encoded only once
+class LinearImage {
+ public:
+  LinearImage(ui32 width, ui32 height, ui32 channels)
+      : width_(width),
+        height_(height),
+        channels_(channels),
+        values_(size_t{width} * height * channels) {}
+
+  [[nodiscard]] ui32 GetWidth() const noexcept { return width_; }
+  [[nodiscard]] ui32 GetHeight() const noexcept { return height_; }
+  [[nodiscard]] size_t GetRowSize() const noexcept {
+    return size_t{width_} * channels_;
+  }
+  [[nodiscard]] float* GetRow(ui32 y) noexcept {
+    return values_.data() + y * GetRowSize();
+  }
+
+ private:
+  ui32 width_ = 0;
+  ui32 height_ = 0;
+  ui32 channels_ = 0;
+  std::vector<float> values_;
+};
+
+void LoadRow(const ui8* src, PixelLayout layout, size_t num_values,
+             float* dst) {
+  const size_t component_size = GetComponentSize(layout.component);
+  const ui32 alpha = GetAlphaChannel(layout);
+  for (size_t i = 0; i != num_values; ++i) {
+    const bool srgb = i % layout.channels != alpha;
+    dst[i] = Load(src + i * component_size, layout.component, srgb);
+  }
+}
+
+void StoreRow(const float* src, PixelLayout layout, size_t num_values,
+              ui8* dst) {
+  const size_t component_size = GetComponentSize(layout.component);
+  const ui32 alpha = GetAlphaChannel(layout);
+  for (size_t i = 0; i != num_values; ++i) {
+    const bool srgb = i % layout.channels != alpha;
+    Store(src[i], layout.component, srgb, dst + i * component_size);
+  }
+}
+
+void AddRows(const float* a, const float* b, size_t num_values, float* dst) {
+  size_t i = 0;
+#ifdef VULKAN_TUTORIAL_SSE2
+  for (; i + 4 <= num_values; i += 4) {
+    _mm_storeu_ps(dst + i,
+                  _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+#endif
+  for (; i != num_values; ++i) {
+    dst[i] = a[i] + b[i];
+  }
+}
+
+// averages pairs of pixels in a row that holds sums of two rows
+void HalveRow(const float* src, ui32 src_width, ui32 channels, ui32 dst_width,
+              float* dst) {
+  ui32 x = 0;
+#ifdef VULKAN_TUTORIAL_SSE2
+  // a pixel of four channels is one register
+  if (channels == 4) {
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    for (; 2 * x + 1 < src_width; ++x) {
+      const __m128 left = _mm_loadu_ps(src + 8 * size_t{x});
+      const __m128 right = _mm_loadu_ps(src + 8 * size_t{x} + 4);
+      _mm_storeu_ps(dst + 4 * size_t{x},
+                    _mm_mul_ps(_mm_add_ps(left, right), quarter));
+    }
+  }
+#endif
+  for (; x != dst_width; ++x) {
+    const size_t x0 = std::min(2 * x, src_width - 1);
+    const size_t x1 = std::min(2 * x + 1, src_width - 1);
+    for (ui32 c = 0; c != channels; ++c) {
+      dst[x * channels + c] =
+          (src[x0 * channels + c] + src[x1 * channels + c]) * 0.25f;
+    }
+  }
+}
+
+[[nodiscard]] LinearImage HalveImage(LinearImage& src, ui32 channels) {
+  LinearImage dst(std::max(src.GetWidth() / 2, 1u),
+                  std::max(src.GetHeight() / 2, 1u), channels);
+  std::vector<float> sum(src.GetRowSize());
+  for (ui32 y = 0; y != dst.GetHeight(); ++y) {
+    const ui32 y0 = std::min(2 * y, src.GetHeight() - 1);
+    const ui32 y1 = std::min(2 * y + 1, src.GetHeight() - 1);
+    AddRows(src.GetRow(y0), src.GetRow(y1), sum.size(), sum.data());
+    HalveRow(sum.data(), src.GetWidth(), channels, dst.GetWidth(),
+             dst.GetRow(y));
+  }
+  return dst;
+}
+}  // namespace
+
+std::vector<TextureMip> GetMipChainLayout(ui32 width, ui32 height,
+                                          size_t pixel_size) {
+  std::vector<TextureMip> mips;
+  ui64 total_size = 0;
+  for (ui32 w = width, h = height;; w = std::max(w / 2, 1u),
+           h = std::max(h / 2, 1u)) {
+    TextureMip& mip = mips.emplace_back();
+    mip.width = w;
+    mip.height = h;
+    mip.offset = total_size;
+    mip.size = ui64{w} * h * pixel_size;
+    total_size += mip.size;
+    if (w <= 1 && h <= 1) {
+      break;
+    }
+  }
+  return mips;
+}
+
+std::vector<ui8> GenerateMipChain(ui32 width, ui32 height,
+                                  PixelLayout layout,
+                                  std::span<const ui8> pixels,
+                                  std::vector<TextureMip>& mips) {
+  Validate(width, height, layout, pixels);
+  mips = GetMipChainLayout(width, height, GetPixelSize(layout));
+  std::vector<ui8> levels(mips.back().offset + mips.back().size);
+  std::copy(pixels.begin(), pixels.end(), levels.begin());
+  for (size_t i = 1; i != mips.size(); ++i) {
+    const TextureMip& src = mips[i - 1];
+    const TextureMip& dst = mips[i];
+    Downsample(layout, src.width, src.height, levels.data() + src.offset,
+               dst.width, dst.height, levels.data() + dst.offset);
+  }
+
+  return levels;
+}
+
+std::vector<ui8> ReduceImage(ui32 width, ui32 height, PixelLayout layout,
+                             std::span<const ui8> pixels, ui32 levels,
+                             TextureMip& reduced) {
+  Validate(width, height, layout, pixels);
+  const size_t pixel_size = GetPixelSize(layout);
+  const size_t src_row_size = size_t{width} * pixel_size;
+  if (levels == 0 || (width == 1 && height == 1)) {
+    reduced = {width, height, 0, pixels.size()};
+    return {pixels.begin(), pixels.end()};
+  }
+
+  // the first level is read straight from the source, two rows at a time
+  const ui32 channels = layout.channels;
+  LinearImage image(std::max(width / 2, 1u), std::max(height / 2, 1u),
+                    channels);
+  const size_t num_values = size_t{width} * channels;
+  std::vector<float> rows(2 * num_values);
+  std::vector<float> sum(num_values);
+  for (ui32 y = 0; y != image.GetHeight(); ++y) {
+    const size_t y0 = std::min(2 * y, height - 1);
+    const size_t y1 = std::min(2 * y + 1, height - 1);
+    LoadRow(pixels.data() + y0 * src_row_size, layout, num_values,
+            rows.data());
+    LoadRow(pixels.data() + y1 * src_row_size, layout, num_values,
+            rows.data() + num_values);
+    AddRows(rows.data(), rows.data() + num_values, num_values, sum.data());
+    HalveRow(sum.data(), width, channels, image.GetWidth(), image.GetRow(y));
+  }
+
+  for (ui32 level = 1; level != levels; ++level) {
+    if (image.GetWidth() == 1 && image.GetHeight() == 1) {
+      break;
+    }
+    image = HalveImage(image, channels);
+  }
+
+  reduced.width = image.GetWidth();
+  reduced.height = image.GetHeight();
+  reduced.offset = 0;
+  reduced.size = ui64{reduced.width} * reduced.height * pixel_size;
+  std::vector<ui8> result(reduced.size);
+  for (ui32 y = 0; y != image.GetHeight(); ++y) {
+    StoreRow(image.GetRow(y), layout, image.GetRowSize(),
+             result.data() + size_t{y} * image.GetWidth() * pixel_size);
+  }
+  return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "integer.hpp"
+#include "pixel_layout.hpp"
+
+struct TextureMip {
+  ui32 width = 0;
+  ui32 height = 0;
+  // bytes from the start of the level data
+  ui64 offset = 0;
+  ui64 size = 0;
+};
+
+// sizes and offsets of all levels down to 1x1, the same as GenerateMipChain
+// produces
+[[nodiscard]] std::vector<TextureMip> GetMipChainLayout(ui32 width,
+                                                        ui32 height,
+                                                        size_t pixel_size);
+
+// Builds the full chain of levels down to 1x1, the first level is a copy of
+// the source. Levels are tightly packed one after another in the layout of
+// the source. 8 bit color is averaged in linear space like blits of sRGB
+// images do, alpha and other components are averaged as they are
+[[nodiscard]] std::vector<ui8> GenerateMipChain(ui32 width, ui32 height,
+                                                PixelLayout layout,
+                                                std::span<const ui8> pixels,
+                                                std::vector<TextureMip>& mips);
+
+// Shrinks the image by `levels` halvings, which is what level `levels` of
+// GenerateMipChain holds, without building the larger levels. Stops at 1x1,
+// `reduced` receives the size of the result
+[[nodiscard]] std::vector<ui8> ReduceImage(ui32 width, ui32 height,
+                                           PixelLayout layout,
+                                           std::span<const ui8> pixels,
+                                           ui32 levels, TextureMip& reduced);
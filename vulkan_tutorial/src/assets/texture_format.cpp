@@ -0,0 +1,251 @@
+#include "assets/texture_format.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+namespace {
+struct FormatEntry {
+  VkFormat format;
+  PixelLayout layout;
+};
+
+constexpr std::array<FormatEntry, 9> kFormats{{
+    {VK_FORMAT_R8_SRGB, {1, PixelComponent::kUnorm8}},
+    {VK_FORMAT_R8G8_SRGB, {2, PixelComponent::kUnorm8}},
+    {VK_FORMAT_R8G8B8A8_SRGB, {4, PixelComponent::kUnorm8}},
+    {VK_FORMAT_R16_UNORM, {1, PixelComponent::kUnorm16}},
+    {VK_FORMAT_R16G16_UNORM, {2, PixelComponent::kUnorm16}},
+    {VK_FORMAT_R16G16B16A16_UNORM, {4, PixelComponent::kUnorm16}},
+    {VK_FORMAT_R16_SFLOAT, {1, PixelComponent::kFloat16}},
+    {VK_FORMAT_R16G16_SFLOAT, {2, PixelComponent::kFloat16}},
+    {VK_FORMAT_R16G16B16A16_SFLOAT, {4, PixelComponent::kFloat16}},
+}};
+
+// marks the opaque alpha channel that has no source
+constexpr ui32 kOpaque = 4;
+
+[[nodiscard]] VkComponentMapping GetSwizzle(ui32 channels) noexcept {
+  VkComponentMapping swizzle{};
+  if (channels == 1 || channels == 2) {
+    swizzle.r = VK_COMPONENT_SWIZZLE_R;
+    swizzle.g = VK_COMPONENT_SWIZZLE_R;
+    swizzle.b = VK_COMPONENT_SWIZZLE_R;
+    swizzle.a =
+        channels == 2 ? VK_COMPONENT_SWIZZLE_G : VK_COMPONENT_SWIZZLE_ONE;
+  }
+  return swizzle;
+}
+
+[[nodiscard]] TextureFormat MakeTextureFormat(const FormatEntry& entry) {
+  TextureFormat format;
+  format.format = entry.format;
+  format.layout = entry.layout;
+  format.swizzle = GetSwizzle(entry.layout.channels);
+  return format;
+}
+
+// source channel of every destination channel
+[[nodiscard]] std::array<ui32, 4> GetChannelSources(ui32 from, ui32 to) {
+  if (from == to) {
+    return {0, 1, 2, 3};
+  }
+
+  if (to == 4) {
+    switch (from) {
+      case 1:
+        return {0, 0, 0, kOpaque};
+      case 2:
+        return {0, 0, 0, 1};
+      case 3:
+        return {0, 1, 2, kOpaque};
+      default:
+        break;
+    }
+  }
+
+  throw std::runtime_error(
+      fmt::format("can not convert {} channels to {}", from, to));
+}
+
+void StoreOpaque(PixelComponent component, ui8* out) noexcept {
+  switch (component) {
+    case PixelComponent::kUnorm8:
+      *out = 0xFF;
+      break;
+    case PixelComponent::kUnorm16: {
+      constexpr ui16 kOne = 0xFFFF;
+      std::memcpy(out, &kOne, sizeof(kOne));
+    } break;
+    case PixelComponent::kFloat16: {
+      constexpr ui16 kOne = 0x3C00;
+      std::memcpy(out, &kOne, sizeof(kOne));
+    } break;
+    case PixelComponent::kFloat32: {
+      constexpr float kOne = 1.0f;
+      std::memcpy(out, &kOne, sizeof(kOne));
+    } break;
+  }
+}
+}  // namespace
+
+TextureFormat GetTextureFormat(PixelLayout layout) noexcept {
+  if (layout.channels == 3) {
+    layout.channels = 4;
+  }
+  if (layout.component == PixelComponent::kFloat32) {
+    layout.component = PixelComponent::kFloat16;
+  }
+
+  for (const FormatEntry& entry : kFormats) {
+    if (entry.layout == layout) {
+      return MakeTextureFormat(entry);
+    }
+  }
+  return {};
+}
+
+TextureFormat ChooseTextureFormat(
+    PixelLayout layout, const std::function<bool(VkFormat)>& is_supported) {
+  TextureFormat format = GetTextureFormat(layout);
+  if (format.format != VK_FORMAT_UNDEFINED && !is_supported(format.format)) {
+    format = GetTextureFormat({4, layout.component});
+  }
+
+  [[unlikely]] if (format.format == VK_FORMAT_UNDEFINED ||
+                   !is_supported(format.format)) {
+    throw std::runtime_error(fmt::format(
+        "no supported texture format for {} channels of {} bytes",
+        layout.channels, GetComponentSize(layout.component)));
+  }
+  return format;
+}
+
+std::optional<TextureFormat> FindTextureFormat(VkFormat format) noexcept {
+  for (const FormatEntry& entry : kFormats) {
+    if (entry.format == format) {
+      return MakeTextureFormat(entry);
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<ui8> ConvertPixels(std::span<const ui8> pixels, PixelLayout from,
+                               PixelLayout to) {
+  if (from == to) {
+    return {pixels.begin(), pixels.end()};
+  }
+
+  const bool to_half = from.component == PixelComponent::kFloat32 &&
+                       to.component == PixelComponent::kFloat16;
+  [[unlikely]] if (from.component != to.component && !to_half) {
+    throw std::runtime_error("unsupported pixel component conversion");
+  }
+
+  const std::array<ui32, 4> sources =
+      GetChannelSources(from.channels, to.channels);
+  const size_t from_size = GetComponentSize(from.component);
+  const size_t to_size = GetComponentSize(to.component);
+  const size_t num_pixels = pixels.size() / GetPixelSize(from);
+  std::vector<ui8> converted(num_pixels * GetPixelSize(to));
+  const ui8* in = pixels.data();
+  ui8* out = converted.data();
+  for (size_t i = 0; i != num_pixels; ++i) {
+    for (ui32 channel = 0; channel != to.channels; ++channel) {
+      const ui32 source = sources[channel];
+      if (source == kOpaque) {
+        StoreOpaque(to.component, out);
+      } else if (to_half) {
+        float value = 0.0f;
+        std::memcpy(&value, in + source * from_size, sizeof(value));
+        const ui16 half = FloatToHalf(value);
+        std::memcpy(out, &half, sizeof(half));
+      } else {
+        std::memcpy(out, in + source * from_size, from_size);
+      }
+      out += to_size;
+    }
+    in += from.channels * from_size;
+  }
+
+  return converted;
+}
+
+std::vector<ui8> ConvertMipChain(std::span<const ui8> levels,
+                                 std::vector<TextureMip>& mips,
+                                 PixelLayout from, PixelLayout to) {
+  // levels are packed one after another, so they are converted at once
+  std::vector<ui8> converted = ConvertPixels(levels, from, to);
+  const size_t from_size = GetPixelSize(from);
+  const size_t to_size = GetPixelSize(to);
+  for (TextureMip& mip : mips) {
+    mip.offset = mip.offset / from_size * to_size;
+    mip.size = mip.size / from_size * to_size;
+  }
+  return converted;
+}
+
+ui16 FloatToHalf(float value) noexcept {
+  ui32 bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const ui32 sign = (bits >> 16) & 0x8000;
+  const ui32 magnitude = bits & 0x7FFFFFFF;
+
+  // infinity and nan, nan keeps a mantissa bit
+  if (magnitude >= 0x7F800000) {
+    return static_cast<ui16>(sign | 0x7C00 |
+                             (magnitude > 0x7F800000 ? 0x200 : 0));
+  }
+  // too large even before rounding
+  if (magnitude >= 0x47800000) {
+    return static_cast<ui16>(sign | 0x7C00);
+  }
+
+  // rounds to nearest even, a carry may reach the exponent which is correct
+  auto round = [](ui32 half, ui32 remainder, ui32 halfway) {
+    return remainder > halfway || (remainder == halfway && (half & 1))
+               ? half + 1
+               : half;
+  };
+
+  // subnormal halves
+  if (magnitude < 0x38800000) {
+    if (magnitude < 0x33000000) {
+      return static_cast<ui16>(sign);
+    }
+    const ui32 mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+    const ui32 shift = 126 - (magnitude >> 23);
+    const ui32 half = mantissa >> shift;
+    const ui32 remainder = mantissa & ((1u << shift) - 1);
+    return static_cast<ui16>(sign |
+                             round(half, remainder, 1u << (shift - 1)));
+  }
+
+  // exponent bias changes from 127 to 15
+  const ui32 half = (magnitude - 0x38000000) >> 13;
+  return static_cast<ui16>(sign | round(half, magnitude & 0x1FFF, 0x1000));
+}
+
+float HalfToFloat(ui16 value) noexcept {
+  const ui32 sign = ui32{value & 0x8000u} << 16;
+  const ui32 exponent = (value >> 10) & 0x1F;
+  const ui32 mantissa = value & 0x3FFu;
+
+  ui32 bits = 0;
+  if (exponent == 0) {
+    const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -magnitude : magnitude;
+  }
+  if (exponent == 31) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float result = 0.0f;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
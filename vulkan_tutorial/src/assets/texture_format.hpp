@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "assets/mip_generator.hpp"
+#include "integer.hpp"
+#include "pixel_layout.hpp"
+#include "vulkan/vulkan.h"
+
+struct TextureFormat {
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  // texels of the format in memory
+  PixelLayout layout;
+  // for image views, replicates gray into rgb
+  VkComponentMapping swizzle{};
+};
+
+// Smallest format that holds pixels of the layout. Textures are color, so 8
+// bit formats are sRGB. 16 bit formats are linear, floats are stored as
+// halves. RGB pixels get an opaque alpha channel because three channel
+// formats are rarely supported for sampling
+[[nodiscard]] TextureFormat GetTextureFormat(PixelLayout layout) noexcept;
+
+// Same as above, falls back to four channels when the device does not support
+// the smaller format
+[[nodiscard]] TextureFormat ChooseTextureFormat(
+    PixelLayout layout, const std::function<bool(VkFormat)>& is_supported);
+
+// description of a format returned by GetTextureFormat
+[[nodiscard]] std::optional<TextureFormat> FindTextureFormat(
+    VkFormat format) noexcept;
+
+// Copies pixels into another layout: gray is replicated into rgb, missing
+// alpha is opaque and 32 bit floats are converted to halves. Other component
+// conversions are not supported
+[[nodiscard]] std::vector<ui8> ConvertPixels(std::span<const ui8> pixels,
+                                             PixelLayout from, PixelLayout to);
+
+// converts all levels of a mip chain and updates their offsets and sizes
+[[nodiscard]] std::vector<ui8> ConvertMipChain(std::span<const ui8> levels,
+                                               std::vector<TextureMip>& mips,
+                                               PixelLayout from,
+                                               PixelLayout to);
+
+[[nodiscard]] ui16 FloatToHalf(float value) noexcept;
+[[nodiscard]] float HalfToFloat(ui16 value) noexcept;
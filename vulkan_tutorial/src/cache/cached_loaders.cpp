@@ -0,0 +1,145 @@
+#include "cache/cached_loaders.hpp"
+
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "cache/derived_data_cache.hpp"
+#include "fmt/format.h"
+#include "image_loader.hpp"
+#include "model_loader.hpp"
+#include "read_file.hpp"
+
+namespace {
+// bump when the output of an importer changes
+constexpr ui32 kImageImporterVersion = 2;
+constexpr ui32 kObjImporterVersion = 1;
+
+template <typename T>
+void Append(std::vector<ui8>& out, std::span<const T> values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  const ui64 count = values.size();
+  const auto count_bytes = reinterpret_cast<const ui8*>(&count);
+  out.insert(out.end(), count_bytes, count_bytes + sizeof(count));
+  const auto bytes = reinterpret_cast<const ui8*>(values.data());
+  out.insert(out.end(), bytes, bytes + values.size_bytes());
+}
+
+// reads what Append wrote, entries are checksummed so size errors mean a bug
+template <typename T>
+void Read(std::span<const ui8>& in, std::vector<T>& values) {
+  ui64 count = 0;
+  [[unlikely]] if (in.size() < sizeof(count)) {
+    throw std::runtime_error("derived data entry is too short");
+  }
+  std::memcpy(&count, in.data(), sizeof(count));
+  in = in.subspan(sizeof(count));
+  [[unlikely]] if (in.size() / sizeof(T) < count) {
+    throw std::runtime_error("derived data entry is too short");
+  }
+  values.resize(count);
+  std::memcpy(values.data(), in.data(), count * sizeof(T));
+  in = in.subspan(count * sizeof(T));
+}
+
+[[nodiscard]] std::span<const ui8> AsBytes(std::span<const char> file) {
+  return std::span(reinterpret_cast<const ui8*>(file.data()), file.size());
+}
+
+[[nodiscard]] std::optional<std::string> MakeKey(std::span<const char> file,
+                                                 DerivedDataCache* cache,
+                                                 std::string_view importer,
+                                                 ui32 version,
+                                                 std::string_view settings) {
+  if (!cache) {
+    return std::nullopt;
+  }
+
+  return DerivedDataCache::MakeKey(AsBytes(file), importer, version, settings);
+}
+}  // namespace
+
+DecodedImage LoadImageCached(const std::filesystem::path& path,
+                             DerivedDataCache* cache) {
+  // read once for the key and for the decoder
+  std::vector<char> file;
+  ReadFile(path, file);
+  return DecodeImageCached(file, cache);
+}
+
+DecodedImage DecodeImageCached(std::span<const char> file,
+                               DerivedDataCache* cache) {
+  const std::optional<std::string> key =
+      MakeKey(file, cache, "image", kImageImporterVersion, "native");
+  DecodedImage image;
+  if (key) {
+    if (std::optional<std::vector<ui8>> entry = cache->Load(*key)) {
+      std::span<const ui8> in = *entry;
+      std::vector<ui32> header;
+      Read(in, header);
+      Read(in, image.pixels);
+      image.width = header.at(0);
+      image.height = header.at(1);
+      image.layout.channels = header.at(2);
+      image.layout.component = static_cast<PixelComponent>(header.at(3));
+      return image;
+    }
+  }
+
+  ImageLoader loader;
+  loader.LoadFromMemory(AsBytes(file));
+  image.width = loader.GetWidth();
+  image.height = loader.GetHeight();
+  image.layout = loader.GetLayout();
+  const std::span<const ui8> pixels = loader.GetData();
+  image.pixels.assign(pixels.begin(), pixels.end());
+
+  if (key) {
+    std::vector<ui8> entry;
+    const std::array header{image.width, image.height, image.layout.channels,
+                            static_cast<ui32>(image.layout.component)};
+    Append(entry, std::span<const ui32>(header));
+    Append(entry, std::span<const ui8>(image.pixels));
+    cache->Store(*key, entry);
+  }
+
+  return image;
+}
+
+void LoadObjModelCached(const std::filesystem::path& path,
+                        DerivedDataCache* cache, std::vector<Vertex>& vertices,
+                        std::vector<ui32>& indices) {
+  std::vector<char> file;
+  ReadFile(path, file);
+  ParseObjModelCached(file, cache, vertices, indices);
+}
+
+void ParseObjModelCached(std::span<const char> file, DerivedDataCache* cache,
+                         std::vector<Vertex>& vertices,
+                         std::vector<ui32>& indices) {
+  vertices.clear();
+  indices.clear();
+  const std::optional<std::string> key =
+      MakeKey(file, cache, "obj", kObjImporterVersion,
+              fmt::format("vertex{}", sizeof(Vertex)));
+  if (key) {
+    if (std::optional<std::vector<ui8>> entry = cache->Load(*key)) {
+      std::span<const ui8> in = *entry;
+      Read(in, vertices);
+      Read(in, indices);
+      return;
+    }
+  }
+
+  ParseObjModel(file, vertices, indices);
+
+  if (key) {
+    std::vector<ui8> entry;
+    Append(entry, std::span<const Vertex>(vertices));
+    Append(entry, std::span<const ui32>(indices));
+    cache->Store(*key, entry);
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "integer.hpp"
+#include "pipeline/vertex.hpp"
+#include "pixel_layout.hpp"
+
+class DerivedDataCache;
+
+// tightly packed pixels with the channels and bit depth of the source
+struct DecodedImage {
+  ui32 width = 0;
+  ui32 height = 0;
+  PixelLayout layout;
+  std::vector<ui8> pixels;
+};
+
+// Same results as the plain loaders. Sources are hashed to look results up in
+// the cache, misses are imported and stored. Cache may be null. Unlike
+// LoadObjModel, the output arrays are replaced
+[[nodiscard]] DecodedImage LoadImageCached(const std::filesystem::path& path,
+                                           DerivedDataCache* cache);
+void LoadObjModelCached(const std::filesystem::path& path,
+                        DerivedDataCache* cache, std::vector<Vertex>& vertices,
+                        std::vector<ui32>& indices);
+
+// same for files that were already read, for loaders that batch their reads
+[[nodiscard]] DecodedImage DecodeImageCached(std::span<const char> file,
+                                             DerivedDataCache* cache);
+void ParseObjModelCached(std::span<const char> file, DerivedDataCache* cache,
+                         std::vector<Vertex>& vertices,
+                         std::vector<ui32>& indices);
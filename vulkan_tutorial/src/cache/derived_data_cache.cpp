@@ -0,0 +1,251 @@
+#include "cache/derived_data_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#include "fmt/format.h"
+#include "process_id.hpp"
+#include "read_file.hpp"
+#include "spdlog/spdlog.h"
+
+namespace {
+constexpr std::array<char, 4> kEntryMagic{'V', 'K', 'D', 'D'};
+constexpr std::string_view kEntryExtension = ".ddc";
+
+struct EntryHeader {
+  std::array<char, 4> magic = kEntryMagic;
+  ui32 reserved = 0;
+  ui64 size = 0;
+  ui64 checksum = 0;
+};
+
+// splitmix64 finalizer, spreads every input bit over the whole result
+[[nodiscard]] constexpr ui64 Mix(ui64 value) noexcept {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  value ^= value >> 31;
+  return value;
+}
+
+// not cryptographic, collisions only matter between versions of one asset
+[[nodiscard]] ui64 HashBytes(std::span<const ui8> bytes, ui64 seed) noexcept {
+  constexpr ui64 kPrime = 0x100000001b3ull;
+  ui64 hash = Mix(seed ^ bytes.size());
+  size_t i = 0;
+  for (; i + sizeof(ui64) <= bytes.size(); i += sizeof(ui64)) {
+    ui64 word = 0;
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    hash = (hash ^ Mix(word)) * kPrime;
+  }
+  for (; i != bytes.size(); ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+
+  return Mix(hash);
+}
+
+[[nodiscard]] std::span<const ui8> AsBytes(std::string_view text) noexcept {
+  return {reinterpret_cast<const ui8*>(text.data()), text.size()};
+}
+}  // namespace
+
+DerivedDataCache::DerivedDataCache(DerivedDataCacheSettings settings)
+    : settings_(std::move(settings)) {
+  std::filesystem::create_directories(settings_.directory);
+  ScanEntries();
+}
+
+std::string DerivedDataCache::MakeKey(std::span<const ui8> source,
+                                      std::string_view importer,
+                                      ui32 importer_version,
+                                      std::string_view settings) {
+  const std::string description =
+      fmt::format("{}:{}:{}", importer, importer_version, settings);
+  // two independent hashes make a 128 bit key
+  std::array<ui64, 2> hash{};
+  for (size_t i = 0; i != hash.size(); ++i) {
+    hash[i] = HashBytes(source, i) ^ Mix(HashBytes(AsBytes(description), i));
+  }
+
+  return fmt::format("{}-{:016x}{:016x}", importer, hash[0], hash[1]);
+}
+
+std::optional<std::vector<ui8>> DerivedDataCache::Load(std::string_view key) {
+  const std::filesystem::path path = GetEntryPath(key);
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    ++num_misses_;
+    return std::nullopt;
+  }
+
+  std::vector<char> buffer;
+  try {
+    ReadFile(path, buffer);
+  } catch (const std::exception& e) {
+    spdlog::warn("derived data cache: {}", e.what());
+    ++num_misses_;
+    return std::nullopt;
+  }
+
+  EntryHeader header;
+  if (buffer.size() >= sizeof(header)) {
+    std::memcpy(&header, buffer.data(), sizeof(header));
+  }
+
+  const std::span<const ui8> payload =
+      std::span(reinterpret_cast<const ui8*>(buffer.data()), buffer.size())
+          .subspan(std::min(sizeof(header), buffer.size()));
+  [[unlikely]] if (buffer.size() < sizeof(header) ||
+                   header.magic != kEntryMagic ||
+                   header.size != payload.size() ||
+                   header.checksum != HashBytes(payload, 0)) {
+    spdlog::warn("derived data cache: removed damaged entry {}", key);
+    std::filesystem::remove(path, error);
+    UpdateEntry(key, 0);
+    ++num_misses_;
+    return std::nullopt;
+  }
+
+  // marks the entry as recently used
+  std::filesystem::last_write_time(
+      path, std::filesystem::file_time_type::clock::now(), error);
+  UpdateEntry(key, buffer.size());
+  ++num_hits_;
+  return std::vector<ui8>(payload.begin(), payload.end());
+}
+
+void DerivedDataCache::Store(std::string_view key,
+                             std::span<const ui8> data) {
+  const std::filesystem::path path = GetEntryPath(key);
+  // unique name, so concurrent writers of all processes never share a
+  // temporary file
+  std::filesystem::path temporary = path;
+  temporary +=
+      fmt::format(".{}-{}.tmp", GetCurrentPid(),
+                  std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+  EntryHeader header;
+  header.size = data.size();
+  header.checksum = HashBytes(data, 0);
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file) {
+      spdlog::warn("derived data cache: failed to write {}",
+                   temporary.string());
+      std::error_code error;
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+
+  // readers see either no entry or a complete one
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    spdlog::warn("derived data cache: failed to store {}: {}", key,
+                 error.message());
+    std::filesystem::remove(temporary, error);
+    return;
+  }
+
+  UpdateEntry(key, sizeof(header) + data.size());
+}
+
+void DerivedDataCache::LogStats() const {
+  const ui64 hits = num_hits_;
+  const ui64 misses = num_misses_;
+  const ui64 total = hits + misses;
+  spdlog::info("derived data cache: {} hits, {} misses, hit rate {:.1f}%",
+               hits, misses,
+               total ? 100.0 * static_cast<double>(hits) /
+                           static_cast<double>(total)
+                     : 0.0);
+}
+
+std::filesystem::path DerivedDataCache::GetEntryPath(
+    std::string_view key) const {
+  std::filesystem::path path = settings_.directory / key;
+  path += kEntryExtension;
+  return path;
+}
+
+void DerivedDataCache::ScanEntries() {
+  std::lock_guard lock(mutex_);
+  std::error_code error;
+  for (const auto& item :
+       std::filesystem::directory_iterator(settings_.directory, error)) {
+    if (!item.is_regular_file(error) ||
+        item.path().extension() != kEntryExtension) {
+      continue;
+    }
+
+    Entry entry;
+    entry.size = item.file_size(error);
+    entry.time = item.last_write_time(error);
+    if (!error) {
+      entries_[item.path().stem().string()] = entry;
+      total_size_ += entry.size;
+    }
+  }
+
+  Evict();
+}
+
+void DerivedDataCache::UpdateEntry(std::string_view key, ui64 size) {
+  std::lock_guard lock(mutex_);
+  if (const auto it = entries_.find(std::string(key)); it != entries_.end()) {
+    total_size_ -= it->second.size;
+    entries_.erase(it);
+  }
+
+  if (size != 0) {
+    entries_.emplace(
+        std::string(key),
+        Entry{size, std::filesystem::file_time_type::clock::now()});
+    total_size_ += size;
+    Evict();
+  }
+}
+
+void DerivedDataCache::Evict() {
+  if (total_size_ <= settings_.max_size) {
+    return;
+  }
+
+  using EntryIterator = decltype(entries_)::iterator;
+  std::vector<EntryIterator> by_time;
+  by_time.reserve(entries_.size());
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    by_time.push_back(it);
+  }
+  std::sort(by_time.begin(), by_time.end(),
+            [](EntryIterator a, EntryIterator b) {
+              return a->second.time < b->second.time;
+            });
+
+  std::error_code error;
+  for (EntryIterator it : by_time) {
+    if (total_size_ <= settings_.max_size) {
+      break;
+    }
+
+    // an entry removed by another process is forgotten too
+    std::filesystem::remove(GetEntryPath(it->first), error);
+    if (error) {
+      continue;
+    }
+
+    spdlog::debug("derived data cache: evicted {}", it->first);
+    total_size_ -= it->second.size;
+    entries_.erase(it);
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "integer.hpp"
+
+struct DerivedDataCacheSettings {
+  std::filesystem::path directory;
+  // least recently used entries are removed above this size
+  ui64 max_size = ui64{1} << 30;
+};
+
+// Stores results of importers in files named by a hash of the source file
+// contents, importer version and settings, so changed sources or importers
+// never hit stale entries. Entries are written atomically and checked on
+// load, a damaged entry is a miss. Recency is the modification time of the
+// entry, it is updated on every hit. Sizes and recency of entries are read
+// from the directory once, then tracked in memory, so entries written by
+// other processes later are not counted until the next start
+class DerivedDataCache {
+ public:
+  explicit DerivedDataCache(DerivedDataCacheSettings settings);
+
+  // importer version has to change whenever its output format changes
+  [[nodiscard]] static std::string MakeKey(std::span<const ui8> source,
+                                           std::string_view importer,
+                                           ui32 importer_version,
+                                           std::string_view settings = {});
+
+  [[nodiscard]] std::optional<std::vector<ui8>> Load(std::string_view key);
+  // failures are logged, the cache is an optimization
+  void Store(std::string_view key, std::span<const ui8> data);
+
+  [[nodiscard]] ui64 GetNumHits() const noexcept { return num_hits_; }
+  [[nodiscard]] ui64 GetNumMisses() const noexcept { return num_misses_; }
+  void LogStats() const;
+
+ private:
+  struct Entry {
+    ui64 size = 0;
+    std::filesystem::file_time_type time;
+  };
+
+  [[nodiscard]] std::filesystem::path GetEntryPath(std::string_view key) const;
+  void ScanEntries();
+  // Updates size and recency of the entry, evicts when the cache is full.
+  // Zero size forgets the entry
+  void UpdateEntry(std::string_view key, ui64 size);
+  // removes least recently used entries until the cache fits, mutex_ is held
+  void Evict();
+
+ private:
+  DerivedDataCacheSettings settings_;
+  std::mutex mutex_;
+  // by key
+  std::unordered_map<std::string, Entry> entries_;
+  ui64 total_size_ = 0;
+  std::atomic<ui64> num_hits_ = 0;
+  std::atomic<ui64> num_misses_ = 0;
+};
@@ -0,0 +1,230 @@
+#include "compression/compressed_blocks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+
+#include "compression/lz4.hpp"
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+#include "threading/thread_pool.hpp"
+
+namespace {
+// followed by the stored size of every block and the blocks
+struct StreamHeader {
+  ui64 raw_size = 0;
+  ui32 block_size = 0;
+  ui32 num_blocks = 0;
+};
+static_assert(std::is_trivially_copyable_v<StreamHeader>);
+
+// set in the stored size of blocks that are compressed
+constexpr ui32 kCompressedBit = ui32{1} << 31;
+
+[[nodiscard]] ui64 GetNumBlocks(ui64 raw_size, ui32 block_size) noexcept {
+  return (raw_size + block_size - 1) / block_size;
+}
+
+template <typename T>
+void Append(std::vector<ui8>& out, const T& value) {
+  const auto bytes = reinterpret_cast<const ui8*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+[[noreturn]] void ThrowBroken() {
+  throw std::runtime_error("compressed blocks are truncated or broken");
+}
+}  // namespace
+
+void CompressBlocks(std::span<const ui8> data, std::vector<ui8>& out,
+                    ui32 block_size) {
+  [[unlikely]] if (block_size == 0 || block_size >= kCompressedBit) {
+    throw std::runtime_error(
+        fmt::format("invalid compression block size {}", block_size));
+  }
+
+  StreamHeader header;
+  header.raw_size = data.size();
+  header.block_size = block_size;
+  header.num_blocks = static_cast<ui32>(GetNumBlocks(data.size(), block_size));
+  Append(out, header);
+  const size_t sizes_offset = out.size();
+  out.resize(out.size() + header.num_blocks * sizeof(ui32));
+
+  std::vector<ui8> compressed(GetLz4CompressBound(block_size));
+  for (ui32 i = 0; i != header.num_blocks; ++i) {
+    const std::span<const ui8> block = data.subspan(
+        size_t{i} * block_size,
+        std::min<size_t>(block_size, data.size() - size_t{i} * block_size));
+    const size_t compressed_size = Lz4Compress(block, compressed);
+    ui32 stored_size = static_cast<ui32>(block.size());
+    if (compressed_size < block.size()) {
+      stored_size = static_cast<ui32>(compressed_size) | kCompressedBit;
+      out.insert(out.end(), compressed.begin(),
+                 compressed.begin() + static_cast<ptrdiff_t>(compressed_size));
+    } else {
+      out.insert(out.end(), block.begin(), block.end());
+    }
+    std::memcpy(out.data() + sizes_offset + i * sizeof(ui32), &stored_size,
+                sizeof(stored_size));
+  }
+}
+
+CompressedBlocks::CompressedBlocks(std::span<const ui8> data) {
+  StreamHeader header;
+  [[unlikely]] if (data.size() < sizeof(header)) {
+    ThrowBroken();
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  const size_t table_size = size_t{header.num_blocks} * sizeof(ui32);
+  [[unlikely]] if (header.block_size == 0 ||
+                   header.num_blocks !=
+                       GetNumBlocks(header.raw_size, header.block_size) ||
+                   data.size() - sizeof(header) < table_size) {
+    ThrowBroken();
+  }
+
+  size_t offset = sizeof(header) + table_size;
+  blocks_.resize(header.num_blocks);
+  for (ui32 i = 0; i != header.num_blocks; ++i) {
+    ui32 stored_size = 0;
+    std::memcpy(&stored_size, data.data() + sizeof(header) + i * sizeof(ui32),
+                sizeof(stored_size));
+    Block& block = blocks_[i];
+    block.offset = offset;
+    block.size = stored_size & ~kCompressedBit;
+    block.compressed = (stored_size & kCompressedBit) != 0;
+    const ui64 raw_block_size = std::min<ui64>(
+        header.block_size, header.raw_size - ui64{i} * header.block_size);
+    [[unlikely]] if (block.size > data.size() - offset ||
+                     (!block.compressed && block.size != raw_block_size)) {
+      ThrowBroken();
+    }
+    offset += block.size;
+  }
+
+  data_ = data.first(offset);
+  raw_size_ = header.raw_size;
+  stored_size_ = offset;
+  block_size_ = header.block_size;
+}
+
+void CompressedBlocks::Decompress(ui64 offset, std::span<ui8> out,
+                                  ThreadPool* thread_pool) const {
+  [[unlikely]] if (offset > raw_size_ || out.size() > raw_size_ - offset) {
+    throw std::runtime_error(fmt::format(
+        "range of {} bytes at {} is outside of {} compressed bytes",
+        out.size(), offset, raw_size_));
+  }
+  if (out.empty()) {
+    return;
+  }
+
+  const size_t first = static_cast<size_t>(offset / block_size_);
+  const size_t num_blocks =
+      static_cast<size_t>((offset + out.size() - 1) / block_size_) - first + 1;
+  if (!thread_pool || num_blocks == 1) {
+    for (size_t i = 0; i != num_blocks; ++i) {
+      DecompressBlock(first + i, offset, out);
+    }
+    return;
+  }
+
+  // helpers that start after all blocks were taken only touch the shared
+  // state, so the caller may return before they run
+  struct Shared {
+    std::atomic<size_t> next = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t num_finished = 0;
+    std::exception_ptr error;
+  };
+  auto shared = std::make_shared<Shared>();
+  const auto take_blocks = [this, shared, first, num_blocks, offset, out]() {
+    while (true) {
+      const size_t i = shared->next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= num_blocks) {
+        return;
+      }
+
+      std::exception_ptr error;
+      try {
+        DecompressBlock(first + i, offset, out);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard lock(shared->mutex);
+      if (error && !shared->error) {
+        shared->error = error;
+      }
+      if (++shared->num_finished == num_blocks) {
+        shared->finished.notify_all();
+      }
+    }
+  };
+
+  const size_t num_helpers =
+      std::min(num_blocks - 1, thread_pool->GetNumThreads());
+  for (size_t i = 0; i != num_helpers; ++i) {
+    thread_pool->Post(take_blocks);
+  }
+  take_blocks();
+
+  std::unique_lock lock(shared->mutex);
+  shared->finished.wait(lock,
+                        [&]() { return shared->num_finished == num_blocks; });
+  if (shared->error) {
+    std::rethrow_exception(shared->error);
+  }
+}
+
+void CompressedBlocks::DecompressBlock(size_t index, ui64 offset,
+                                       std::span<ui8> out) const {
+  const Block& block = blocks_[index];
+  const std::span<const ui8> stored = data_.subspan(block.offset, block.size);
+  const ui64 block_begin = ui64{index} * block_size_;
+  const size_t raw_block_size =
+      static_cast<size_t>(std::min<ui64>(block_size_, raw_size_ - block_begin));
+
+  // part of the block that is requested
+  const ui64 begin = std::max(block_begin, offset);
+  const ui64 end = std::min(block_begin + raw_block_size, offset + out.size());
+  const std::span<ui8> target = out.subspan(
+      static_cast<size_t>(begin - offset), static_cast<size_t>(end - begin));
+  const size_t skipped = static_cast<size_t>(begin - block_begin);
+
+  if (!block.compressed) {
+    std::memcpy(target.data(), stored.data() + skipped, target.size());
+  } else if (target.size() == raw_block_size) {
+    Lz4Decompress(stored, target);
+  } else {
+    // blocks at the ends of the range are decoded aside
+    std::vector<ui8> raw(raw_block_size);
+    Lz4Decompress(stored, raw);
+    std::memcpy(target.data(), raw.data() + skipped, target.size());
+  }
+}
+
+void LogDecompression(std::string_view asset, ui64 raw_size,
+                      size_t stored_size, ui64 decoded_size,
+                      std::chrono::nanoseconds duration) {
+  constexpr double kMiB = 1 << 20;
+  const double seconds = std::chrono::duration<double>(duration).count();
+  const double decoded_mib = static_cast<double>(decoded_size) / kMiB;
+  spdlog::info(
+      "{}: {:.1f} MiB stored in {:.1f} MiB, ratio {:.2f}, decoded {:.1f} MiB "
+      "at {:.0f} MiB/s",
+      asset, static_cast<double>(raw_size) / kMiB,
+      static_cast<double>(stored_size) / kMiB,
+      static_cast<double>(raw_size) /
+          static_cast<double>(std::max<size_t>(stored_size, 1)),
+      decoded_mib, seconds > 0.0 ? decoded_mib / seconds : 0.0);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "integer.hpp"
+
+class ThreadPool;
+
+// raw bytes of a block, large enough to keep the pool busy with a few blocks
+// of a texture and small enough to split a mesh between threads
+constexpr ui32 kDefaultCompressionBlockSize = 256 << 10;
+
+// Appends `data` split into blocks of `block_size` raw bytes that are
+// compressed with LZ4 independently, so any range is decoded without the
+// blocks before it and blocks are decoded in parallel. Blocks that do not
+// shrink are stored as they are
+void CompressBlocks(std::span<const ui8> data, std::vector<ui8>& out,
+                    ui32 block_size = kDefaultCompressionBlockSize);
+
+// Block table of data written by CompressBlocks. Refers to the stored bytes,
+// which have to outlive it
+class CompressedBlocks {
+ public:
+  CompressedBlocks() = default;
+  // validates the block table, throws when it does not fit into `data`
+  explicit CompressedBlocks(std::span<const ui8> data);
+
+  [[nodiscard]] ui64 GetRawSize() const noexcept { return raw_size_; }
+  // block table and compressed blocks
+  [[nodiscard]] size_t GetStoredSize() const noexcept { return stored_size_; }
+
+  // Decodes raw bytes from `offset` into `out`. Blocks that are covered
+  // whole are decoded straight into `out`. With a pool, blocks are taken by
+  // the pool and the calling thread together, so calls from tasks of the same
+  // pool do not deadlock
+  void Decompress(ui64 offset, std::span<ui8> out,
+                  ThreadPool* thread_pool = nullptr) const;
+
+ private:
+  struct Block {
+    size_t offset = 0;
+    ui32 size = 0;
+    bool compressed = false;
+  };
+
+  void DecompressBlock(size_t index, ui64 offset, std::span<ui8> out) const;
+
+ private:
+  std::span<const ui8> data_;
+  std::vector<Block> blocks_;
+  ui64 raw_size_ = 0;
+  size_t stored_size_ = 0;
+  ui32 block_size_ = 0;
+};
+
+// logs compression ratio of an asset and throughput of decoding
+// `decoded_size` of its raw bytes
+void LogDecompression(std::string_view asset, ui64 raw_size,
+                      size_t stored_size, ui64 decoded_size,
+                      std::chrono::nanoseconds duration);
@@ -0,0 +1,198 @@
+#include "compression/lz4.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kMinMatch = 4;
+// the last match starts at least this many bytes before the end
+constexpr size_t kMatchFindLimit = 12;
+// the last bytes are always literals
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMaxOffset = 65535;
+constexpr ui32 kHashBits = 12;
+// short copies are done in chunks of this size when there is room after them
+constexpr size_t kCopyChunk = 16;
+
+[[nodiscard]] ui32 Read32(const ui8* data) noexcept {
+  ui32 value = 0;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+[[nodiscard]] ui32 Hash(ui32 sequence) noexcept {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// lengths that do not fit into a nibble continue in bytes of 255
+[[nodiscard]] ui8* WriteLength(ui8* out, size_t length) noexcept {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = static_cast<ui8>(length);
+  return out;
+}
+
+[[nodiscard]] ui8* WriteLiterals(ui8* out, ui8* token, const ui8* literals,
+                                 size_t size) noexcept {
+  if (size >= 15) {
+    *token = 15 << 4;
+    out = WriteLength(out, size - 15);
+  } else {
+    *token = static_cast<ui8>(size << 4);
+  }
+  if (size != 0) {
+    std::memcpy(out, literals, size);
+  }
+  return out + size;
+}
+
+[[noreturn]] void ThrowMalformed() {
+  throw std::runtime_error("lz4 block is malformed");
+}
+
+[[nodiscard]] size_t ReadLength(const ui8*& in, const ui8* end) {
+  size_t length = 0;
+  ui8 value = 255;
+  while (value == 255) {
+    [[unlikely]] if (in == end) {
+      ThrowMalformed();
+    }
+    value = *in++;
+    length += value;
+  }
+  return length;
+}
+}  // namespace
+
+size_t Lz4Compress(std::span<const ui8> in, std::span<ui8> out) {
+  [[unlikely]] if (out.size() < GetLz4CompressBound(in.size())) {
+    throw std::runtime_error("lz4 output buffer is too small");
+  }
+
+  const ui8* const begin = in.data();
+  const size_t size = in.size();
+  ui8* op = out.data();
+  size_t anchor = 0;
+
+  if (size >= kMatchFindLimit + 1) {
+    // positions plus one, zero is an empty slot
+    std::array<ui32, size_t{1} << kHashBits> table{};
+    const size_t match_end_limit = size - kLastLiterals;
+    size_t pos = 0;
+    while (pos + kMatchFindLimit <= size) {
+      const ui32 sequence = Read32(begin + pos);
+      ui32& slot = table[Hash(sequence)];
+      const size_t candidate = slot;
+      slot = static_cast<ui32>(pos + 1);
+      if (candidate == 0 || pos - (candidate - 1) > kMaxOffset ||
+          Read32(begin + candidate - 1) != sequence) {
+        // incompressible data is skipped faster the longer it lasts
+        pos += 1 + ((pos - anchor) >> 6);
+        continue;
+      }
+
+      const size_t match = candidate - 1;
+      size_t length = kMinMatch;
+      while (pos + length < match_end_limit &&
+             begin[match + length] == begin[pos + length]) {
+        ++length;
+      }
+
+      ui8* token = op++;
+      op = WriteLiterals(op, token, begin + anchor, pos - anchor);
+      const size_t offset = pos - match;
+      *op++ = static_cast<ui8>(offset);
+      *op++ = static_cast<ui8>(offset >> 8);
+      if (length - kMinMatch >= 15) {
+        *token |= 15;
+        op = WriteLength(op, length - kMinMatch - 15);
+      } else {
+        *token |= static_cast<ui8>(length - kMinMatch);
+      }
+
+      pos += length;
+      anchor = pos;
+    }
+  }
+
+  ui8* token = op++;
+  op = WriteLiterals(op, token, begin + anchor, size - anchor);
+  return static_cast<size_t>(op - out.data());
+}
+
+void Lz4Decompress(std::span<const ui8> in, std::span<ui8> out) {
+  const ui8* ip = in.data();
+  const ui8* const in_end = ip + in.size();
+  ui8* op = out.data();
+  ui8* const out_end = op + out.size();
+
+  while (true) {
+    [[unlikely]] if (ip == in_end) {
+      ThrowMalformed();
+    }
+    const ui8 token = *ip++;
+
+    size_t literals = token >> 4;
+    if (literals == 15) {
+      literals += ReadLength(ip, in_end);
+    }
+    [[unlikely]] if (literals > static_cast<size_t>(in_end - ip) ||
+                     literals > static_cast<size_t>(out_end - op)) {
+      ThrowMalformed();
+    }
+    if (literals <= kCopyChunk &&
+        static_cast<size_t>(in_end - ip) >= kCopyChunk &&
+        static_cast<size_t>(out_end - op) >= kCopyChunk) {
+      std::memcpy(op, ip, kCopyChunk);
+    } else if (literals != 0) {
+      std::memcpy(op, ip, literals);
+    }
+    ip += literals;
+    op += literals;
+
+    // the last sequence has no match
+    if (ip == in_end) {
+      break;
+    }
+
+    [[unlikely]] if (in_end - ip < 2) {
+      ThrowMalformed();
+    }
+    const size_t offset = size_t{ip[0]} | size_t{ip[1]} << 8;
+    ip += 2;
+    size_t length = token & 15;
+    if (length == 15) {
+      length += ReadLength(ip, in_end);
+    }
+    length += kMinMatch;
+    [[unlikely]] if (offset == 0 ||
+                     offset > static_cast<size_t>(op - out.data()) ||
+                     length > static_cast<size_t>(out_end - op)) {
+      ThrowMalformed();
+    }
+
+    const ui8* match = op - offset;
+    if (offset >= kCopyChunk &&
+        static_cast<size_t>(out_end - op) >= length + kCopyChunk) {
+      // chunks only read bytes that are already final
+      for (size_t i = 0; i < length; i += kCopyChunk) {
+        std::memcpy(op + i, match + i, kCopyChunk);
+      }
+      op += length;
+    } else if (offset >= length) {
+      std::memcpy(op, match, length);
+      op += length;
+    } else {
+      // overlapping matches repeat the bytes that were just written
+      for (size_t i = 0; i != length; ++i) {
+        *op++ = *match++;
+      }
+    }
+  }
+
+  [[unlikely]] if (op != out_end) {
+    ThrowMalformed();
+  }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+
+#include "integer.hpp"
+
+// LZ4 block format: literals and matches of at least four bytes up to 64 KiB
+// back, without frames or checksums. Compression is greedy with a single hash
+// table, decompression is a plain copy loop
+
+// size of the output buffer that fits compressed data of any input
+[[nodiscard]] constexpr size_t GetLz4CompressBound(size_t size) noexcept {
+  return size + size / 255 + 16;
+}
+
+// returns the size of compressed data, `out` has to fit the bound
+[[nodiscard]] size_t Lz4Compress(std::span<const ui8> in, std::span<ui8> out);
+
+// `out` has the exact size of the original data, throws on malformed input
+void Lz4Decompress(std::span<const ui8> in, std::span<ui8> out);
@@ -0,0 +1,367 @@
+#include "config/app_config.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+constexpr std::array<std::pair<std::string_view, VkPresentModeKHR>, 4>
+    kPresentModes{{{"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+                   {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+                   {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+                   {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR}}};
+
+constexpr std::array<std::pair<std::string_view, ClockMode>, 3> kClockModes{
+    {{"realtime", ClockMode::RealTime},
+     {"fixed", ClockMode::FixedStep},
+     {"playback", ClockMode::Playback}}};
+
+// every tier halves both sides of a texture
+constexpr ui32 kMaxTextureQuality = 8;
+
+[[nodiscard]] std::string_view Trim(std::string_view text) noexcept {
+  constexpr std::string_view kSpaces = " \t\r\n";
+  const size_t begin = text.find_first_not_of(kSpaces);
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+
+  const size_t end = text.find_last_not_of(kSpaces);
+  return text.substr(begin, end - begin + 1);
+}
+
+[[noreturn]] void ThrowInvalidValue(std::string_view key,
+                                    std::string_view value,
+                                    std::string_view expected) {
+  throw std::runtime_error(fmt::format(
+      "invalid value \"{}\" for {}, expected {}", value, key, expected));
+}
+
+[[nodiscard]] ui32 ParseUnsigned(std::string_view key, std::string_view value,
+                                 ui32 min, ui32 max) {
+  ui32 result = 0;
+  const auto [end, error] =
+      std::from_chars(value.data(), value.data() + value.size(), result);
+  if (error != std::errc() || end != value.data() + value.size() ||
+      result < min || result > max) {
+    ThrowInvalidValue(key, value, fmt::format("integer in [{}, {}]", min, max));
+  }
+
+  return result;
+}
+
+[[nodiscard]] bool ParseBool(std::string_view key, std::string_view value) {
+  if (value == "true" || value == "on" || value == "yes" || value == "1") {
+    return true;
+  }
+
+  if (value == "false" || value == "off" || value == "no" || value == "0") {
+    return false;
+  }
+
+  ThrowInvalidValue(key, value, "true or false");
+}
+
+[[nodiscard]] std::vector<VkPresentModeKHR> ParsePresentModes(
+    std::string_view key, std::string_view value) {
+  std::vector<VkPresentModeKHR> modes;
+  while (!value.empty()) {
+    const size_t comma = value.find(',');
+    const std::string_view name = Trim(value.substr(0, comma));
+    value = comma == std::string_view::npos ? std::string_view{}
+                                            : value.substr(comma + 1);
+
+    auto it =
+        std::find_if(kPresentModes.begin(), kPresentModes.end(),
+                     [&](const auto& mode) { return mode.first == name; });
+    if (it == kPresentModes.end()) {
+      ThrowInvalidValue(key, name,
+                        "comma separated immediate, mailbox, fifo or "
+                        "fifo_relaxed");
+    }
+    modes.push_back(it->second);
+  }
+
+  if (modes.empty()) {
+    ThrowInvalidValue(key, value, "at least one present mode");
+  }
+
+  return modes;
+}
+
+// comma separated `name:tier` pairs
+[[nodiscard]] std::map<std::string, ui32> ParseTextureQualities(
+    std::string_view key, std::string_view value) {
+  std::map<std::string, ui32> tiers;
+  while (!value.empty()) {
+    const size_t comma = value.find(',');
+    const std::string_view entry = Trim(value.substr(0, comma));
+    value = comma == std::string_view::npos ? std::string_view{}
+                                            : value.substr(comma + 1);
+
+    const size_t colon = entry.find(':');
+    const std::string_view name = Trim(entry.substr(0, colon));
+    if (colon == std::string_view::npos || name.empty()) {
+      ThrowInvalidValue(key, entry, "comma separated name:tier pairs");
+    }
+    tiers[std::string(name)] = ParseUnsigned(
+        key, Trim(entry.substr(colon + 1)), 0, kMaxTextureQuality);
+  }
+
+  return tiers;
+}
+
+[[nodiscard]] ClockMode ParseClockMode(std::string_view key,
+                                     std::string_view value) {
+  auto it = std::find_if(kClockModes.begin(), kClockModes.end(),
+                         [&](const auto& mode) { return mode.first == value; });
+  if (it == kClockModes.end()) {
+    ThrowInvalidValue(key, value, "realtime, fixed or playback");
+  }
+
+  return it->second;
+}
+
+using Setter = std::function<void(std::string_view, std::string_view,
+                                   AppConfig&)>;
+
+[[nodiscard]] const std::map<std::string_view, Setter>& GetSetters() {
+  static const std::map<std::string_view, Setter> setters{
+      {"max_frames_in_flight",
+       [](auto key, auto value, AppConfig& config) {
+         config.max_frames_in_flight = ParseUnsigned(key, value, 1, 8);
+       }},
+      {"window_width",
+       [](auto key, auto value, AppConfig& config) {
+         config.window_width = ParseUnsigned(key, value, 1, 16384);
+       }},
+      {"window_height",
+       [](auto key, auto value, AppConfig& config) {
+         config.window_height = ParseUnsigned(key, value, 1, 16384);
+       }},
+      {"msaa_samples",
+       [](auto key, auto value, AppConfig& config) {
+         const ui32 samples = ParseUnsigned(key, value, 0, 64);
+         if ((samples & (samples - 1)) != 0) {
+           ThrowInvalidValue(key, value, "zero or a power of two");
+         }
+         config.msaa_samples = samples;
+       }},
+      {"present_modes",
+       [](auto key, auto value, AppConfig& config) {
+         config.present_modes = ParsePresentModes(key, value);
+       }},
+      {"max_anisotropy",
+       [](auto key, auto value, AppConfig& config) {
+         config.max_anisotropy = ParseUnsigned(key, value, 1, 64);
+       }},
+      {"validation",
+       [](auto key, auto value, AppConfig& config) {
+         config.validation = ParseBool(key, value);
+       }},
+      {"mesa_overlay",
+       [](auto key, auto value, AppConfig& config) {
+         config.mesa_overlay = ParseBool(key, value);
+       }},
+      {"lunarg_monitor",
+       [](auto key, auto value, AppConfig& config) {
+         config.lunarg_monitor = ParseBool(key, value);
+       }},
+      {"content_dir",
+       [](auto, auto value, AppConfig& config) {
+         config.content_dir = value;
+       }},
+      {"device",
+       [](auto, auto value, AppConfig& config) { config.device = value; }},
+      {"device_benchmark",
+       [](auto key, auto value, AppConfig& config) {
+         config.device_benchmark = ParseBool(key, value);
+       }},
+      {"metrics_port",
+       [](auto key, auto value, AppConfig& config) {
+         config.metrics_port = static_cast<ui16>(
+             ParseUnsigned(key, value, 0, std::numeric_limits<ui16>::max()));
+       }},
+      {"clock",
+       [](auto key, auto value, AppConfig& config) {
+         config.clock = ParseClockMode(key, value);
+       }},
+      {"simulation_rate",
+       [](auto key, auto value, AppConfig& config) {
+         config.simulation_rate = ParseUnsigned(key, value, 1, 10000);
+       }},
+      {"camera_path",
+       [](auto, auto value, AppConfig& config) {
+         config.camera_path = value;
+       }},
+      {"record_camera_path",
+       [](auto, auto value, AppConfig& config) {
+         config.record_camera_path = value;
+       }},
+      {"scene",
+       [](auto, auto value, AppConfig& config) { config.scene = value; }},
+      {"mesh_streaming",
+       [](auto key, auto value, AppConfig& config) {
+         config.mesh_streaming = ParseBool(key, value);
+       }},
+      {"cache_dir",
+       [](auto, auto value, AppConfig& config) { config.cache_dir = value; }},
+      {"cache_size_mb",
+       [](auto key, auto value, AppConfig& config) {
+         config.cache_size_mb = ParseUnsigned(key, value, 0, 1 << 20);
+       }},
+      {"texture_quality",
+       [](auto key, auto value, AppConfig& config) {
+         config.texture_quality =
+             ParseUnsigned(key, value, 0, kMaxTextureQuality);
+       }},
+      {"texture_quality_overrides",
+       [](auto key, auto value, AppConfig& config) {
+         config.texture_quality_overrides = ParseTextureQualities(key, value);
+       }},
+      {"texture_budget_mb",
+       [](auto key, auto value, AppConfig& config) {
+         config.texture_budget_mb = ParseUnsigned(key, value, 0, 1 << 24);
+       }},
+      {"io_uring",
+       [](auto key, auto value, AppConfig& config) {
+         config.io_uring = ParseBool(key, value);
+       }},
+      {"direct_io",
+       [](auto key, auto value, AppConfig& config) {
+         config.direct_io = ParseBool(key, value);
+       }},
+      {"split_vertex_streams",
+       [](auto key, auto value, AppConfig& config) {
+         config.split_vertex_streams = ParseBool(key, value);
+       }},
+      {"depth_prepass",
+       [](auto key, auto value, AppConfig& config) {
+         config.depth_prepass = ParseBool(key, value);
+       }},
+      {"frame_limit",
+       [](auto key, auto value, AppConfig& config) {
+         config.frame_limit = ParseUnsigned(
+             key, value, 0, std::numeric_limits<ui32>::max());
+       }},
+  };
+
+  return setters;
+}
+
+// environment variables predate the config file and are kept for scripts
+void ApplyEnvironment(AppConfig& config) {
+  if (const char* device = std::getenv("VULKAN_TUTORIAL_DEVICE")) {
+    config.device = device;
+  }
+
+  if (const char* benchmark = std::getenv("VULKAN_TUTORIAL_DEVICE_BENCHMARK")) {
+    config.device_benchmark = std::string_view(benchmark) != "0";
+  }
+}
+}  // namespace
+
+void ApplyConfigValue(std::string_view key, std::string_view value,
+                      AppConfig& config) {
+  const auto& setters = GetSetters();
+  auto it = setters.find(key);
+  [[unlikely]] if (it == setters.end()) {
+    throw std::runtime_error(fmt::format("unknown config key {}", key));
+  }
+
+  it->second(key, Trim(value), config);
+}
+
+void ApplyConfigFile(const std::filesystem::path& path, AppConfig& config) {
+  std::ifstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  std::string line;
+  for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+    const std::string_view text =
+        Trim(std::string_view(line).substr(0, line.find('#')));
+    if (text.empty()) {
+      continue;
+    }
+
+    const size_t separator = text.find('=');
+    try {
+      [[unlikely]] if (separator == std::string_view::npos) {
+        throw std::runtime_error("expected key = value");
+      }
+      ApplyConfigValue(Trim(text.substr(0, separator)),
+                       text.substr(separator + 1), config);
+    } catch (const std::exception& e) {
+      throw std::runtime_error(fmt::format("{}:{}: {}", path.string(),
+                                           line_number, e.what()));
+    }
+  }
+}
+
+std::string_view ToString(VkPresentModeKHR mode) noexcept {
+  for (const auto& [name, value] : kPresentModes) {
+    if (value == mode) {
+      return name;
+    }
+  }
+
+  return "unknown";
+}
+
+ConfigSource::ConfigSource(
+    std::optional<std::filesystem::path> file,
+    std::vector<std::pair<std::string, std::string>> overrides)
+    : file_(std::move(file)), overrides_(std::move(overrides)) {}
+
+AppConfig ConfigSource::Load() {
+  AppConfig config;
+  if (file_) {
+    loaded_time_ = GetModificationTime();
+    ApplyConfigFile(*file_, config);
+  }
+
+  ApplyEnvironment(config);
+  for (const auto& [key, value] : overrides_) {
+    ApplyConfigValue(key, value, config);
+  }
+
+  return config;
+}
+
+std::optional<AppConfig> ConfigSource::PollChanges() {
+  if (!file_ || GetModificationTime() == loaded_time_) {
+    return std::nullopt;
+  }
+
+  try {
+    AppConfig config = Load();
+    spdlog::info("reloaded config {}", file_->string());
+    return config;
+  } catch (const std::exception& e) {
+    spdlog::error("config is not reloaded: {}", e.what());
+    return std::nullopt;
+  }
+}
+
+std::optional<std::filesystem::file_time_type>
+ConfigSource::GetModificationTime() const {
+  std::error_code error;
+  const auto time = std::filesystem::last_write_time(*file_, error);
+  if (error) {
+    return std::nullopt;
+  }
+
+  return time;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "definitions.hpp"
+#include "integer.hpp"
+#include "simulation/simulation_clock.hpp"
+#include "vulkan/vulkan.h"
+
+// Settings tuned per deployment. Values come from defaults, then the config
+// file, then environment variables and finally command line overrides.
+// Device dependent values are validated when the device is known
+struct AppConfig {
+  // frames the CPU may prepare while the GPU still renders previous ones
+  ui32 max_frames_in_flight = 2;
+  ui32 window_width = 800;
+  ui32 window_height = 600;
+  // zero picks the maximal count supported by the device
+  ui32 msaa_samples = 0;
+  // the first mode supported by the surface is used, FIFO is the fallback
+  std::vector<VkPresentModeKHR> present_modes{
+      VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR,
+      VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+  // clamped to the device limit, one disables anisotropic filtering
+  ui32 max_anisotropy = 16;
+  bool validation = kEnableValidation;
+  bool mesa_overlay = false;
+  bool lunarg_monitor = false;
+  // empty means `content` next to the executable
+  std::filesystem::path content_dir;
+  // substring of the device name or its uuid, empty picks the best device
+  std::string device;
+  bool device_benchmark = false;
+  // zero disables the metrics exporter
+  ui16 metrics_port = 0;
+  ClockMode clock = ClockMode::RealTime;
+  // animation steps per second of fixed step and playback clocks
+  ui32 simulation_rate = 60;
+  // played by playback clock
+  std::filesystem::path camera_path;
+  // camera of every frame is written here on exit when not empty
+  std::filesystem::path record_camera_path;
+  // zero renders until the window is closed
+  ui32 frame_limit = 0;
+  // list of meshes, empty loads the viking room model
+  std::filesystem::path scene;
+  // meshes are loaded in the background and boxes of baked meshes are drawn
+  // until they arrive. Off with trace recording, replay and regression check
+  bool mesh_streaming = true;
+  // imported assets, empty means `derived_data` next to the executable
+  std::filesystem::path cache_dir;
+  // least recently used entries are removed above it, zero disables the cache
+  ui32 cache_size_mb = 1024;
+  // device memory for textures, largest mip levels of cold textures are
+  // evicted above it. Zero follows the device budget when it is known
+  ui32 texture_budget_mb = 0;
+  // quality tier of textures is the number of their largest mip levels that
+  // are not loaded, for low memory devices
+  ui32 texture_quality = 0;
+  // tiers of single textures by file name without extension
+  std::map<std::string, ui32> texture_quality_overrides;
+  // assets are read through io_uring when the kernel supports it, otherwise
+  // with pread on the thread pool
+  bool io_uring = true;
+  // asset reads bypass the page cache, for cold loads of large files
+  bool direct_io = false;
+  // vertex buffers hold positions and the other attributes in separate
+  // streams, the depth prepass then fetches only positions
+  bool split_vertex_streams = true;
+  // depth of all meshes is drawn first, so shading runs once per pixel
+  bool depth_prepass = false;
+
+  bool operator==(const AppConfig&) const = default;
+};
+
+// Parses a single `key = value` setting. Throws on unknown keys and
+// malformed values
+void ApplyConfigValue(std::string_view key, std::string_view value,
+                      AppConfig& config);
+
+// Lines are `key = value`, `#` starts a comment
+void ApplyConfigFile(const std::filesystem::path& path, AppConfig& config);
+
+[[nodiscard]] std::string_view ToString(VkPresentModeKHR mode) noexcept;
+
+// Builds the config from all sources and rebuilds it when the file changes
+class ConfigSource {
+ public:
+  // the file is optional, overrides are key and value pairs
+  ConfigSource(std::optional<std::filesystem::path> file,
+               std::vector<std::pair<std::string, std::string>> overrides);
+
+  [[nodiscard]] AppConfig Load();
+
+  // Returns the new config if the file was modified since the last load.
+  // Errors in the modified file are logged and ignored
+  [[nodiscard]] std::optional<AppConfig> PollChanges();
+
+ private:
+  [[nodiscard]] std::optional<std::filesystem::file_time_type>
+  GetModificationTime() const;
+
+ private:
+  std::optional<std::filesystem::path> file_;
+  std::vector<std::pair<std::string, std::string>> overrides_;
+  std::optional<std::filesystem::file_time_type> loaded_time_;
+};
@@ -0,0 +1,425 @@
+#include "device_selector.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <stdexcept>
+#include <string_view>
+
+#include "error_handling.hpp"
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+#include "vulkan_utility.hpp"
+
+namespace {
+std::string ToLower(std::string_view text) {
+  std::string result(text);
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](unsigned char c) {
+                   return static_cast<char>(std::tolower(c));
+                 });
+  return result;
+}
+
+int SampleCountToLog2(VkSampleCountFlagBits samples) noexcept {
+  int result = 0;
+  for (auto value = static_cast<ui32>(samples); value > 1; value >>= 1) {
+    ++result;
+  }
+  return result;
+}
+}  // namespace
+
+DeviceSelector::DeviceSelector(DeviceSelectionSettings settings)
+    : settings_(std::move(settings)) {}
+
+DeviceCandidate DeviceSelector::Select(VkInstance instance,
+                                       VkSurfaceKHR surface) const {
+  std::vector<VkPhysicalDevice> devices;
+  VulkanUtility::GetDevices(instance, devices);
+
+  [[unlikely]] if (devices.empty()) {
+    throw std::runtime_error("There is no vulkan capable devices");
+  }
+
+  spdlog::info("rating physical devices:");
+  std::vector<DeviceCandidate> candidates;
+  for (VkPhysicalDevice device : devices) {
+    if (auto candidate = Evaluate(device, surface); candidate.has_value()) {
+      candidates.push_back(std::move(*candidate));
+    }
+  }
+
+  [[unlikely]] if (candidates.empty()) {
+    throw std::runtime_error("There is no suitable device");
+  }
+
+  if (!settings_.device_override.empty()) {
+    for (DeviceCandidate& candidate : candidates) {
+      if (MatchesOverride(candidate.device_info)) {
+        spdlog::info("picked {}: matches device override \"{}\"",
+                     candidate.device_info.properties.deviceName,
+                     settings_.device_override);
+        return std::move(candidate);
+      }
+    }
+
+    spdlog::warn(
+        "no suitable device matches device override \"{}\", picking device "
+        "with the highest score",
+        settings_.device_override);
+  }
+
+  auto best = std::max_element(
+      candidates.begin(), candidates.end(),
+      [](const DeviceCandidate& a, const DeviceCandidate& b) {
+        return a.score < b.score;
+      });
+  spdlog::info("picked {}: the highest score {}",
+               best->device_info.properties.deviceName, best->score);
+  return std::move(*best);
+}
+
+std::optional<DeviceCandidate> DeviceSelector::Evaluate(
+    VkPhysicalDevice device, VkSurfaceKHR surface) const {
+  DeviceCandidate candidate;
+  PhysicalDeviceInfo& device_info = candidate.device_info;
+  device_info.Populate(device, surface, settings_.instance_api_version);
+  const std::string_view name = device_info.properties.deviceName;
+
+  for (const char* extension : settings_.required_extensions) {
+    if (!device_info.HasExtension(extension)) {
+      spdlog::info("   {}: rejected, {} is not supported", name, extension);
+      return {};
+    }
+  }
+
+  if (!device_info.HasAllRequired()) {
+    spdlog::info("   {}: rejected, no graphics or present queue family",
+                 name);
+    return {};
+  }
+
+  // Check swapchain compatibility
+  candidate.surface_info.Populate(device, surface);
+  if (candidate.surface_info.formats.empty() ||
+      candidate.surface_info.present_modes.empty()) {
+    spdlog::info("   {}: rejected, swap chain is not supported", name);
+    return {};
+  }
+
+  if (settings_.run_benchmark) {
+    candidate.benchmark = RunBenchmark(device_info);
+  }
+
+  Rate(candidate);
+
+  spdlog::info("   {} [{}]: score {}", name,
+               device_info.has_device_uuid ? device_info.GetDeviceUuidString()
+                                           : "no uuid",
+               candidate.score);
+  for (const std::string& reason : candidate.reasons) {
+    spdlog::info("      {}", reason);
+  }
+
+  return candidate;
+}
+
+void DeviceSelector::Rate(DeviceCandidate& candidate) const {
+  const PhysicalDeviceInfo& device_info = candidate.device_info;
+  candidate.score = 0;
+  auto add = [&](int value, std::string_view reason) {
+    candidate.score += value;
+    candidate.reasons.push_back(fmt::format("{:+5} {}", value, reason));
+  };
+
+  // Discrete GPUs have a significant performance advantage
+  switch (device_info.properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      add(1000, "discrete GPU");
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      add(500, "integrated GPU");
+      break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      add(250, "virtual GPU");
+      break;
+    default:
+      add(0, "CPU or other device type");
+      break;
+  }
+
+  // integrated GPUs may report big shared heaps, so memory gives less than
+  // device type even when capped
+  constexpr VkDeviceSize kMiB = VkDeviceSize(1) << 20;
+  constexpr VkDeviceSize kMaxRatedMemory = VkDeviceSize(16) << 30;
+  const VkDeviceSize local_memory = device_info.GetDeviceLocalMemorySize();
+  add(static_cast<int>(std::min(local_memory, kMaxRatedMemory) / (40 * kMiB)),
+      fmt::format("{} MiB of device local memory", local_memory / kMiB));
+
+  if (device_info.HasDedicatedTransferFamily()) {
+    add(50, "dedicated transfer queue family");
+  }
+
+  if (device_info.GetGraphicsQueueFamilyIndex() ==
+      device_info.GetPresentQueueFamilyIndex()) {
+    add(25, "graphics queue can present");
+  }
+
+  for (const char* extension : settings_.optional_extensions) {
+    if (device_info.HasExtension(extension)) {
+      add(20, fmt::format("supports {}", extension));
+    }
+  }
+
+  if (device_info.features.samplerAnisotropy) {
+    add(100, "sampler anisotropy");
+  }
+
+  const VkSampleCountFlagBits max_samples =
+      device_info.GetMaxUsableSampleCount();
+  add(20 * SampleCountToLog2(max_samples),
+      fmt::format("MSAA up to {}x", static_cast<ui32>(max_samples)));
+
+  const ui32 api_version = device_info.properties.apiVersion;
+  add(20 * static_cast<int>(VK_VERSION_MINOR(api_version)),
+      fmt::format("Vulkan {}.{}", VK_VERSION_MAJOR(api_version),
+                  VK_VERSION_MINOR(api_version)));
+
+  // capped like memory, together the benchmarks give less than the gap
+  // between device types
+  if (candidate.benchmark.has_value()) {
+    const DeviceBenchmarkResult& benchmark = *candidate.benchmark;
+    constexpr double kMaxRatedCopy = 40.0;   // GB/s
+    constexpr double kMaxRatedClear = 10.0;  // Gpixels/s
+    const double copy = std::min(benchmark.copy_gb_per_second, kMaxRatedCopy);
+    const double clear =
+        std::min(benchmark.clear_gpixels_per_second, kMaxRatedClear);
+    add(static_cast<int>(copy * 5.0),
+        fmt::format("copy {:.1f} GB/s", benchmark.copy_gb_per_second));
+    add(static_cast<int>(clear * 20.0),
+        fmt::format("clear {:.2f} Gpixels/s",
+                    benchmark.clear_gpixels_per_second));
+  }
+}
+
+bool DeviceSelector::MatchesOverride(
+    const PhysicalDeviceInfo& device_info) const {
+  const std::string expected = ToLower(settings_.device_override);
+  if (device_info.has_device_uuid &&
+      ToLower(device_info.GetDeviceUuidString()) == expected) {
+    return true;
+  }
+
+  return ToLower(device_info.properties.deviceName).find(expected) !=
+         std::string::npos;
+}
+
+std::optional<DeviceBenchmarkResult> DeviceSelector::RunBenchmark(
+    const PhysicalDeviceInfo& device_info) noexcept {
+  constexpr VkDeviceSize kCopySize = VkDeviceSize(64) << 20;
+  constexpr ui32 kNumCopies = 8;
+  constexpr ui32 kClearExtent = 2048;
+  constexpr ui32 kNumClears = 8;
+  using Clock = std::chrono::steady_clock;
+  using Vk = VulkanUtility;
+
+  VkDevice device = nullptr;
+  VkCommandPool command_pool = nullptr;
+  VkFence fence = nullptr;
+  VkImage image = nullptr;
+  std::vector<VkBuffer> buffers;
+  std::vector<VkDeviceMemory> memory;
+
+  std::optional<DeviceBenchmarkResult> result;
+  try {
+    const ui32 family = device_info.GetGraphicsQueueFamilyIndex();
+    const float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_create_info{};
+    queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_create_info.queueFamilyIndex = family;
+    queue_create_info.queueCount = 1;
+    queue_create_info.pQueuePriorities = &queue_priority;
+
+    VkDeviceCreateInfo device_create_info{};
+    device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.queueCreateInfoCount = 1;
+    device_create_info.pQueueCreateInfos = &queue_create_info;
+    VkWrap(vkCreateDevice)(device_info.device, &device_create_info, nullptr,
+                           &device);
+
+    VkQueue queue = nullptr;
+    vkGetDeviceQueue(device, family, 0, &queue);
+
+    auto allocate = [&](const VkMemoryRequirements& requirements) {
+      VkMemoryAllocateInfo alloc_info{};
+      alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      alloc_info.allocationSize = requirements.size;
+      alloc_info.memoryTypeIndex = device_info.GetMemoryTypeIndex(
+          requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      VkWrap(vkAllocateMemory)(device, &alloc_info, nullptr,
+                               &memory.emplace_back());
+      return memory.back();
+    };
+
+    for (size_t i = 0; i != 2; ++i) {
+      VkBufferCreateInfo buffer_info{};
+      buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      buffer_info.size = kCopySize;
+      buffer_info.usage =
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+      buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      VkWrap(vkCreateBuffer)(device, &buffer_info, nullptr,
+                             &buffers.emplace_back());
+
+      VkMemoryRequirements requirements;
+      vkGetBufferMemoryRequirements(device, buffers.back(), &requirements);
+      VkWrap(vkBindBufferMemory)(device, buffers.back(), allocate(requirements),
+                                 0u);
+    }
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.extent = {kClearExtent, kClearExtent, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    VkWrap(vkCreateImage)(device, &image_info, nullptr, &image);
+    {
+      VkMemoryRequirements requirements;
+      vkGetImageMemoryRequirements(device, image, &requirements);
+      VkWrap(vkBindImageMemory)(device, image, allocate(requirements), 0u);
+    }
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = family;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VkWrap(vkCreateCommandPool)(device, &pool_info, nullptr, &command_pool);
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkWrap(vkCreateFence)(device, &fence_info, nullptr, &fence);
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+    VkCommandBuffer command_buffer = nullptr;
+    VkWrap(vkAllocateCommandBuffers)(device, &alloc_info, &command_buffer);
+
+    // records commands with `record` and returns seconds spent on GPU
+    // including submission overhead
+    auto measure = [&](auto&& record) {
+      VkCommandBufferBeginInfo begin_info{};
+      begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      VkWrap(vkBeginCommandBuffer)(command_buffer, &begin_info);
+      record(command_buffer);
+      VkWrap(vkEndCommandBuffer)(command_buffer);
+
+      VkSubmitInfo submit_info{};
+      submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submit_info.commandBufferCount = 1;
+      submit_info.pCommandBuffers = &command_buffer;
+
+      const auto start = Clock::now();
+      VkWrap(vkQueueSubmit)(queue, 1u, &submit_info, fence);
+      VkWrap(vkWaitForFences)(device, 1u, &fence, kVkTrue, UINT64_MAX);
+      const auto finish = Clock::now();
+
+      VkWrap(vkResetFences)(device, 1u, &fence);
+      VkWrap(vkResetCommandBuffer)(command_buffer, 0u);
+      return std::chrono::duration<double>(finish - start).count();
+    };
+
+    VkMemoryBarrier transfer_barrier{};
+    transfer_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    transfer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    transfer_barrier.dstAccessMask =
+        VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    auto record_copies = [&](VkCommandBuffer cb) {
+      VkBufferCopy region{};
+      region.size = kCopySize;
+      for (ui32 i = 0; i != kNumCopies; ++i) {
+        vkCmdCopyBuffer(cb, buffers[i % 2], buffers[(i + 1) % 2], 1u, &region);
+        vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                             &transfer_barrier, 0, nullptr, 0, nullptr);
+      }
+    };
+
+    auto record_clears = [&](VkCommandBuffer cb) {
+      VkImageSubresourceRange range{};
+      range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      range.levelCount = 1;
+      range.layerCount = 1;
+
+      VkImageMemoryBarrier layout_barrier{};
+      layout_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      layout_barrier.srcAccessMask = 0;
+      layout_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      layout_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      layout_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      layout_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      layout_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      layout_barrier.image = image;
+      layout_barrier.subresourceRange = range;
+      vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                           nullptr, 1, &layout_barrier);
+
+      for (ui32 i = 0; i != kNumClears; ++i) {
+        const float value =
+            static_cast<float>(i) / static_cast<float>(kNumClears);
+        const VkClearColorValue color{{value, value, value, 1.0f}};
+        vkCmdClearColorImage(cb, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             &color, 1u, &range);
+        vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                             &transfer_barrier, 0, nullptr, 0, nullptr);
+      }
+    };
+
+    // the first run of each benchmark is a warm up
+    measure(record_copies);
+    const double copy_seconds = measure(record_copies);
+    measure(record_clears);
+    const double clear_seconds = measure(record_clears);
+
+    constexpr double copied_bytes =
+        static_cast<double>(kCopySize) * kNumCopies;
+    constexpr double cleared_pixels =
+        static_cast<double>(kClearExtent) * kClearExtent * kNumClears;
+
+    DeviceBenchmarkResult benchmark;
+    benchmark.copy_gb_per_second = copied_bytes / copy_seconds * 1e-9;
+    benchmark.clear_gpixels_per_second = cleared_pixels / clear_seconds * 1e-9;
+    result = benchmark;
+  } catch (const std::exception& e) {
+    spdlog::warn("benchmark failed on {}: {}",
+                 device_info.properties.deviceName, e.what());
+  }
+
+  if (device) {
+    vkDeviceWaitIdle(device);
+  }
+
+  Vk::Destroy<vkDestroyFence>(device, fence);
+  Vk::Destroy<vkDestroyCommandPool>(device, command_pool);
+  Vk::Destroy<vkDestroyImage>(device, image);
+  Vk::Destroy<vkDestroyBuffer>(device, buffers);
+  Vk::FreeMemory(device, memory);
+  Vk::Destroy<vkDestroyDevice>(device);
+
+  return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "device_surface_info.hpp"
+#include "physical_device_info.hpp"
+#include "vulkan/vulkan.h"
+
+struct DeviceSelectionSettings {
+  std::vector<const char*> required_extensions;
+  // give extra score, the device is usable without them
+  std::vector<const char*> optional_extensions;
+  // device name (or its part) or device UUID, picks this device regardless
+  // of its score if it is suitable
+  std::string device_override;
+  // runs a short copy and clear benchmark on each suitable device
+  bool run_benchmark = false;
+  ui32 instance_api_version = VK_API_VERSION_1_0;
+};
+
+struct DeviceBenchmarkResult {
+  double copy_gb_per_second = 0.0;
+  double clear_gpixels_per_second = 0.0;
+};
+
+struct DeviceCandidate {
+  PhysicalDeviceInfo device_info;
+  DeviceSurfaceInfo surface_info;
+  std::optional<DeviceBenchmarkResult> benchmark;
+  std::vector<std::string> reasons;
+  int score = -1;
+};
+
+class DeviceSelector {
+ public:
+  explicit DeviceSelector(DeviceSelectionSettings settings);
+
+  // throws if there is no suitable device
+  [[nodiscard]] DeviceCandidate Select(VkInstance instance,
+                                       VkSurfaceKHR surface) const;
+
+ private:
+  // returns empty optional if device can't be used at all
+  [[nodiscard]] std::optional<DeviceCandidate> Evaluate(
+      VkPhysicalDevice device, VkSurfaceKHR surface) const;
+  void Rate(DeviceCandidate& candidate) const;
+  [[nodiscard]] bool MatchesOverride(
+      const PhysicalDeviceInfo& device_info) const;
+
+  [[nodiscard]] static std::optional<DeviceBenchmarkResult> RunBenchmark(
+      const PhysicalDeviceInfo& device_info) noexcept;
+
+ private:
+  DeviceSelectionSettings settings_;
+};
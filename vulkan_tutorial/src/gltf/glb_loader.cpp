@@ -0,0 +1,453 @@
+#include "gltf/glb_loader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include "fmt/format.h"
+#include "json/json.hpp"
+#include "mapped_file.hpp"
+#include "pipeline/descriptors/vertex_descriptor.hpp"
+#include "scene/scene_geometry.hpp"
+#include "spdlog/spdlog.h"
+
+namespace {
+constexpr ui32 kGlbMagic = 0x46546C67;  // "glTF"
+constexpr ui32 kGlbVersion = 2;
+constexpr ui32 kJsonChunk = 0x4E4F534A;  // "JSON"
+constexpr ui32 kBinChunk = 0x004E4942;   // "BIN\0"
+constexpr ui64 kTrianglesMode = 4;
+
+enum ComponentType : ui32 {
+  kByte = 5120,
+  kUnsignedByte = 5121,
+  kShort = 5122,
+  kUnsignedShort = 5123,
+  kUnsignedInt = 5125,
+  kFloat = 5126
+};
+
+// glTF attribute read into each vertex input location
+constexpr std::array<std::string_view, 3> kAttributeSemantics{
+    "POSITION", "COLOR_0", "TEXCOORD_0"};
+static_assert(kAttributeSemantics.size() ==
+              StructDescriptor<Vertex>::GetInputAttributeDescriptions().size());
+
+struct Accessor {
+  ui64 buffer_view = 0;
+  // offset of the first element inside of the buffer view
+  size_t offset = 0;
+  // starts at the first element
+  std::span<const ui8> data;
+  size_t count = 0;
+  size_t stride = 0;
+  ui32 component_type = 0;
+  ui32 num_components = 0;
+  bool normalized = false;
+};
+
+[[nodiscard]] size_t GetComponentSize(ui32 component_type) {
+  switch (component_type) {
+    case kByte:
+    case kUnsignedByte:
+      return 1;
+    case kShort:
+    case kUnsignedShort:
+      return 2;
+    case kUnsignedInt:
+    case kFloat:
+      return 4;
+    default:
+      throw std::runtime_error(
+          fmt::format("unknown component type {}", component_type));
+  }
+}
+
+[[nodiscard]] ui32 GetNumComponents(std::string_view type) {
+  if (type == "SCALAR") {
+    return 1;
+  }
+  if (type == "VEC2") {
+    return 2;
+  }
+  if (type == "VEC3") {
+    return 3;
+  }
+  if (type == "VEC4") {
+    return 4;
+  }
+  throw std::runtime_error(fmt::format("unsupported accessor type {}", type));
+}
+
+// format of the accessor as a vertex attribute, only float formats are used by
+// vertices so the rest is undefined
+[[nodiscard]] VkFormat GetVertexFormat(const Accessor& accessor) noexcept {
+  if (accessor.component_type != kFloat) {
+    return VK_FORMAT_UNDEFINED;
+  }
+
+  switch (accessor.num_components) {
+    case 1:
+      return VK_FORMAT_R32_SFLOAT;
+    case 2:
+      return VK_FORMAT_R32G32_SFLOAT;
+    case 3:
+      return VK_FORMAT_R32G32B32_SFLOAT;
+    case 4:
+      return VK_FORMAT_R32G32B32A32_SFLOAT;
+    default:
+      return VK_FORMAT_UNDEFINED;
+  }
+}
+
+class GlbFile {
+ public:
+  explicit GlbFile(const std::filesystem::path& path) : file_(path) {
+    const std::span<const ui8> data = file_.GetData();
+    auto read_u32 = [&](size_t offset) {
+      [[unlikely]] if (offset > data.size() ||
+                       sizeof(ui32) > data.size() - offset) {
+        throw std::runtime_error("glb file is truncated");
+      }
+      ui32 value = 0;
+      std::memcpy(&value, data.data() + offset, sizeof(value));
+      return value;
+    };
+
+    [[unlikely]] if (read_u32(0) != kGlbMagic ||
+                     read_u32(4) != kGlbVersion) {
+      throw std::runtime_error("not a glTF 2.0 binary file");
+    }
+    // the header has the length of the whole file
+    [[unlikely]] if (read_u32(8) > data.size()) {
+      throw std::runtime_error("glb file is truncated");
+    }
+
+    // chunks are 4 byte aligned, unknown chunks are skipped
+    constexpr size_t kHeaderSize = 12;
+    for (size_t offset = kHeaderSize; offset < data.size();) {
+      const size_t length = read_u32(offset);
+      const ui32 type = read_u32(offset + 4);
+      // the type was read, so the chunk header is inside of the file
+      const size_t begin = offset + 8;
+      [[unlikely]] if (length > data.size() - begin) {
+        throw std::runtime_error("glb chunk is truncated");
+      }
+
+      const std::span<const ui8> chunk = data.subspan(begin, length);
+      if (type == kJsonChunk && document_.IsNull()) {
+        document_ = ParseJson(std::string_view(
+            reinterpret_cast<const char*>(chunk.data()), chunk.size()));
+      } else if (type == kBinChunk && !bin_) {
+        bin_ = chunk;
+      }
+      offset = begin + length;
+    }
+
+    [[unlikely]] if (document_.IsNull()) {
+      throw std::runtime_error("glb file has no json chunk");
+    }
+  }
+
+  [[nodiscard]] const JsonValue& GetDocument() const noexcept {
+    return document_;
+  }
+
+  [[nodiscard]] Accessor GetAccessor(ui64 index) const {
+    const JsonValue& json = document_["accessors"][index];
+    [[unlikely]] if (json.Find("sparse")) {
+      throw std::runtime_error("sparse accessors are not supported");
+    }
+
+    Accessor accessor;
+    [[unlikely]] if (!json.Find("bufferView")) {
+      throw std::runtime_error("accessors without buffer view are not "
+                               "supported");
+    }
+    accessor.buffer_view = json["bufferView"].AsUnsigned();
+    accessor.offset = json.GetUnsigned("byteOffset", 0);
+    accessor.count = json["count"].AsUnsigned();
+    accessor.component_type =
+        static_cast<ui32>(json["componentType"].AsUnsigned());
+    accessor.num_components = GetNumComponents(json["type"].AsString());
+    if (const JsonValue* normalized = json.Find("normalized")) {
+      accessor.normalized = normalized->AsBool();
+    }
+
+    const size_t element_size =
+        GetComponentSize(accessor.component_type) * accessor.num_components;
+    const std::span<const ui8> view = GetBufferView(accessor.buffer_view);
+    const JsonValue& view_json =
+        document_["bufferViews"][accessor.buffer_view];
+    accessor.stride = view_json.GetUnsigned("byteStride", element_size);
+
+    // Every element has to be inside of the view. Values come from the file,
+    // so the end of the last element is not computed, it could overflow
+    bool inside =
+        accessor.stride >= element_size && accessor.offset <= view.size();
+    if (inside && accessor.count != 0) {
+      const size_t available = view.size() - accessor.offset;
+      // the last element starts count - 1 strides after the first one
+      inside = element_size <= available &&
+               accessor.count - 1 <=
+                   (available - element_size) / accessor.stride;
+    }
+    [[unlikely]] if (!inside) {
+      throw std::runtime_error(
+          fmt::format("accessor {} is out of its buffer view", index));
+    }
+
+    accessor.data = view.subspan(accessor.offset);
+    return accessor;
+  }
+
+ private:
+  [[nodiscard]] std::span<const ui8> GetBufferView(ui64 index) const {
+    const JsonValue& view = document_["bufferViews"][index];
+    const ui64 buffer = view["buffer"].AsUnsigned();
+    const JsonValue& buffer_json = document_["buffers"][buffer];
+    [[unlikely]] if (buffer != 0 || buffer_json.Find("uri") || !bin_) {
+      throw std::runtime_error("only the embedded glb buffer is supported");
+    }
+
+    const size_t offset = view.GetUnsigned("byteOffset", 0);
+    const size_t length = view["byteLength"].AsUnsigned();
+    [[unlikely]] if (offset > bin_->size() || length > bin_->size() - offset) {
+      throw std::runtime_error(
+          fmt::format("buffer view {} is out of the buffer", index));
+    }
+
+    return bin_->subspan(offset, length);
+  }
+
+ private:
+  MappedFile file_;
+  JsonValue document_;
+  std::optional<std::span<const ui8>> bin_;
+};
+
+// converts one element to floats, missing components keep their values
+void ReadElement(const Accessor& accessor, size_t index,
+                 std::span<float> out) {
+  const ui8* element = accessor.data.data() + index * accessor.stride;
+  const size_t num_components =
+      std::min<size_t>(accessor.num_components, out.size());
+  for (size_t c = 0; c != num_components; ++c) {
+    auto read = [&]<typename T>(T) {
+      T value;
+      std::memcpy(&value, element + c * sizeof(T), sizeof(T));
+      return value;
+    };
+
+    float value = 0.0f;
+    switch (accessor.component_type) {
+      case kFloat:
+        value = read(float{});
+        break;
+      case kUnsignedByte:
+        value = static_cast<float>(read(ui8{}));
+        value = accessor.normalized ? value / 255.0f : value;
+        break;
+      case kUnsignedShort:
+        value = static_cast<float>(read(ui16{}));
+        value = accessor.normalized ? value / 65535.0f : value;
+        break;
+      case kByte:
+        value = static_cast<float>(read(i8{}));
+        value = accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+        break;
+      case kShort:
+        value = static_cast<float>(read(i16{}));
+        value =
+            accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        break;
+      case kUnsignedInt:
+        value = static_cast<float>(read(ui32{}));
+        break;
+    }
+    out[c] = value;
+  }
+}
+
+// whether the attributes are one interleaved array with Vertex layout
+[[nodiscard]] bool MatchesVertexLayout(
+    std::span<const std::optional<Accessor>> attributes) {
+  constexpr auto kBindings = StructDescriptor<Vertex>::GetBindingDescription();
+  constexpr auto kInputs =
+      StructDescriptor<Vertex>::GetInputAttributeDescriptions();
+
+  const Accessor* first = attributes[0] ? &*attributes[0] : nullptr;
+  if (!first) {
+    return false;
+  }
+
+  for (size_t i = 0; i != kInputs.size(); ++i) {
+    const VkVertexInputAttributeDescription& input = kInputs[i];
+    const std::optional<Accessor>& accessor = attributes[i];
+    if (!accessor || accessor->buffer_view != first->buffer_view ||
+        accessor->count != first->count ||
+        accessor->stride != kBindings[input.binding].stride ||
+        GetVertexFormat(*accessor) != input.format ||
+        accessor->offset - first->offset + kInputs[0].offset != input.offset) {
+      return false;
+    }
+  }
+
+  // the last vertex has to be complete too, not just its attributes
+  return first->data.size() >= first->count * sizeof(Vertex);
+}
+
+// returns true if vertices were copied without conversion
+bool LoadVertices(std::span<const std::optional<Accessor>> attributes,
+                  std::span<Vertex> vertices) {
+  if (MatchesVertexLayout(attributes)) {
+    std::memcpy(vertices.data(), attributes[0]->data.data(),
+                vertices.size_bytes());
+    return true;
+  }
+
+  for (const std::optional<Accessor>& accessor : attributes) {
+    [[unlikely]] if (accessor && accessor->count < vertices.size()) {
+      throw std::runtime_error("attributes have different vertex counts");
+    }
+  }
+
+  for (size_t i = 0; i != vertices.size(); ++i) {
+    Vertex& vertex = vertices[i];
+    std::array<float, 3> position{};
+    std::array<float, 3> color{1.0f, 1.0f, 1.0f};
+    std::array<float, 2> tex_coord{};
+    if (attributes[0]) {
+      ReadElement(*attributes[0], i, position);
+    }
+    if (attributes[1]) {
+      ReadElement(*attributes[1], i, color);
+    }
+    if (attributes[2]) {
+      ReadElement(*attributes[2], i, tex_coord);
+    }
+    vertex.pos = {position[0], position[1], position[2]};
+    vertex.color = {color[0], color[1], color[2]};
+    vertex.tex_coord = {tex_coord[0], tex_coord[1]};
+  }
+
+  return false;
+}
+
+void LoadIndices(const std::optional<Accessor>& accessor,
+                 std::span<ui32> indices, size_t num_vertices) {
+  if (!accessor) {
+    // not indexed, every three vertices are a triangle
+    for (size_t i = 0; i != indices.size(); ++i) {
+      indices[i] = static_cast<ui32>(i);
+    }
+    return;
+  }
+
+  if (accessor->component_type == kUnsignedInt &&
+      accessor->stride == sizeof(ui32)) {
+    std::memcpy(indices.data(), accessor->data.data(), indices.size_bytes());
+  } else {
+    for (size_t i = 0; i != indices.size(); ++i) {
+      const ui8* element = accessor->data.data() + i * accessor->stride;
+      switch (accessor->component_type) {
+        case kUnsignedByte:
+          indices[i] = *element;
+          break;
+        case kUnsignedShort: {
+          ui16 index = 0;
+          std::memcpy(&index, element, sizeof(index));
+          indices[i] = index;
+        } break;
+        case kUnsignedInt:
+          std::memcpy(&indices[i], element, sizeof(ui32));
+          break;
+        default:
+          throw std::runtime_error("indices have to be unsigned integers");
+      }
+    }
+  }
+
+  // invalid index would make the GPU read outside of the mesh
+  for (const ui32 index : indices) {
+    [[unlikely]] if (index >= num_vertices) {
+      throw std::runtime_error(fmt::format(
+          "index {} is out of {} vertices", index, num_vertices));
+    }
+  }
+}
+}  // namespace
+
+void LoadGlbModel(const std::filesystem::path& path,
+                  SceneGeometry& geometry) {
+  try {
+    const GlbFile file(path);
+    const JsonValue& document = file.GetDocument();
+    const JsonValue* meshes = document.Find("meshes");
+    if (!meshes) {
+      spdlog::warn("{} has no meshes", path.string());
+      return;
+    }
+
+    size_t num_copied = 0;
+    size_t num_converted = 0;
+    for (size_t mesh_index = 0; mesh_index != meshes->AsArray().size();
+         ++mesh_index) {
+      const JsonValue& mesh = (*meshes)[mesh_index];
+      const JsonValue& primitives = mesh["primitives"];
+      for (size_t i = 0; i != primitives.AsArray().size(); ++i) {
+        const JsonValue& primitive = primitives[i];
+        if (primitive.GetUnsigned("mode", kTrianglesMode) != kTrianglesMode) {
+          spdlog::warn("{}: skipped primitive {} of mesh {}, only triangles "
+                       "are supported",
+                       path.string(), i, mesh_index);
+          continue;
+        }
+
+        const JsonValue& attributes_json = primitive["attributes"];
+        std::array<std::optional<Accessor>, kAttributeSemantics.size()>
+            attributes;
+        for (size_t a = 0; a != attributes.size(); ++a) {
+          if (const JsonValue* accessor =
+                  attributes_json.Find(kAttributeSemantics[a])) {
+            attributes[a] = file.GetAccessor(accessor->AsUnsigned());
+          }
+        }
+        [[unlikely]] if (!attributes[0]) {
+          throw std::runtime_error(
+              fmt::format("primitive {} of mesh {} has no positions", i,
+                          mesh_index));
+        }
+
+        std::optional<Accessor> indices;
+        if (const JsonValue* accessor = primitive.Find("indices")) {
+          indices = file.GetAccessor(accessor->AsUnsigned());
+        }
+
+        const size_t num_vertices = attributes[0]->count;
+        const size_t num_indices = indices ? indices->count : num_vertices;
+        const JsonValue* mesh_name = mesh.Find("name");
+        const std::string name =
+            fmt::format("{}/{}/{}", path.stem().string(),
+                        mesh_name ? mesh_name->AsString()
+                                  : std::to_string(mesh_index),
+                        i);
+        const SceneGeometry::MeshStorage storage =
+            geometry.AllocateMesh(name, num_vertices, num_indices);
+        const bool copied = LoadVertices(attributes, storage.vertices);
+        LoadIndices(indices, storage.indices, num_vertices);
+        ++(copied ? num_copied : num_converted);
+      }
+    }
+
+    spdlog::debug("{}: {} primitives copied, {} converted", path.string(),
+                  num_copied, num_converted);
+  } catch (const std::exception& e) {
+    throw std::runtime_error(
+        fmt::format("failed to load {}: {}", path.string(), e.what()));
+  }
+}
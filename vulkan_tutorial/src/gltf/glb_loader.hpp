@@ -0,0 +1,11 @@
+#pragma once
+
+#include <filesystem>
+
+class SceneGeometry;
+
+// Appends triangle primitives of all meshes of a binary glTF 2.0 file to the
+// geometry, a mesh per primitive. Node transforms are not applied. When
+// attributes are interleaved in a buffer view exactly like `Vertex`, the view
+// is copied as is. Other layouts are converted vertex by vertex
+void LoadGlbModel(const std::filesystem::path& path, SceneGeometry& geometry);
@@ -23,7 +23,9 @@ void ImageLoader::MoveFrom(ImageLoader& another) {
   another.Reset();
 }
 
-ImageLoader::ImageLoader(const std::string_view& path) { LoadFromFile(path); }
+ImageLoader::ImageLoader(const std::string_view& path, ui32 channels) {
+  LoadFromFile(path, channels);
+}
 
 ImageLoader::ImageLoader(ImageLoader&& another) { MoveFrom(another); }
 
@@ -35,15 +37,59 @@ ImageLoader& ImageLoader::operator=(ImageLoader&& another) {
 
 ImageLoader::~ImageLoader() { Destroy(); }
 
-void ImageLoader::LoadFromFile(const std::string_view& path) {
+void ImageLoader::LoadFromFile(const std::string_view& path, ui32 channels) {
   Destroy();
-  pixel_data_ =
-      stbi_load(path.data(), &width_, &height_, &channels_, STBI_rgb_alpha);
+  int file_channels = 0;
+  const int desired_channels = static_cast<int>(channels);
+  if (stbi_is_hdr(path.data())) {
+    component_ = PixelComponent::kFloat32;
+    pixel_data_ = reinterpret_cast<unsigned char*>(stbi_loadf(
+        path.data(), &width_, &height_, &file_channels, desired_channels));
+  } else if (stbi_is_16_bit(path.data())) {
+    component_ = PixelComponent::kUnorm16;
+    pixel_data_ = reinterpret_cast<unsigned char*>(stbi_load_16(
+        path.data(), &width_, &height_, &file_channels, desired_channels));
+  } else {
+    component_ = PixelComponent::kUnorm8;
+    pixel_data_ = stbi_load(path.data(), &width_, &height_, &file_channels,
+                            desired_channels);
+  }
 
   [[unlikely]] if (!pixel_data_) {
     throw std::runtime_error(
         fmt::format("Failed to load texture from file {}", path));
   }
+
+  channels_ = channels != 0 ? desired_channels : file_channels;
+}
+
+void ImageLoader::LoadFromMemory(std::span<const ui8> file, ui32 channels) {
+  Destroy();
+  const int size = static_cast<int>(file.size());
+  int file_channels = 0;
+  const int desired_channels = static_cast<int>(channels);
+  if (stbi_is_hdr_from_memory(file.data(), size)) {
+    component_ = PixelComponent::kFloat32;
+    pixel_data_ = reinterpret_cast<unsigned char*>(
+        stbi_loadf_from_memory(file.data(), size, &width_, &height_,
+                               &file_channels, desired_channels));
+  } else if (stbi_is_16_bit_from_memory(file.data(), size)) {
+    component_ = PixelComponent::kUnorm16;
+    pixel_data_ = reinterpret_cast<unsigned char*>(
+        stbi_load_16_from_memory(file.data(), size, &width_, &height_,
+                                 &file_channels, desired_channels));
+  } else {
+    component_ = PixelComponent::kUnorm8;
+    pixel_data_ = stbi_load_from_memory(file.data(), size, &width_, &height_,
+                                        &file_channels, desired_channels);
+  }
+
+  [[unlikely]] if (!pixel_data_) {
+    throw std::runtime_error(fmt::format("Failed to decode texture: {}",
+                                         stbi_failure_reason()));
+  }
+
+  channels_ = channels != 0 ? desired_channels : file_channels;
 }
 
 void ImageLoader::Destroy() {
@@ -58,6 +104,7 @@ void ImageLoader::Reset() {
   width_ = -1;
   height_ = -1;
   channels_ = -1;
+  component_ = PixelComponent::kUnorm8;
 }
 
 ui32 ImageLoader::GetWidth() const noexcept {
@@ -66,9 +113,14 @@ ui32 ImageLoader::GetWidth() const noexcept {
 ui32 ImageLoader::GetHeight() const noexcept {
   return static_cast<ui32>(height_);
 }
-ui32 ImageLoader::GetChannels() const noexcept { return 4; }
+ui32 ImageLoader::GetChannels() const noexcept {
+  return static_cast<ui32>(channels_);
+}
+PixelLayout ImageLoader::GetLayout() const noexcept {
+  return {GetChannels(), component_};
+}
 size_t ImageLoader::GetSize() const noexcept {
-  return GetWidth() * GetHeight() * GetChannels();
+  return size_t{GetWidth()} * GetHeight() * GetPixelSize(GetLayout());
 }
 std::span<const unsigned char> ImageLoader::GetData() const noexcept {
   return std::span(pixel_data_, pixel_data_ + GetSize());
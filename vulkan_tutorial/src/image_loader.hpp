@@ -4,22 +4,29 @@
 #include <string_view>
 
 #include "integer.hpp"
+#include "pixel_layout.hpp"
 
+// Decodes images with the channels and bit depth of the file: 8 and 16 bit
+// images keep their depth, HDR images are decoded to 32 bit floats
 class ImageLoader {
  public:
   ImageLoader() = default;
-  ImageLoader(const std::string_view& path);
+  // zero channels keeps the channels of the file
+  ImageLoader(const std::string_view& path, ui32 channels = 0);
   ImageLoader(ImageLoader&& another);
   ~ImageLoader();
   ImageLoader& operator=(ImageLoader&& another);
 
-  void LoadFromFile(const std::string_view& path);
+  void LoadFromFile(const std::string_view& path, ui32 channels = 0);
+  // decodes an image file that was already read
+  void LoadFromMemory(std::span<const ui8> file, ui32 channels = 0);
   void Destroy();
   void Reset();
 
   [[nodiscard]] ui32 GetWidth() const noexcept;
   [[nodiscard]] ui32 GetHeight() const noexcept;
   [[nodiscard]] ui32 GetChannels() const noexcept;
+  [[nodiscard]] PixelLayout GetLayout() const noexcept;
   [[nodiscard]] size_t GetSize() const noexcept;
   [[nodiscard]] std::span<const unsigned char> GetData() const noexcept;
 
@@ -33,4 +40,5 @@ class ImageLoader {
   int width_ = -1;
   int height_ = -1;
   int channels_ = -1;
-};
\ No newline at end of file
+  PixelComponent component_ = PixelComponent::kUnorm8;
+};
@@ -0,0 +1,68 @@
+#include "image_writer.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdouble-promotion"
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wcast-align"
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wduplicated-branches"
+#endif
+#include "stb/stb_image_write.h"
+#pragma GCC diagnostic pop
+
+std::vector<ui8> EncodePng(ui32 width, ui32 height,
+                           std::span<const ui8> rgba) {
+  constexpr int kChannels = 4;
+  [[unlikely]] if (rgba.size() != size_t{width} * height * kChannels) {
+    throw std::runtime_error(fmt::format(
+        "{} bytes can't be encoded as {}x{} RGBA image", rgba.size(), width,
+        height));
+  }
+
+  std::vector<ui8> encoded;
+  auto append = [](void* context, void* data, int size) {
+    auto& out = *reinterpret_cast<std::vector<ui8>*>(context);
+    const auto bytes = reinterpret_cast<const ui8*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+  };
+
+  const int stride = static_cast<int>(width) * kChannels;
+  [[unlikely]] if (!stbi_write_png_to_func(
+                       append, &encoded, static_cast<int>(width),
+                       static_cast<int>(height), kChannels, rgba.data(),
+                       stride)) {
+    throw std::runtime_error(
+        fmt::format("Failed to encode {}x{} image as PNG", width, height));
+  }
+
+  return encoded;
+}
+
+void WritePng(const std::filesystem::path& path, ui32 width, ui32 height,
+              std::span<const ui8> rgba) {
+  const std::vector<ui8> encoded = EncodePng(width, height, rgba);
+
+  std::ofstream file(path, std::ios::binary);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  file.write(reinterpret_cast<const char*>(encoded.data()),
+             static_cast<std::streamsize>(encoded.size()));
+  [[unlikely]] if (!file) {
+    throw std::runtime_error(
+        fmt::format("failed to write {} bytes to file {}", encoded.size(),
+                    path.string()));
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "integer.hpp"
+
+// encodes tightly packed 8 bit RGBA pixels as PNG
+[[nodiscard]] std::vector<ui8> EncodePng(ui32 width, ui32 height,
+                                         std::span<const ui8> rgba);
+void WritePng(const std::filesystem::path& path, ui32 width, ui32 height,
+              std::span<const ui8> rgba);
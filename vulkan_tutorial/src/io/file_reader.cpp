@@ -0,0 +1,642 @@
+#include "io/file_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+#include "threading/thread_pool.hpp"
+
+#ifdef _WIN32
+#include "read_file.hpp"
+#include "unused_var.hpp"
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <deque>
+#include <thread>
+#endif
+
+class FileReader::Backend {
+ public:
+  virtual ~Backend() = default;
+  virtual void Submit(std::vector<Request> requests) = 0;
+  [[nodiscard]] virtual FileReaderBackend GetType() const noexcept = 0;
+};
+
+namespace {
+[[nodiscard]] size_t AlignUp(size_t value, size_t alignment) noexcept {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+#ifndef _WIN32
+// closes the descriptor when destroyed
+class FileDescriptor {
+ public:
+  FileDescriptor() = default;
+  explicit FileDescriptor(int fd) noexcept : fd_(fd) {}
+  FileDescriptor(FileDescriptor&& another) noexcept
+      : fd_(std::exchange(another.fd_, -1)) {}
+  FileDescriptor& operator=(FileDescriptor&& another) noexcept {
+    std::swap(fd_, another.fd_);
+    return *this;
+  }
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  [[nodiscard]] int Get() const noexcept { return fd_; }
+
+ private:
+  int fd_ = -1;
+};
+
+struct OpenedFile {
+  FileDescriptor fd;
+  size_t size = 0;
+  // bytes read, the size rounded up to the alignment for direct reads
+  size_t read_size = 0;
+};
+
+// Falls back to the page cache when the filesystem rejects O_DIRECT
+[[nodiscard]] OpenedFile OpenFile(const std::filesystem::path& path,
+                                  bool direct) {
+  int flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_DIRECT
+  if (direct) {
+    flags |= O_DIRECT;
+  }
+#endif
+  int fd = open(path.c_str(), flags);
+  if (fd < 0 && direct && errno == EINVAL) {
+    direct = false;
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  [[unlikely]] if (fd < 0) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  OpenedFile file{FileDescriptor(fd)};
+  struct stat info {};
+  [[unlikely]] if (fstat(fd, &info) != 0) {
+    throw std::runtime_error(
+        fmt::format("failed to get size of file {}", path.string()));
+  }
+
+  file.size = static_cast<size_t>(info.st_size);
+  file.read_size = direct ? AlignUp(file.size, kDirectIoAlignment) : file.size;
+  return file;
+}
+
+[[noreturn]] void ThrowReadError(const std::filesystem::path& path,
+                                 int error) {
+  throw std::runtime_error(fmt::format("failed to read file {}: {}",
+                                       path.string(), std::strerror(error)));
+}
+#endif
+
+[[nodiscard]] FileBuffer ReadWholeFile(const std::filesystem::path& path,
+                                       bool direct, size_t chunk_size) {
+#ifdef _WIN32
+  UnusedVar(direct, chunk_size);
+  std::vector<char> contents;
+  ::ReadFile(path, contents);
+  return FileBuffer(contents.begin(), contents.end());
+#else
+  const OpenedFile file = OpenFile(path, direct);
+  FileBuffer data(file.read_size);
+  size_t offset = 0;
+  while (offset < file.read_size) {
+    const size_t size = std::min(chunk_size, file.read_size - offset);
+    const ssize_t result = pread(file.fd.Get(), data.data() + offset, size,
+                                 static_cast<off_t>(offset));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    [[unlikely]] if (result < 0) {
+      ThrowReadError(path, errno);
+    }
+    if (result == 0) {
+      break;
+    }
+    offset += static_cast<size_t>(result);
+  }
+
+  data.resize(std::min(offset, file.size));
+  return data;
+#endif
+}
+
+// one task per file, files are read in parallel by the threads of the pool
+class ThreadPoolBackend final : public FileReader::Backend {
+ public:
+  ThreadPoolBackend(ThreadPool& thread_pool,
+                    const FileReaderSettings& settings)
+      : thread_pool_(&thread_pool), settings_(settings) {}
+
+  ~ThreadPoolBackend() override {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&]() { return num_in_flight_ == 0; });
+  }
+
+  void Submit(std::vector<FileReader::Request> requests) override {
+    {
+      std::lock_guard lock(mutex_);
+      num_in_flight_ += requests.size();
+    }
+
+    for (FileReader::Request& request : requests) {
+      thread_pool_->Post([this, request = std::move(request)]() {
+        FileBuffer data;
+        std::exception_ptr error;
+        try {
+          data = ReadWholeFile(request.path, settings_.direct,
+                               settings_.chunk_size);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        request.on_complete(std::move(data), error);
+
+        std::lock_guard lock(mutex_);
+        if (--num_in_flight_ == 0) {
+          idle_.notify_all();
+        }
+      });
+    }
+  }
+
+  [[nodiscard]] FileReaderBackend GetType() const noexcept override {
+    return FileReaderBackend::ThreadPool;
+  }
+
+ private:
+  ThreadPool* thread_pool_;
+  FileReaderSettings settings_;
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  size_t num_in_flight_ = 0;
+};
+
+#ifdef __linux__
+// io_uring through raw system calls, liburing is not a dependency
+class IoUringBackend final : public FileReader::Backend {
+ public:
+  // throws when the kernel does not support io_uring reads
+  explicit IoUringBackend(const FileReaderSettings& settings);
+  ~IoUringBackend() override;
+
+  void Submit(std::vector<FileReader::Request> requests) override;
+
+  [[nodiscard]] FileReaderBackend GetType() const noexcept override {
+    return FileReaderBackend::IoUring;
+  }
+
+ private:
+  struct PendingFile {
+    FileReader::Request request;
+    OpenedFile file;
+    FileBuffer data;
+    // bytes that are not submitted yet start here
+    size_t next_offset = 0;
+    size_t num_reads = 0;
+    std::exception_ptr error;
+  };
+
+  struct ChunkRead {
+    PendingFile* file = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+  };
+
+  void ThreadLoop();
+  // files that fail to open keep the error and are completed without reads
+  void OpenFiles(std::vector<FileReader::Request> requests);
+  void QueueReads();
+  void QueueChunk(const ChunkRead& chunk);
+  void QueueWakeRead();
+  // submits queued entries and waits for at least one completion
+  void Enter();
+  void ReapCompletions();
+  void OnChunkRead(ui32 slot, i32 result);
+  void CompleteFinishedFiles();
+
+ private:
+  // user data of the eventfd read, chunk reads use their slot
+  static constexpr ui64 kWakeTag = ~ui64{0};
+
+  FileReaderSettings settings_;
+  int ring_fd_ = -1;
+  int wake_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  ui32* sq_tail_ = nullptr;
+  ui32 sq_mask_ = 0;
+  ui32* sq_array_ = nullptr;
+  ui32* cq_head_ = nullptr;
+  ui32* cq_tail_ = nullptr;
+  ui32 cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+  ui32 num_to_submit_ = 0;
+  ui64 wake_value_ = 0;
+  bool wake_armed_ = false;
+
+  // owned by the reader thread
+  std::deque<std::unique_ptr<PendingFile>> files_;
+  std::vector<ChunkRead> chunks_;
+  std::vector<ui32> free_chunks_;
+
+  std::mutex mutex_;
+  std::vector<FileReader::Request> submitted_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+[[nodiscard]] int IoUringSetup(ui32 entries, io_uring_params& params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+[[nodiscard]] int IoUringEnter(int ring_fd, ui32 to_submit, ui32 min_complete,
+                               ui32 flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+[[nodiscard]] bool IsReadSupported(int ring_fd) {
+  constexpr size_t kNumOps = 256;
+  std::vector<ui8> storage(sizeof(io_uring_probe) +
+                           kNumOps * sizeof(io_uring_probe_op));
+  auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+  if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+              kNumOps) < 0) {
+    return false;
+  }
+
+  return probe->last_op >= IORING_OP_READ &&
+         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+template <typename T>
+[[nodiscard]] T* RingPointer(void* ring, ui32 offset) noexcept {
+  return reinterpret_cast<T*>(static_cast<ui8*>(ring) + offset);
+}
+
+IoUringBackend::IoUringBackend(const FileReaderSettings& settings)
+    : settings_(settings) {
+  // one more entry for the wake read
+  io_uring_params params{};
+  ring_fd_ = IoUringSetup(settings_.queue_depth + 1, params);
+  [[unlikely]] if (ring_fd_ < 0) {
+    throw std::runtime_error(
+        fmt::format("io_uring_setup failed: {}", std::strerror(errno)));
+  }
+
+  // the destructor does not run when the constructor throws
+  try {
+    [[unlikely]] if (!IsReadSupported(ring_fd_)) {
+      throw std::runtime_error("io_uring does not support reads");
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(ui32);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    const auto map = [&](size_t size, off_t offset) {
+      void* pointer = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+      [[unlikely]] if (pointer == MAP_FAILED) {
+        throw std::runtime_error(
+            fmt::format("failed to map io_uring: {}", std::strerror(errno)));
+      }
+      return pointer;
+    };
+    sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    [[unlikely]] if (wake_fd_ < 0) {
+      throw std::runtime_error(
+          fmt::format("failed to create eventfd: {}", std::strerror(errno)));
+    }
+  } catch (...) {
+    if (sqes_) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(ring_fd_);
+    throw;
+  }
+
+  sq_tail_ = RingPointer<ui32>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *RingPointer<ui32>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingPointer<ui32>(sq_ring_, params.sq_off.array);
+  cq_head_ = RingPointer<ui32>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingPointer<ui32>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *RingPointer<ui32>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingPointer<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+  chunks_.resize(settings_.queue_depth);
+  for (ui32 slot = settings_.queue_depth; slot != 0; --slot) {
+    free_chunks_.push_back(slot - 1);
+  }
+
+  thread_ = std::thread([this]() { ThreadLoop(); });
+}
+
+IoUringBackend::~IoUringBackend() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  eventfd_write(wake_fd_, 1);
+  thread_.join();
+
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+  close(wake_fd_);
+}
+
+void IoUringBackend::Submit(std::vector<FileReader::Request> requests) {
+  {
+    std::lock_guard lock(mutex_);
+    std::move(requests.begin(), requests.end(),
+              std::back_inserter(submitted_));
+  }
+
+  eventfd_write(wake_fd_, 1);
+}
+
+void IoUringBackend::ThreadLoop() {
+  while (true) {
+    std::vector<FileReader::Request> requests;
+    {
+      std::lock_guard lock(mutex_);
+      requests.swap(submitted_);
+    }
+
+    OpenFiles(std::move(requests));
+    QueueReads();
+    // Files without reads, which failed to open or are empty, and files whose
+    // last reads were reaped complete before the wait, nothing else would
+    // wake the thread for them
+    CompleteFinishedFiles();
+    {
+      std::lock_guard lock(mutex_);
+      // the kernel keeps reading into buffers of files in flight
+      if (stopping_ && submitted_.empty() && files_.empty()) {
+        break;
+      }
+    }
+
+    QueueWakeRead();
+    Enter();
+    ReapCompletions();
+  }
+}
+
+void IoUringBackend::OpenFiles(std::vector<FileReader::Request> requests) {
+  for (FileReader::Request& request : requests) {
+    auto pending = std::make_unique<PendingFile>();
+    pending->request = std::move(request);
+    try {
+      pending->file = OpenFile(pending->request.path, settings_.direct);
+      pending->data.resize(pending->file.read_size);
+    } catch (...) {
+      pending->error = std::current_exception();
+    }
+    files_.push_back(std::move(pending));
+  }
+}
+
+void IoUringBackend::QueueReads() {
+  // files are read in order, chunks of one file are in flight together
+  for (const std::unique_ptr<PendingFile>& pending : files_) {
+    if (pending->error) {
+      continue;
+    }
+
+    while (pending->next_offset < pending->file.read_size &&
+           !free_chunks_.empty()) {
+      const size_t size = std::min<size_t>(
+          settings_.chunk_size, pending->file.read_size - pending->next_offset);
+      QueueChunk({pending.get(), pending->next_offset, size});
+      pending->next_offset += size;
+    }
+
+    if (free_chunks_.empty()) {
+      return;
+    }
+  }
+}
+
+void IoUringBackend::QueueChunk(const ChunkRead& chunk) {
+  const ui32 slot = free_chunks_.back();
+  free_chunks_.pop_back();
+  chunks_[slot] = chunk;
+  ++chunk.file->num_reads;
+
+  std::atomic_ref tail(*sq_tail_);
+  const ui32 index = tail.load(std::memory_order_relaxed) & sq_mask_;
+  io_uring_sqe& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = chunk.file->file.fd.Get();
+  sqe.off = chunk.offset;
+  sqe.addr = reinterpret_cast<ui64>(chunk.file->data.data() + chunk.offset);
+  sqe.len = static_cast<ui32>(chunk.size);
+  sqe.user_data = slot;
+  sq_array_[index] = index;
+  tail.store(tail.load(std::memory_order_relaxed) + 1,
+             std::memory_order_release);
+  ++num_to_submit_;
+}
+
+void IoUringBackend::QueueWakeRead() {
+  if (wake_armed_) {
+    return;
+  }
+
+  std::atomic_ref tail(*sq_tail_);
+  const ui32 index = tail.load(std::memory_order_relaxed) & sq_mask_;
+  io_uring_sqe& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = wake_fd_;
+  sqe.addr = reinterpret_cast<ui64>(&wake_value_);
+  sqe.len = sizeof(wake_value_);
+  sqe.user_data = kWakeTag;
+  sq_array_[index] = index;
+  tail.store(tail.load(std::memory_order_relaxed) + 1,
+             std::memory_order_release);
+  ++num_to_submit_;
+  wake_armed_ = true;
+}
+
+void IoUringBackend::Enter() {
+  while (true) {
+    const int result = IoUringEnter(ring_fd_, num_to_submit_, 1,
+                                    IORING_ENTER_GETEVENTS);
+    if (result >= 0) {
+      num_to_submit_ -= std::min(num_to_submit_, static_cast<ui32>(result));
+      return;
+    }
+
+    // full completion queue, reaping makes room
+    if (errno == EBUSY) {
+      return;
+    }
+
+    [[unlikely]] if (errno != EINTR && errno != EAGAIN) {
+      spdlog::critical("io_uring_enter failed: {}", std::strerror(errno));
+      std::terminate();
+    }
+  }
+}
+
+void IoUringBackend::ReapCompletions() {
+  std::atomic_ref head(*cq_head_);
+  std::atomic_ref tail(*cq_tail_);
+  ui32 current = head.load(std::memory_order_relaxed);
+  const ui32 last = tail.load(std::memory_order_acquire);
+  for (; current != last; ++current) {
+    const io_uring_cqe& cqe = cqes_[current & cq_mask_];
+    if (cqe.user_data == kWakeTag) {
+      wake_armed_ = false;
+    } else {
+      OnChunkRead(static_cast<ui32>(cqe.user_data), cqe.res);
+    }
+  }
+  head.store(current, std::memory_order_release);
+}
+
+void IoUringBackend::OnChunkRead(ui32 slot, i32 result) {
+  const ChunkRead chunk = chunks_[slot];
+  free_chunks_.push_back(slot);
+  PendingFile& pending = *chunk.file;
+  --pending.num_reads;
+
+  if (result == -EINTR || result == -EAGAIN) {
+    QueueChunk(chunk);
+    return;
+  }
+
+  if (result < 0) {
+    if (!pending.error) {
+      pending.error = std::make_exception_ptr(std::runtime_error(
+          fmt::format("failed to read file {}: {}",
+                      pending.request.path.string(), std::strerror(-result))));
+    }
+    return;
+  }
+
+  // short reads happen at the end of file or when interrupted, the rest of
+  // the chunk is read again
+  const size_t read = static_cast<size_t>(result);
+  if (read != 0 && read < chunk.size &&
+      chunk.offset + read < pending.file.size) {
+    QueueChunk({chunk.file, chunk.offset + read, chunk.size - read});
+  }
+}
+
+void IoUringBackend::CompleteFinishedFiles() {
+  std::erase_if(files_, [](const std::unique_ptr<PendingFile>& pending) {
+    const bool all_queued =
+        pending->error || pending->next_offset >= pending->file.read_size;
+    if (!all_queued || pending->num_reads != 0) {
+      return false;
+    }
+
+    pending->file.fd = FileDescriptor();
+    FileBuffer data;
+    if (!pending->error) {
+      pending->data.resize(pending->file.size);
+      data = std::move(pending->data);
+    }
+    pending->request.on_complete(std::move(data), pending->error);
+    return true;
+  });
+}
+#endif
+}  // namespace
+
+std::string_view ToString(FileReaderBackend backend) noexcept {
+  switch (backend) {
+    case FileReaderBackend::IoUring:
+      return "io_uring";
+    case FileReaderBackend::ThreadPool:
+      return "thread pool";
+  }
+
+  return "unknown";
+}
+
+FileReader::FileReader(ThreadPool& thread_pool,
+                       FileReaderSettings settings) {
+  // direct reads have to stay aligned
+  settings.chunk_size = static_cast<ui32>(
+      AlignUp(std::max<size_t>(settings.chunk_size, 1), kDirectIoAlignment));
+  settings.queue_depth = std::max<ui32>(settings.queue_depth, 1);
+
+#ifdef __linux__
+  if (settings.io_uring) {
+    try {
+      backend_ = std::make_unique<IoUringBackend>(settings);
+    } catch (const std::exception& e) {
+      spdlog::warn("files are read on the thread pool: {}", e.what());
+    }
+  }
+#endif
+
+  if (!backend_) {
+    backend_ = std::make_unique<ThreadPoolBackend>(thread_pool, settings);
+  }
+}
+
+FileReader::~FileReader() = default;
+
+void FileReader::Submit(std::vector<Request> requests) {
+  if (!requests.empty()) {
+    backend_->Submit(std::move(requests));
+  }
+}
+
+FileReaderBackend FileReader::GetBackend() const noexcept {
+  return backend_->GetType();
+}
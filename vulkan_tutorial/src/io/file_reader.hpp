@@ -0,0 +1,91 @@
+#pragma once
+
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "integer.hpp"
+
+class ThreadPool;
+
+// O_DIRECT needs buffers, offsets and sizes aligned to the logical block size
+// of the device, a page covers the common ones
+constexpr size_t kDirectIoAlignment = 4096;
+
+template <typename T>
+class DirectIoAllocator {
+ public:
+  using value_type = T;
+
+  DirectIoAllocator() noexcept = default;
+  template <typename U>
+  DirectIoAllocator(const DirectIoAllocator<U>&) noexcept {}
+
+  [[nodiscard]] T* allocate(size_t count) {
+    return static_cast<T*>(::operator new(
+        count * sizeof(T), std::align_val_t{kDirectIoAlignment}));
+  }
+  void deallocate(T* pointer, size_t) noexcept {
+    ::operator delete(pointer, std::align_val_t{kDirectIoAlignment});
+  }
+
+  template <typename U>
+  bool operator==(const DirectIoAllocator<U>&) const noexcept {
+    return true;
+  }
+};
+
+// whole file contents, aligned so direct reads land in it without copies
+using FileBuffer = std::vector<char, DirectIoAllocator<char>>;
+
+enum class FileReaderBackend { IoUring, ThreadPool };
+
+[[nodiscard]] std::string_view ToString(FileReaderBackend backend) noexcept;
+
+struct FileReaderSettings {
+  // the thread pool is used when off or when the kernel lacks io_uring
+  bool io_uring = true;
+  // bypasses the page cache, files on filesystems without O_DIRECT are read
+  // through it
+  bool direct = false;
+  // large files are split into reads of this size that are in flight together
+  ui32 chunk_size = 1 << 20;
+  // reads in flight at once
+  ui32 queue_depth = 64;
+};
+
+// Reads whole files in batches. On Linux the reads of all files of a batch
+// are submitted to io_uring with one system call and completed by a reader
+// thread. Without io_uring every file is read with pread on the thread pool
+class FileReader {
+ public:
+  // data is empty when error is set, must not throw
+  using Completion =
+      std::function<void(FileBuffer data, std::exception_ptr error)>;
+
+  struct Request {
+    std::filesystem::path path;
+    Completion on_complete;
+  };
+
+  FileReader(ThreadPool& thread_pool, FileReaderSettings settings);
+  FileReader(const FileReader&) = delete;
+  FileReader& operator=(const FileReader&) = delete;
+  // waits for submitted reads
+  ~FileReader();
+
+  // Completions run on the reader thread or on the pool in any order, they
+  // should only hand the data over
+  void Submit(std::vector<Request> requests);
+
+  [[nodiscard]] FileReaderBackend GetBackend() const noexcept;
+
+  class Backend;
+
+ private:
+  std::unique_ptr<Backend> backend_;
+};
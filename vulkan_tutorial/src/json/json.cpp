@@ -0,0 +1,365 @@
+#include "json/json.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+namespace {
+// deeper documents are malformed or hostile, recursion must not overflow
+constexpr ui32 kMaxDepth = 256;
+
+class JsonParser {
+ public:
+  explicit JsonParser(std::string_view text) : text_(text) {}
+
+  [[nodiscard]] JsonValue ParseDocument() {
+    JsonValue value = ParseValue(0);
+    SkipSpaces();
+    if (position_ != text_.size()) {
+      Fail("unexpected data after the document");
+    }
+
+    return value;
+  }
+
+ private:
+  [[noreturn]] void Fail(std::string_view message) const {
+    throw std::runtime_error(
+        fmt::format("invalid json at offset {}: {}", position_, message));
+  }
+
+  void SkipSpaces() noexcept {
+    while (position_ < text_.size() &&
+           (text_[position_] == ' ' || text_[position_] == '\t' ||
+            text_[position_] == '\n' || text_[position_] == '\r')) {
+      ++position_;
+    }
+  }
+
+  [[nodiscard]] char Peek() const noexcept {
+    return position_ < text_.size() ? text_[position_] : '\0';
+  }
+
+  void Expect(char c) {
+    if (Peek() != c) {
+      Fail(fmt::format("expected '{}'", c));
+    }
+    ++position_;
+  }
+
+  bool ConsumeWord(std::string_view word) noexcept {
+    if (text_.substr(position_, word.size()) != word) {
+      return false;
+    }
+    position_ += word.size();
+    return true;
+  }
+
+  [[nodiscard]] JsonValue ParseValue(ui32 depth) {
+    if (depth == kMaxDepth) {
+      Fail("document is nested too deep");
+    }
+
+    SkipSpaces();
+    switch (Peek()) {
+      case '{':
+        return ParseObject(depth);
+      case '[':
+        return ParseArray(depth);
+      case '"':
+        return JsonValue(ParseString());
+      case 't':
+      case 'f':
+        if (ConsumeWord("true")) {
+          return JsonValue(true);
+        }
+        if (ConsumeWord("false")) {
+          return JsonValue(false);
+        }
+        break;
+      case 'n':
+        if (ConsumeWord("null")) {
+          return JsonValue();
+        }
+        break;
+      default:
+        return JsonValue(ParseNumber());
+    }
+
+    Fail("unexpected literal");
+  }
+
+  [[nodiscard]] JsonValue ParseObject(ui32 depth) {
+    Expect('{');
+    JsonValue::Object members;
+    SkipSpaces();
+    if (Peek() == '}') {
+      ++position_;
+      return JsonValue(std::move(members));
+    }
+
+    while (true) {
+      SkipSpaces();
+      std::string key = ParseString();
+      SkipSpaces();
+      Expect(':');
+      members.emplace_back(std::move(key), ParseValue(depth + 1));
+      SkipSpaces();
+      if (Peek() == '}') {
+        ++position_;
+        return JsonValue(std::move(members));
+      }
+      Expect(',');
+    }
+  }
+
+  [[nodiscard]] JsonValue ParseArray(ui32 depth) {
+    Expect('[');
+    JsonValue::Array elements;
+    SkipSpaces();
+    if (Peek() == ']') {
+      ++position_;
+      return JsonValue(std::move(elements));
+    }
+
+    while (true) {
+      elements.push_back(ParseValue(depth + 1));
+      SkipSpaces();
+      if (Peek() == ']') {
+        ++position_;
+        return JsonValue(std::move(elements));
+      }
+      Expect(',');
+    }
+  }
+
+  [[nodiscard]] ui32 ParseHex4() {
+    ui32 code = 0;
+    for (int i = 0; i != 4; ++i) {
+      const char c = Peek();
+      ui32 digit = 0;
+      if (c >= '0' && c <= '9') {
+        digit = static_cast<ui32>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        digit = static_cast<ui32>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        digit = static_cast<ui32>(c - 'A' + 10);
+      } else {
+        Fail("invalid unicode escape");
+      }
+      code = code * 16 + digit;
+      ++position_;
+    }
+
+    return code;
+  }
+
+  static void AppendUtf8(ui32 code, std::string& out) {
+    auto byte = [&](ui32 value) { out.push_back(static_cast<char>(value)); };
+    if (code < 0x80) {
+      byte(code);
+    } else if (code < 0x800) {
+      byte(0xC0 | (code >> 6));
+      byte(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      byte(0xE0 | (code >> 12));
+      byte(0x80 | ((code >> 6) & 0x3F));
+      byte(0x80 | (code & 0x3F));
+    } else {
+      byte(0xF0 | (code >> 18));
+      byte(0x80 | ((code >> 12) & 0x3F));
+      byte(0x80 | ((code >> 6) & 0x3F));
+      byte(0x80 | (code & 0x3F));
+    }
+  }
+
+  [[nodiscard]] std::string ParseString() {
+    Expect('"');
+    std::string result;
+    while (true) {
+      if (position_ == text_.size()) {
+        Fail("unterminated string");
+      }
+
+      const char c = text_[position_++];
+      if (c == '"') {
+        return result;
+      }
+      if (c != '\\') {
+        result.push_back(c);
+        continue;
+      }
+
+      if (position_ == text_.size()) {
+        Fail("unterminated string");
+      }
+      const char escaped = text_[position_++];
+      switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+          result.push_back(escaped);
+          break;
+        case 'b':
+          result.push_back('\b');
+          break;
+        case 'f':
+          result.push_back('\f');
+          break;
+        case 'n':
+          result.push_back('\n');
+          break;
+        case 'r':
+          result.push_back('\r');
+          break;
+        case 't':
+          result.push_back('\t');
+          break;
+        case 'u': {
+          ui32 code = ParseHex4();
+          // characters outside of the basic plane are surrogate pairs
+          if (code >= 0xD800 && code < 0xDC00 && ConsumeWord("\\u")) {
+            const ui32 low = ParseHex4();
+            if (low < 0xDC00 || low >= 0xE000) {
+              Fail("invalid surrogate pair");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          if (code >= 0xD800 && code < 0xE000) {
+            Fail("unpaired surrogate");
+          }
+          AppendUtf8(code, result);
+        } break;
+        default:
+          Fail("invalid escape");
+      }
+    }
+  }
+
+  size_t SkipDigits() noexcept {
+    const size_t begin = position_;
+    while (position_ < text_.size() && text_[position_] >= '0' &&
+           text_[position_] <= '9') {
+      ++position_;
+    }
+    return position_ - begin;
+  }
+
+  [[nodiscard]] double ParseNumber() {
+    // strtod alone would take hex, infinity, leading plus and bare dots
+    const size_t begin = position_;
+    ConsumeWord("-");
+    bool valid = ConsumeWord("0") || SkipDigits() != 0;
+    if (valid && ConsumeWord(".")) {
+      valid = SkipDigits() != 0;
+    }
+    if (valid && (Peek() == 'e' || Peek() == 'E')) {
+      ++position_;
+      if (Peek() == '+' || Peek() == '-') {
+        ++position_;
+      }
+      valid = SkipDigits() != 0;
+    }
+    if (!valid) {
+      position_ = begin;
+      Fail("invalid number");
+    }
+
+    // strtod needs a terminated string
+    const std::string token(text_.substr(begin, position_ - begin));
+    const double value = std::strtod(token.c_str(), nullptr);
+    if (!std::isfinite(value)) {
+      position_ = begin;
+      Fail("number is out of range");
+    }
+
+    return value;
+  }
+
+ private:
+  std::string_view text_;
+  size_t position_ = 0;
+};
+
+[[noreturn]] void ThrowTypeError(std::string_view expected) {
+  throw std::runtime_error(fmt::format("json value is not {}", expected));
+}
+}  // namespace
+
+bool JsonValue::AsBool() const {
+  const bool* value = std::get_if<bool>(&value_);
+  [[unlikely]] if (!value) { ThrowTypeError("a boolean"); }
+  return *value;
+}
+
+double JsonValue::AsNumber() const {
+  const double* value = std::get_if<double>(&value_);
+  [[unlikely]] if (!value) { ThrowTypeError("a number"); }
+  return *value;
+}
+
+ui64 JsonValue::AsUnsigned() const {
+  const double value = AsNumber();
+  // 2^53 is the last integer that doubles represent exactly
+  [[unlikely]] if (value < 0.0 || value > 9007199254740992.0 ||
+                   std::trunc(value) < value) {
+    ThrowTypeError("an unsigned integer");
+  }
+  return static_cast<ui64>(value);
+}
+
+const std::string& JsonValue::AsString() const {
+  const std::string* value = std::get_if<std::string>(&value_);
+  [[unlikely]] if (!value) { ThrowTypeError("a string"); }
+  return *value;
+}
+
+const JsonValue::Array& JsonValue::AsArray() const {
+  const Array* value = std::get_if<Array>(&value_);
+  [[unlikely]] if (!value) { ThrowTypeError("an array"); }
+  return *value;
+}
+
+const JsonValue::Object& JsonValue::AsObject() const {
+  const Object* value = std::get_if<Object>(&value_);
+  [[unlikely]] if (!value) { ThrowTypeError("an object"); }
+  return *value;
+}
+
+const JsonValue* JsonValue::Find(std::string_view key) const {
+  for (const auto& [name, value] : AsObject()) {
+    if (name == key) {
+      return &value;
+    }
+  }
+
+  return nullptr;
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const {
+  const JsonValue* value = Find(key);
+  [[unlikely]] if (!value) {
+    throw std::runtime_error(fmt::format("json member {} is missing", key));
+  }
+  return *value;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+  const Array& array = AsArray();
+  [[unlikely]] if (index >= array.size()) {
+    throw std::runtime_error(fmt::format(
+        "json index {} is out of range of {} elements", index, array.size()));
+  }
+  return array[index];
+}
+
+ui64 JsonValue::GetUnsigned(std::string_view key, ui64 fallback) const {
+  const JsonValue* value = Find(key);
+  return value ? value->AsUnsigned() : fallback;
+}
+
+JsonValue ParseJson(std::string_view text) {
+  return JsonParser(text).ParseDocument();
+}
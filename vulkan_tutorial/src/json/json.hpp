@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "integer.hpp"
+
+// Parsed JSON document. Accessors throw when the value has another type, so
+// loaders can read required fields without checking every step
+class JsonValue {
+ public:
+  using Array = std::vector<JsonValue>;
+  // members in document order
+  using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+ public:
+  JsonValue() = default;
+  explicit JsonValue(bool value) : value_(value) {}
+  explicit JsonValue(double value) : value_(value) {}
+  explicit JsonValue(std::string value) : value_(std::move(value)) {}
+  explicit JsonValue(Array value) : value_(std::move(value)) {}
+  explicit JsonValue(Object value) : value_(std::move(value)) {}
+
+  [[nodiscard]] bool IsNull() const noexcept {
+    return std::holds_alternative<std::monostate>(value_);
+  }
+  [[nodiscard]] bool IsNumber() const noexcept {
+    return std::holds_alternative<double>(value_);
+  }
+  [[nodiscard]] bool IsString() const noexcept {
+    return std::holds_alternative<std::string>(value_);
+  }
+  [[nodiscard]] bool IsArray() const noexcept {
+    return std::holds_alternative<Array>(value_);
+  }
+  [[nodiscard]] bool IsObject() const noexcept {
+    return std::holds_alternative<Object>(value_);
+  }
+
+  [[nodiscard]] bool AsBool() const;
+  [[nodiscard]] double AsNumber() const;
+  // throws if the number is negative, fractional or too big
+  [[nodiscard]] ui64 AsUnsigned() const;
+  [[nodiscard]] const std::string& AsString() const;
+  [[nodiscard]] const Array& AsArray() const;
+  [[nodiscard]] const Object& AsObject() const;
+
+  // nullptr when the member is missing
+  [[nodiscard]] const JsonValue* Find(std::string_view key) const;
+  // throws when the member is missing
+  [[nodiscard]] const JsonValue& operator[](std::string_view key) const;
+  [[nodiscard]] const JsonValue& operator[](size_t index) const;
+
+  // value of an optional unsigned member
+  [[nodiscard]] ui64 GetUnsigned(std::string_view key, ui64 fallback) const;
+
+ private:
+  std::variant<std::monostate, bool, double, std::string, Array, Object>
+      value_;
+};
+
+// throws with the offset of the first error
+[[nodiscard]] JsonValue ParseJson(std::string_view text);
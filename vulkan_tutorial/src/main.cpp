@@ -1,21 +1,68 @@
 #include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "application.hpp"
+#include "config/app_config.hpp"
+#include "fmt/format.h"
 #include "spdlog/spdlog.h"
-#include "unused_var.hpp"
 
 int main(int argc, char** argv) {
-  UnusedVar(argc);
-
   try {
     Application app;
-    app.SetExecutableFile(std::filesystem::path(argv[0]));
+    const std::filesystem::path executable_file(argv[0]);
+    app.SetExecutableFile(executable_file);
+
+    // used when present and no other file is specified
+    std::optional<std::filesystem::path> config_file =
+        executable_file.parent_path() / "vulkan_tutorial.ini";
+    if (!std::filesystem::exists(*config_file)) {
+      config_file.reset();
+    }
+
+    std::vector<std::pair<std::string, std::string>> overrides;
+    std::optional<RegressionCheckSettings> regression_check;
+    bool update_references = false;
+    for (int i = 1; i < argc; ++i) {
+      const std::string_view arg = argv[i];
+      if (arg == "--check" && i + 1 < argc) {
+        regression_check.emplace().reference_dir = argv[++i];
+      } else if (arg == "--update-references") {
+        update_references = true;
+      } else if (arg == "--record-trace" && i + 1 < argc) {
+        app.EnableTraceRecording(argv[++i]);
+      } else if (arg == "--replay" && i + 1 < argc) {
+        app.EnableReplay(argv[++i]);
+      } else if (arg == "--config" && i + 1 < argc) {
+        config_file = argv[++i];
+      } else if (arg == "--metrics-port" && i + 1 < argc) {
+        overrides.emplace_back("metrics_port", argv[++i]);
+      } else if (const size_t separator = arg.find('=');
+                 arg.starts_with("--") && separator != arg.npos) {
+        // any config value: --key=value
+        overrides.emplace_back(arg.substr(2, separator - 2),
+                               arg.substr(separator + 1));
+      } else {
+        throw std::runtime_error(fmt::format("unknown argument {}", arg));
+      }
+    }
+
+    app.SetConfigSource(
+        ConfigSource(std::move(config_file), std::move(overrides)));
+
+    if (regression_check) {
+      regression_check->update_references = update_references;
+      app.EnableRegressionCheck(std::move(*regression_check));
+    }
+
     app.Run();
+    return app.GetExitCode();
   } catch (const std::exception& e) {
     spdlog::critical("Unhandled exception: {}\n", e.what());
     return EXIT_FAILURE;
   }
-
-  return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,98 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  [[unlikely]] if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file_, &size);
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0) {
+    // empty files can't be mapped
+    return;
+  }
+
+  mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  const void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)
+                              : nullptr;
+  [[unlikely]] if (!view) {
+    if (mapping_) {
+      CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+    throw std::runtime_error(
+        fmt::format("failed to map file {}", path.string()));
+  }
+
+  data_ = static_cast<const ui8*>(view);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+  }
+  if (file_) {
+    CloseHandle(file_);
+  }
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  const int file = open(path.c_str(), O_RDONLY);
+  [[unlikely]] if (file < 0) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  struct stat info {};
+  if (fstat(file, &info) != 0) {
+    close(file);
+    throw std::runtime_error(
+        fmt::format("failed to get size of file {}", path.string()));
+  }
+
+  size_ = static_cast<size_t>(info.st_size);
+  if (size_ == 0) {
+    // empty files can't be mapped
+    close(file);
+    return;
+  }
+
+  void* view = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+  // the mapping keeps its own reference to the file
+  close(file);
+  [[unlikely]] if (view == MAP_FAILED) {
+    throw std::runtime_error(
+        fmt::format("failed to map file {}", path.string()));
+  }
+
+  data_ = static_cast<const ui8*>(view);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<ui8*>(data_), size_);
+  }
+}
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+
+#include "integer.hpp"
+
+// Read only memory mapping of a whole file. Pages are loaded by the OS on
+// first access, so parsing a file does not copy it into a separate buffer
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  [[nodiscard]] std::span<const ui8> GetData() const noexcept {
+    return {data_, size_};
+  }
+
+ private:
+  const ui8* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
@@ -0,0 +1,107 @@
+#include "model_loader.hpp"
+
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+
+#include "tiny_obj_loader.h"
+
+namespace std {
+template <>
+struct hash<tinyobj::index_t> {
+  size_t operator()(const tinyobj::index_t& index) const noexcept {
+    return (hash<int>()(index.vertex_index) ^
+            hash<int>()(index.texcoord_index) ^
+            hash<int>()(index.normal_index));
+  }
+};
+}  // namespace std
+
+namespace tinyobj {
+bool operator==(const index_t& a, const index_t& b) noexcept {
+  return a.vertex_index == b.vertex_index &&
+         a.texcoord_index == b.texcoord_index &&
+         a.normal_index == b.normal_index;
+}
+}  // namespace tinyobj
+
+namespace {
+// reads the file contents in place, std::ispanstream is C++23
+class MemoryBuffer : public std::streambuf {
+ public:
+  explicit MemoryBuffer(std::span<const char> data) {
+    char* begin = const_cast<char*>(data.data());
+    setg(begin, begin, begin + data.size());
+  }
+};
+
+void AppendTriangles(const tinyobj::attrib_t& attrib,
+                     const std::vector<tinyobj::shape_t>& shapes,
+                     std::vector<Vertex>& vertices,
+                     std::vector<ui32>& indices) {
+  std::unordered_map<tinyobj::index_t, ui32> index_remap;
+  for (const tinyobj::shape_t& shape : shapes) {
+    indices.reserve(indices.size() + shape.mesh.indices.size());
+    for (const tinyobj::index_t& model_index : shape.mesh.indices) {
+      auto map_iterator = index_remap.find(model_index);
+      if (map_iterator == index_remap.end()) {
+        Vertex v{};
+        const size_t vertex_offset =
+            static_cast<size_t>(3 * model_index.vertex_index);
+        v.pos = {attrib.vertices[vertex_offset + 0u],
+                 attrib.vertices[vertex_offset + 1u],
+                 attrib.vertices[vertex_offset + 2u]};
+
+        const size_t texcoord_offset =
+            static_cast<size_t>(2 * model_index.texcoord_index);
+        v.tex_coord = {attrib.texcoords[texcoord_offset + 0u],
+                       1.0f - attrib.texcoords[texcoord_offset + 1u]};
+        v.color = {1.0f, 1.0f, 1.0f};
+        const ui32 index = static_cast<ui32>(vertices.size());
+        vertices.push_back(v);
+
+        auto [it, inserted] = index_remap.insert({model_index, index});
+        map_iterator = it;
+      }
+
+      indices.push_back(map_iterator->second);
+    }
+  }
+}
+}  // namespace
+
+void LoadObjModel(const std::filesystem::path& path,
+                  std::vector<Vertex>& vertices, std::vector<ui32>& indices) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warn, err;
+
+  const auto model_path = path.string();
+
+  [[unlikely]] if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
+                                     model_path.data())) {
+    throw std::runtime_error(warn + err);
+  }
+
+  AppendTriangles(attrib, shapes, vertices, indices);
+}
+
+void ParseObjModel(std::span<const char> file, std::vector<Vertex>& vertices,
+                   std::vector<ui32>& indices) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warn, err;
+
+  MemoryBuffer buffer(file);
+  std::istream stream(&buffer);
+  [[unlikely]] if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
+                                     &stream)) {
+    throw std::runtime_error(warn + err);
+  }
+
+  AppendTriangles(attrib, shapes, vertices, indices);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "integer.hpp"
+#include "pipeline/vertex.hpp"
+
+// Parses wavefront obj file and appends its triangles to the output arrays.
+// Vertices with identical attribute indices are merged
+void LoadObjModel(const std::filesystem::path& path,
+                  std::vector<Vertex>& vertices, std::vector<ui32>& indices);
+// same for a file that was already read, materials are not loaded
+void ParseObjModel(std::span<const char> file, std::vector<Vertex>& vertices,
+                   std::vector<ui32>& indices);
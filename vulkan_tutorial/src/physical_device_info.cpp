@@ -1,14 +1,33 @@
 #include "physical_device_info.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 #include "error_handling.hpp"
+#include "fmt/format.h"
 #include "vulkan_utility.hpp"
 
 void PhysicalDeviceInfo::Populate(VkPhysicalDevice new_device,
-                                  VkSurfaceKHR surface) {
+                                  VkSurfaceKHR surface,
+                                  ui32 instance_api_version) {
   device = new_device;
   vkGetPhysicalDeviceProperties(device, &properties);
+
+  has_device_uuid = false;
+  if (instance_api_version >= VK_API_VERSION_1_1 &&
+      properties.apiVersion >= VK_API_VERSION_1_1) {
+    VkPhysicalDeviceIDProperties id_properties{};
+    id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &id_properties;
+    vkGetPhysicalDeviceProperties2(device, &properties2);
+    std::copy(std::begin(id_properties.deviceUUID),
+              std::end(id_properties.deviceUUID), device_uuid.begin());
+    has_device_uuid = true;
+  }
+
   vkGetPhysicalDeviceMemoryProperties(device, &memory_properties);
   vkGetPhysicalDeviceFeatures(device, &features);
   VulkanUtility::GetQueueFamilies(device, families_properties);
@@ -112,40 +131,76 @@ VkSampleCountFlagBits PhysicalDeviceInfo::GetMaxUsableSampleCount()
 }
 
 void PhysicalDeviceInfo::PopulateIndexCache(VkSurfaceKHR surface) {
-  int i = 0;
-  for (const auto& queueFamily : families_properties) {
-    if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-      graphics_fi_ = i;
+  graphics_fi_ = -1;
+  present_fi_ = -1;
+  transfer_fi_ = -1;
+  compute_fi_ = -1;
+
+  constexpr VkQueueFlags graphics_or_compute =
+      VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+  // Visit every family: the first complete match is not necessarily the best
+  // one, e.g. dedicated transfer families usually come after graphics
+  for (ui32 i = 0; i != families_properties.size(); ++i) {
+    const VkQueueFlags flags = families_properties[i].queueFlags;
+    const int index = static_cast<int>(i);
+    const bool can_present =
+        VulkanUtility::DeviceSupportsPresentation(device, i, surface);
+
+    if (flags & VK_QUEUE_GRAPHICS_BIT) {
+      // prefer graphics family that can present too - no need to share
+      // swap chain images between families then
+      const bool better = graphics_fi_ == -1 ||
+                          (can_present && graphics_fi_ != present_fi_);
+      if (better) {
+        graphics_fi_ = index;
+        if (can_present) {
+          present_fi_ = index;
+        }
+      }
     }
 
-    if (VulkanUtility::DeviceSupportsPresentation(device, static_cast<ui32>(i),
-                                                  surface)) {
-      present_fi_ = i;
+    if (can_present && present_fi_ == -1) {
+      present_fi_ = index;
     }
 
-    if (IsComplete()) {
-      break;
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+        compute_fi_ == -1) {
+      compute_fi_ = index;
     }
 
-    i++;
+    // graphics and compute families implicitly support transfer
+    if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & graphics_or_compute) &&
+        transfer_fi_ == -1) {
+      transfer_fi_ = index;
+    }
   }
 }
 
-[[nodiscard]] int PhysicalDeviceInfo::RateDevice() const noexcept {
-  if (!HasAllRequired()) {
-    return -1;
+VkDeviceSize PhysicalDeviceInfo::GetDeviceLocalMemorySize() const noexcept {
+  VkDeviceSize result = 0;
+  for (ui32 i = 0; i != memory_properties.memoryHeapCount; ++i) {
+    const VkMemoryHeap& heap = memory_properties.memoryHeaps[i];
+    if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      result = std::max(result, heap.size);
+    }
   }
 
-  int score = 0;
+  return result;
+}
 
-  // Discrete GPUs have a significant performance advantage
-  if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-    score += 1000;
+std::string PhysicalDeviceInfo::GetDeviceUuidString() const {
+  if (!has_device_uuid) {
+    return {};
   }
 
-  if (features.samplerAnisotropy) {
-    score += 100;
+  std::string result;
+  for (size_t i = 0; i != device_uuid.size(); ++i) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      result += '-';
+    }
+    result += fmt::format("{:02x}", device_uuid[i]);
   }
 
-  return score;
+  return result;
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <optional>
 #include <span>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
@@ -11,9 +13,15 @@
 
 class PhysicalDeviceInfo {
  public:
-  void Populate(VkPhysicalDevice new_device, VkSurfaceKHR present_surface);
+  // instance_api_version is the version instance was created with, device
+  // UUID is queried only if both instance and device support Vulkan 1.1
+  void Populate(VkPhysicalDevice new_device, VkSurfaceKHR present_surface,
+                ui32 instance_api_version = VK_API_VERSION_1_0);
   [[nodiscard]] bool HasExtension(std::string_view name) const noexcept;
-  [[nodiscard]] int RateDevice() const noexcept;
+  // size of the largest device local heap in bytes
+  [[nodiscard]] VkDeviceSize GetDeviceLocalMemorySize() const noexcept;
+  // formatted as xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx, empty if unknown
+  [[nodiscard]] std::string GetDeviceUuidString() const;
   void PopulateIndexCache(VkSurfaceKHR surface);
 
   [[nodiscard]] bool HasGraphicsFamily() const noexcept {
@@ -22,6 +30,14 @@ class PhysicalDeviceInfo {
   [[nodiscard]] bool HasPresentFamily() const noexcept {
     return present_fi_ != -1;
   }
+  // family that supports transfer but neither graphics nor compute
+  [[nodiscard]] bool HasDedicatedTransferFamily() const noexcept {
+    return transfer_fi_ != -1;
+  }
+  // family that supports compute but not graphics
+  [[nodiscard]] bool HasAsyncComputeFamily() const noexcept {
+    return compute_fi_ != -1;
+  }
   [[nodiscard]] bool HasAllRequired() const noexcept {
     return HasGraphicsFamily() && HasPresentFamily();
   }
@@ -35,6 +51,19 @@ class PhysicalDeviceInfo {
   [[nodiscard]] ui32 GetPresentQueueFamilyIndex() const noexcept {
     return static_cast<ui32>(present_fi_);
   }
+  // falls back to graphics family if there is no dedicated transfer family
+  [[nodiscard]] ui32 GetTransferQueueFamilyIndex() const noexcept {
+    return static_cast<ui32>(HasDedicatedTransferFamily() ? transfer_fi_
+                                                          : graphics_fi_);
+  }
+  // falls back to graphics family if there is no async compute family
+  [[nodiscard]] ui32 GetComputeQueueFamilyIndex() const noexcept {
+    return static_cast<ui32>(HasAsyncComputeFamily() ? compute_fi_
+                                                     : graphics_fi_);
+  }
+  [[nodiscard]] ui32 GetQueueCount(ui32 family_index) const noexcept {
+    return families_properties[family_index].queueCount;
+  }
   [[nodiscard]] std::optional<ui32> FindMemoryTypeIndex(
       ui32 filter, VkMemoryPropertyFlags properties) const noexcept;
   [[nodiscard]] ui32 GetMemoryTypeIndex(ui32 filter,
@@ -59,6 +88,10 @@ class PhysicalDeviceInfo {
   VkPhysicalDeviceProperties properties;
   VkPhysicalDeviceFeatures features;
   VkPhysicalDeviceMemoryProperties memory_properties;
+  std::array<ui8, VK_UUID_SIZE> device_uuid{};
+  bool has_device_uuid = false;
   int graphics_fi_ = -1;
   int present_fi_ = -1;
+  int transfer_fi_ = -1;
+  int compute_fi_ = -1;
 };
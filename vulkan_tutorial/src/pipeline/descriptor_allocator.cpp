@@ -0,0 +1,277 @@
+#include "pipeline/descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "error_handling.hpp"
+#include "fmt/format.h"
+
+namespace {
+// sets in the first pool of a chain, every next pool is twice as large
+constexpr ui32 kFirstPoolSets = 16;
+constexpr ui32 kMaxPoolSets = 1024;
+
+[[nodiscard]] bool IsBufferDescriptor(VkDescriptorType type) noexcept {
+  switch (type) {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+[[nodiscard]] bool IsImageDescriptor(VkDescriptorType type) noexcept {
+  switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <typename Handle>
+[[nodiscard]] ui64 ToKey(Handle handle) noexcept {
+  return reinterpret_cast<ui64>(handle);
+}
+}  // namespace
+
+DescriptorInfo MakeBufferDescriptor(VkBuffer buffer, VkDeviceSize offset,
+                                    VkDeviceSize range) noexcept {
+  DescriptorInfo info{};
+  info.buffer.buffer = buffer;
+  info.buffer.offset = offset;
+  info.buffer.range = range;
+  return info;
+}
+
+DescriptorInfo MakeImageDescriptor(VkSampler sampler, VkImageView view,
+                                   VkImageLayout layout) noexcept {
+  DescriptorInfo info{};
+  info.image.sampler = sampler;
+  info.image.imageView = view;
+  info.image.imageLayout = layout;
+  return info;
+}
+
+DescriptorAllocator::DescriptorAllocator(
+    VkDevice device, std::span<const VkDescriptorSetLayoutBinding> bindings,
+    bool update_templates)
+    : device_(device), bindings_(bindings.begin(), bindings.end()) {
+  std::ranges::sort(bindings_, {}, &VkDescriptorSetLayoutBinding::binding);
+  for (const VkDescriptorSetLayoutBinding& binding : bindings_) {
+    [[unlikely]] if (!IsBufferDescriptor(binding.descriptorType) &&
+                     !IsImageDescriptor(binding.descriptorType)) {
+      throw std::runtime_error(
+          fmt::format("descriptor type {} of binding {} is not supported",
+                      static_cast<int>(binding.descriptorType),
+                      binding.binding));
+    }
+    descriptor_types_.insert(descriptor_types_.end(), binding.descriptorCount,
+                             binding.descriptorType);
+  }
+
+  VkDescriptorSetLayoutCreateInfo layout_info{};
+  layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layout_info.bindingCount = static_cast<ui32>(bindings_.size());
+  layout_info.pBindings = bindings_.data();
+  VkWrap(vkCreateDescriptorSetLayout)(device_, &layout_info, nullptr,
+                                      &layout_);
+
+  if (!update_templates) {
+    return;
+  }
+
+  // resources of a set are one array, every binding reads its part of it
+  std::vector<VkDescriptorUpdateTemplateEntry> entries;
+  size_t first = 0;
+  for (const VkDescriptorSetLayoutBinding& binding : bindings_) {
+    VkDescriptorUpdateTemplateEntry& entry = entries.emplace_back();
+    entry.dstBinding = binding.binding;
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = binding.descriptorCount;
+    entry.descriptorType = binding.descriptorType;
+    entry.offset = first * sizeof(DescriptorInfo);
+    entry.stride = sizeof(DescriptorInfo);
+    first += binding.descriptorCount;
+  }
+
+  VkDescriptorUpdateTemplateCreateInfo template_info{};
+  template_info.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  template_info.descriptorUpdateEntryCount = static_cast<ui32>(entries.size());
+  template_info.pDescriptorUpdateEntries = entries.data();
+  template_info.templateType =
+      VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+  template_info.descriptorSetLayout = layout_;
+  VkWrap(vkCreateDescriptorUpdateTemplate)(device_, &template_info, nullptr,
+                                           &update_template_);
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+  for (VkDescriptorPool pool : persistent_pools_.pools) {
+    vkDestroyDescriptorPool(device_, pool, nullptr);
+  }
+  if (update_template_) {
+    vkDestroyDescriptorUpdateTemplate(device_, update_template_, nullptr);
+  }
+  vkDestroyDescriptorSetLayout(device_, layout_, nullptr);
+}
+
+VkDescriptorSet DescriptorAllocator::GetPersistentSet(
+    std::span<const DescriptorInfo> resources) {
+  CheckResources(resources);
+  std::vector<ui64> key = MakeKey(resources);
+  if (auto it = persistent_sets_.find(key); it != persistent_sets_.end()) {
+    return it->second;
+  }
+
+  VkDescriptorSet set = nullptr;
+  if (!free_sets_.empty()) {
+    set = free_sets_.back();
+    free_sets_.pop_back();
+  } else {
+    set = Allocate(persistent_pools_);
+  }
+  Write(set, resources);
+  persistent_sets_.emplace(std::move(key), set);
+  return set;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(PoolChain& chain) {
+  VkDescriptorSetAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &layout_;
+
+  while (true) {
+    const bool new_pool = chain.current == chain.pools.size();
+    if (new_pool) {
+      const ui32 num_sets = std::min(
+          kFirstPoolSets << std::min<size_t>(chain.pools.size(), 16),
+          kMaxPoolSets);
+      std::vector<VkDescriptorPoolSize> pool_sizes;
+      for (const VkDescriptorSetLayoutBinding& binding : bindings_) {
+        pool_sizes.push_back(
+            {binding.descriptorType, binding.descriptorCount * num_sets});
+      }
+
+      VkDescriptorPoolCreateInfo pool_info{};
+      pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+      pool_info.poolSizeCount = static_cast<ui32>(pool_sizes.size());
+      pool_info.pPoolSizes = pool_sizes.data();
+      pool_info.maxSets = num_sets;
+      VkWrap(vkCreateDescriptorPool)(device_, &pool_info, nullptr,
+                                     &chain.pools.emplace_back());
+    }
+
+    alloc_info.descriptorPool = chain.pools[chain.current];
+    VkDescriptorSet set = nullptr;
+    const VkResult result =
+        vkAllocateDescriptorSets(device_, &alloc_info, &set);
+    if (result == VK_SUCCESS) {
+      return set;
+    }
+
+    // a full pool is skipped, a pool that was just created has to fit one
+    // set
+    [[unlikely]] if (new_pool || (result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+                                  result != VK_ERROR_FRAGMENTED_POOL)) {
+      VkExpect(result, VK_SUCCESS, "vkAllocateDescriptorSets", __FILE__,
+               __LINE__);
+    }
+    ++chain.current;
+  }
+}
+
+void DescriptorAllocator::Write(VkDescriptorSet set,
+                                std::span<const DescriptorInfo> resources) {
+  ++num_writes_;
+  if (update_template_) {
+    vkUpdateDescriptorSetWithTemplate(device_, set, update_template_,
+                                      resources.data());
+    return;
+  }
+
+  // infos of both kinds have the size of DescriptorInfo, so a part of the
+  // resources is an array of either
+  std::vector<VkWriteDescriptorSet> writes;
+  size_t first = 0;
+  for (const VkDescriptorSetLayoutBinding& binding : bindings_) {
+    VkWriteDescriptorSet& write = writes.emplace_back();
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding.binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = binding.descriptorType;
+    write.descriptorCount = binding.descriptorCount;
+    if (IsBufferDescriptor(binding.descriptorType)) {
+      write.pBufferInfo = &resources[first].buffer;
+    } else {
+      write.pImageInfo = &resources[first].image;
+    }
+    first += binding.descriptorCount;
+  }
+  vkUpdateDescriptorSets(device_, static_cast<ui32>(writes.size()),
+                         writes.data(), 0, nullptr);
+}
+
+void DescriptorAllocator::CheckResources(
+    std::span<const DescriptorInfo> resources) const {
+  [[unlikely]] if (resources.size() != descriptor_types_.size()) {
+    throw std::runtime_error(
+        fmt::format("descriptor set takes {} resources, got {}",
+                    descriptor_types_.size(), resources.size()));
+  }
+}
+
+std::vector<ui64> DescriptorAllocator::MakeKey(
+    std::span<const DescriptorInfo> resources) const {
+  // three values per descriptor, the handles come first
+  std::vector<ui64> key;
+  key.reserve(resources.size() * kKeyStride);
+  for (size_t i = 0; i != resources.size(); ++i) {
+    if (IsBufferDescriptor(descriptor_types_[i])) {
+      const VkDescriptorBufferInfo& info = resources[i].buffer;
+      key.insert(key.end(), {ToKey(info.buffer), info.offset, info.range});
+    } else {
+      const VkDescriptorImageInfo& info = resources[i].image;
+      key.insert(key.end(), {ToKey(info.sampler), ToKey(info.imageView),
+                             static_cast<ui64>(info.imageLayout)});
+    }
+  }
+  return key;
+}
+
+void DescriptorAllocator::ReleaseSetsUsingHandle(ui64 handle) {
+  std::erase_if(persistent_sets_, [&](const auto& entry) {
+    const std::vector<ui64>& key = entry.first;
+    bool uses = false;
+    for (size_t i = 0; i != descriptor_types_.size() && !uses; ++i) {
+      const size_t num_handles =
+          IsBufferDescriptor(descriptor_types_[i]) ? 1 : 2;
+      for (size_t j = 0; j != num_handles; ++j) {
+        uses = uses || key[i * kKeyStride + j] == handle;
+      }
+    }
+    if (uses) {
+      free_sets_.push_back(entry.second);
+    }
+    return uses;
+  });
+}
+
+size_t DescriptorAllocator::KeyHash::operator()(
+    const std::vector<ui64>& key) const noexcept {
+  ui64 hash = key.size();
+  for (const ui64 value : key) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+  return static_cast<size_t>(hash);
+}
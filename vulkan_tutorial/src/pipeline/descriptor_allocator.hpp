@@ -0,0 +1,97 @@
+#pragma once
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "integer.hpp"
+#include "vulkan/vulkan.h"
+
+// One descriptor of a set. Update templates read an array of them, so both
+// kinds of info have the same size
+union DescriptorInfo {
+  VkDescriptorBufferInfo buffer;
+  VkDescriptorImageInfo image;
+};
+static_assert(sizeof(VkDescriptorBufferInfo) == sizeof(DescriptorInfo) &&
+              sizeof(VkDescriptorImageInfo) == sizeof(DescriptorInfo));
+
+[[nodiscard]] DescriptorInfo MakeBufferDescriptor(VkBuffer buffer,
+                                                  VkDeviceSize offset,
+                                                  VkDeviceSize range) noexcept;
+[[nodiscard]] DescriptorInfo MakeImageDescriptor(
+    VkSampler sampler, VkImageView view, VkImageLayout layout) noexcept;
+
+// Owns a descriptor set layout and every set allocated for it. Sets come from
+// pools that grow when they run out, a pool never has to fit all sets.
+// Persistent sets are cached by the resources they bind, so asking for the
+// same resources again returns the same set without writing it. Sets are
+// written with an update template when the device has them.
+// Resources of a set are given in the order of binding numbers, one
+// DescriptorInfo per descriptor; buffer and image descriptors are supported
+class DescriptorAllocator {
+ public:
+  // update templates need Vulkan 1.1, sets are written with
+  // vkUpdateDescriptorSets without them
+  DescriptorAllocator(VkDevice device,
+                      std::span<const VkDescriptorSetLayoutBinding> bindings,
+                      bool update_templates);
+  DescriptorAllocator(const DescriptorAllocator&) = delete;
+  DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+  ~DescriptorAllocator();
+
+  [[nodiscard]] VkDescriptorSetLayout GetLayout() const noexcept {
+    return layout_;
+  }
+
+  // returns the cached set of these resources or writes a new one
+  [[nodiscard]] VkDescriptorSet GetPersistentSet(
+      std::span<const DescriptorInfo> resources);
+  // command buffers that bind a set become invalid when it is written
+  [[nodiscard]] ui64 GetNumWrites() const noexcept { return num_writes_; }
+
+  // Sets that bind the buffer, image view or sampler are reused for other
+  // resources. Call before the handle is destroyed, when no submitted
+  // command buffer uses these sets
+  template <typename Handle>
+  void ReleaseSetsUsing(Handle handle) {
+    ReleaseSetsUsingHandle(reinterpret_cast<ui64>(handle));
+  }
+
+ private:
+  // allocation moves to the next pool when the current one is full and adds
+  // a larger one after the last
+  struct PoolChain {
+    std::vector<VkDescriptorPool> pools;
+    size_t current = 0;
+  };
+
+  // values in the key of a persistent set per descriptor
+  static constexpr size_t kKeyStride = 3;
+
+  struct KeyHash {
+    size_t operator()(const std::vector<ui64>& key) const noexcept;
+  };
+
+  [[nodiscard]] VkDescriptorSet Allocate(PoolChain& chain);
+  void Write(VkDescriptorSet set, std::span<const DescriptorInfo> resources);
+  void CheckResources(std::span<const DescriptorInfo> resources) const;
+  [[nodiscard]] std::vector<ui64> MakeKey(
+      std::span<const DescriptorInfo> resources) const;
+  void ReleaseSetsUsingHandle(ui64 handle);
+
+ private:
+  VkDevice device_ = nullptr;
+  VkDescriptorSetLayout layout_ = nullptr;
+  VkDescriptorUpdateTemplate update_template_ = nullptr;
+  // sorted by binding number
+  std::vector<VkDescriptorSetLayoutBinding> bindings_;
+  // type of every descriptor of a set
+  std::vector<VkDescriptorType> descriptor_types_;
+  PoolChain persistent_pools_;
+  std::unordered_map<std::vector<ui64>, VkDescriptorSet, KeyHash>
+      persistent_sets_;
+  // released persistent sets, written again for the next resources
+  std::vector<VkDescriptorSet> free_sets_;
+  ui64 num_writes_ = 0;
+};
@@ -2,6 +2,7 @@
 
 #include <array>
 
+#include "integer.hpp"
 #include "pipeline/vertex.hpp"
 #include "struct_descriptor.hpp"
 #include "vulkan/vulkan.h"
@@ -41,3 +42,49 @@ struct StructDescriptor<Vertex> {
     return std::array{d0, d1, d2};
   }
 };
+
+// positions in binding 0 and the other attributes in binding 1 at the same
+// locations as in `Vertex`, so the same shaders read both layouts
+template <>
+struct StructDescriptor<VertexStreams> {
+  static constexpr ui32 kPositionBinding = 0;
+  static constexpr ui32 kAttributeBinding = 1;
+
+  [[nodiscard]] static constexpr std::array<VkVertexInputBindingDescription, 2>
+  GetBindingDescription() noexcept {
+    VkVertexInputBindingDescription positions{};
+    positions.binding = kPositionBinding;
+    positions.stride = sizeof(glm::vec3);
+    positions.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputBindingDescription attributes{};
+    attributes.binding = kAttributeBinding;
+    attributes.stride = sizeof(VertexAttributes);
+    attributes.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return std::array{positions, attributes};
+  }
+
+  [[nodiscard]] static constexpr std::array<VkVertexInputAttributeDescription,
+                                            3>
+  GetInputAttributeDescriptions() noexcept {
+    VkVertexInputAttributeDescription d0{};
+    d0.binding = kPositionBinding;
+    d0.location = 0;
+    d0.format = VK_FORMAT_R32G32B32_SFLOAT;
+    d0.offset = 0;
+
+    VkVertexInputAttributeDescription d1{};
+    d1.binding = kAttributeBinding;
+    d1.location = 1;
+    d1.format = VK_FORMAT_R32G32B32_SFLOAT;
+    d1.offset = offsetof(VertexAttributes, color);
+
+    VkVertexInputAttributeDescription d2{};
+    d2.binding = kAttributeBinding;
+    d2.location = 2;
+    d2.format = VK_FORMAT_R32G32_SFLOAT;
+    d2.offset = offsetof(VertexAttributes, tex_coord);
+
+    return std::array{d0, d1, d2};
+  }
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+
+#include "integer.hpp"
+#include "pipeline/descriptors/struct_descriptor.hpp"
+#include "vulkan/vulkan.h"
+
+// Types used by the reflection headers that the build generates from compiled
+// shaders, and compile time helpers that turn them into pipeline state
+
+struct ShaderStage {
+  VkShaderStageFlagBits stage;
+  // file name in the shaders directory
+  const char* file;
+  const char* entry_point;
+};
+
+struct ShaderDescriptorBinding {
+  ui32 set = 0;
+  VkDescriptorSetLayoutBinding layout{};
+  // bytes of uniform and storage blocks read by shaders, zero otherwise
+  ui32 block_size = 0;
+};
+
+struct ShaderVertexInput {
+  ui32 location = 0;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+template <size_t N>
+[[nodiscard]] constexpr bool UsesSingleDescriptorSet(
+    const std::array<ShaderDescriptorBinding, N>& bindings) noexcept {
+  for (const ShaderDescriptorBinding& binding : bindings) {
+    if (binding.set != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// true when the shaders declare the binding with this descriptor type
+template <size_t N>
+[[nodiscard]] constexpr bool HasDescriptorBinding(
+    const std::array<ShaderDescriptorBinding, N>& bindings, ui32 set,
+    ui32 binding, VkDescriptorType type) noexcept {
+  for (const ShaderDescriptorBinding& candidate : bindings) {
+    if (candidate.set == set && candidate.layout.binding == binding) {
+      return candidate.layout.descriptorType == type;
+    }
+  }
+  return false;
+}
+
+// zero when there is no block at the binding
+template <size_t N>
+[[nodiscard]] constexpr ui32 GetDescriptorBlockSize(
+    const std::array<ShaderDescriptorBinding, N>& bindings, ui32 set,
+    ui32 binding) noexcept {
+  for (const ShaderDescriptorBinding& candidate : bindings) {
+    if (candidate.set == set && candidate.layout.binding == binding) {
+      return candidate.block_size;
+    }
+  }
+  return 0;
+}
+
+template <size_t N>
+[[nodiscard]] constexpr std::array<VkDescriptorSetLayoutBinding, N>
+GetDescriptorSetLayoutBindings(
+    const std::array<ShaderDescriptorBinding, N>& bindings) noexcept {
+  std::array<VkDescriptorSetLayoutBinding, N> layout_bindings{};
+  for (size_t i = 0; i != N; ++i) {
+    layout_bindings[i] = bindings[i].layout;
+  }
+  return layout_bindings;
+}
+
+// true when the struct descriptor of T has an attribute with the same
+// location and format for every input of the vertex shader
+template <typename T, size_t N>
+[[nodiscard]] constexpr bool MatchesVertexInputs(
+    const std::array<ShaderVertexInput, N>& inputs) noexcept {
+  constexpr auto attributes =
+      StructDescriptor<T>::GetInputAttributeDescriptions();
+  for (const ShaderVertexInput& input : inputs) {
+    bool found = false;
+    for (const VkVertexInputAttributeDescription& attribute : attributes) {
+      found = found || (attribute.location == input.location &&
+                        attribute.format == input.format);
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Attributes of T that the vertex shader reads, check MatchesVertexInputs
+// first. Attributes the shader does not declare are left out, so one vertex
+// struct serves several programs
+template <typename T, size_t N>
+[[nodiscard]] constexpr std::array<VkVertexInputAttributeDescription, N>
+GetVertexAttributes(const std::array<ShaderVertexInput, N>& inputs) noexcept {
+  constexpr auto attributes =
+      StructDescriptor<T>::GetInputAttributeDescriptions();
+  std::array<VkVertexInputAttributeDescription, N> result{};
+  for (size_t i = 0; i != N; ++i) {
+    for (const VkVertexInputAttributeDescription& attribute : attributes) {
+      if (attribute.location == inputs[i].location) {
+        result[i] = attribute;
+      }
+    }
+  }
+  return result;
+}
+
+// true when every input of the vertex shader comes from the binding, such a
+// program is drawn with only that vertex buffer bound
+template <typename T, size_t N>
+[[nodiscard]] constexpr bool ReadsOnlyVertexBinding(
+    const std::array<ShaderVertexInput, N>& inputs, ui32 binding) noexcept {
+  for (const VkVertexInputAttributeDescription& attribute :
+       GetVertexAttributes<T>(inputs)) {
+    if (attribute.binding != binding) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,34 @@
+#include "pipeline/uniform_buffer_object.hpp"
+
+#include <cmath>
+
+#include "include_glm.hpp"
+
+include_glm_begin;
+#include "glm/gtc/matrix_transform.hpp"
+include_glm_end;
+
+CameraPose GetOrbitCamera(float time) {
+  const float distance = 1.0f + std::abs(std::sin(time));
+  CameraPose camera;
+  camera.eye = glm::vec3(distance, distance, distance);
+  camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
+  return camera;
+}
+
+UniformBufferObject MakeUniformBufferObject(float time,
+                                            const CameraPose& camera,
+                                            float aspect_ratio) {
+  UniformBufferObject ubo{};
+  ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
+                          glm::vec3(0.0f, 0.0f, 1.0f));
+  ubo.view =
+      glm::lookAt(camera.eye, camera.target, glm::vec3(0.0f, 0.0f, 1.0f));
+  ubo.proj = glm::perspective(glm::radians(45.0f), aspect_ratio, 0.1f, 10.0f);
+  ubo.proj[1][1] *= -1;
+  return ubo;
+}
+
+UniformBufferObject MakeUniformBufferObject(float time, float aspect_ratio) {
+  return MakeUniformBufferObject(time, GetOrbitCamera(time), aspect_ratio);
+}
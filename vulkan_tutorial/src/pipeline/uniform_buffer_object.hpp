@@ -6,4 +6,18 @@ struct UniformBufferObject {
   alignas(16) glm::mat4 model;
   alignas(16) glm::mat4 view;
   alignas(16) glm::mat4 proj;
-};
\ No newline at end of file
+};
+
+struct CameraPose {
+  glm::vec3 eye{};
+  glm::vec3 target{};
+};
+
+// camera that moves towards and away from the model
+[[nodiscard]] CameraPose GetOrbitCamera(float time);
+
+// matrices of the spinning model at `time` seconds of the animation
+[[nodiscard]] UniformBufferObject MakeUniformBufferObject(
+    float time, const CameraPose& camera, float aspect_ratio);
+[[nodiscard]] UniformBufferObject MakeUniformBufferObject(float time,
+                                                          float aspect_ratio);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "include_glm.hpp"
 include_glm_begin;
 #include "glm/mat4x4.hpp"
@@ -11,3 +13,16 @@ struct Vertex {
   glm::vec3 color;
   glm::vec2 tex_coord;
 };
+
+// Vertices split into two streams: tightly packed positions and the other
+// attributes. Passes that only need positions bind the first stream and
+// fetch 12 bytes per vertex instead of 32
+struct VertexAttributes {
+  glm::vec3 color;
+  glm::vec2 tex_coord;
+};
+
+struct VertexStreams {
+  std::vector<glm::vec3> positions;
+  std::vector<VertexAttributes> attributes;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+#include "integer.hpp"
+
+enum class PixelComponent : ui8 { kUnorm8, kUnorm16, kFloat16, kFloat32 };
+
+// Tightly packed pixels. One channel is gray, two channels are gray and alpha
+struct PixelLayout {
+  ui32 channels = 4;
+  PixelComponent component = PixelComponent::kUnorm8;
+
+  [[nodiscard]] bool operator==(const PixelLayout&) const = default;
+};
+
+[[nodiscard]] constexpr size_t GetComponentSize(
+    PixelComponent component) noexcept {
+  switch (component) {
+    case PixelComponent::kUnorm8:
+      return 1;
+    case PixelComponent::kUnorm16:
+    case PixelComponent::kFloat16:
+      return 2;
+    case PixelComponent::kFloat32:
+      return 4;
+  }
+  return 0;
+}
+
+[[nodiscard]] constexpr size_t GetPixelSize(PixelLayout layout) noexcept {
+  return layout.channels * GetComponentSize(layout.component);
+}
@@ -0,0 +1,15 @@
+#include "process_id.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+ui64 GetCurrentPid() noexcept {
+#ifdef _WIN32
+  return ::GetCurrentProcessId();
+#else
+  return static_cast<ui64>(getpid());
+#endif
+}
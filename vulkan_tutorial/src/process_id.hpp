@@ -0,0 +1,7 @@
+#pragma once
+
+#include "integer.hpp"
+
+// id of the current process, tells apart files and records of processes
+// that run at the same time
+[[nodiscard]] ui64 GetCurrentPid() noexcept;
@@ -0,0 +1,159 @@
+#include "profiling/frame_stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "spdlog/spdlog.h"
+
+namespace {
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+// number of stutters kept for queries
+constexpr size_t kMaxStutters = 64;
+
+// metrics which may be blamed for a stutter
+constexpr std::array kStutterCauses{FrameMetric::Cpu, FrameMetric::Gpu,
+                                    FrameMetric::Acquire,
+                                    FrameMetric::Present};
+}  // namespace
+
+std::string_view ToString(FrameMetric metric) noexcept {
+  switch (metric) {
+    case FrameMetric::Frame:
+      return "frame";
+    case FrameMetric::Cpu:
+      return "cpu";
+    case FrameMetric::Gpu:
+      return "gpu";
+    case FrameMetric::Acquire:
+      return "acquire";
+    case FrameMetric::Present:
+      return "present";
+    case FrameMetric::Count:
+      break;
+  }
+
+  return "unknown";
+}
+
+FrameStats::FrameStats(FrameStatsSettings settings)
+    : settings_(settings),
+      windows_(kNumFrameMetrics, RollingWindow(settings.window_size)),
+      last_log_time_(Clock::now()) {}
+
+void FrameStats::BeginFrame() {
+  current_.fill(0.0);
+  current_[static_cast<size_t>(FrameMetric::Gpu)] =
+      std::numeric_limits<double>::quiet_NaN();
+  frame_start_ = Clock::now();
+}
+
+void FrameStats::AddDuration(FrameMetric metric,
+                             std::chrono::nanoseconds duration) {
+  assert(metric != FrameMetric::Gpu && metric != FrameMetric::Count);
+  current_[static_cast<size_t>(metric)] += Milliseconds(duration).count();
+}
+
+void FrameStats::AddGpuTime(std::chrono::nanoseconds duration) {
+  const double gpu_ms = Milliseconds(duration).count();
+  current_[static_cast<size_t>(FrameMetric::Gpu)] = gpu_ms;
+  GetWindow(FrameMetric::Gpu).Push(gpu_ms);
+}
+
+void FrameStats::EndFrame() {
+  const Clock::time_point now = Clock::now();
+  const double frame_ms = Milliseconds(now - frame_start_).count();
+  auto get = [&](FrameMetric metric) -> double& {
+    return current_[static_cast<size_t>(metric)];
+  };
+  get(FrameMetric::Frame) = frame_ms;
+  get(FrameMetric::Cpu) = std::max(
+      frame_ms - get(FrameMetric::Acquire) - get(FrameMetric::Present), 0.0);
+
+  // median is taken before the frame is added so the stutter can't hide it
+  DetectStutter(frame_ms);
+
+  for (FrameMetric metric : {FrameMetric::Frame, FrameMetric::Cpu,
+                             FrameMetric::Acquire, FrameMetric::Present}) {
+    GetWindow(metric).Push(get(metric));
+  }
+  ++num_frames_;
+
+  if (settings_.log_interval.count() != 0 &&
+      now - last_log_time_ >= settings_.log_interval) {
+    last_log_time_ = now;
+    LogSummary();
+  }
+}
+
+void FrameStats::DetectStutter(double frame_ms) {
+  const RollingWindow& frames = GetWindow(FrameMetric::Frame);
+  if (frames.GetSize() < settings_.min_frames) {
+    return;
+  }
+
+  const double median_ms = frames.GetMedian();
+  if (frame_ms <= median_ms * settings_.stutter_threshold) {
+    return;
+  }
+
+  FrameStutter stutter;
+  stutter.frame_index = num_frames_;
+  stutter.frame_ms = frame_ms;
+  stutter.median_ms = median_ms;
+  double max_excess = -1.0;
+  for (FrameMetric metric : kStutterCauses) {
+    // gpu time of this frame is not known yet, the latest one is used
+    const double value = metric == FrameMetric::Gpu
+                             ? GetWindow(metric).GetLast()
+                             : current_[static_cast<size_t>(metric)];
+    const double excess = value - GetWindow(metric).GetMedian();
+    if (excess > max_excess) {
+      max_excess = excess;
+      stutter.cause = metric;
+    }
+  }
+
+  ++num_stutters_;
+  if (stutters_.size() == kMaxStutters) {
+    stutters_.pop_front();
+  }
+  stutters_.push_back(stutter);
+
+  spdlog::warn("stutter in frame {}: {:.2f} ms, median {:.2f} ms, caused by {}",
+               stutter.frame_index, stutter.frame_ms, stutter.median_ms,
+               ToString(stutter.cause));
+}
+
+FrameStatsSummary FrameStats::GetSummary() const {
+  FrameStatsSummary summary;
+  for (size_t i = 0; i != kNumFrameMetrics; ++i) {
+    summary.metrics[i] = windows_[i].Summarize();
+  }
+  summary.num_frames = num_frames_;
+  summary.num_stutters = num_stutters_;
+  return summary;
+}
+
+FrameMetricSummary FrameStats::GetSummary(FrameMetric metric) const {
+  return GetWindow(metric).Summarize();
+}
+
+void FrameStats::LogSummary() const {
+  const FrameStatsSummary summary = GetSummary();
+  spdlog::info("frame stats over {} frames, {} stutters in total",
+               summary[FrameMetric::Frame].num_samples, summary.num_stutters);
+  for (size_t i = 0; i != kNumFrameMetrics; ++i) {
+    const FrameMetricSummary& metric = summary.metrics[i];
+    if (metric.num_samples == 0) {
+      continue;
+    }
+
+    spdlog::info(
+        "  {:<8} p50 {:7.2f} ms, p95 {:7.2f} ms, p99 {:7.2f} ms, "
+        "max {:7.2f} ms",
+        ToString(static_cast<FrameMetric>(i)), metric.p50, metric.p95,
+        metric.p99, metric.max);
+  }
+}
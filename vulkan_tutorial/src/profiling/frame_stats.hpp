@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+#include "integer.hpp"
+#include "profiling/rolling_window.hpp"
+
+enum class FrameMetric : ui8 {
+  // whole frame on CPU side, from the beginning to the end of the frame
+  Frame,
+  // frame minus acquire and present
+  Cpu,
+  // measured with timestamp queries, arrives a few frames late
+  Gpu,
+  Acquire,
+  Present,
+  Count
+};
+
+inline constexpr size_t kNumFrameMetrics =
+    static_cast<size_t>(FrameMetric::Count);
+
+[[nodiscard]] std::string_view ToString(FrameMetric metric) noexcept;
+
+struct FrameStatsSettings {
+  // statistics are computed over this many recent frames
+  size_t window_size = 512;
+  // frame longer than median multiplied by this is a stutter
+  double stutter_threshold = 2.0;
+  // stutters are not detected until the window has this many frames
+  size_t min_frames = 30;
+  // zero disables periodic logging of the summary
+  std::chrono::nanoseconds log_interval = std::chrono::seconds(5);
+};
+
+// all values are in milliseconds
+using FrameMetricSummary = PercentileSummary;
+
+struct FrameStatsSummary {
+  std::array<FrameMetricSummary, kNumFrameMetrics> metrics{};
+  ui64 num_frames = 0;
+  ui64 num_stutters = 0;
+
+  [[nodiscard]] const FrameMetricSummary& operator[](
+      FrameMetric metric) const noexcept {
+    return metrics[static_cast<size_t>(metric)];
+  }
+};
+
+struct FrameStutter {
+  ui64 frame_index = 0;
+  double frame_ms = 0.0;
+  double median_ms = 0.0;
+  // metric which exceeded its own median the most
+  FrameMetric cause = FrameMetric::Cpu;
+};
+
+// Collects frame timings in a rolling window. Frames are bracketed with
+// BeginFrame and EndFrame, durations of the frame parts are added in
+// between
+class FrameStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FrameStats(FrameStatsSettings settings = {});
+
+  void BeginFrame();
+  void AddDuration(FrameMetric metric, std::chrono::nanoseconds duration);
+  // gpu time comes from queries of earlier frames so it is added separately
+  void AddGpuTime(std::chrono::nanoseconds duration);
+  void EndFrame();
+
+  [[nodiscard]] FrameStatsSummary GetSummary() const;
+  [[nodiscard]] FrameMetricSummary GetSummary(FrameMetric metric) const;
+  // values of the last finished frame, gpu is NaN unless a gpu time arrived
+  // during the frame
+  [[nodiscard]] const std::array<double, kNumFrameMetrics>& GetLastFrame()
+      const noexcept {
+    return current_;
+  }
+  [[nodiscard]] ui64 GetNumFrames() const noexcept { return num_frames_; }
+  [[nodiscard]] ui64 GetNumStutters() const noexcept { return num_stutters_; }
+  // most recent stutters, oldest first
+  [[nodiscard]] const std::deque<FrameStutter>& GetStutters() const noexcept {
+    return stutters_;
+  }
+
+  void LogSummary() const;
+
+ private:
+
+  [[nodiscard]] RollingWindow& GetWindow(FrameMetric metric) noexcept {
+    return windows_[static_cast<size_t>(metric)];
+  }
+  [[nodiscard]] const RollingWindow& GetWindow(
+      FrameMetric metric) const noexcept {
+    return windows_[static_cast<size_t>(metric)];
+  }
+
+  void DetectStutter(double frame_ms);
+
+ private:
+  FrameStatsSettings settings_;
+  std::vector<RollingWindow> windows_;
+  std::deque<FrameStutter> stutters_;
+  std::array<double, kNumFrameMetrics> current_{};
+  Clock::time_point frame_start_;
+  Clock::time_point last_log_time_;
+  ui64 num_frames_ = 0;
+  ui64 num_stutters_ = 0;
+};
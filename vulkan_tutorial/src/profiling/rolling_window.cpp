@@ -0,0 +1,61 @@
+#include "profiling/rolling_window.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+RollingWindow::RollingWindow(size_t capacity)
+    : capacity_(std::max(capacity, size_t{1})) {
+  values_.reserve(capacity_);
+}
+
+void RollingWindow::Push(double value) {
+  if (values_.size() < capacity_) {
+    values_.push_back(value);
+  } else {
+    values_[next_] = value;
+  }
+  next_ = (next_ + 1) % capacity_;
+}
+
+double RollingWindow::GetLast() const noexcept {
+  if (values_.empty()) {
+    return 0.0;
+  }
+
+  return values_[(next_ + capacity_ - 1) % capacity_];
+}
+
+PercentileSummary RollingWindow::Summarize() const {
+  PercentileSummary summary;
+  summary.num_samples = values_.size();
+  if (values_.empty()) {
+    return summary;
+  }
+
+  std::vector<double> sorted = values_;
+  std::sort(sorted.begin(), sorted.end());
+  // nearest rank percentile
+  auto percentile = [&](double p) {
+    const auto rank = static_cast<size_t>(
+        std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp(rank, size_t{1}, sorted.size()) - 1];
+  };
+
+  summary.p50 = percentile(0.50);
+  summary.p95 = percentile(0.95);
+  summary.p99 = percentile(0.99);
+  summary.max = sorted.back();
+  return summary;
+}
+
+double RollingWindow::GetMedian() const {
+  if (values_.empty()) {
+    return 0.0;
+  }
+
+  std::vector<double> copy = values_;
+  auto middle = copy.begin() + static_cast<std::ptrdiff_t>(copy.size() / 2);
+  std::nth_element(copy.begin(), middle, copy.end());
+  return *middle;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct PercentileSummary {
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+  size_t num_samples = 0;
+};
+
+// keeps the last `capacity` values, older ones are overwritten
+class RollingWindow {
+ public:
+  explicit RollingWindow(size_t capacity);
+
+  void Push(double value);
+  [[nodiscard]] size_t GetSize() const noexcept { return values_.size(); }
+  [[nodiscard]] double GetLast() const noexcept;
+  [[nodiscard]] PercentileSummary Summarize() const;
+  [[nodiscard]] double GetMedian() const;
+
+ private:
+  std::vector<double> values_;
+  size_t capacity_ = 0;
+  size_t next_ = 0;
+};
@@ -0,0 +1,181 @@
+#include "profiling/startup_profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "fmt/format.h"
+#include "process_id.hpp"
+#include "spdlog/spdlog.h"
+
+namespace {
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+// stages are compared with their average over this many previous runs
+constexpr size_t kHistoryRuns = 10;
+
+[[nodiscard]] double ToMilliseconds(std::chrono::nanoseconds duration) {
+  return Milliseconds(duration).count();
+}
+}  // namespace
+
+std::chrono::nanoseconds StartupProfiler::GetTotal() const noexcept {
+  return std::accumulate(stages_.begin(), stages_.end(),
+                         std::chrono::nanoseconds{0},
+                         [](std::chrono::nanoseconds sum,
+                            const StartupStage& stage) {
+                           return sum + stage.total;
+                         });
+}
+
+std::chrono::nanoseconds StartupProfiler::GetStageTotal(
+    std::string_view name) const noexcept {
+  std::chrono::nanoseconds total{0};
+  for (const StartupStage& stage : stages_) {
+    if (stage.name == name) {
+      total += stage.total;
+    }
+  }
+
+  return total;
+}
+
+void StartupProfiler::BeginStage(std::string_view name) {
+  assert(!current_stage_ && "nested stages are not supported");
+  current_stage_ = stages_.size();
+  stages_.push_back({std::string(name)});
+  stage_start_ = Clock::now();
+}
+
+void StartupProfiler::EndStage() {
+  stages_[*current_stage_].total = Clock::now() - stage_start_;
+  current_stage_.reset();
+}
+
+void StartupProfiler::PrintTable(
+    const std::filesystem::path& history_path) const {
+  const std::map<std::string, HistoryEntry> history =
+      ReadHistory(history_path);
+  const double total_ms = ToMilliseconds(GetTotal());
+
+  spdlog::info("{:<28} {:>10} {:>10} {:>10} {:>7} {:>10} {:>8}", "stage",
+               "total ms", "cpu ms", "wait ms", "share", "avg ms", "change");
+  for (const StartupStage& stage : stages_) {
+    const double stage_ms = ToMilliseconds(stage.total);
+    const double wait_ms = ToMilliseconds(stage.wait);
+    std::string average = "-";
+    std::string change = "-";
+    auto it = history.find(stage.name);
+    if (it != history.end() && it->second.num_runs != 0) {
+      const double average_ms = it->second.total_ms / it->second.num_runs;
+      average = fmt::format("{:.2f}", average_ms);
+      if (average_ms > 0.0) {
+        change = fmt::format("{:+.0f}%", (stage_ms / average_ms - 1.0) * 100);
+      }
+    }
+
+    spdlog::info("{:<28} {:>10.2f} {:>10.2f} {:>10.2f} {:>6.1f}% {:>10} {:>8}",
+                 stage.name, stage_ms, stage_ms - wait_ms, wait_ms,
+                 total_ms > 0.0 ? stage_ms / total_ms * 100 : 0.0, average,
+                 change);
+  }
+  spdlog::info("{:<28} {:>10.2f}", "total", total_ms);
+}
+
+void StartupProfiler::WriteJson(const std::filesystem::path& path) const {
+  std::ofstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  file << fmt::format("{{\n  \"total_ms\": {:.3f},\n  \"stages\": [",
+                      ToMilliseconds(GetTotal()));
+  for (size_t i = 0; i != stages_.size(); ++i) {
+    const StartupStage& stage = stages_[i];
+    file << fmt::format(
+        "{}\n    {{\"name\": \"{}\", \"total_ms\": {:.3f}, \"cpu_ms\": {:.3f}, "
+        "\"wait_ms\": {:.3f}}}",
+        i == 0 ? "" : ",", stage.name, ToMilliseconds(stage.total),
+        ToMilliseconds(stage.total - stage.wait), ToMilliseconds(stage.wait));
+  }
+  file << "\n  ]\n}\n";
+}
+
+void StartupProfiler::AppendHistory(const std::filesystem::path& path) const {
+  const bool write_header = !std::filesystem::exists(path);
+  std::ofstream file(path, std::ios::app);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  if (write_header) {
+    file << "run,stage,total_ms,wait_ms\n";
+  }
+
+  // milliseconds since epoch and the process id identify the run, runs that
+  // start together still get different ids
+  const auto milliseconds =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  const std::string run = fmt::format("{}-{}", milliseconds, GetCurrentPid());
+  for (const StartupStage& stage : stages_) {
+    file << fmt::format("{},{},{:.3f},{:.3f}\n", run, stage.name,
+                        ToMilliseconds(stage.total),
+                        ToMilliseconds(stage.wait));
+  }
+}
+
+std::map<std::string, StartupProfiler::HistoryEntry>
+StartupProfiler::ReadHistory(const std::filesystem::path& path) {
+  struct Row {
+    std::string run;
+    std::string stage;
+    double total_ms = 0.0;
+  };
+
+  std::vector<Row> rows;
+  std::ifstream file(path);
+  std::string line;
+  // the first line is the header
+  std::getline(file, line);
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    Row row;
+    std::string total;
+    if (std::getline(stream, row.run, ',') &&
+        std::getline(stream, row.stage, ',') &&
+        std::getline(stream, total, ',')) {
+      row.total_ms = std::strtod(total.data(), nullptr);
+      rows.push_back(std::move(row));
+    }
+  }
+
+  // runs are appended in order, walk back until enough of them are seen
+  std::set<std::string> runs;
+  std::map<std::string, std::set<std::string>> stage_runs;
+  std::map<std::string, HistoryEntry> history;
+  for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+    if (!runs.contains(it->run)) {
+      if (runs.size() == kHistoryRuns) {
+        break;
+      }
+      runs.insert(it->run);
+    }
+
+    HistoryEntry& entry = history[it->stage];
+    entry.total_ms += it->total_ms;
+    if (stage_runs[it->stage].insert(it->run).second) {
+      ++entry.num_runs;
+    }
+  }
+
+  return history;
+}
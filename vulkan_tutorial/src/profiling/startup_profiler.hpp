@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "integer.hpp"
+
+struct StartupStage {
+  std::string name;
+  std::chrono::nanoseconds total{0};
+  // part of the total spent blocked on the GPU, the rest is CPU work
+  std::chrono::nanoseconds wait{0};
+};
+
+// Times initialization stages. Blocking waits inside a stage are reported
+// separately through MeasureWait, so it is visible whether a stage is slow
+// because of CPU work or because it waits for uploads to finish
+class StartupProfiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  template <typename Function>
+  void Measure(std::string_view name, Function&& function) {
+    BeginStage(name);
+    function();
+    EndStage();
+  }
+
+  // Time of the wait is attributed to the current stage. Waits outside of a
+  // stage are just executed
+  template <typename Function>
+  void MeasureWait(Function&& function) {
+    const Clock::time_point start = Clock::now();
+    function();
+    if (current_stage_) {
+      stages_[*current_stage_].wait += Clock::now() - start;
+    }
+  }
+
+  [[nodiscard]] const std::vector<StartupStage>& GetStages() const noexcept {
+    return stages_;
+  }
+  [[nodiscard]] std::chrono::nanoseconds GetTotal() const noexcept;
+  // sum of all stages with this name
+  [[nodiscard]] std::chrono::nanoseconds GetStageTotal(
+      std::string_view name) const noexcept;
+
+  // Logs a table of stages. If history is not empty, each stage is compared
+  // with its average over the previous runs
+  void PrintTable(const std::filesystem::path& history_path) const;
+  void WriteJson(const std::filesystem::path& path) const;
+  // one csv row per stage, rows of the same run share the run id
+  void AppendHistory(const std::filesystem::path& path) const;
+
+ private:
+  struct HistoryEntry {
+    double total_ms = 0.0;
+    ui32 num_runs = 0;
+  };
+
+  void BeginStage(std::string_view name);
+  void EndStage();
+
+  // sums of stage totals over the last runs recorded in the history
+  [[nodiscard]] static std::map<std::string, HistoryEntry> ReadHistory(
+      const std::filesystem::path& path);
+
+ private:
+  std::vector<StartupStage> stages_;
+  std::optional<size_t> current_stage_;
+  Clock::time_point stage_start_;
+};
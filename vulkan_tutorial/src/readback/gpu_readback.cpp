@@ -0,0 +1,312 @@
+#include "readback/gpu_readback.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#include "error_handling.hpp"
+#include "fmt/format.h"
+#include "physical_device_info.hpp"
+#include "threading/thread_pool.hpp"
+#include "vulkan_utility.hpp"
+
+namespace {
+constexpr ui32 kBytesPerPixel = 4;
+
+[[nodiscard]] bool IsBgra(VkFormat format) noexcept {
+  return format == VK_FORMAT_B8G8R8A8_UNORM ||
+         format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+}  // namespace
+
+GpuReadback::GpuReadback(VkDevice device, const PhysicalDeviceInfo& device_info,
+                         ui32 queue_family_index, ThreadPool& thread_pool)
+    : device_(device), device_info_(&device_info), thread_pool_(&thread_pool) {
+  VkCommandPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.queueFamilyIndex = queue_family_index;
+  pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  VkWrap(vkCreateCommandPool)(device_, &pool_info, nullptr, &command_pool_);
+}
+
+GpuReadback::~GpuReadback() {
+  while (!in_flight_.empty()) {
+    CopyInFlight& copy = in_flight_.front();
+    if (copy.fence) {
+      vkWaitForFences(device_, 1u, &copy.fence, kVkTrue, UINT64_MAX);
+      Poll();
+      continue;
+    }
+
+    copy.promise.set_exception(std::make_exception_ptr(
+        std::runtime_error("readback commands were never submitted")));
+    {
+      std::lock_guard lock(staging_mutex_);
+      staging_busy_[copy.staging_index] = false;
+    }
+    in_flight_.pop_front();
+  }
+
+  // workers may still be converting pixels from mapped memory
+  {
+    std::unique_lock lock(staging_mutex_);
+    staging_released_.wait(lock, [&]() {
+      return std::none_of(staging_busy_.begin(), staging_busy_.end(),
+                          [](bool busy) { return busy; });
+    });
+  }
+
+  using Vk = VulkanUtility;
+  for (StagingBuffer& staging : staging_buffers_) {
+    vkUnmapMemory(device_, staging.memory);
+    Vk::Destroy<vkDestroyBuffer>(device_, staging.buffer);
+    Vk::FreeMemory(device_, staging.memory);
+  }
+
+  // command buffers are freed with the pool
+  Vk::Destroy<vkDestroyCommandPool>(device_, command_pool_);
+}
+
+bool GpuReadback::IsFormatSupported(VkFormat format) noexcept {
+  return IsBgra(format) || format == VK_FORMAT_R8G8B8A8_UNORM ||
+         format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+VkCommandBuffer GpuReadback::RecordCopy(const ReadbackSource& source,
+                                        std::promise<ReadbackImage> promise) {
+  [[unlikely]] if (!IsFormatSupported(source.format)) {
+    throw std::runtime_error(
+        fmt::format("readback does not support format {}",
+                    static_cast<int>(source.format)));
+  }
+
+  const VkDeviceSize size = VkDeviceSize{source.extent.width} *
+                            source.extent.height * kBytesPerPixel;
+  const size_t staging_index = AcquireStagingBuffer(size);
+  VkBuffer staging_buffer = nullptr;
+  {
+    std::lock_guard lock(staging_mutex_);
+    staging_buffer = staging_buffers_[staging_index].buffer;
+  }
+
+  const VkCommandBuffer command_buffer = AcquireCommandBuffer();
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VkWrap(vkBeginCommandBuffer)(command_buffer, &begin_info);
+
+  VkImageMemoryBarrier image_barrier{};
+  image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  image_barrier.srcAccessMask = source.src_access;
+  image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  image_barrier.oldLayout = source.layout;
+  image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  image_barrier.image = source.image;
+  image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  image_barrier.subresourceRange.baseMipLevel = 0;
+  image_barrier.subresourceRange.levelCount = 1;
+  image_barrier.subresourceRange.baseArrayLayer = 0;
+  image_barrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(command_buffer, source.src_stage,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &image_barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {source.extent.width, source.extent.height, 1};
+  vkCmdCopyImageToBuffer(command_buffer, source.image,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging_buffer,
+                         1u, &region);
+
+  // the copy only reads the image, so restoring the layout needs no access
+  image_barrier.srcAccessMask = 0;
+  image_barrier.dstAccessMask = 0;
+  image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  image_barrier.newLayout = source.layout;
+
+  VkBufferMemoryBarrier buffer_barrier{};
+  buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  buffer_barrier.buffer = staging_buffer;
+  buffer_barrier.offset = 0;
+  buffer_barrier.size = size;
+  vkCmdPipelineBarrier(
+      command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+      nullptr, 1, &buffer_barrier, 1, &image_barrier);
+
+  VkWrap(vkEndCommandBuffer)(command_buffer);
+
+  CopyInFlight& copy = in_flight_.emplace_back();
+  copy.command_buffer = command_buffer;
+  copy.staging_index = staging_index;
+  copy.format = source.format;
+  copy.extent = source.extent;
+  copy.promise = std::move(promise);
+  return command_buffer;
+}
+
+void GpuReadback::OnSubmitted(VkFence fence) {
+  for (CopyInFlight& copy : in_flight_) {
+    if (!copy.fence) {
+      copy.fence = fence;
+    }
+  }
+}
+
+void GpuReadback::Poll() {
+  for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+    if (!it->fence || vkGetFenceStatus(device_, it->fence) != VK_SUCCESS) {
+      ++it;
+      continue;
+    }
+
+    StagingBuffer staging;
+    {
+      std::lock_guard lock(staging_mutex_);
+      staging = staging_buffers_[it->staging_index];
+    }
+
+    free_command_buffers_.push_back(it->command_buffer);
+    thread_pool_->Enqueue(
+        [this, copy = std::move(*it), staging]() mutable {
+          Resolve(std::move(copy), staging);
+        });
+    it = in_flight_.erase(it);
+  }
+}
+
+size_t GpuReadback::AcquireStagingBuffer(VkDeviceSize size) {
+  std::lock_guard lock(staging_mutex_);
+
+  // the smallest free buffer that fits
+  std::optional<size_t> best;
+  for (size_t i = 0; i != staging_buffers_.size(); ++i) {
+    if (!staging_busy_[i] && staging_buffers_[i].size >= size &&
+        (!best || staging_buffers_[i].size < staging_buffers_[*best].size)) {
+      best = i;
+    }
+  }
+
+  if (!best) {
+    best = staging_buffers_.size();
+    staging_buffers_.push_back(CreateStagingBuffer(size));
+    staging_busy_.push_back(false);
+  }
+
+  staging_busy_[*best] = true;
+  return *best;
+}
+
+GpuReadback::StagingBuffer GpuReadback::CreateStagingBuffer(
+    VkDeviceSize size) const {
+  StagingBuffer staging;
+  staging.size = size;
+
+  VkBufferCreateInfo buffer_info{};
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.size = size;
+  buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkWrap(vkCreateBuffer)(device_, &buffer_info, nullptr, &staging.buffer);
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device_, staging.buffer, &requirements);
+
+  // cached memory makes reading on CPU much faster than write combined one
+  std::optional<ui32> memory_type = device_info_->FindMemoryTypeIndex(
+      requirements.memoryTypeBits,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+  if (!memory_type) {
+    memory_type = device_info_->GetMemoryTypeIndex(
+        requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  }
+
+  const VkMemoryPropertyFlags memory_flags =
+      device_info_->memory_properties.memoryTypes[*memory_type].propertyFlags;
+  staging.coherent =
+      (memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+  VkMemoryAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.allocationSize = requirements.size;
+  alloc_info.memoryTypeIndex = *memory_type;
+  VkWrap(vkAllocateMemory)(device_, &alloc_info, nullptr, &staging.memory);
+  VkWrap(vkBindBufferMemory)(device_, staging.buffer, staging.memory, 0u);
+
+  void* mapped = nullptr;
+  VkWrap(vkMapMemory)(device_, staging.memory, 0u, VK_WHOLE_SIZE, 0u, &mapped);
+  staging.mapped = reinterpret_cast<ui8*>(mapped);
+  return staging;
+}
+
+VkCommandBuffer GpuReadback::AcquireCommandBuffer() {
+  if (!free_command_buffers_.empty()) {
+    const VkCommandBuffer command_buffer = free_command_buffers_.back();
+    free_command_buffers_.pop_back();
+    return command_buffer;
+  }
+
+  VkCommandBufferAllocateInfo alloc_info{};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.commandPool = command_pool_;
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = 1;
+  VkCommandBuffer command_buffer = nullptr;
+  VkWrap(vkAllocateCommandBuffers)(device_, &alloc_info, &command_buffer);
+  return command_buffer;
+}
+
+void GpuReadback::Resolve(CopyInFlight copy, StagingBuffer staging) {
+  try {
+    if (!staging.coherent) {
+      VkMappedMemoryRange range{};
+      range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+      range.memory = staging.memory;
+      range.offset = 0;
+      range.size = VK_WHOLE_SIZE;
+      VkWrap(vkInvalidateMappedMemoryRanges)(device_, 1u, &range);
+    }
+
+    ReadbackImage image;
+    image.width = copy.extent.width;
+    image.height = copy.extent.height;
+    image.pixels.resize(size_t{image.width} * image.height * kBytesPerPixel);
+
+    const ui8* src = staging.mapped;
+    ui8* dst = image.pixels.data();
+    if (IsBgra(copy.format)) {
+      for (size_t i = 0; i < image.pixels.size(); i += kBytesPerPixel) {
+        dst[i + 0] = src[i + 2];
+        dst[i + 1] = src[i + 1];
+        dst[i + 2] = src[i + 0];
+        dst[i + 3] = src[i + 3];
+      }
+    } else {
+      std::memcpy(dst, src, image.pixels.size());
+    }
+
+    copy.promise.set_value(std::move(image));
+  } catch (...) {
+    copy.promise.set_exception(std::current_exception());
+  }
+
+  // notify under the lock, destructor may destroy the object right after
+  std::lock_guard lock(staging_mutex_);
+  staging_busy_[copy.staging_index] = false;
+  staging_released_.notify_all();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include "integer.hpp"
+#include "vulkan/vulkan.h"
+
+class PhysicalDeviceInfo;
+class ThreadPool;
+
+// tightly packed 8 bit RGBA pixels
+struct ReadbackImage {
+  ui32 width = 0;
+  ui32 height = 0;
+  std::vector<ui8> pixels;
+};
+
+struct ReadbackSource {
+  VkImage image = nullptr;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  VkExtent2D extent{};
+  // layout of the image when the copy starts, it is restored after the copy
+  VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  // stage and access of the commands that rendered the image
+  VkPipelineStageFlags src_stage =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  VkAccessFlags src_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+};
+
+// Copies images into host cached buffers without stalling the render loop.
+// Pixels are converted to RGBA on worker threads which then fulfil the
+// futures. Staging buffers and command buffers are recycled so continuous
+// readback does not allocate once it warms up
+class GpuReadback {
+ public:
+  GpuReadback(VkDevice device, const PhysicalDeviceInfo& device_info,
+              ui32 queue_family_index, ThreadPool& thread_pool);
+  GpuReadback(const GpuReadback&) = delete;
+  GpuReadback& operator=(const GpuReadback&) = delete;
+  // waits for all copies in flight
+  ~GpuReadback();
+
+  [[nodiscard]] static bool IsFormatSupported(VkFormat format) noexcept;
+
+  // Records a copy of the image. The returned command buffer has to be
+  // submitted to a queue of `queue_family_index` after the commands that
+  // render the image, then `OnSubmitted` has to be called with the fence of
+  // that submission
+  [[nodiscard]] VkCommandBuffer RecordCopy(const ReadbackSource& source,
+                                           std::promise<ReadbackImage> promise);
+  void OnSubmitted(VkFence fence);
+
+  // Never blocks. Fences are not owned by the readback, so each fence has to
+  // be observed signaled before it is reset: call it after waiting for the
+  // frame fence and before resetting it
+  void Poll();
+
+  [[nodiscard]] bool HasCopiesInFlight() const noexcept {
+    return !in_flight_.empty();
+  }
+  [[nodiscard]] size_t GetNumCopiesInFlight() const noexcept {
+    return in_flight_.size();
+  }
+
+ private:
+  struct StagingBuffer {
+    VkBuffer buffer = nullptr;
+    VkDeviceMemory memory = nullptr;
+    VkDeviceSize size = 0;
+    ui8* mapped = nullptr;
+    bool coherent = false;
+  };
+
+  struct CopyInFlight {
+    VkCommandBuffer command_buffer = nullptr;
+    VkFence fence = nullptr;
+    size_t staging_index = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent{};
+    std::promise<ReadbackImage> promise;
+  };
+
+  [[nodiscard]] size_t AcquireStagingBuffer(VkDeviceSize size);
+  [[nodiscard]] StagingBuffer CreateStagingBuffer(VkDeviceSize size) const;
+  [[nodiscard]] VkCommandBuffer AcquireCommandBuffer();
+  // runs on a worker thread
+  void Resolve(CopyInFlight copy, StagingBuffer staging);
+
+ private:
+  VkDevice device_ = nullptr;
+  const PhysicalDeviceInfo* device_info_ = nullptr;
+  ThreadPool* thread_pool_ = nullptr;
+  VkCommandPool command_pool_ = nullptr;
+  std::vector<VkCommandBuffer> free_command_buffers_;
+  std::deque<CopyInFlight> in_flight_;
+
+  // guarded by the mutex because workers return buffers when they are done
+  std::mutex staging_mutex_;
+  std::condition_variable staging_released_;
+  std::vector<StagingBuffer> staging_buffers_;
+  std::vector<bool> staging_busy_;
+};
@@ -0,0 +1,183 @@
+#include "regression/regression_check.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+#include "image_loader.hpp"
+#include "image_writer.hpp"
+#include "read_file.hpp"
+#include "spdlog/spdlog.h"
+
+RegressionCheck::RegressionCheck(RegressionCheckSettings settings)
+    : settings_(std::move(settings)) {
+  if (settings_.update_references) {
+    std::filesystem::create_directories(settings_.reference_dir);
+  }
+}
+
+bool RegressionCheck::HasReferences() const {
+  return settings_.update_references ||
+         std::filesystem::exists(GetReferenceFramePath());
+}
+
+bool RegressionCheck::CheckFrame(const ReadbackImage& frame) const {
+  const std::filesystem::path reference_path = GetReferenceFramePath();
+  if (settings_.update_references) {
+    WritePng(reference_path, frame.width, frame.height, frame.pixels);
+    spdlog::info("reference frame written to {}", reference_path.string());
+    return true;
+  }
+
+  const ImageLoader reference(reference_path.string(), 4);
+  if (reference.GetWidth() != frame.width ||
+      reference.GetHeight() != frame.height) {
+    spdlog::error("frame is {}x{} but reference is {}x{}", frame.width,
+                  frame.height, reference.GetWidth(), reference.GetHeight());
+    return false;
+  }
+
+  const std::span<const unsigned char> expected = reference.GetData();
+  const int tolerance = settings_.pixel_tolerance;
+  size_t num_mismatched = 0;
+  int max_difference = 0;
+  for (size_t i = 0; i < expected.size(); i += 4) {
+    bool mismatch = false;
+    for (size_t channel = 0; channel != 4; ++channel) {
+      const int difference =
+          std::abs(int{expected[i + channel]} - int{frame.pixels[i + channel]});
+      max_difference = std::max(max_difference, difference);
+      mismatch = mismatch || difference > tolerance;
+    }
+
+    if (mismatch) {
+      ++num_mismatched;
+    }
+  }
+
+  const size_t num_pixels = expected.size() / 4;
+  const double mismatched_fraction =
+      static_cast<double>(num_mismatched) / static_cast<double>(num_pixels);
+  if (mismatched_fraction > settings_.max_mismatched_pixels) {
+    std::filesystem::path actual_path = reference_path;
+    actual_path.replace_filename("frame_actual.png");
+    WritePng(actual_path, frame.width, frame.height, frame.pixels);
+    spdlog::error(
+        "frame differs from reference: {} of {} pixels ({:.3f}%) exceed "
+        "tolerance {}, max difference {}. Actual frame written to {}",
+        num_mismatched, num_pixels, mismatched_fraction * 100.0, tolerance,
+        max_difference, actual_path.string());
+    return false;
+  }
+
+  spdlog::info("frame matches reference: {} mismatched pixels, max difference "
+               "{}",
+               num_mismatched, max_difference);
+  return true;
+}
+
+void RegressionCheck::ReportMetrics(const RegressionMetrics& metrics) const {
+  const std::map<std::string, double> current{
+      {"startup_ms", metrics.startup},
+      {"upload_ms", metrics.upload},
+      {"frame_ms", metrics.frame}};
+
+  const std::filesystem::path baseline_path = GetBaselinePath();
+  if (settings_.update_references) {
+    WriteBaseline(baseline_path, current);
+    spdlog::info("performance baseline written to {}", baseline_path.string());
+    return;
+  }
+
+  if (!std::filesystem::exists(baseline_path)) {
+    spdlog::warn("there is no performance baseline {}, it is written with "
+                 "--update-references",
+                 baseline_path.string());
+    return;
+  }
+
+  const std::map<std::string, double> baseline = ReadBaseline(baseline_path);
+  for (const auto& [name, value] : current) {
+    auto it = baseline.find(name);
+    if (it == baseline.end()) {
+      spdlog::warn("{}: {:.3f}, no baseline", name, value);
+      continue;
+    }
+
+    const double limit = it->second * (1.0 + settings_.max_slowdown);
+    if (value > limit) {
+      spdlog::warn("{}: {:.3f}, baseline {:.3f}, limit {:.3f} - slowdown",
+                   name, value, it->second, limit);
+    } else {
+      spdlog::info("{}: {:.3f}, baseline {:.3f}, limit {:.3f}", name, value,
+                   it->second, limit);
+    }
+  }
+}
+
+std::filesystem::path RegressionCheck::GetReferenceFramePath() const {
+  return settings_.reference_dir / "frame.png";
+}
+
+std::filesystem::path RegressionCheck::GetBaselinePath() const {
+  return settings_.reference_dir / "baseline.json";
+}
+
+std::map<std::string, double> RegressionCheck::ReadBaseline(
+    const std::filesystem::path& path) {
+  std::vector<char> buffer;
+  ReadFile(path, buffer);
+  buffer.push_back('\0');
+
+  std::map<std::string, double> values;
+  const char* cursor = buffer.data();
+  while (true) {
+    const char* key_begin = std::strchr(cursor, '"');
+    if (!key_begin) {
+      break;
+    }
+
+    const char* key_end = std::strchr(key_begin + 1, '"');
+    const char* colon = key_end ? std::strchr(key_end, ':') : nullptr;
+    [[unlikely]] if (!colon) {
+      throw std::runtime_error(
+          fmt::format("malformed baseline file {}", path.string()));
+    }
+
+    char* value_end = nullptr;
+    const double value = std::strtod(colon + 1, &value_end);
+    [[unlikely]] if (value_end == colon + 1) {
+      throw std::runtime_error(
+          fmt::format("malformed baseline file {}", path.string()));
+    }
+
+    values[std::string(key_begin + 1, key_end)] = value;
+    cursor = value_end;
+  }
+
+  return values;
+}
+
+void RegressionCheck::WriteBaseline(
+    const std::filesystem::path& path,
+    const std::map<std::string, double>& values) {
+  std::ofstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  file << "{\n";
+  size_t index = 0;
+  for (const auto& [name, value] : values) {
+    const bool last = ++index == values.size();
+    file << fmt::format("  \"{}\": {:.3f}{}\n", name, value, last ? "" : ",");
+  }
+  file << "}\n";
+}
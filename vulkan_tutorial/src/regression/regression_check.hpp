@@ -0,0 +1,68 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include "integer.hpp"
+#include "readback/gpu_readback.hpp"
+
+struct RegressionCheckSettings {
+  // keeps reference frame and performance baseline
+  std::filesystem::path reference_dir;
+  // animation is frozen at this time so frames are reproducible
+  float animation_time = 1.0f;
+  ui32 warmup_frames = 30;
+  ui32 measured_frames = 200;
+  // maximal per channel difference that is not considered a mismatch
+  ui8 pixel_tolerance = 8;
+  // fraction of mismatched pixels that still passes
+  double max_mismatched_pixels = 0.001;
+  // timings may grow by this fraction before a slowdown is reported, timings
+  // depend on the machine so they never fail the check
+  double max_slowdown = 0.25;
+  // writes reference frame and baseline from the current results, without it
+  // the check is skipped when there is no reference frame
+  bool update_references = false;
+};
+
+// all values are in milliseconds
+struct RegressionMetrics {
+  double startup = 0.0;
+  double upload = 0.0;
+  double frame = 0.0;
+};
+
+class RegressionCheck {
+ public:
+  // exit code of a skipped check, CTest reports the test as skipped
+  static constexpr int kSkipExitCode = 77;
+
+ public:
+  explicit RegressionCheck(RegressionCheckSettings settings);
+
+  [[nodiscard]] const RegressionCheckSettings& GetSettings() const noexcept {
+    return settings_;
+  }
+
+  // false when the reference frame is missing and is not going to be written
+  [[nodiscard]] bool HasReferences() const;
+
+  // returns false on a mismatch, details are logged
+  [[nodiscard]] bool CheckFrame(const ReadbackImage& frame) const;
+  // compares timings with the baseline and warns about slowdowns
+  void ReportMetrics(const RegressionMetrics& metrics) const;
+
+ private:
+  [[nodiscard]] std::filesystem::path GetReferenceFramePath() const;
+  [[nodiscard]] std::filesystem::path GetBaselinePath() const;
+
+  // flat json object with numeric values
+  [[nodiscard]] static std::map<std::string, double> ReadBaseline(
+      const std::filesystem::path& path);
+  static void WriteBaseline(const std::filesystem::path& path,
+                            const std::map<std::string, double>& values);
+
+ private:
+  RegressionCheckSettings settings_;
+};
@@ -0,0 +1,180 @@
+#include "residency/texture_residency.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+
+TextureResidency::TextureResidency(TextureResidencySettings settings)
+    : settings_(settings) {}
+
+ui32 TextureResidency::AddTexture(std::span<const TextureMip> mips) {
+  [[unlikely]] if (mips.empty()) {
+    throw std::runtime_error("texture without mip levels");
+  }
+
+  Texture& texture = textures_.emplace_back();
+  texture.mips.assign(mips.begin(), mips.end());
+  texture.last_used_frame = frame_;
+  for (ui32 mip = 0; mip != texture.mips.size(); ++mip) {
+    const TextureMip& level = texture.mips[mip];
+    if (std::max(level.width, level.height) < settings_.min_resident_size) {
+      break;
+    }
+    texture.max_first_mip = mip;
+  }
+
+  resident_size_ += GetSize(texture, 0);
+  return static_cast<ui32>(textures_.size() - 1);
+}
+
+void TextureResidency::MarkUsed(ui32 texture, float screen_size) {
+  Texture& used = textures_.at(texture);
+  // a texture may be drawn a few times per frame, the largest draw decides
+  if (used.last_used_frame != frame_) {
+    used.screen_size = 0.0f;
+  }
+  used.last_used_frame = frame_;
+  used.screen_size = std::max(used.screen_size, screen_size);
+}
+
+std::vector<TextureResidencyChange> TextureResidency::Update(ui64 budget) {
+  std::vector<ui32> first_mips(textures_.size());
+  std::transform(textures_.begin(), textures_.end(), first_mips.begin(),
+                 [](const Texture& texture) { return texture.first_mip; });
+  if (resident_size_ > budget) {
+    Evict(budget, first_mips);
+  } else {
+    Restore(budget, first_mips);
+  }
+
+  std::vector<TextureResidencyChange> changes;
+  for (ui32 index = 0; index != textures_.size(); ++index) {
+    Texture& texture = textures_[index];
+    if (texture.first_mip == first_mips[index]) {
+      continue;
+    }
+
+    resident_size_ -= GetSize(texture, texture.first_mip);
+    texture.first_mip = first_mips[index];
+    resident_size_ += GetSize(texture, texture.first_mip);
+    changes.push_back({index, texture.first_mip});
+  }
+
+  ++frame_;
+  return changes;
+}
+
+ui32 TextureResidency::GetFirstMip(ui32 texture) const {
+  return textures_.at(texture).first_mip;
+}
+
+ui64 TextureResidency::GetSize(const Texture& texture, ui32 first_mip) {
+  return std::accumulate(
+      texture.mips.begin() + first_mip, texture.mips.end(), ui64{0},
+      [](ui64 size, const TextureMip& mip) { return size + mip.size; });
+}
+
+bool TextureResidency::IsCold(const Texture& texture) const noexcept {
+  return frame_ - texture.last_used_frame >= settings_.cold_frames;
+}
+
+ui32 TextureResidency::GetVisibleMip(const Texture& texture) noexcept {
+  ui32 mip = 0;
+  while (mip + 1 < texture.mips.size()) {
+    const TextureMip& next = texture.mips[mip + 1];
+    if (static_cast<float>(std::max(next.width, next.height)) <
+        texture.screen_size) {
+      break;
+    }
+    ++mip;
+  }
+  return mip;
+}
+
+TextureResidency::EvictionOrder TextureResidency::GetEvictionOrder(
+    const Texture& texture, ui32 first_mip) const noexcept {
+  EvictionOrder order;
+  if (IsCold(texture)) {
+    order.tier = 0;
+  } else if (first_mip < GetVisibleMip(texture)) {
+    order.tier = 1;
+  } else {
+    order.tier = 2;
+  }
+  order.last_used_frame = texture.last_used_frame;
+  order.screen_size = texture.screen_size;
+  return order;
+}
+
+void TextureResidency::Evict(ui64 budget,
+                             std::vector<ui32>& first_mips) const {
+  ui64 total = resident_size_;
+  // one level at a time, so a texture moves to a later tier once its
+  // invisible levels are gone
+  while (total > budget) {
+    std::optional<ui32> victim;
+    EvictionOrder victim_order;
+    for (ui32 index = 0; index != textures_.size(); ++index) {
+      const Texture& texture = textures_[index];
+      if (first_mips[index] >= texture.max_first_mip) {
+        continue;
+      }
+
+      const EvictionOrder order =
+          GetEvictionOrder(texture, first_mips[index]);
+      if (!victim || order < victim_order) {
+        victim = index;
+        victim_order = order;
+      }
+    }
+
+    if (!victim) {
+      // everything is at the smallest allowed size, over budget anyway
+      break;
+    }
+
+    total -= textures_[*victim].mips[first_mips[*victim]].size;
+    ++first_mips[*victim];
+  }
+}
+
+void TextureResidency::Restore(ui64 budget,
+                               std::vector<ui32>& first_mips) const {
+  std::vector<ui32> candidates;
+  for (ui32 index = 0; index != textures_.size(); ++index) {
+    if (first_mips[index] != 0 && !IsCold(textures_[index])) {
+      candidates.push_back(index);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(), [&](ui32 a, ui32 b) {
+    const Texture& texture_a = textures_[a];
+    const Texture& texture_b = textures_[b];
+    return std::tie(texture_b.screen_size, texture_b.last_used_frame) <
+           std::tie(texture_a.screen_size, texture_a.last_used_frame);
+  });
+
+  ui64 total = resident_size_;
+  ui32 num_restored = 0;
+  for (const ui32 index : candidates) {
+    if (num_restored == settings_.max_restores_per_frame) {
+      break;
+    }
+
+    // as many levels as fit, the largest ones may stay evicted
+    const Texture& texture = textures_[index];
+    const ui32 first_mip = first_mips[index];
+    const ui64 available = budget - total;
+    for (ui32 target = 0; target != first_mip; ++target) {
+      const ui64 extra = GetSize(texture, target) - GetSize(texture, first_mip);
+      if (extra + settings_.restore_margin <= available) {
+        total += extra;
+        first_mips[index] = target;
+        ++num_restored;
+        break;
+      }
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "assets/mip_generator.hpp"
+#include "integer.hpp"
+
+struct TextureResidencySettings {
+  // textures that were not drawn for this many frames are evicted first
+  ui32 cold_frames = 120;
+  // levels smaller than this are never evicted, so every texture stays
+  // recognizable however small the budget is
+  ui32 min_resident_size = 64;
+  // Levels are restored only when they fit this many bytes below the budget,
+  // so a restored texture is not evicted again by the next frame
+  ui64 restore_margin = ui64{16} << 20;
+  // every restore uploads a texture, this bounds the stall of one frame
+  ui32 max_restores_per_frame = 1;
+};
+
+struct TextureResidencyChange {
+  ui32 texture = 0;
+  // index of the largest level that has to be resident
+  ui32 first_mip = 0;
+};
+
+// Decides how many of the largest mip levels of every texture are kept in
+// device memory. The renderer reports which textures are drawn and how large
+// they appear on screen, and applies returned changes by recreating images
+// with fewer or more levels. When resident levels exceed the budget, cold
+// textures lose levels first, then the ones whose largest levels are finer
+// than the screen can show, then the smallest on screen. Levels come back
+// when there is room again, the largest textures on screen first
+class TextureResidency {
+ public:
+  explicit TextureResidency(TextureResidencySettings settings = {});
+
+  // levels from the largest one, returns the id of the texture
+  [[nodiscard]] ui32 AddTexture(std::span<const TextureMip> mips);
+
+  // `screen_size` is how many pixels the texture spans along its larger side
+  void MarkUsed(ui32 texture, float screen_size);
+
+  // Returns changes that bring resident levels within the budget and starts
+  // the next frame. Every change has to be applied before the next call
+  [[nodiscard]] std::vector<TextureResidencyChange> Update(ui64 budget);
+
+  [[nodiscard]] ui32 GetFirstMip(ui32 texture) const;
+  [[nodiscard]] ui64 GetResidentSize() const noexcept {
+    return resident_size_;
+  }
+  [[nodiscard]] const TextureResidencySettings& GetSettings() const noexcept {
+    return settings_;
+  }
+
+ private:
+  struct Texture {
+    std::vector<TextureMip> mips;
+    // largest level that may be evicted
+    ui32 max_first_mip = 0;
+    ui32 first_mip = 0;
+    ui64 last_used_frame = 0;
+    float screen_size = 0.0f;
+  };
+
+  // lower values lose levels first
+  struct EvictionOrder {
+    ui32 tier = 0;
+    ui64 last_used_frame = 0;
+    float screen_size = 0.0f;
+
+    [[nodiscard]] auto operator<=>(const EvictionOrder&) const = default;
+  };
+
+  [[nodiscard]] static ui64 GetSize(const Texture& texture, ui32 first_mip);
+  [[nodiscard]] bool IsCold(const Texture& texture) const noexcept;
+  // finest level the screen can show, the larger ones are not visible
+  [[nodiscard]] static ui32 GetVisibleMip(const Texture& texture) noexcept;
+  [[nodiscard]] EvictionOrder GetEvictionOrder(const Texture& texture,
+                                               ui32 first_mip) const noexcept;
+
+  void Evict(ui64 budget, std::vector<ui32>& first_mips) const;
+  void Restore(ui64 budget, std::vector<ui32>& first_mips) const;
+
+ private:
+  TextureResidencySettings settings_;
+  std::vector<Texture> textures_;
+  ui64 resident_size_ = 0;
+  ui64 frame_ = 0;
+};
@@ -0,0 +1,193 @@
+#include "scene/scene_geometry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "assets/baked_mesh.hpp"
+#include "cache/cached_loaders.hpp"
+#include "fmt/format.h"
+#include "gltf/glb_loader.hpp"
+#include "include_glm.hpp"
+include_glm_begin;
+#include "glm/glm.hpp"
+include_glm_end;
+
+void MeshBounds::Add(const glm::vec3& point) noexcept {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void MeshBounds::Add(const MeshBounds& bounds) noexcept {
+  min = glm::min(min, bounds.min);
+  max = glm::max(max, bounds.max);
+}
+
+MeshBounds ComputeBounds(std::span<const Vertex> vertices) noexcept {
+  MeshBounds bounds;
+  for (const Vertex& vertex : vertices) {
+    bounds.Add(vertex.pos);
+  }
+  return bounds;
+}
+
+const MeshRange& SceneGeometry::AddMesh(std::string name,
+                                        std::span<const Vertex> vertices,
+                                        std::span<const ui32> indices) {
+  const MeshStorage storage =
+      AllocateMesh(std::move(name), vertices.size(), indices.size());
+  std::copy(vertices.begin(), vertices.end(), storage.vertices.begin());
+  std::copy(indices.begin(), indices.end(), storage.indices.begin());
+  return meshes_.back();
+}
+
+SceneGeometry::MeshStorage SceneGeometry::AllocateMesh(std::string name,
+                                                       size_t num_vertices,
+                                                       size_t num_indices) {
+  // vertex offset is signed in vkCmdDrawIndexed
+  constexpr size_t kMaxVertices = std::numeric_limits<i32>::max();
+  constexpr size_t kMaxIndices = std::numeric_limits<ui32>::max();
+  [[unlikely]] if (vertices_.size() + num_vertices > kMaxVertices ||
+                   indices_.size() + num_indices > kMaxIndices) {
+    throw std::runtime_error(
+        fmt::format("mesh {} does not fit into scene buffers", name));
+  }
+
+  MeshRange& mesh = meshes_.emplace_back();
+  mesh.name = std::move(name);
+  mesh.first_index = static_cast<ui32>(indices_.size());
+  mesh.index_count = static_cast<ui32>(num_indices);
+  mesh.vertex_offset = static_cast<i32>(vertices_.size());
+  mesh.vertex_count = static_cast<ui32>(num_vertices);
+
+  vertices_.resize(vertices_.size() + num_vertices);
+  indices_.resize(indices_.size() + num_indices);
+  MeshStorage storage;
+  storage.vertices = std::span(vertices_).last(num_vertices);
+  storage.indices = std::span(indices_).last(num_indices);
+  return storage;
+}
+
+SceneGeometry::MeshStorage SceneGeometry::AllocateMeshes(
+    std::span<const MeshRange> meshes, size_t num_vertices,
+    size_t num_indices) {
+  constexpr size_t kMaxVertices = std::numeric_limits<i32>::max();
+  constexpr size_t kMaxIndices = std::numeric_limits<ui32>::max();
+  [[unlikely]] if (vertices_.size() + num_vertices > kMaxVertices ||
+                   indices_.size() + num_indices > kMaxIndices) {
+    throw std::runtime_error("meshes do not fit into scene buffers");
+  }
+
+  for (const MeshRange& mesh : meshes) {
+    [[unlikely]] if (mesh.vertex_offset < 0 ||
+                     size_t{mesh.first_index} + mesh.index_count >
+                         num_indices ||
+                     size_t{static_cast<ui32>(mesh.vertex_offset)} +
+                             mesh.vertex_count >
+                         num_vertices) {
+      throw std::runtime_error(
+          fmt::format("mesh {} is out of bounds", mesh.name));
+    }
+  }
+
+  for (const MeshRange& mesh : meshes) {
+    MeshRange& added = meshes_.emplace_back(mesh);
+    added.first_index += static_cast<ui32>(indices_.size());
+    added.vertex_offset += static_cast<i32>(vertices_.size());
+  }
+
+  vertices_.resize(vertices_.size() + num_vertices);
+  indices_.resize(indices_.size() + num_indices);
+  MeshStorage storage;
+  storage.vertices = std::span(vertices_).last(num_vertices);
+  storage.indices = std::span(indices_).last(num_indices);
+  return storage;
+}
+
+void SceneGeometry::Clear() noexcept {
+  vertices_.clear();
+  indices_.clear();
+  meshes_.clear();
+}
+
+const MeshRange& AddBoxMesh(std::string name, const MeshBounds& bounds,
+                            SceneGeometry& geometry) {
+  // corner `i` takes max along the axes of set bits
+  std::array<Vertex, 8> vertices{};
+  for (size_t i = 0; i != vertices.size(); ++i) {
+    vertices[i].pos = {(i & 1) ? bounds.max.x : bounds.min.x,
+                       (i & 2) ? bounds.max.y : bounds.min.y,
+                       (i & 4) ? bounds.max.z : bounds.min.z};
+    vertices[i].color = {1.0f, 1.0f, 1.0f};
+  }
+
+  // counter clockwise seen from outside
+  constexpr std::array<ui32, 36> kIndices{
+      0, 2, 3, 0, 3, 1,  // -z
+      4, 5, 7, 4, 7, 6,  // +z
+      0, 4, 6, 0, 6, 2,  // -x
+      1, 3, 7, 1, 7, 5,  // +x
+      0, 1, 5, 0, 5, 4,  // -y
+      2, 6, 7, 2, 7, 3,  // +y
+  };
+  return geometry.AddMesh(std::move(name), vertices, kIndices);
+}
+
+std::vector<std::filesystem::path> ReadSceneFile(
+    const std::filesystem::path& path) {
+  std::ifstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  std::vector<std::filesystem::path> mesh_files;
+  std::string line;
+  while (std::getline(file, line)) {
+    line.erase(std::min(line.find('#'), line.size()));
+    const size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+      continue;
+    }
+
+    const size_t end = line.find_last_not_of(" \t\r");
+    mesh_files.push_back(path.parent_path() /
+                         line.substr(begin, end - begin + 1));
+  }
+
+  return mesh_files;
+}
+
+VertexStreams SplitVertexStreams(std::span<const Vertex> vertices) {
+  VertexStreams streams;
+  streams.positions.reserve(vertices.size());
+  streams.attributes.reserve(vertices.size());
+  for (const Vertex& vertex : vertices) {
+    streams.positions.push_back(vertex.pos);
+    streams.attributes.push_back({vertex.color, vertex.tex_coord});
+  }
+  return streams;
+}
+
+void LoadSceneMeshes(std::span<const std::filesystem::path> mesh_files,
+                     SceneGeometry& geometry, DerivedDataCache* cache,
+                     ThreadPool* thread_pool) {
+  std::vector<Vertex> vertices;
+  std::vector<ui32> indices;
+  for (const std::filesystem::path& mesh_file : mesh_files) {
+    if (mesh_file.extension() == ".mesh") {
+      LoadBakedMesh(mesh_file, geometry, thread_pool);
+      continue;
+    }
+
+    if (mesh_file.extension() == ".glb") {
+      LoadGlbModel(mesh_file, geometry);
+      continue;
+    }
+
+    LoadObjModelCached(mesh_file, cache, vertices, indices);
+    geometry.AddMesh(mesh_file.stem().string(), vertices, indices);
+  }
+}
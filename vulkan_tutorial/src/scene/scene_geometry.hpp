@@ -0,0 +1,98 @@
+#pragma once
+
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "integer.hpp"
+#include "pipeline/vertex.hpp"
+
+class DerivedDataCache;
+class ThreadPool;
+
+// axis aligned box, empty until a point is added
+struct MeshBounds {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+  void Add(const glm::vec3& point) noexcept;
+  void Add(const MeshBounds& bounds) noexcept;
+  [[nodiscard]] bool IsEmpty() const noexcept { return min.x > max.x; }
+};
+
+[[nodiscard]] MeshBounds ComputeBounds(
+    std::span<const Vertex> vertices) noexcept;
+
+// where a mesh lives in the shared vertex and index arrays
+struct MeshRange {
+  std::string name;
+  ui32 first_index = 0;
+  ui32 index_count = 0;
+  // added to every index of the mesh by the draw
+  i32 vertex_offset = 0;
+  ui32 vertex_count = 0;
+};
+
+// Vertices and indices of all meshes packed into shared arrays that are
+// uploaded as a single vertex buffer and a single index buffer. Indices stay
+// relative to their mesh, so meshes are appended without rewriting them and
+// every draw reuses the same buffer bindings
+class SceneGeometry {
+ public:
+  // throws when offsets would not fit into draw parameters
+  const MeshRange& AddMesh(std::string name, std::span<const Vertex> vertices,
+                           std::span<const ui32> indices);
+  // Reserves space for a mesh that the caller fills in place, so loaders can
+  // copy data straight into the shared arrays. Spans are invalidated by the
+  // next added mesh
+  struct MeshStorage {
+    std::span<Vertex> vertices;
+    std::span<ui32> indices;
+  };
+  [[nodiscard]] MeshStorage AllocateMesh(std::string name, size_t num_vertices,
+                                         size_t num_indices);
+  // Appends meshes with ranges relative to new arrays of the given sizes and
+  // returns space for both arrays, so a loader fills all meshes at once
+  [[nodiscard]] MeshStorage AllocateMeshes(std::span<const MeshRange> meshes,
+                                           size_t num_vertices,
+                                           size_t num_indices);
+  void Clear() noexcept;
+
+  [[nodiscard]] const std::vector<Vertex>& GetVertices() const noexcept {
+    return vertices_;
+  }
+  [[nodiscard]] const std::vector<ui32>& GetIndices() const noexcept {
+    return indices_;
+  }
+  [[nodiscard]] const std::vector<MeshRange>& GetMeshes() const noexcept {
+    return meshes_;
+  }
+
+ private:
+  std::vector<Vertex> vertices_;
+  std::vector<ui32> indices_;
+  std::vector<MeshRange> meshes_;
+};
+
+// Twelve triangles of the box, drawn in place of meshes that are not loaded
+// yet. Texture coordinates are zero, so the box has a single color
+const MeshRange& AddBoxMesh(std::string name, const MeshBounds& bounds,
+                            SceneGeometry& geometry);
+
+// Scene file lists a mesh file per line, `#` starts a comment. Relative paths
+// are resolved against the directory of the scene file
+[[nodiscard]] std::vector<std::filesystem::path> ReadSceneFile(
+    const std::filesystem::path& path);
+
+// copies vertices into separate position and attribute streams
+[[nodiscard]] VertexStreams SplitVertexStreams(
+    std::span<const Vertex> vertices);
+
+// Loads baked meshes, obj and glb files and appends them to the geometry in
+// order. Imported obj files are kept in the cache when it is not null, baked
+// meshes are decompressed on the pool when it is not null
+void LoadSceneMeshes(std::span<const std::filesystem::path> mesh_files,
+                     SceneGeometry& geometry, DerivedDataCache* cache,
+                     ThreadPool* thread_pool = nullptr);
@@ -0,0 +1,100 @@
+#include "simulation/camera_path.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "fmt/format.h"
+
+CameraPath CameraPath::Load(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  CameraPath camera_path;
+  std::string line;
+  for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+    std::istringstream stream(line.substr(0, line.find('#')));
+    CameraKeyframe keyframe;
+    if (!(stream >> keyframe.time)) {
+      // empty line or comment
+      continue;
+    }
+
+    CameraPose& camera = keyframe.camera;
+    stream >> camera.eye.x >> camera.eye.y >> camera.eye.z;
+    stream >> camera.target.x >> camera.target.y >> camera.target.z;
+    [[unlikely]] if (!stream || (!camera_path.keyframes_.empty() &&
+                                 keyframe.time <
+                                     camera_path.keyframes_.back().time)) {
+      throw std::runtime_error(fmt::format(
+          "{}:{}: expected time and six coordinates in time order",
+          path.string(), line_number));
+    }
+
+    camera_path.keyframes_.push_back(keyframe);
+  }
+
+  [[unlikely]] if (camera_path.IsEmpty()) {
+    throw std::runtime_error(
+        fmt::format("camera path {} has no keyframes", path.string()));
+  }
+
+  return camera_path;
+}
+
+void CameraPath::Save(const std::filesystem::path& path) const {
+  std::ofstream file(path);
+  [[unlikely]] if (!file.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  file << "# time eye.x eye.y eye.z target.x target.y target.z\n";
+  for (const CameraKeyframe& keyframe : keyframes_) {
+    const CameraPose& camera = keyframe.camera;
+    // nine digits keep floats exact after reading them back
+    file << fmt::format("{:.9g} {:.9g} {:.9g} {:.9g} {:.9g} {:.9g} {:.9g}\n",
+                        keyframe.time, camera.eye.x, camera.eye.y,
+                        camera.eye.z, camera.target.x, camera.target.y,
+                        camera.target.z);
+  }
+}
+
+void CameraPath::Add(const CameraKeyframe& keyframe) {
+  [[unlikely]] if (!keyframes_.empty() &&
+                   keyframe.time < keyframes_.back().time) {
+    throw std::runtime_error("camera keyframes are not in time order");
+  }
+
+  keyframes_.push_back(keyframe);
+}
+
+CameraPose CameraPath::Sample(float time) const {
+  [[unlikely]] if (keyframes_.empty()) {
+    throw std::runtime_error("sampling empty camera path");
+  }
+
+  auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), time,
+                               [](float t, const CameraKeyframe& keyframe) {
+                                 return t < keyframe.time;
+                               });
+  if (next == keyframes_.begin()) {
+    return next->camera;
+  }
+  if (next == keyframes_.end()) {
+    return keyframes_.back().camera;
+  }
+
+  const CameraKeyframe& previous = *std::prev(next);
+  const float span = next->time - previous.time;
+  const float t = (time - previous.time) / span;
+  CameraPose camera;
+  camera.eye = glm::mix(previous.camera.eye, next->camera.eye, t);
+  camera.target = glm::mix(previous.camera.target, next->camera.target, t);
+  return camera;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "pipeline/uniform_buffer_object.hpp"
+
+struct CameraKeyframe {
+  // seconds of the animation
+  float time = 0.0f;
+  CameraPose camera;
+};
+
+// Camera poses over time. Text file has a keyframe per line:
+// `time eye.x eye.y eye.z target.x target.y target.z`, `#` starts a comment
+class CameraPath {
+ public:
+  [[nodiscard]] static CameraPath Load(const std::filesystem::path& path);
+  void Save(const std::filesystem::path& path) const;
+
+  // keyframes have to be added in time order
+  void Add(const CameraKeyframe& keyframe);
+
+  // linearly interpolated, clamped to the first and the last keyframes
+  [[nodiscard]] CameraPose Sample(float time) const;
+
+  [[nodiscard]] bool IsEmpty() const noexcept { return keyframes_.empty(); }
+  [[nodiscard]] float GetDuration() const noexcept {
+    return keyframes_.empty() ? 0.0f : keyframes_.back().time;
+  }
+
+ private:
+  std::vector<CameraKeyframe> keyframes_;
+};
@@ -0,0 +1,76 @@
+#include "simulation/simulation_clock.hpp"
+
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+SimulationClock::SimulationClock(SimulationClockSettings settings)
+    : settings_(std::move(settings)) {
+  if (settings_.mode == ClockMode::Playback) {
+    playback_ = CameraPath::Load(settings_.camera_path);
+  }
+
+  [[unlikely]] if (settings_.mode != ClockMode::RealTime &&
+                   settings_.step.count() < 0) {
+    throw std::runtime_error("simulation step can't be negative");
+  }
+
+  frame_.time = GetTime(0);
+  frame_.camera = playback_ ? playback_->Sample(frame_.time)
+                            : GetOrbitCamera(frame_.time);
+}
+
+bool SimulationClock::Advance() {
+  // the first call moves to the first frame
+  const ui64 index = started_ ? frame_.index + 1 : 0;
+  if (!started_) {
+    started_ = true;
+    start_ = Clock::now();
+  }
+
+  if (settings_.frame_limit != 0 && index >= settings_.frame_limit) {
+    return false;
+  }
+
+  const float time = GetTime(index);
+  if (playback_ && time > playback_->GetDuration()) {
+    return false;
+  }
+
+  frame_.index = index;
+  frame_.time = time;
+  frame_.camera =
+      playback_ ? playback_->Sample(time) : GetOrbitCamera(time);
+
+  if (recording_) {
+    recording_->Add({frame_.time, frame_.camera});
+  }
+
+  return true;
+}
+
+void SimulationClock::RecordCamera(std::filesystem::path path) {
+  recording_.emplace();
+  recording_path_ = std::move(path);
+}
+
+void SimulationClock::SaveRecording() const {
+  if (recording_) {
+    recording_->Save(recording_path_);
+    spdlog::info("camera path written to {}", recording_path_.string());
+  }
+}
+
+float SimulationClock::GetTime(ui64 frame_index) const {
+  using Seconds = std::chrono::duration<double>;
+  if (settings_.mode == ClockMode::RealTime) {
+    const double elapsed =
+        frame_index == 0 ? 0.0 : Seconds(Clock::now() - start_).count();
+    return settings_.start_time + static_cast<float>(elapsed);
+  }
+
+  // multiplied rather than accumulated so the error does not grow
+  const double elapsed =
+      Seconds(settings_.step).count() * static_cast<double>(frame_index);
+  return settings_.start_time + static_cast<float>(elapsed);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+
+#include "integer.hpp"
+#include "simulation/camera_path.hpp"
+
+enum class ClockMode {
+  // animation follows wall clock time, frames differ between runs
+  RealTime,
+  // every frame advances the animation by the same step
+  FixedStep,
+  // fixed step, camera follows a recorded path and the run ends with it
+  Playback
+};
+
+struct SimulationClockSettings {
+  ClockMode mode = ClockMode::RealTime;
+  // animation time of the first frame
+  float start_time = 0.0f;
+  // used by fixed step and playback modes
+  std::chrono::nanoseconds step = std::chrono::microseconds(16667);
+  // required by playback mode
+  std::filesystem::path camera_path;
+  // zero does not limit the number of frames
+  ui64 frame_limit = 0;
+};
+
+struct SimulationFrame {
+  ui64 index = 0;
+  // seconds of the animation
+  float time = 0.0f;
+  CameraPose camera;
+};
+
+// Decides what every frame shows. With fixed step and playback modes the
+// sequence of frames does not depend on how fast they are rendered, so runs
+// can be compared frame by frame
+class SimulationClock {
+ public:
+  explicit SimulationClock(SimulationClockSettings settings = {});
+
+  // Moves to the next frame. Returns false when the frame limit is reached or
+  // the camera path is over
+  [[nodiscard]] bool Advance();
+
+  [[nodiscard]] const SimulationFrame& GetFrame() const noexcept {
+    return frame_;
+  }
+  [[nodiscard]] const SimulationClockSettings& GetSettings() const noexcept {
+    return settings_;
+  }
+
+  // every advanced frame is added to the path which is saved to `path`
+  void RecordCamera(std::filesystem::path path);
+  void SaveRecording() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  [[nodiscard]] float GetTime(ui64 frame_index) const;
+
+ private:
+  SimulationClockSettings settings_;
+  std::optional<CameraPath> playback_;
+  std::optional<CameraPath> recording_;
+  std::filesystem::path recording_path_;
+  Clock::time_point start_;
+  SimulationFrame frame_;
+  bool started_ = false;
+};
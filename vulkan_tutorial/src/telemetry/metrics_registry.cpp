@@ -0,0 +1,58 @@
+#include "telemetry/metrics_registry.hpp"
+
+#include <cmath>
+#include <set>
+
+#include "fmt/format.h"
+
+namespace {
+std::string_view ToString(MetricsRegistry::Type type) noexcept {
+  switch (type) {
+    case MetricsRegistry::Type::Gauge:
+      return "gauge";
+    case MetricsRegistry::Type::Counter:
+      return "counter";
+    case MetricsRegistry::Type::Summary:
+      return "summary";
+  }
+
+  return "untyped";
+}
+}  // namespace
+
+std::atomic<double>& MetricsRegistry::Add(std::string_view family,
+                                          std::string_view labels,
+                                          std::string_view help, Type type,
+                                          std::string_view suffix) {
+  Metric& metric = metrics_.emplace_back();
+  metric.family = family;
+  metric.suffix = suffix;
+  metric.labels = labels;
+  metric.help = help;
+  metric.type = type;
+  return metric.value;
+}
+
+std::string MetricsRegistry::Format() const {
+  std::string text;
+  std::set<std::string_view> described;
+  for (const Metric& metric : metrics_) {
+    // help and type are written once, before the first sample of the family
+    if (described.insert(metric.family).second) {
+      text += fmt::format("# HELP {} {}\n# TYPE {} {}\n", metric.family,
+                          metric.help, metric.family, ToString(metric.type));
+    }
+
+    const double value = metric.value.load(std::memory_order_relaxed);
+    const std::string labels =
+        metric.labels.empty() ? "" : fmt::format("{{{}}}", metric.labels);
+    if (std::isnan(value)) {
+      text += fmt::format("{}{}{} NaN\n", metric.family, metric.suffix, labels);
+    } else {
+      text += fmt::format("{}{}{} {}\n", metric.family, metric.suffix, labels,
+                          value);
+    }
+  }
+
+  return text;
+}
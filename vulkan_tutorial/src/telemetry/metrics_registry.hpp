@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <string_view>
+
+// Named values in Prometheus text format. Writers publish values with
+// relaxed atomic stores and never wait for readers. Registration is not
+// synchronized, all metrics have to be added before other threads read them
+class MetricsRegistry {
+ public:
+  enum class Type { Gauge, Counter, Summary };
+
+  static_assert(std::atomic<double>::is_always_lock_free);
+
+  // Metrics of the same family share help and type and have to be added one
+  // after another. Labels are written as they are, for example `heap="0"`.
+  // `suffix` is appended to the name of the sample, e.g. `_sum` and `_count`
+  // of a summary. The reference stays valid for the lifetime of the registry
+  std::atomic<double>& Add(std::string_view family, std::string_view labels,
+                           std::string_view help, Type type = Type::Gauge,
+                           std::string_view suffix = {});
+
+  [[nodiscard]] std::string Format() const;
+
+ private:
+  struct Metric {
+    std::string family;
+    std::string suffix;
+    std::string labels;
+    std::string help;
+    Type type = Type::Gauge;
+    std::atomic<double> value{0.0};
+  };
+
+  // deque keeps references to its elements on growth
+  std::deque<Metric> metrics_;
+};
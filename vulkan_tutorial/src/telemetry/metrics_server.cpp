@@ -0,0 +1,200 @@
+#include "telemetry/metrics_server.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include "fmt/format.h"
+#include "spdlog/spdlog.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr int kTickMilliseconds = 100;
+// requests are tiny, anything bigger is not a scrape
+constexpr size_t kMaxRequestSize = 8192;
+
+#ifdef _WIN32
+static_assert(sizeof(SOCKET) == sizeof(std::uintptr_t));
+constexpr std::uintptr_t kInvalidSocket = INVALID_SOCKET;
+
+void CloseSocket(std::uintptr_t socket) { closesocket(socket); }
+int PollSockets(pollfd* fds, size_t count, int timeout) {
+  return WSAPoll(fds, static_cast<ULONG>(count), timeout);
+}
+int GetSocketError() { return WSAGetLastError(); }
+using IoSize = int;
+constexpr int kSendFlags = 0;
+#else
+constexpr int kInvalidSocket = -1;
+
+void CloseSocket(int socket) { close(socket); }
+int PollSockets(pollfd* fds, size_t count, int timeout) {
+  return poll(fds, static_cast<nfds_t>(count), timeout);
+}
+int GetSocketError() { return errno; }
+using IoSize = size_t;
+#ifdef MSG_NOSIGNAL
+// closed connection must not kill the process with SIGPIPE
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+#endif
+
+template <typename Socket>
+bool SendAll(Socket socket, std::string_view data) {
+  while (!data.empty()) {
+    const auto sent = send(socket, data.data(),
+                           static_cast<IoSize>(data.size()), kSendFlags);
+    if (sent <= 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+
+  return true;
+}
+}  // namespace
+
+MetricsServer::MetricsServer(ui16 port, RenderFunction render,
+                             TickFunction tick)
+    : render_(std::move(render)), tick_(std::move(tick)) {
+#ifdef _WIN32
+  WSADATA wsa_data{};
+  [[unlikely]] if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    throw std::runtime_error("failed to initialize winsock");
+  }
+#endif
+
+  auto fail = [&](std::string_view what) {
+    const int error = GetSocketError();
+    if (listen_socket_ != kInvalidSocket) {
+      CloseSocket(listen_socket_);
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    throw std::runtime_error(fmt::format(
+        "metrics server failed to {} on port {}: error {}", what, port, error));
+  };
+
+  listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  [[unlikely]] if (listen_socket_ == kInvalidSocket) {
+    fail("create socket");
+  }
+
+  const int reuse = 1;
+  setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR,
+             reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+  // loopback only, metrics are not meant to be exposed to the network
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  [[unlikely]] if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+                        sizeof(address)) != 0) {
+    fail("bind");
+  }
+
+  [[unlikely]] if (listen(listen_socket_, 8) != 0) {
+    fail("listen");
+  }
+
+  socklen_t address_size = sizeof(address);
+  getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+              &address_size);
+  port_ = ntohs(address.sin_port);
+
+  thread_ = std::thread([this]() { Serve(); });
+  spdlog::info("metrics are served at http://127.0.0.1:{}/metrics", port_);
+}
+
+MetricsServer::~MetricsServer() {
+  stop_ = true;
+  thread_.join();
+  CloseSocket(listen_socket_);
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+void MetricsServer::Serve() {
+  while (!stop_) {
+    pollfd descriptor{};
+    descriptor.fd = listen_socket_;
+    descriptor.events = POLLIN;
+    const int num_ready = PollSockets(&descriptor, 1, kTickMilliseconds);
+
+    try {
+      tick_();
+      if (num_ready > 0 && (descriptor.revents & POLLIN)) {
+        const SocketHandle client = accept(listen_socket_, nullptr, nullptr);
+        if (client != kInvalidSocket) {
+          HandleConnection(client);
+          CloseSocket(client);
+        }
+      }
+    } catch (const std::exception& e) {
+      spdlog::warn("metrics server: {}", e.what());
+    }
+  }
+}
+
+void MetricsServer::HandleConnection(SocketHandle client) const {
+  // a stalled client must not block the server for long
+#ifdef _WIN32
+  const DWORD timeout = 1000;
+#else
+  const timeval timeout{1, 0};
+#endif
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < kMaxRequestSize) {
+    const auto received =
+        recv(client, buffer, static_cast<IoSize>(sizeof(buffer)), 0);
+    if (received <= 0) {
+      return;
+    }
+    request.append(buffer, static_cast<size_t>(received));
+  }
+
+  const std::string_view request_line =
+      std::string_view(request).substr(0, request.find("\r\n"));
+  const bool is_get = request_line.starts_with("GET ");
+  const bool is_metrics = request_line.starts_with("GET /metrics ") ||
+                          request_line.starts_with("GET /metrics?");
+
+  std::string body;
+  std::string_view status = "200 OK";
+  if (!is_get) {
+    status = "405 Method Not Allowed";
+  } else if (!is_metrics) {
+    status = "404 Not Found";
+  } else {
+    body = render_();
+  }
+
+  const std::string header = fmt::format(
+      "HTTP/1.1 {}\r\nContent-Type: text/plain; version=0.0.4; "
+      "charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+      status, body.size());
+  if (SendAll(client, header)) {
+    SendAll(client, body);
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "integer.hpp"
+
+// Minimal HTTP server bound to the loopback interface. Serves `GET /metrics`
+// on its own thread, one connection at a time
+class MetricsServer {
+ public:
+  using RenderFunction = std::function<std::string()>;
+  using TickFunction = std::function<void()>;
+
+  // Both functions are called on the server thread: `render` produces the
+  // response body, `tick` is called about ten times per second. Port zero
+  // picks any free port
+  MetricsServer(ui16 port, RenderFunction render, TickFunction tick);
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+  ~MetricsServer();
+
+  [[nodiscard]] ui16 GetPort() const noexcept { return port_; }
+
+ private:
+#ifdef _WIN32
+  using SocketHandle = std::uintptr_t;
+#else
+  using SocketHandle = int;
+#endif
+
+  void Serve();
+  void HandleConnection(SocketHandle client) const;
+
+ private:
+  RenderFunction render_;
+  TickFunction tick_;
+  SocketHandle listen_socket_{};
+  ui16 port_ = 0;
+  std::atomic<bool> stop_ = false;
+  std::thread thread_;
+};
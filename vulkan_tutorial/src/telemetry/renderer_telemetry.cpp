@@ -0,0 +1,168 @@
+#include "telemetry/renderer_telemetry.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string_view>
+
+#include "fmt/format.h"
+#include "physical_device_info.hpp"
+
+namespace {
+// frame samples older than this are not included in percentiles
+constexpr size_t kFrameWindowSize = 1024;
+
+constexpr std::array<std::string_view, 4> kQuantileLabels{"0.5", "0.95",
+                                                           "0.99", "1"};
+
+constexpr std::string_view kFrameTimeFamily = "vulkan_tutorial_frame_time_ms";
+constexpr std::string_view kFrameTimeHelp =
+    "Frame time, quantiles over recent frames, milliseconds";
+}  // namespace
+
+RendererTelemetry::RendererTelemetry(ui16 port,
+                                     const PhysicalDeviceInfo& device_info,
+                                     bool memory_budget_enabled)
+    : physical_device_(device_info.device),
+      memory_budget_enabled_(memory_budget_enabled),
+      num_heaps_(device_info.memory_properties.memoryHeapCount),
+      windows_(kNumFrameMetrics, RollingWindow(kFrameWindowSize)) {
+  using Type = MetricsRegistry::Type;
+
+  for (size_t metric = 0; metric != kNumFrameMetrics; ++metric) {
+    FrameSummary& summary = frame_summaries_[metric];
+    const std::string part = fmt::format(
+        "part=\"{}\"", ToString(static_cast<FrameMetric>(metric)));
+    for (size_t quantile = 0; quantile != kQuantileLabels.size(); ++quantile) {
+      summary.quantiles[quantile] = &registry_.Add(
+          kFrameTimeFamily,
+          fmt::format("{},quantile=\"{}\"", part, kQuantileLabels[quantile]),
+          kFrameTimeHelp, Type::Summary);
+    }
+    summary.sum = &registry_.Add(kFrameTimeFamily, part, kFrameTimeHelp,
+                                 Type::Summary, "_sum");
+    summary.count = &registry_.Add(kFrameTimeFamily, part, kFrameTimeHelp,
+                                   Type::Summary, "_count");
+  }
+
+  frames_total_ = &registry_.Add("vulkan_tutorial_frames_total", "",
+                                 "Rendered frames", Type::Counter);
+  stutters_total_ = &registry_.Add("vulkan_tutorial_stutters_total", "",
+                                   "Frames longer than the stutter threshold",
+                                   Type::Counter);
+  dropped_samples_total_ = &registry_.Add(
+      "vulkan_tutorial_dropped_frame_samples_total", "",
+      "Frame samples not exported because the queue was full", Type::Counter);
+  readback_copies_ = &registry_.Add("vulkan_tutorial_readback_queue_depth",
+                                    "", "Image copies to host in flight");
+  pending_screenshots_ =
+      &registry_.Add("vulkan_tutorial_pending_screenshots", "",
+                     "Screenshots waiting to be written");
+
+  auto add_heap_metrics = [&](std::string_view family, std::string_view help,
+                              std::vector<std::atomic<double>*>& metrics) {
+    for (ui32 heap = 0; heap != num_heaps_; ++heap) {
+      metrics.push_back(
+          &registry_.Add(family, fmt::format("heap=\"{}\"", heap), help));
+    }
+  };
+
+  add_heap_metrics("vulkan_tutorial_memory_heap_size_bytes",
+                   "Size of the memory heap", heap_sizes_);
+  for (ui32 heap = 0; heap != num_heaps_; ++heap) {
+    heap_sizes_[heap]->store(static_cast<double>(
+        device_info.memory_properties.memoryHeaps[heap].size));
+  }
+
+  if (memory_budget_enabled_) {
+    add_heap_metrics("vulkan_tutorial_memory_heap_budget_bytes",
+                     "Memory the process can use from the heap", heap_budgets_);
+    add_heap_metrics("vulkan_tutorial_memory_heap_usage_bytes",
+                     "Memory the process uses from the heap", heap_usages_);
+  }
+
+  server_ = std::make_unique<MetricsServer>(
+      port, [this]() { return Render(); }, [this]() { DrainFrames(); });
+}
+
+void RendererTelemetry::PublishFrame(const FrameStats& frame_stats) noexcept {
+  if (!frames_.TryPush(frame_stats.GetLastFrame())) {
+    dropped_samples_total_->store(static_cast<double>(++num_dropped_frames_),
+                                  std::memory_order_relaxed);
+  }
+
+  frames_total_->store(static_cast<double>(frame_stats.GetNumFrames()),
+                       std::memory_order_relaxed);
+  stutters_total_->store(static_cast<double>(frame_stats.GetNumStutters()),
+                         std::memory_order_relaxed);
+}
+
+void RendererTelemetry::PublishQueues(size_t readback_copies,
+                                      size_t pending_screenshots) noexcept {
+  readback_copies_->store(static_cast<double>(readback_copies),
+                          std::memory_order_relaxed);
+  pending_screenshots_->store(static_cast<double>(pending_screenshots),
+                              std::memory_order_relaxed);
+}
+
+void RendererTelemetry::DrainFrames() {
+  while (std::optional<FrameSample> sample = frames_.TryPop()) {
+    for (size_t metric = 0; metric != kNumFrameMetrics; ++metric) {
+      // gpu time is missing in frames that got no new timestamps
+      const double value = (*sample)[metric];
+      if (std::isnan(value)) {
+        continue;
+      }
+
+      windows_[metric].Push(value);
+      FrameSummary& summary = frame_summaries_[metric];
+      summary.total_ms += value;
+      ++summary.num_samples;
+    }
+  }
+}
+
+std::string RendererTelemetry::Render() {
+  DrainFrames();
+  for (size_t metric = 0; metric != kNumFrameMetrics; ++metric) {
+    const PercentileSummary window = windows_[metric].Summarize();
+    // quantiles of an empty window are unknown
+    std::array values{window.p50, window.p95, window.p99, window.max};
+    if (window.num_samples == 0) {
+      values.fill(std::numeric_limits<double>::quiet_NaN());
+    }
+
+    const FrameSummary& summary = frame_summaries_[metric];
+    for (size_t quantile = 0; quantile != values.size(); ++quantile) {
+      summary.quantiles[quantile]->store(values[quantile],
+                                         std::memory_order_relaxed);
+    }
+    summary.sum->store(summary.total_ms, std::memory_order_relaxed);
+    summary.count->store(static_cast<double>(summary.num_samples),
+                         std::memory_order_relaxed);
+  }
+
+  UpdateMemoryMetrics();
+  return registry_.Format();
+}
+
+void RendererTelemetry::UpdateMemoryMetrics() {
+  if (!memory_budget_enabled_) {
+    return;
+  }
+
+  // physical device queries don't need external synchronization, so it is
+  // safe to call them concurrently with the render loop
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+  budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  VkPhysicalDeviceMemoryProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  properties.pNext = &budget;
+  vkGetPhysicalDeviceMemoryProperties2(physical_device_, &properties);
+
+  for (ui32 heap = 0; heap != num_heaps_; ++heap) {
+    heap_budgets_[heap]->store(static_cast<double>(budget.heapBudget[heap]),
+                               std::memory_order_relaxed);
+    heap_usages_[heap]->store(static_cast<double>(budget.heapUsage[heap]),
+                              std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "integer.hpp"
+#include "profiling/frame_stats.hpp"
+#include "profiling/rolling_window.hpp"
+#include "telemetry/metrics_registry.hpp"
+#include "telemetry/metrics_server.hpp"
+#include "threading/spsc_queue.hpp"
+#include "vulkan/vulkan.h"
+
+class PhysicalDeviceInfo;
+
+// Exports renderer metrics over HTTP. The render loop only pushes frame
+// samples to a lock-free queue and stores atomics, percentiles and memory
+// budget are computed on the server thread
+class RendererTelemetry {
+ public:
+  // memory budget is reported only if VK_EXT_memory_budget is enabled
+  RendererTelemetry(ui16 port, const PhysicalDeviceInfo& device_info,
+                    bool memory_budget_enabled);
+
+  [[nodiscard]] ui16 GetPort() const noexcept { return server_->GetPort(); }
+
+  // render thread only, never blocks
+  void PublishFrame(const FrameStats& frame_stats) noexcept;
+  void PublishQueues(size_t readback_copies,
+                     size_t pending_screenshots) noexcept;
+
+ private:
+  using FrameSample = std::array<double, kNumFrameMetrics>;
+
+  // server thread
+  void DrainFrames();
+  [[nodiscard]] std::string Render();
+  void UpdateMemoryMetrics();
+
+ private:
+  VkPhysicalDevice physical_device_ = nullptr;
+  bool memory_budget_enabled_ = false;
+  ui32 num_heaps_ = 0;
+
+  MetricsRegistry registry_;
+  SpscQueue<FrameSample, 4096> frames_;
+  ui64 num_dropped_frames_ = 0;
+  std::vector<RollingWindow> windows_;
+
+  // summary of a frame metric: p50, p95, p99 and max over the window, sum
+  // and count of every exported sample
+  struct FrameSummary {
+    std::array<std::atomic<double>*, 4> quantiles{};
+    std::atomic<double>* sum = nullptr;
+    std::atomic<double>* count = nullptr;
+    double total_ms = 0.0;
+    ui64 num_samples = 0;
+  };
+  std::array<FrameSummary, kNumFrameMetrics> frame_summaries_{};
+  std::atomic<double>* frames_total_ = nullptr;
+  std::atomic<double>* stutters_total_ = nullptr;
+  std::atomic<double>* dropped_samples_total_ = nullptr;
+  std::atomic<double>* readback_copies_ = nullptr;
+  std::atomic<double>* pending_screenshots_ = nullptr;
+  std::vector<std::atomic<double>*> heap_sizes_;
+  std::vector<std::atomic<double>*> heap_budgets_;
+  std::vector<std::atomic<double>*> heap_usages_;
+
+  // started last, when all metrics are registered
+  std::unique_ptr<MetricsServer> server_;
+};
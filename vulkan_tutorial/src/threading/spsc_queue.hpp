@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Push fails instead of waiting when the queue is full
+template <typename T, size_t kCapacity>
+class SpscQueue {
+  static_assert(kCapacity != 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "capacity must be a power of two");
+
+ public:
+  [[nodiscard]] bool TryPush(const T& value) noexcept {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+      return false;
+    }
+
+    slots_[tail & (kCapacity - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] std::optional<T> TryPop() noexcept {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+
+    T value = slots_[head & (kCapacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+ private:
+  std::array<T, kCapacity> slots_{};
+  // indices only grow, they are on separate cache lines so that producer and
+  // consumer don't invalidate each other
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+template <typename T>
+class Task;
+
+// resumes the coroutine that awaits the finished task
+struct TaskFinalAwaiter {
+  [[nodiscard]] bool await_ready() const noexcept { return false; }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> handle) noexcept {
+    if (handle.promise().continuation) {
+      return handle.promise().continuation;
+    }
+    return std::noop_coroutine();
+  }
+  void await_resume() const noexcept {}
+};
+
+struct TaskPromiseBase {
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  TaskFinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept {
+    exception = std::current_exception();
+  }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr exception;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  Task<T> get_return_object() noexcept;
+  template <typename U>
+  void return_value(U&& result) {
+    value.emplace(std::forward<U>(result));
+  }
+  T TakeResult() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*value);
+  }
+
+  std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object() noexcept;
+  void return_void() const noexcept {}
+  void TakeResult() const {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+// Coroutine that starts when it is awaited and resumes the awaiting one
+// when it finishes, on the same thread. Exceptions are rethrown to the
+// awaiting coroutine. Tasks that nobody awaits are started by TaskScheduler
+template <typename T = void>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = TaskPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() noexcept = default;
+  explicit Task(Handle handle) noexcept : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      Destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { Destroy(); }
+
+  // runs the task until it suspends for the first time
+  void Start() { handle_.resume(); }
+  [[nodiscard]] bool IsDone() const noexcept { return handle_.done(); }
+  // the task has to be done, rethrows its exception
+  T TakeResult() { return handle_.promise().TakeResult(); }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      T await_resume() { return handle.promise().TakeResult(); }
+
+      Handle handle;
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  void Destroy() noexcept {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+ private:
+  Handle handle_;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
@@ -0,0 +1,199 @@
+#include "threading/task_scheduler.hpp"
+
+#include <chrono>
+
+#include "error_handling.hpp"
+#include "spdlog/spdlog.h"
+#include "vulkan_utility.hpp"
+
+namespace {
+// pool work is noticed this late at most while fences are waited for
+constexpr ui64 kFenceWaitTimeout =
+    std::chrono::nanoseconds(std::chrono::milliseconds(1)).count();
+}  // namespace
+
+TaskScheduler::TaskScheduler(ThreadPool& thread_pool, FileReader& file_reader,
+                             VkDevice device)
+    : thread_pool_(&thread_pool),
+      file_reader_(&file_reader),
+      device_(device),
+      state_(std::make_shared<SharedState>()) {}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard lock(state_->mutex);
+    state_->cancelled = true;
+    state_->ready.clear();
+  }
+
+  spawned_.clear();
+}
+
+Task<void> TaskScheduler::WhenAll(std::vector<Task<void>> tasks) {
+  Barrier barrier;
+  std::vector<Task<void>> runners;
+  runners.reserve(tasks.size());
+  for (Task<void>& task : tasks) {
+    runners.push_back(RunAndSignal(std::move(task), barrier));
+  }
+  co_await BarrierAwaiter{barrier, runners};
+}
+
+void TaskScheduler::Spawn(Task<void> task) {
+  spawned_.push_back(std::move(task));
+  spawned_.back().Start();
+}
+
+size_t TaskScheduler::Poll() {
+  std::vector<std::coroutine_handle<>> ready;
+  {
+    std::lock_guard lock(state_->mutex);
+    ready.swap(state_->ready);
+  }
+
+  std::erase_if(fences_, [&](const PendingFence& pending) {
+    const VkResult status = vkGetFenceStatus(device_, pending.fence);
+    if (status == VK_NOT_READY) {
+      return false;
+    }
+    [[unlikely]] if (status != VK_SUCCESS) {
+      VkThrow(vkGetFenceStatus, status);
+    }
+
+    ready.push_back(pending.handle);
+    return true;
+  });
+
+  for (const std::coroutine_handle<> handle : ready) {
+    handle.resume();
+  }
+
+  std::erase_if(spawned_, [](Task<void>& task) {
+    if (!task.IsDone()) {
+      return false;
+    }
+
+    try {
+      task.TakeResult();
+    } catch (const std::exception& e) {
+      spdlog::error("task failed: {}", e.what());
+    }
+    return true;
+  });
+
+  return ready.size();
+}
+
+void TaskScheduler::FileAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  contents.resize(paths.size());
+  remaining = paths.size();
+
+  std::vector<FileReader::Request> requests;
+  requests.reserve(paths.size());
+  for (size_t i = 0; i != paths.size(); ++i) {
+    requests.push_back(
+        {paths[i], [this, i, handle, state = scheduler->state_](
+                       FileBuffer data, std::exception_ptr read_error) {
+           // the awaiting coroutine is destroyed when cancelled
+           std::lock_guard lock(state->mutex);
+           if (state->cancelled) {
+             return;
+           }
+
+           contents[i] = std::move(data);
+           if (read_error && !error) {
+             error = read_error;
+           }
+           if (--remaining == 0) {
+             state->ready.push_back(handle);
+             state->has_ready.notify_one();
+           }
+         }});
+  }
+  scheduler->file_reader_->Submit(std::move(requests));
+}
+
+std::vector<FileBuffer> TaskScheduler::FileAwaiter::await_resume() {
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return std::move(contents);
+}
+
+bool TaskScheduler::FenceAwaiter::await_ready() const {
+  return vkGetFenceStatus(scheduler->device_, fence) == VK_SUCCESS;
+}
+
+void TaskScheduler::FenceAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  scheduler->fences_.push_back({fence, handle});
+}
+
+bool TaskScheduler::BarrierAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  // one extra count, so tasks that finish right away don't schedule the
+  // awaiting coroutine before it is suspended
+  barrier.awaiting = handle;
+  barrier.remaining = tasks.size() + 1;
+  for (Task<void>& task : tasks) {
+    task.Start();
+  }
+  return --barrier.remaining != 0;
+}
+
+void TaskScheduler::BarrierAwaiter::await_resume() const {
+  if (barrier.exception) {
+    std::rethrow_exception(barrier.exception);
+  }
+}
+
+Task<void> TaskScheduler::RunAndSignal(Task<void> task, Barrier& barrier) {
+  std::exception_ptr exception;
+  try {
+    co_await std::move(task);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  Signal(barrier, exception);
+}
+
+void TaskScheduler::Signal(Barrier& barrier, std::exception_ptr exception) {
+  if (exception && !barrier.exception) {
+    barrier.exception = exception;
+  }
+  // the awaiting coroutine destroys this task, so it is resumed later
+  if (--barrier.remaining == 0) {
+    Schedule(barrier.awaiting);
+  }
+}
+
+void TaskScheduler::Schedule(std::coroutine_handle<> handle) {
+  std::lock_guard lock(state_->mutex);
+  state_->ready.push_back(handle);
+}
+
+void TaskScheduler::Wait() {
+  std::vector<VkFence> fences;
+  {
+    std::unique_lock lock(state_->mutex);
+    if (fences_.empty()) {
+      state_->has_ready.wait(lock, [&]() { return !state_->ready.empty(); });
+      return;
+    }
+    if (!state_->ready.empty()) {
+      return;
+    }
+  }
+
+  fences.reserve(fences_.size());
+  for (const PendingFence& pending : fences_) {
+    fences.push_back(pending.fence);
+  }
+  const VkResult result =
+      vkWaitForFences(device_, static_cast<ui32>(fences.size()), fences.data(),
+                      kVkFalse, kFenceWaitTimeout);
+  [[unlikely]] if (result != VK_SUCCESS && result != VK_TIMEOUT) {
+    VkThrow(vkWaitForFences, result);
+  }
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "integer.hpp"
+#include "io/file_reader.hpp"
+#include "threading/task.hpp"
+#include "threading/thread_pool.hpp"
+#include "vulkan/vulkan.h"
+
+// Runs coroutines on the thread that polls it, the main thread of the
+// application, so they may use Vulkan objects without locks. CPU work is
+// awaited on the thread pool, file reads on the file reader and GPU work
+// through fences, so thousands of loads can be in flight with the threads of
+// the pool only
+class TaskScheduler {
+ public:
+  TaskScheduler(ThreadPool& thread_pool, FileReader& file_reader,
+                VkDevice device);
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+  // Destroys spawned tasks that did not finish. Work in flight finishes on
+  // the pool and its result is dropped
+  ~TaskScheduler();
+
+  // runs `work` on the thread pool, the awaiting coroutine gets its result
+  // or exception
+  template <typename Work>
+  [[nodiscard]] auto Run(Work work) {
+    return WorkAwaiter<Work>(*this, std::move(work));
+  }
+
+  // whole file read by the file reader
+  [[nodiscard]] auto ReadFile(std::filesystem::path path) {
+    std::vector<std::filesystem::path> paths;
+    paths.push_back(std::move(path));
+    return SingleFileAwaiter(*this, std::move(paths));
+  }
+
+  // files are submitted as one batch, contents are in the order of paths.
+  // The first error is rethrown when all reads finished
+  [[nodiscard]] auto ReadFiles(std::vector<std::filesystem::path> paths) {
+    return FileAwaiter(*this, std::move(paths));
+  }
+
+  // the awaiting coroutine resumes when the fence is signaled
+  [[nodiscard]] auto WaitFence(VkFence fence) {
+    return FenceAwaiter{this, fence};
+  }
+
+  // runs tasks concurrently, rethrows the first exception when all finished
+  [[nodiscard]] Task<void> WhenAll(std::vector<Task<void>> tasks);
+  template <typename T>
+  [[nodiscard]] Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks);
+
+  // starts the task and keeps it until it finishes, errors are logged
+  void Spawn(Task<void> task);
+
+  // resumes coroutines whose work finished, returns how many
+  size_t Poll();
+
+  // polls until the task finishes, blocks while nothing can be resumed
+  template <typename T>
+  T RunUntilDone(Task<T> task) {
+    task.Start();
+    while (!task.IsDone()) {
+      Wait();
+      Poll();
+    }
+    return task.TakeResult();
+  }
+
+  [[nodiscard]] size_t GetNumSpawned() const noexcept {
+    return spawned_.size();
+  }
+
+ private:
+  // shared with work on the pool, which may finish after the scheduler is
+  // destroyed
+  struct SharedState {
+    std::mutex mutex;
+    std::condition_variable has_ready;
+    std::vector<std::coroutine_handle<>> ready;
+    bool cancelled = false;
+  };
+
+  template <typename Work>
+  class WorkAwaiter {
+   public:
+    using Result = std::invoke_result_t<Work&>;
+
+    WorkAwaiter(TaskScheduler& scheduler, Work work)
+        : scheduler_(&scheduler), work_(std::move(work)) {}
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      // std::function of the pool needs a copyable callable
+      scheduler_->thread_pool_->Post(
+          [this, handle, state = scheduler_->state_,
+           work = std::make_shared<Work>(std::move(work_))]() {
+            Outcome outcome;
+            try {
+              if constexpr (std::is_void_v<Result>) {
+                (*work)();
+              } else {
+                outcome.template emplace<1>((*work)());
+              }
+            } catch (...) {
+              outcome.template emplace<2>(std::current_exception());
+            }
+
+            // the awaiting coroutine is destroyed when cancelled
+            std::lock_guard lock(state->mutex);
+            if (!state->cancelled) {
+              outcome_ = std::move(outcome);
+              state->ready.push_back(handle);
+              state->has_ready.notify_one();
+            }
+          });
+    }
+    Result await_resume() {
+      if (outcome_.index() == 2) {
+        std::rethrow_exception(std::get<2>(outcome_));
+      }
+      if constexpr (!std::is_void_v<Result>) {
+        return std::move(std::get<1>(outcome_));
+      }
+    }
+
+   private:
+    using Value =
+        std::conditional_t<std::is_void_v<Result>, std::monostate, Result>;
+    using Outcome = std::variant<std::monostate, Value, std::exception_ptr>;
+
+    TaskScheduler* scheduler_;
+    Work work_;
+    Outcome outcome_;
+  };
+
+  // completions of the reader only touch the awaiter while not cancelled
+  struct FileAwaiter {
+    FileAwaiter(TaskScheduler& owner, std::vector<std::filesystem::path> files)
+        : scheduler(&owner), paths(std::move(files)) {}
+
+    [[nodiscard]] bool await_ready() const noexcept { return paths.empty(); }
+    void await_suspend(std::coroutine_handle<> handle);
+    std::vector<FileBuffer> await_resume();
+
+    TaskScheduler* scheduler;
+    std::vector<std::filesystem::path> paths;
+    std::vector<FileBuffer> contents;
+    size_t remaining = 0;
+    std::exception_ptr error;
+  };
+
+  struct SingleFileAwaiter : FileAwaiter {
+    using FileAwaiter::FileAwaiter;
+
+    FileBuffer await_resume() {
+      return std::move(FileAwaiter::await_resume().front());
+    }
+  };
+
+  struct FenceAwaiter {
+    [[nodiscard]] bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+
+    TaskScheduler* scheduler;
+    VkFence fence;
+  };
+
+  struct PendingFence {
+    VkFence fence = nullptr;
+    std::coroutine_handle<> handle;
+  };
+
+  // tasks of WhenAll that did not finish, the last one schedules the
+  // awaiting coroutine
+  struct Barrier {
+    size_t remaining = 0;
+    std::coroutine_handle<> awaiting;
+    std::exception_ptr exception;
+  };
+
+  struct BarrierAwaiter {
+    [[nodiscard]] bool await_ready() const noexcept { return tasks.empty(); }
+    bool await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const;
+
+    Barrier& barrier;
+    std::vector<Task<void>>& tasks;
+  };
+
+  // runs one task of WhenAll
+  [[nodiscard]] Task<void> RunAndSignal(Task<void> task, Barrier& barrier);
+  template <typename T>
+  [[nodiscard]] Task<void> RunAndStore(Task<T> task, std::optional<T>& result,
+                                       Barrier& barrier) {
+    std::exception_ptr exception;
+    try {
+      result.emplace(co_await std::move(task));
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    Signal(barrier, exception);
+  }
+  void Signal(Barrier& barrier, std::exception_ptr exception);
+  // resumed by the next Poll
+  void Schedule(std::coroutine_handle<> handle);
+  // blocks until a coroutine can be resumed
+  void Wait();
+
+ private:
+  ThreadPool* thread_pool_;
+  FileReader* file_reader_;
+  VkDevice device_;
+  std::shared_ptr<SharedState> state_;
+  std::vector<PendingFence> fences_;
+  std::vector<Task<void>> spawned_;
+};
+
+template <typename T>
+Task<std::vector<T>> TaskScheduler::WhenAll(std::vector<Task<T>> tasks) {
+  Barrier barrier;
+  std::vector<std::optional<T>> results(tasks.size());
+  std::vector<Task<void>> runners;
+  runners.reserve(tasks.size());
+  for (size_t i = 0; i != tasks.size(); ++i) {
+    runners.push_back(RunAndStore(std::move(tasks[i]), results[i], barrier));
+  }
+  co_await BarrierAwaiter{barrier, runners};
+
+  std::vector<T> values;
+  values.reserve(results.size());
+  for (std::optional<T>& result : results) {
+    values.push_back(std::move(*result));
+  }
+  co_return values;
+}
@@ -0,0 +1,54 @@
+#include "threading/thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  if (num_threads == 0) {
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(hardware_threads, 2) - 1;
+  }
+
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+
+  has_tasks_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Push(std::function<void()> task) {
+  {
+    std::lock_guard lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+
+  has_tasks_.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      has_tasks_.wait(lock, [&]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+ public:
+  // zero means one thread per hardware thread except the main one
+  explicit ThreadPool(size_t num_threads = 0);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  // runs all queued tasks before joining threads
+  ~ThreadPool();
+
+  // exceptions thrown by the task are delivered through the future
+  template <typename Task>
+  auto Enqueue(Task&& task) -> std::future<std::invoke_result_t<Task>> {
+    using Result = std::invoke_result_t<Task>;
+    // std::function requires copyable callable
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Task>(task));
+    std::future<Result> result = packaged->get_future();
+    Push([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+  // cheaper than Enqueue when the task delivers its result itself, the task
+  // must not throw
+  void Post(std::function<void()> task) { Push(std::move(task)); }
+
+  [[nodiscard]] size_t GetNumThreads() const noexcept {
+    return threads_.size();
+  }
+
+ private:
+  void Push(std::function<void()> task);
+  void WorkerLoop();
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+  bool stopping_ = false;
+};
@@ -0,0 +1,236 @@
+#include "trace/trace_file.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "fmt/format.h"
+#include "read_file.hpp"
+#include "spdlog/spdlog.h"
+
+namespace {
+constexpr std::array<char, 4> kMagic{'V', 'K', 'T', 'R'};
+constexpr ui32 kVersion = 1;
+
+template <typename T>
+void Append(std::vector<ui8>& out, const T& value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  const auto bytes = reinterpret_cast<const ui8*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void AppendBytes(std::vector<ui8>& out, std::span<const ui8> bytes) {
+  Append(out, static_cast<ui64>(bytes.size()));
+  out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+// reads values from a chunk payload and throws when it is too short
+class PayloadReader {
+ public:
+  PayloadReader(std::span<const ui8> payload, const std::filesystem::path& path)
+      : payload_(payload), path_(&path) {}
+
+  template <typename T>
+  [[nodiscard]] T Read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T value;
+    std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+
+  // reads the number of elements of an array that follows, the elements
+  // have to fit into the rest of the payload
+  template <typename T>
+  [[nodiscard]] size_t ReadCount() {
+    const ui64 count = Read<ui64>();
+    [[unlikely]] if (count > GetRemaining() / sizeof(T)) {
+      throw std::runtime_error(fmt::format(
+          "array of {} elements of {} bytes exceeds the chunk of {} bytes in "
+          "trace {}",
+          count, sizeof(T), GetRemaining(), path_->string()));
+    }
+
+    return static_cast<size_t>(count);
+  }
+
+  [[nodiscard]] std::span<const ui8> ReadBytes() {
+    return Take(ReadCount<ui8>());
+  }
+
+  [[nodiscard]] size_t GetRemaining() const noexcept {
+    return payload_.size();
+  }
+
+  [[nodiscard]] std::span<const ui8> Take(size_t size) {
+    [[unlikely]] if (size > payload_.size()) {
+      throw std::runtime_error(
+          fmt::format("truncated chunk in trace {}", path_->string()));
+    }
+
+    const std::span<const ui8> bytes = payload_.first(size);
+    payload_ = payload_.subspan(size);
+    return bytes;
+  }
+
+ private:
+  std::span<const ui8> payload_;
+  const std::filesystem::path* path_;
+};
+}  // namespace
+
+TraceWriter::TraceWriter(const std::filesystem::path& path)
+    : path_(path), file_(path, std::ios::binary) {
+  [[unlikely]] if (!file_.is_open()) {
+    throw std::runtime_error(
+        fmt::format("failed to open file {}", path.string()));
+  }
+
+  file_.write(kMagic.data(), kMagic.size());
+  file_.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+}
+
+void TraceWriter::WriteTexture(ui32 width, ui32 height, VkFormat format,
+                               std::span<const ui8> pixels) {
+  payload_.clear();
+  Append(payload_, width);
+  Append(payload_, height);
+  Append(payload_, format);
+  AppendBytes(payload_, pixels);
+  WriteChunk(TraceChunk::Texture, payload_);
+}
+
+void TraceWriter::WriteVertices(ui32 stride, std::span<const ui8> vertices) {
+  payload_.clear();
+  Append(payload_, stride);
+  AppendBytes(payload_, vertices);
+  WriteChunk(TraceChunk::Vertices, payload_);
+}
+
+void TraceWriter::WriteIndices(std::span<const ui32> indices) {
+  payload_.clear();
+  AppendBytes(payload_,
+              std::span(reinterpret_cast<const ui8*>(indices.data()),
+                        indices.size_bytes()));
+  WriteChunk(TraceChunk::Indices, payload_);
+}
+
+void TraceWriter::WriteCommands(const TracedCommands& commands) {
+  payload_.clear();
+  Append(payload_, commands.extent);
+  Append(payload_, static_cast<ui64>(commands.draws.size()));
+  for (const TracedDraw& draw : commands.draws) {
+    Append(payload_, draw);
+  }
+  WriteChunk(TraceChunk::Commands, payload_);
+}
+
+void TraceWriter::WriteFrame(std::span<const ui8> uniforms) {
+  payload_.clear();
+  AppendBytes(payload_, uniforms);
+  WriteChunk(TraceChunk::Frame, payload_);
+  ++num_frames_;
+}
+
+void TraceWriter::WriteChunk(TraceChunk type, std::span<const ui8> payload) {
+  const ui64 size = payload.size();
+  file_.write(reinterpret_cast<const char*>(&type), sizeof(type));
+  file_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  file_.write(reinterpret_cast<const char*>(payload.data()),
+              static_cast<std::streamsize>(size));
+  file_.flush();
+  [[unlikely]] if (!file_) {
+    throw std::runtime_error(
+        fmt::format("failed to write trace {}", path_.string()));
+  }
+}
+
+Trace ReadTrace(const std::filesystem::path& path) {
+  std::vector<char> buffer;
+  ReadFile(path, buffer);
+  PayloadReader file(
+      std::span(reinterpret_cast<const ui8*>(buffer.data()), buffer.size()),
+      path);
+
+  const auto magic = file.Read<std::array<char, 4>>();
+  const auto version = file.Read<ui32>();
+  [[unlikely]] if (magic != kMagic || version != kVersion) {
+    throw std::runtime_error(fmt::format(
+        "{} is not a trace of version {}", path.string(), kVersion));
+  }
+
+  Trace trace;
+  bool has_commands = false;
+  constexpr size_t kChunkHeaderSize = sizeof(TraceChunk) + sizeof(ui64);
+  while (file.GetRemaining() != 0) {
+    // the last chunk may be incomplete when the application was killed
+    if (file.GetRemaining() < kChunkHeaderSize) {
+      spdlog::warn("trace {} is truncated", path.string());
+      break;
+    }
+
+    const auto type = file.Read<TraceChunk>();
+    const auto size = file.Read<ui64>();
+    if (size > file.GetRemaining()) {
+      spdlog::warn("trace {} is truncated", path.string());
+      break;
+    }
+
+    PayloadReader chunk(file.Take(size), path);
+    switch (type) {
+      case TraceChunk::Texture: {
+        TracedTexture& texture = trace.textures.emplace_back();
+        texture.width = chunk.Read<ui32>();
+        texture.height = chunk.Read<ui32>();
+        texture.format = chunk.Read<VkFormat>();
+        const std::span<const ui8> pixels = chunk.ReadBytes();
+        texture.pixels.assign(pixels.begin(), pixels.end());
+      } break;
+
+      case TraceChunk::Vertices: {
+        trace.vertex_stride = chunk.Read<ui32>();
+        const std::span<const ui8> vertices = chunk.ReadBytes();
+        trace.vertices.assign(vertices.begin(), vertices.end());
+      } break;
+
+      case TraceChunk::Indices: {
+        const std::span<const ui8> indices = chunk.ReadBytes();
+        [[unlikely]] if (indices.size() % sizeof(ui32) != 0) {
+          throw std::runtime_error(
+              fmt::format("indices of {} bytes are not whole in trace {}",
+                          indices.size(), path.string()));
+        }
+        trace.indices.resize(indices.size() / sizeof(ui32));
+        std::memcpy(trace.indices.data(), indices.data(),
+                    trace.indices.size() * sizeof(ui32));
+      } break;
+
+      case TraceChunk::Commands:
+        if (has_commands) {
+          spdlog::warn("commands were recorded again, window was resized");
+          break;
+        }
+        has_commands = true;
+        trace.commands.extent = chunk.Read<VkExtent2D>();
+        trace.commands.draws.resize(chunk.ReadCount<TracedDraw>());
+        for (TracedDraw& draw : trace.commands.draws) {
+          draw = chunk.Read<TracedDraw>();
+        }
+        break;
+
+      case TraceChunk::Frame: {
+        const std::span<const ui8> uniforms = chunk.ReadBytes();
+        trace.frames.emplace_back().uniforms.assign(uniforms.begin(),
+                                                    uniforms.end());
+      } break;
+
+      default:
+        // chunks of newer versions
+        spdlog::warn("unknown chunk {} in trace {}", static_cast<ui32>(type),
+                     path.string());
+        break;
+    }
+  }
+
+  return trace;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+#include "integer.hpp"
+#include "vulkan/vulkan.h"
+
+// Trace file is a header followed by chunks in the order the application
+// issued them. A chunk is its type, payload size and payload. Values are
+// stored in host byte order, so traces are portable between little endian
+// machines only
+
+enum class TraceChunk : ui32 {
+  Texture = 1,
+  Vertices = 2,
+  Indices = 3,
+  Commands = 4,
+  Frame = 5
+};
+
+struct TracedTexture {
+  ui32 width = 0;
+  ui32 height = 0;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  std::vector<ui8> pixels;
+};
+
+struct TracedDraw {
+  ui32 index_count = 0;
+  ui32 instance_count = 1;
+  ui32 first_index = 0;
+  i32 vertex_offset = 0;
+};
+
+// what the command buffers do, recorded when they are (re)created
+struct TracedCommands {
+  VkExtent2D extent{};
+  std::vector<TracedDraw> draws;
+};
+
+struct TracedFrame {
+  // contents of the uniform buffer for this frame
+  std::vector<ui8> uniforms;
+};
+
+struct Trace {
+  std::vector<TracedTexture> textures;
+  ui32 vertex_stride = 0;
+  std::vector<ui8> vertices;
+  std::vector<ui32> indices;
+  // the first recording, replay does not resize the window
+  TracedCommands commands;
+  std::vector<TracedFrame> frames;
+};
+
+// Writes chunks as soon as they are issued so a trace of a crashed run is
+// still readable up to the last complete chunk
+class TraceWriter {
+ public:
+  explicit TraceWriter(const std::filesystem::path& path);
+
+  void WriteTexture(ui32 width, ui32 height, VkFormat format,
+                    std::span<const ui8> pixels);
+  void WriteVertices(ui32 stride, std::span<const ui8> vertices);
+  void WriteIndices(std::span<const ui32> indices);
+  void WriteCommands(const TracedCommands& commands);
+  void WriteFrame(std::span<const ui8> uniforms);
+
+  [[nodiscard]] ui64 GetNumFrames() const noexcept { return num_frames_; }
+
+ private:
+  void WriteChunk(TraceChunk type, std::span<const ui8> payload);
+
+ private:
+  std::filesystem::path path_;
+  std::ofstream file_;
+  std::vector<ui8> payload_;
+  ui64 num_frames_ = 0;
+};
+
+[[nodiscard]] Trace ReadTrace(const std::filesystem::path& path);
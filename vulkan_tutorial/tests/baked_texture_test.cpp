@@ -0,0 +1,126 @@
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assets/baked_texture.hpp"
+#include "assets/texture_format.hpp"
+#include "fmt/format.h"
+#include "process_id.hpp"
+#include "test_check.hpp"
+
+namespace {
+constexpr ui32 kWidth = 5;
+constexpr ui32 kHeight = 3;
+
+class BakedTextureTest {
+ public:
+  BakedTextureTest()
+      : dir_(std::filesystem::temp_directory_path() /
+             fmt::format("vulkan_tutorial_baked_texture_test_{}",
+                         GetCurrentPid())) {
+    std::filesystem::create_directories(dir_);
+  }
+  BakedTextureTest(const BakedTextureTest&) = delete;
+  BakedTextureTest& operator=(const BakedTextureTest&) = delete;
+  ~BakedTextureTest() {
+    std::error_code error;
+    std::filesystem::remove_all(dir_, error);
+  }
+
+  [[nodiscard]] std::filesystem::path Write(
+      VkFormat format, const std::vector<TextureMip>& mips) const {
+    const TextureMip& last = mips.back();
+    std::vector<ui8> levels(last.offset + last.size);
+    for (size_t i = 0; i != levels.size(); ++i) {
+      levels[i] = static_cast<ui8>(i);
+    }
+
+    const std::filesystem::path path = dir_ / "texture.tex";
+    BakedTexture::Write(path, format, mips, levels);
+    return path;
+  }
+
+  // whether reading fails with a message that contains `error`
+  [[nodiscard]] bool Fails(VkFormat format,
+                           const std::vector<TextureMip>& mips,
+                           std::string_view error) const {
+    std::string message;
+    try {
+      const BakedTexture texture(Write(format, mips));
+    } catch (const std::exception& e) {
+      message = e.what();
+    }
+    if (message.empty() || message.find(error) == std::string::npos) {
+      spdlog::error("expected error '{}', got '{}'", error, message);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::filesystem::path dir_;
+};
+
+void TestFormats(const BakedTextureTest& test) {
+  // every format the baker writes is read back with its layout
+  for (const ui32 channels : {1u, 2u, 3u, 4u}) {
+    for (const PixelComponent component :
+         {PixelComponent::kUnorm8, PixelComponent::kUnorm16,
+          PixelComponent::kFloat16, PixelComponent::kFloat32}) {
+      const TextureFormat format = GetTextureFormat({channels, component});
+      const std::vector<TextureMip> mips =
+          GetMipChainLayout(kWidth, kHeight, GetPixelSize(format.layout));
+      const BakedTexture texture(test.Write(format.format, mips));
+      TEST_CHECK(texture.GetFormat() == format.format);
+      TEST_CHECK(texture.GetLayout() == format.layout);
+      TEST_CHECK(texture.GetWidth() == kWidth);
+      TEST_CHECK(texture.GetHeight() == kHeight);
+      TEST_CHECK(texture.GetMips().size() == mips.size());
+      TEST_CHECK(texture.GetLevelsSize() ==
+                 mips.back().offset + mips.back().size);
+    }
+  }
+
+  const std::vector<TextureMip> mips = GetMipChainLayout(kWidth, kHeight, 4);
+  TEST_CHECK(test.Fails(VK_FORMAT_UNDEFINED, mips, "unknown format"));
+  TEST_CHECK(test.Fails(VK_FORMAT_D32_SFLOAT, mips, "unknown format"));
+}
+
+void TestMipSizes(const BakedTextureTest& test) {
+  const TextureFormat format = GetTextureFormat({});
+  const size_t pixel_size = GetPixelSize(format.layout);
+
+  // a level that is smaller or larger than its texels, the levels still
+  // cover every mip, so only the size check catches it
+  for (const i64 delta : {i64{-1}, i64{1}, -static_cast<i64>(pixel_size)}) {
+    std::vector<TextureMip> mips =
+        GetMipChainLayout(kWidth, kHeight, pixel_size);
+    mips.front().size = static_cast<ui64>(
+        static_cast<i64>(mips.front().size) + delta);
+    TEST_CHECK(test.Fails(format.format, mips, "mip of"));
+  }
+
+  // width times height times the pixel size wraps around to zero
+  std::vector<TextureMip> overflow =
+      GetMipChainLayout(kWidth, kHeight, pixel_size);
+  overflow.back().width = 1u << 31;
+  overflow.back().height = 1u << 31;
+  overflow.back().size = 0;
+  TEST_CHECK(test.Fails(format.format, overflow, "mip of"));
+
+  std::vector<TextureMip> empty =
+      GetMipChainLayout(kWidth, kHeight, pixel_size);
+  empty.back().width = 0;
+  empty.back().size = 0;
+  TEST_CHECK(test.Fails(format.format, empty, "mip of"));
+}
+}  // namespace
+
+int main() {
+  const BakedTextureTest test;
+  TestFormats(test);
+  TestMipSizes(test);
+  return GetTestResult();
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <vector>
+
+#include "pipeline/descriptor_allocator.hpp"
+#include "test_check.hpp"
+
+namespace {
+// more sets than the first pools of a chain hold
+constexpr ui32 kNumSets = 100;
+constexpr VkDeviceSize kBufferSize = 256;
+
+// device of the first physical device, the allocator needs no queues or
+// window system
+class TestDevice {
+ public:
+  TestDevice() = default;
+  TestDevice(const TestDevice&) = delete;
+  TestDevice& operator=(const TestDevice&) = delete;
+  ~TestDevice() {
+    if (device_) {
+      for (size_t i = 0; i != buffers_.size(); ++i) {
+        vkDestroyBuffer(device_, buffers_[i], nullptr);
+        vkFreeMemory(device_, memory_[i], nullptr);
+      }
+      vkDestroyDevice(device_, nullptr);
+    }
+    if (instance_) {
+      vkDestroyInstance(instance_, nullptr);
+    }
+  }
+
+  // false when there is no Vulkan driver or device
+  [[nodiscard]] bool Create() {
+    // vkEnumerateInstanceVersion does not exist in Vulkan 1.0 loaders
+    auto enumerate_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    ui32 instance_version = VK_API_VERSION_1_0;
+    if (enumerate_version == nullptr ||
+        enumerate_version(&instance_version) != VK_SUCCESS) {
+      instance_version = VK_API_VERSION_1_0;
+    }
+    instance_version = std::min(instance_version, VK_API_VERSION_1_1);
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.apiVersion = instance_version;
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+    if (vkCreateInstance(&instance_info, nullptr, &instance_) != VK_SUCCESS) {
+      instance_ = nullptr;
+      return false;
+    }
+
+    ui32 num_devices = 1;
+    VkPhysicalDevice physical_device = nullptr;
+    const VkResult result =
+        vkEnumeratePhysicalDevices(instance_, &num_devices, &physical_device);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) ||
+        num_devices == 0) {
+      return false;
+    }
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    update_templates_ = instance_version >= VK_API_VERSION_1_1 &&
+                        properties.apiVersion >= VK_API_VERSION_1_1;
+
+    // a device needs one queue even if nothing is submitted
+    const float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    if (vkCreateDevice(physical_device, &device_info, nullptr, &device_) !=
+        VK_SUCCESS) {
+      device_ = nullptr;
+      return false;
+    }
+
+    // descriptors are written with buffers that are bound to memory
+    for (size_t i = 0; i != buffers_.size(); ++i) {
+      VkBufferCreateInfo buffer_info{};
+      buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      buffer_info.size = kBufferSize;
+      buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+      buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      if (vkCreateBuffer(device_, &buffer_info, nullptr, &buffers_[i]) !=
+          VK_SUCCESS) {
+        return false;
+      }
+
+      VkMemoryRequirements requirements{};
+      vkGetBufferMemoryRequirements(device_, buffers_[i], &requirements);
+      VkMemoryAllocateInfo alloc_info{};
+      alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+      alloc_info.allocationSize = requirements.size;
+      alloc_info.memoryTypeIndex = static_cast<ui32>(
+          std::countr_zero(requirements.memoryTypeBits));
+      if (vkAllocateMemory(device_, &alloc_info, nullptr, &memory_[i]) !=
+              VK_SUCCESS ||
+          vkBindBufferMemory(device_, buffers_[i], memory_[i], 0) !=
+              VK_SUCCESS) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  [[nodiscard]] VkDevice GetDevice() const noexcept { return device_; }
+  [[nodiscard]] bool HasUpdateTemplates() const noexcept {
+    return update_templates_;
+  }
+  [[nodiscard]] const std::array<VkBuffer, 2>& GetBuffers() const noexcept {
+    return buffers_;
+  }
+
+ private:
+  VkInstance instance_ = nullptr;
+  VkDevice device_ = nullptr;
+  bool update_templates_ = false;
+  std::array<VkBuffer, 2> buffers_{};
+  std::array<VkDeviceMemory, 2> memory_{};
+};
+
+[[nodiscard]] bool Contains(const std::vector<VkDescriptorSet>& sets,
+                            VkDescriptorSet set) {
+  return std::ranges::find(sets, set) != sets.end();
+}
+
+void TestAllocator(const TestDevice& device, bool update_templates) {
+  spdlog::info("update templates {}", update_templates);
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  for (ui32 i = 0; i != bindings.size(); ++i) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  }
+  DescriptorAllocator allocator(device.GetDevice(), bindings,
+                                update_templates);
+
+  // the first buffer is bound by every set, ranges of the second one make
+  // the resources different
+  const VkBuffer first = device.GetBuffers()[0];
+  const VkBuffer second = device.GetBuffers()[1];
+  auto get_set = [&](VkBuffer buffer, VkDeviceSize range) {
+    const std::array resources{MakeBufferDescriptor(first, 0, kBufferSize),
+                               MakeBufferDescriptor(buffer, 0, range)};
+    return allocator.GetPersistentSet(resources);
+  };
+
+  // pools are added when the previous ones are full
+  std::vector<VkDescriptorSet> sets;
+  for (ui32 i = 0; i != kNumSets; ++i) {
+    sets.push_back(get_set(first, i + 1));
+  }
+  std::vector<VkDescriptorSet> unique_sets = sets;
+  std::ranges::sort(unique_sets);
+  TEST_CHECK(std::ranges::unique(unique_sets).empty());
+  TEST_CHECK(!Contains(sets, nullptr));
+  TEST_CHECK(allocator.GetNumWrites() == kNumSets);
+
+  // the same resources get the cached set without a write
+  TEST_CHECK(get_set(first, 1) == sets.front());
+  TEST_CHECK(get_set(first, kNumSets) == sets.back());
+  TEST_CHECK(allocator.GetNumWrites() == kNumSets);
+
+  // a released set is written again for the next resources, sets that
+  // don't bind the released buffer stay cached
+  const VkDescriptorSet released = get_set(second, 1);
+  TEST_CHECK(!Contains(sets, released));
+  allocator.ReleaseSetsUsing(second);
+  TEST_CHECK(get_set(second, 2) == released);
+  TEST_CHECK(allocator.GetNumWrites() == kNumSets + 2);
+  TEST_CHECK(get_set(first, 1) == sets.front());
+  TEST_CHECK(allocator.GetNumWrites() == kNumSets + 2);
+
+  // the buffer of the first binding releases every set
+  allocator.ReleaseSetsUsing(first);
+  const VkDescriptorSet reused = get_set(second, 1);
+  TEST_CHECK(reused == released || Contains(sets, reused));
+  TEST_CHECK(allocator.GetNumWrites() == kNumSets + 3);
+}
+}  // namespace
+
+int main() {
+  TestDevice device;
+  if (!device.Create()) {
+    spdlog::warn("there is no Vulkan device, the test is skipped");
+    return kSkipTestResult;
+  }
+
+  TestAllocator(device, false);
+  if (device.HasUpdateTemplates()) {
+    TestAllocator(device, true);
+  }
+  return GetTestResult();
+}
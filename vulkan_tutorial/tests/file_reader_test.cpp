@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "io/file_reader.hpp"
+#include "process_id.hpp"
+#include "test_check.hpp"
+#include "threading/thread_pool.hpp"
+
+namespace {
+// a reader that never completes a request fails the test instead of hanging
+constexpr auto kReadTimeout = std::chrono::seconds(10);
+
+struct ReadResult {
+  FileBuffer data;
+  bool failed = false;
+};
+
+// reads all files in one batch, results are in the order of paths
+std::vector<ReadResult> ReadFiles(
+    FileReader& reader, const std::vector<std::filesystem::path>& paths) {
+  std::vector<std::promise<ReadResult>> promises(paths.size());
+  std::vector<FileReader::Request> requests;
+  for (size_t i = 0; i != paths.size(); ++i) {
+    requests.push_back(
+        {paths[i], [&promise = promises[i]](FileBuffer data,
+                                            std::exception_ptr error) {
+           promise.set_value({std::move(data), error != nullptr});
+         }});
+  }
+  reader.Submit(std::move(requests));
+
+  std::vector<ReadResult> results;
+  for (std::promise<ReadResult>& promise : promises) {
+    std::future<ReadResult> result = promise.get_future();
+    if (result.wait_for(kReadTimeout) != std::future_status::ready) {
+      spdlog::error("file read did not complete in {} s",
+                    kReadTimeout.count());
+      // the reader can't be destroyed while it waits for the read
+      std::_Exit(1);
+    }
+    results.push_back(result.get());
+  }
+
+  return results;
+}
+
+[[nodiscard]] char GetByte(size_t index) noexcept {
+  return static_cast<char>(index * 7 + index / 251);
+}
+
+[[nodiscard]] bool HasContents(const FileBuffer& data, size_t size) {
+  if (data.size() != size) {
+    return false;
+  }
+
+  for (size_t i = 0; i != size; ++i) {
+    if (data[i] != GetByte(i)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void TestReader(const std::filesystem::path& dir, bool io_uring, bool direct,
+                size_t large_size) {
+  spdlog::info("io_uring {}, direct {}", io_uring, direct);
+  ThreadPool thread_pool(2);
+  FileReaderSettings settings;
+  settings.io_uring = io_uring;
+  settings.direct = direct;
+  // a few chunks are in flight, the rest waits for free slots
+  settings.chunk_size = 1 << 16;
+  settings.queue_depth = 4;
+  FileReader reader(thread_pool, settings);
+  if (!io_uring) {
+    TEST_CHECK(reader.GetBackend() == FileReaderBackend::ThreadPool);
+  }
+
+  const std::filesystem::path large = dir / "large.bin";
+  const std::filesystem::path empty = dir / "empty.bin";
+  const std::filesystem::path missing = dir / "missing.bin";
+
+  // files without reads complete even when nothing else is in flight
+  const std::vector<ReadResult> missing_only = ReadFiles(reader, {missing});
+  TEST_CHECK(missing_only[0].failed && missing_only[0].data.empty());
+  const std::vector<ReadResult> empty_only = ReadFiles(reader, {empty});
+  TEST_CHECK(!empty_only[0].failed && empty_only[0].data.empty());
+
+  const std::vector<ReadResult> batch =
+      ReadFiles(reader, {large, empty, missing, large});
+  TEST_CHECK(!batch[0].failed && HasContents(batch[0].data, large_size));
+  TEST_CHECK(!batch[1].failed && batch[1].data.empty());
+  TEST_CHECK(batch[2].failed && batch[2].data.empty());
+  TEST_CHECK(!batch[3].failed && HasContents(batch[3].data, large_size));
+}
+}  // namespace
+
+int main() {
+  const std::filesystem::path dir =
+      std::filesystem::temp_directory_path() /
+      fmt::format("vulkan_tutorial_file_reader_test_{}", GetCurrentPid());
+  std::filesystem::create_directories(dir);
+
+  // many chunks and a size that is not a multiple of the direct alignment
+  const size_t large_size = 40 * (1 << 16) + 123;
+  {
+    std::ofstream large(dir / "large.bin", std::ios::binary);
+    for (size_t i = 0; i != large_size; ++i) {
+      large.put(GetByte(i));
+    }
+    std::ofstream empty(dir / "empty.bin", std::ios::binary);
+  }
+
+  for (const bool io_uring : {true, false}) {
+    for (const bool direct : {false, true}) {
+      TestReader(dir, io_uring, direct, large_size);
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::remove_all(dir, error);
+  return GetTestResult();
+}
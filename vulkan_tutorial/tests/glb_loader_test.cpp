@@ -0,0 +1,232 @@
+#include <array>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gltf/glb_loader.hpp"
+#include "process_id.hpp"
+#include "scene/scene_geometry.hpp"
+#include "test_check.hpp"
+
+namespace {
+// parts of a document with one indexed triangle, tests replace one of them
+struct Document {
+  std::string buffer = R"({"byteLength": 44})";
+  std::string position_view = R"({"buffer": 0, "byteLength": 36})";
+  std::string index_view =
+      R"({"buffer": 0, "byteOffset": 36, "byteLength": 6})";
+  std::string position_accessor =
+      R"({"bufferView": 0, "componentType": 5126, "count": 3,
+          "type": "VEC3"})";
+  std::string index_accessor =
+      R"({"bufferView": 1, "componentType": 5123, "count": 3,
+          "type": "SCALAR"})";
+
+  [[nodiscard]] std::string ToJson() const {
+    return fmt::format(
+        R"({{"asset": {{"version": "2.0"}}, "buffers": [{}],
+            "bufferViews": [{}, {}], "accessors": [{}, {}],
+            "meshes": [{{"primitives": [{{"attributes": {{"POSITION": 0}},
+                                          "indices": 1}}]}}]}})",
+        buffer, position_view, index_view, position_accessor, index_accessor);
+  }
+};
+
+constexpr std::array<float, 9> kPositions{0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+                                          0.0f, 0.0f, 1.0f, 0.0f};
+constexpr std::array<ui16, 3> kIndices{0, 1, 2};
+
+void Append(std::vector<ui8>& out, ui32 value) {
+  const auto bytes = reinterpret_cast<const ui8*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+// chunks are padded to four bytes, json with spaces and bin with zeros
+[[nodiscard]] std::vector<ui8> MakeGlb(std::string json,
+                                       std::vector<ui8> bin) {
+  json.resize((json.size() + 3) / 4 * 4, ' ');
+  bin.resize((bin.size() + 3) / 4 * 4, 0);
+
+  std::vector<ui8> glb;
+  Append(glb, 0x46546C67);  // "glTF"
+  Append(glb, 2);
+  Append(glb, static_cast<ui32>(12 + 8 + json.size() + 8 + bin.size()));
+  Append(glb, static_cast<ui32>(json.size()));
+  Append(glb, 0x4E4F534A);  // "JSON"
+  glb.insert(glb.end(), json.begin(), json.end());
+  Append(glb, static_cast<ui32>(bin.size()));
+  Append(glb, 0x004E4942);  // "BIN\0"
+  glb.insert(glb.end(), bin.begin(), bin.end());
+  return glb;
+}
+
+[[nodiscard]] std::vector<ui8> MakeBin() {
+  std::vector<ui8> bin(sizeof(kPositions) + sizeof(kIndices));
+  std::memcpy(bin.data(), kPositions.data(), sizeof(kPositions));
+  std::memcpy(bin.data() + sizeof(kPositions), kIndices.data(),
+              sizeof(kIndices));
+  return bin;
+}
+
+class GlbTest {
+ public:
+  GlbTest()
+      : dir_(std::filesystem::temp_directory_path() /
+             fmt::format("vulkan_tutorial_glb_loader_test_{}",
+                         GetCurrentPid())) {
+    std::filesystem::create_directories(dir_);
+  }
+  GlbTest(const GlbTest&) = delete;
+  GlbTest& operator=(const GlbTest&) = delete;
+  ~GlbTest() {
+    std::error_code error;
+    std::filesystem::remove_all(dir_, error);
+  }
+
+  // loads the file into `geometry`, returns the error message or an empty
+  // string
+  [[nodiscard]] std::string Load(std::span<const ui8> glb,
+                                 SceneGeometry& geometry) const {
+    const std::filesystem::path path = dir_ / "model.glb";
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(glb.data()),
+                 static_cast<std::streamsize>(glb.size()));
+    }
+
+    try {
+      LoadGlbModel(path, geometry);
+      return {};
+    } catch (const std::exception& e) {
+      return e.what();
+    }
+  }
+
+  // whether loading fails with a message that contains `error`
+  [[nodiscard]] bool Fails(std::span<const ui8> glb,
+                           std::string_view error) const {
+    SceneGeometry geometry;
+    const std::string message = Load(glb, geometry);
+    if (message.find(error) == std::string::npos) {
+      spdlog::error("expected error '{}', got '{}'", error, message);
+      return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool Fails(const Document& document,
+                           std::string_view error) const {
+    return Fails(MakeGlb(document.ToJson(), MakeBin()), error);
+  }
+
+ private:
+  std::filesystem::path dir_;
+};
+
+void TestValidFile(const GlbTest& test) {
+  SceneGeometry geometry;
+  TEST_CHECK(test.Load(MakeGlb(Document{}.ToJson(), MakeBin()), geometry)
+                 .empty());
+  TEST_CHECK(geometry.GetMeshes().size() == 1);
+  TEST_CHECK(geometry.GetVertices().size() == 3);
+  TEST_CHECK(geometry.GetIndices() ==
+             std::vector<ui32>(kIndices.begin(), kIndices.end()));
+  if (geometry.GetVertices().size() == 3) {
+    TEST_CHECK(geometry.GetVertices()[1].pos.x == 1.0f);
+    TEST_CHECK(geometry.GetVertices()[2].pos.y == 1.0f);
+  }
+}
+
+// the file cut to `size` bytes, with the length in the header matching
+[[nodiscard]] std::vector<ui8> Cut(std::vector<ui8> glb, size_t size) {
+  glb.resize(size);
+  const auto length = static_cast<ui32>(size);
+  std::memcpy(glb.data() + 8, &length, sizeof(length));
+  return glb;
+}
+
+void TestTruncatedFile(const GlbTest& test) {
+  const std::vector<ui8> glb = MakeGlb(Document{}.ToJson(), MakeBin());
+  // inside of the header, of the json chunk header and of both chunks
+  for (const size_t size : {size_t{0}, size_t{3}, size_t{8}, size_t{11},
+                            size_t{15}, size_t{30}, glb.size() - 4}) {
+    TEST_CHECK(test.Fails(std::span(glb).first(size), "glb file is truncated"));
+  }
+
+  // the header agrees with the file, but a chunk runs past its end
+  TEST_CHECK(test.Fails(Cut(glb, 30), "glb chunk is truncated"));
+  TEST_CHECK(test.Fails(Cut(glb, glb.size() - 4), "glb chunk is truncated"));
+  TEST_CHECK(test.Fails(Cut(glb, 15), "glb file is truncated"));
+
+  // a chunk length that would wrap around the end of the file
+  std::vector<ui8> huge_chunk = glb;
+  const ui32 length = 0xFFFFFFFF;
+  std::memcpy(huge_chunk.data() + 12, &length, sizeof(length));
+  TEST_CHECK(test.Fails(huge_chunk, "glb chunk is truncated"));
+
+  std::vector<ui8> bad_magic = glb;
+  bad_magic[0] = 'x';
+  TEST_CHECK(test.Fails(bad_magic, "not a glTF 2.0 binary file"));
+}
+
+void TestBadRanges(const GlbTest& test) {
+  // buffer views past the bin chunk, the last one wraps around in 64 bits
+  for (const std::string_view view :
+       {R"({"buffer": 0, "byteLength": 45})",
+        R"({"buffer": 0, "byteOffset": 48, "byteLength": 1})",
+        R"({"buffer": 0, "byteOffset": 9007199254740992,
+            "byteLength": 9007199254740992})"}) {
+    Document document;
+    document.position_view = view;
+    TEST_CHECK(test.Fails(document, "buffer view 0 is out of the buffer"));
+  }
+
+  // accessors past their view: one element too many, an offset past the
+  // view, a count whose byte size overflows and a stride under the element
+  for (const std::string_view accessor :
+       {R"({"bufferView": 0, "componentType": 5126, "count": 4,
+            "type": "VEC3"})",
+        R"({"bufferView": 0, "byteOffset": 40, "componentType": 5126,
+            "count": 1, "type": "VEC3"})",
+        R"({"bufferView": 0, "byteOffset": 4, "componentType": 5126,
+            "count": 3, "type": "VEC3"})",
+        R"({"bufferView": 0, "componentType": 5126,
+            "count": 9007199254740992, "type": "VEC3"})"}) {
+    Document document;
+    document.position_accessor = accessor;
+    TEST_CHECK(test.Fails(document, "accessor 0 is out of its buffer view"));
+  }
+
+  Document stride;
+  stride.position_view = R"({"buffer": 0, "byteLength": 36, "byteStride": 4})";
+  TEST_CHECK(test.Fails(stride, "accessor 0 is out of its buffer view"));
+
+  Document index_view;
+  index_view.index_view = R"({"buffer": 0, "byteOffset": 36, "byteLength": 4})";
+  TEST_CHECK(test.Fails(index_view, "accessor 1 is out of its buffer view"));
+
+  // indices have to stay inside of the mesh
+  std::vector<ui8> bin = MakeBin();
+  bin[sizeof(kPositions) + 2 * sizeof(ui16)] = 3;
+  TEST_CHECK(test.Fails(MakeGlb(Document{}.ToJson(), bin),
+                        "index 3 is out of 3 vertices"));
+
+  Document external;
+  external.buffer = R"({"byteLength": 44, "uri": "model.bin"})";
+  TEST_CHECK(test.Fails(external, "only the embedded glb buffer"));
+}
+}  // namespace
+
+int main() {
+  const GlbTest test;
+  TestValidFile(test);
+  TestTruncatedFile(test);
+  TestBadRanges(test);
+  return GetTestResult();
+}
@@ -0,0 +1,115 @@
+#include <exception>
+#include <string>
+#include <string_view>
+
+#include "json/json.hpp"
+#include "test_check.hpp"
+
+namespace {
+[[nodiscard]] bool Parses(std::string_view text) {
+  try {
+    (void)ParseJson(text);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+template <typename Access>
+[[nodiscard]] bool Throws(Access&& access) {
+  try {
+    access();
+  } catch (const std::exception&) {
+    return true;
+  }
+  return false;
+}
+
+void TestValues() {
+  const JsonValue document = ParseJson(
+      R"( {"a": [1, -2.5e2, 0, true, false, null], "b": {"c": "d\n\u00e9"}} )");
+  const JsonValue& a = document["a"];
+  TEST_CHECK(a.AsArray().size() == 6);
+  TEST_CHECK(a[0].AsUnsigned() == 1);
+  TEST_CHECK(a[1].AsNumber() == -250.0);
+  TEST_CHECK(a[3].AsBool() && !a[4].AsBool() && a[5].IsNull());
+  TEST_CHECK(document["b"]["c"].AsString() == "d\n\xc3\xa9");
+  TEST_CHECK(document.GetUnsigned("missing", 7) == 7);
+  TEST_CHECK(!document.Find("missing"));
+
+  // a character outside of the basic plane is a surrogate pair
+  TEST_CHECK(ParseJson(R"("\ud83d\ude00")").AsString() ==
+             "\xf0\x9f\x98\x80");
+
+  // accessors throw on other types and missing members
+  TEST_CHECK(Throws([&] { (void)a[0].AsString(); }));
+  TEST_CHECK(Throws([&] { (void)a[1].AsUnsigned(); }));
+  TEST_CHECK(Throws([&] { (void)a[6]; }));
+  TEST_CHECK(Throws([&] { (void)document["missing"]; }));
+  TEST_CHECK(Throws([&] { (void)a.Find("a"); }));
+}
+
+void TestDepth() {
+  // the limit is 256 nested values
+  auto nested = [](size_t depth) {
+    return std::string(depth, '[') + std::string(depth, ']');
+  };
+  TEST_CHECK(Parses(nested(256)));
+  TEST_CHECK(!Parses(nested(257)));
+  // deep enough to overflow the stack without the limit
+  TEST_CHECK(!Parses(nested(1 << 20)));
+
+  std::string objects;
+  for (int i = 0; i != 300; ++i) {
+    objects += "{\"a\":";
+  }
+  TEST_CHECK(!Parses(objects + "1" + std::string(300, '}')));
+}
+
+void TestMalformed() {
+  for (const std::string_view text :
+       {"", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[1 2]", "tru", "nul",
+        "[1] 2", "\"unterminated", "{1: 2}"}) {
+    if (Parses(text)) {
+      spdlog::error("malformed document parsed: {}", text);
+      TEST_CHECK(false);
+    }
+  }
+
+  // escapes
+  for (const std::string_view text :
+       {R"("\x")", R"("\u12")", R"("\u12g4")", "\"\\", R"("\ud800A")",
+        R"("\udc00")", R"("\ud800")", R"("\ud800x")"}) {
+    if (Parses(text)) {
+      spdlog::error("bad escape parsed: {}", text);
+      TEST_CHECK(false);
+    }
+  }
+  TEST_CHECK(ParseJson(R"("\"\\\/\b\f\n\r\t")").AsString() ==
+             "\"\\/\b\f\n\r\t");
+
+  // numbers
+  for (const std::string_view text :
+       {"-", "+1", ".5", "1.", "01", "1e", "1e+", "--1", "1.2.3", "0x10",
+        "inf", "NaN", "1e999", "-1e999"}) {
+    if (Parses(text)) {
+      spdlog::error("bad number parsed: {}", text);
+      TEST_CHECK(false);
+    }
+  }
+  for (const std::string_view text : {"0", "-0", "12", "1.5", "1e5", "1E+5",
+                                      "2.5e-3", "-0.0"}) {
+    if (!Parses(text)) {
+      spdlog::error("number was not parsed: {}", text);
+      TEST_CHECK(false);
+    }
+  }
+}
+}  // namespace
+
+int main() {
+  TestValues();
+  TestDepth();
+  TestMalformed();
+  return GetTestResult();
+}
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "compression/compressed_blocks.hpp"
+#include "compression/lz4.hpp"
+#include "test_check.hpp"
+#include "threading/thread_pool.hpp"
+
+namespace {
+[[nodiscard]] std::vector<ui8> Compress(std::span<const ui8> data) {
+  std::vector<ui8> compressed(GetLz4CompressBound(data.size()));
+  compressed.resize(Lz4Compress(data, compressed));
+  return compressed;
+}
+
+// false when decoding throws
+[[nodiscard]] bool Decompress(std::span<const ui8> compressed,
+                              std::span<ui8> out) {
+  try {
+    Lz4Decompress(compressed, out);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+[[nodiscard]] bool RoundTrips(std::span<const ui8> data) {
+  const std::vector<ui8> compressed = Compress(data);
+  std::vector<ui8> out(data.size());
+  return Decompress(compressed, out) && std::ranges::equal(out, data);
+}
+
+[[nodiscard]] std::vector<ui8> MakeRandom(size_t size) {
+  std::mt19937 random(size);
+  std::vector<ui8> data(size);
+  for (ui8& value : data) {
+    value = static_cast<ui8>(random());
+  }
+  return data;
+}
+
+// runs of repeated bytes between random ones, compressible but not trivial
+[[nodiscard]] std::vector<ui8> MakeMixed(size_t size) {
+  std::mt19937 random(static_cast<ui32>(size) + 1);
+  std::vector<ui8> data;
+  while (data.size() < size) {
+    const size_t run = std::min<size_t>(random() % 64, size - data.size());
+    data.insert(data.end(), run, static_cast<ui8>(random() % 4));
+    data.push_back(static_cast<ui8>(random()));
+  }
+  data.resize(size);
+  return data;
+}
+
+void TestRoundTrips() {
+  TEST_CHECK(RoundTrips({}));
+
+  // inputs around the sizes that have room for a match
+  for (size_t size = 1; size != 40; ++size) {
+    TEST_CHECK(RoundTrips(MakeRandom(size)));
+    TEST_CHECK(RoundTrips(std::vector<ui8>(size, 7)));
+  }
+
+  const std::vector<ui8> random = MakeRandom(1 << 20);
+  const std::vector<ui8> compressed_random = Compress(random);
+  TEST_CHECK(compressed_random.size() <= GetLz4CompressBound(random.size()));
+  TEST_CHECK(RoundTrips(random));
+
+  // literal and match lengths that continue in many bytes
+  const std::vector<ui8> zeros(1 << 20, 0);
+  TEST_CHECK(Compress(zeros).size() < zeros.size() / 100);
+  TEST_CHECK(RoundTrips(zeros));
+  TEST_CHECK(RoundTrips(MakeMixed(1 << 20)));
+
+  // matches are limited to 64 KiB back
+  std::vector<ui8> far = MakeRandom(1 << 17);
+  far.insert(far.end(), far.begin(), far.end());
+  TEST_CHECK(RoundTrips(far));
+
+  std::vector<ui8> small(8);
+  TEST_CHECK(!Decompress(Compress(zeros), small));
+  bool threw = false;
+  try {
+    (void)Lz4Compress(zeros, small);
+  } catch (const std::exception&) {
+    threw = true;
+  }
+  TEST_CHECK(threw);
+}
+
+// Literals of one period followed by a match `offset` back that is longer
+// than the offset, so it reads bytes the match itself writes
+void TestOverlappingMatches() {
+  for (size_t offset = 1; offset != 8; ++offset) {
+    for (const size_t length : {size_t{4}, size_t{18}, size_t{300}}) {
+      std::vector<ui8> expected(offset + length);
+      for (size_t i = 0; i != expected.size(); ++i) {
+        expected[i] = static_cast<ui8>('a' + i % offset);
+      }
+
+      std::vector<ui8> block;
+      const size_t extra = length - 4;
+      block.push_back(
+          static_cast<ui8>(offset << 4 | std::min<size_t>(extra, 15)));
+      block.insert(block.end(), expected.begin(),
+                   expected.begin() + static_cast<ptrdiff_t>(offset));
+      block.push_back(static_cast<ui8>(offset));
+      block.push_back(0);
+      if (extra >= 15) {
+        size_t rest = extra - 15;
+        for (; rest >= 255; rest -= 255) {
+          block.push_back(255);
+        }
+        block.push_back(static_cast<ui8>(rest));
+      }
+      // the last sequence has only literals, here none
+      block.push_back(0);
+
+      std::vector<ui8> out(expected.size());
+      TEST_CHECK(Decompress(block, out) && out == expected);
+      TEST_CHECK(RoundTrips(expected));
+    }
+  }
+}
+
+void TestMalformedInput() {
+  const std::vector<ui8> data = MakeMixed(1 << 16);
+  const std::vector<ui8> compressed = Compress(data);
+  std::vector<ui8> out(data.size());
+
+  // every prefix is rejected, a sanitized build catches reads past its end
+  for (size_t size = 0; size != compressed.size(); ++size) {
+    const std::vector<ui8> prefix(
+        compressed.begin(), compressed.begin() + static_cast<ptrdiff_t>(size));
+    if (Decompress(prefix, out)) {
+      spdlog::error("prefix of {} bytes was decoded", size);
+      TEST_CHECK(false);
+      break;
+    }
+  }
+
+  // output of another size
+  std::vector<ui8> larger(data.size() + 1);
+  TEST_CHECK(!Decompress(compressed, larger));
+  std::vector<ui8> smaller(data.size() - 1);
+  TEST_CHECK(!Decompress(compressed, smaller));
+
+  // four literals and a match at offset zero or before the output
+  for (const ui8 offset : {ui8{0}, ui8{5}}) {
+    const std::vector<ui8> block{0x40, 1, 2, 3, 4, offset, 0, 0x00};
+    std::vector<ui8> block_out(8);
+    TEST_CHECK(!Decompress(block, block_out));
+  }
+
+  // more literals than the input has
+  const std::vector<ui8> literals{0xf0, 200, 1, 2, 3};
+  std::vector<ui8> literals_out(215);
+  TEST_CHECK(!Decompress(literals, literals_out));
+  // a length that never ends
+  const std::vector<ui8> length{0xf0, 255, 255};
+  TEST_CHECK(!Decompress(length, literals_out));
+}
+
+[[nodiscard]] bool DecompressBlocks(const CompressedBlocks& blocks,
+                                    ui64 offset, std::span<ui8> out,
+                                    ThreadPool* thread_pool) {
+  try {
+    blocks.Decompress(offset, out, thread_pool);
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+void TestBlocks() {
+  constexpr ui32 kBlockSize = 4096;
+  // random blocks are stored as they are, the others are compressed
+  std::vector<ui8> data = MakeMixed(kBlockSize * 40 + 123);
+  const std::vector<ui8> random = MakeRandom(kBlockSize * 2);
+  std::ranges::copy(random, data.begin() + kBlockSize * 10);
+
+  std::vector<ui8> stored;
+  CompressBlocks(data, stored, kBlockSize);
+  const CompressedBlocks blocks(stored);
+  TEST_CHECK(blocks.GetRawSize() == data.size());
+  TEST_CHECK(blocks.GetStoredSize() == stored.size());
+  TEST_CHECK(blocks.GetStoredSize() < data.size());
+
+  ThreadPool thread_pool(4);
+  for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+    std::vector<ui8> out(data.size());
+    TEST_CHECK(DecompressBlocks(blocks, 0, out, pool) && out == data);
+
+    // ranges that start and end inside blocks
+    const size_t offset = kBlockSize * 3 + 17;
+    std::vector<ui8> range(kBlockSize * 9 + 5);
+    TEST_CHECK(DecompressBlocks(blocks, offset, range, pool) &&
+               std::ranges::equal(
+                   range, std::span(data).subspan(offset, range.size())));
+
+    std::vector<ui8> outside(2);
+    TEST_CHECK(!DecompressBlocks(blocks, data.size() - 1, outside, pool));
+  }
+
+  std::vector<ui8> empty_stored;
+  CompressBlocks({}, empty_stored, kBlockSize);
+  const CompressedBlocks empty(empty_stored);
+  TEST_CHECK(empty.GetRawSize() == 0);
+  TEST_CHECK(DecompressBlocks(empty, 0, {}, &thread_pool));
+
+  // truncated streams are rejected when the table is read
+  for (const size_t size : {size_t{0}, size_t{10}, stored.size() / 2,
+                            stored.size() - 1}) {
+    bool threw = false;
+    try {
+      const CompressedBlocks truncated{std::span(stored).first(size)};
+    } catch (const std::exception&) {
+      threw = true;
+    }
+    TEST_CHECK(threw);
+  }
+
+  // a broken block fails the parallel decode instead of being skipped: the
+  // header has the raw size, block size and number of blocks, then the table
+  constexpr size_t kHeaderSize = sizeof(ui64) + 2 * sizeof(ui32);
+  ui32 first_stored_size = 0;
+  std::memcpy(&first_stored_size, stored.data() + kHeaderSize,
+              sizeof(first_stored_size));
+  TEST_CHECK((first_stored_size >> 31) != 0);
+  std::vector<ui8> broken = stored;
+  const size_t num_blocks = (data.size() + kBlockSize - 1) / kBlockSize;
+  std::fill_n(broken.begin() +
+                  static_cast<ptrdiff_t>(kHeaderSize +
+                                         num_blocks * sizeof(ui32)),
+              first_stored_size & ~(ui32{1} << 31), ui8{0xff});
+  const CompressedBlocks broken_blocks(broken);
+  std::vector<ui8> out(data.size());
+  TEST_CHECK(!DecompressBlocks(broken_blocks, 0, out, &thread_pool));
+}
+}  // namespace
+
+int main() {
+  TestRoundTrips();
+  TestOverlappingMatches();
+  TestMalformedInput();
+  TestBlocks();
+  return GetTestResult();
+}
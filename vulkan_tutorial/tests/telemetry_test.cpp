@@ -0,0 +1,150 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "fmt/format.h"
+#include "physical_device_info.hpp"
+#include "profiling/frame_stats.hpp"
+#include "telemetry/renderer_telemetry.hpp"
+#include "test_check.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+void CloseSocket(SocketHandle socket) { closesocket(socket); }
+using IoSize = int;
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+void CloseSocket(SocketHandle socket) { close(socket); }
+using IoSize = size_t;
+#endif
+
+// Returns the whole response, the server closes the connection after it.
+// Empty if the server can't be reached
+std::string Fetch(ui16 port, std::string_view path) {
+  const SocketHandle client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (client == kInvalidSocket) {
+    return {};
+  }
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(client, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    CloseSocket(client);
+    return {};
+  }
+
+  const std::string request = fmt::format(
+      "GET {} HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n",
+      path);
+  std::string response;
+  const auto sent =
+      send(client, request.data(), static_cast<IoSize>(request.size()), 0);
+  if (sent >= 0 && static_cast<size_t>(sent) == request.size()) {
+    char buffer[1024];
+    while (true) {
+      const auto received =
+          recv(client, buffer, static_cast<IoSize>(sizeof(buffer)), 0);
+      if (received <= 0) {
+        break;
+      }
+      response.append(buffer, static_cast<size_t>(received));
+    }
+  }
+
+  CloseSocket(client);
+  return response;
+}
+
+bool Contains(std::string_view text, std::string_view line) {
+  return text.find(line) != std::string_view::npos;
+}
+
+void TestGpuTimeIsPublishedOnce() {
+  FrameStatsSettings settings;
+  settings.log_interval = std::chrono::nanoseconds(0);
+  FrameStats frame_stats(settings);
+
+  frame_stats.BeginFrame();
+  frame_stats.EndFrame();
+  TEST_CHECK(std::isnan(frame_stats.GetLastFrame()[static_cast<size_t>(
+      FrameMetric::Gpu)]));
+
+  frame_stats.BeginFrame();
+  frame_stats.AddGpuTime(std::chrono::milliseconds(4));
+  frame_stats.EndFrame();
+  TEST_CHECK(frame_stats.GetLastFrame()[static_cast<size_t>(
+                 FrameMetric::Gpu)] == 4.0);
+
+  // the sample of the previous frame is not repeated
+  frame_stats.BeginFrame();
+  frame_stats.EndFrame();
+  TEST_CHECK(std::isnan(frame_stats.GetLastFrame()[static_cast<size_t>(
+      FrameMetric::Gpu)]));
+  TEST_CHECK(frame_stats.GetSummary(FrameMetric::Gpu).num_samples == 1);
+}
+
+void TestExporter() {
+  PhysicalDeviceInfo device_info{};
+  device_info.memory_properties.memoryHeapCount = 0;
+  RendererTelemetry telemetry(0, device_info, false);
+
+  FrameStatsSettings settings;
+  settings.log_interval = std::chrono::nanoseconds(0);
+  FrameStats frame_stats(settings);
+  for (int frame = 0; frame != 3; ++frame) {
+    frame_stats.BeginFrame();
+    if (frame == 1) {
+      frame_stats.AddGpuTime(std::chrono::milliseconds(2));
+    }
+    frame_stats.EndFrame();
+    telemetry.PublishFrame(frame_stats);
+  }
+  telemetry.PublishQueues(2, 1);
+
+  const std::string response = Fetch(telemetry.GetPort(), "/metrics");
+  TEST_CHECK(response.starts_with("HTTP/1.1 200 OK\r\n"));
+  TEST_CHECK(
+      Contains(response, "# TYPE vulkan_tutorial_frame_time_ms summary\n"));
+  TEST_CHECK(Contains(response,
+                      "vulkan_tutorial_frame_time_ms{part=\"gpu\","
+                      "quantile=\"0.5\"} 2\n"));
+  TEST_CHECK(Contains(response,
+                      "vulkan_tutorial_frame_time_ms_sum{part=\"gpu\"} 2\n"));
+  TEST_CHECK(Contains(response,
+                      "vulkan_tutorial_frame_time_ms_count{part=\"gpu\"} 1\n"));
+  TEST_CHECK(Contains(
+      response, "vulkan_tutorial_frame_time_ms_count{part=\"frame\"} 3\n"));
+  // help and type are written once per family
+  TEST_CHECK(response.find("# TYPE vulkan_tutorial_frame_time_ms ") ==
+             response.rfind("# TYPE vulkan_tutorial_frame_time_ms "));
+  TEST_CHECK(Contains(response, "# TYPE vulkan_tutorial_frames_total counter\n"
+                                "vulkan_tutorial_frames_total 3\n"));
+  TEST_CHECK(Contains(response, "vulkan_tutorial_readback_queue_depth 2\n"));
+
+  TEST_CHECK(Fetch(telemetry.GetPort(), "/other")
+                 .starts_with("HTTP/1.1 404 Not Found\r\n"));
+}
+}  // namespace
+
+int main() {
+  TestGpuTimeIsPublishedOnce();
+  TestExporter();
+  return GetTestResult();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+
+#include "spdlog/spdlog.h"
+
+// Tests are plain executables registered with CTest. A failed check is
+// logged and the test keeps running, main returns `GetTestResult()`
+inline int num_failed_checks = 0;
+
+inline void CheckImpl(bool condition, std::string_view expression,
+                      std::string_view file, int line) {
+  if (!condition) {
+    ++num_failed_checks;
+    spdlog::error("{}:{}: check failed: {}", file, line, expression);
+  }
+}
+
+#define TEST_CHECK(condition) \
+  CheckImpl(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+// CTest reports a test that returns it as skipped, e.g. without a device
+constexpr int kSkipTestResult = 77;
+
+[[nodiscard]] inline int GetTestResult() noexcept {
+  return num_failed_checks == 0 ? 0 : 1;
+}